@@ -0,0 +1,126 @@
+import argparse
+import json
+import re
+import struct
+import sys
+
+# Decodes the binary log records written when LOG_BINARY is defined (see include/log_binary.h).
+# The string table is generated at build time by log_strings.py.
+#
+# Usage:
+#   python decode_logs.py capture.bin
+#   python decode_logs.py --port /dev/ttyUSB0
+
+SYNC = 0xA5
+HEADER_SIZE = 11
+LEVELS = ["D", "I", "W", "E"]
+
+printf_regex = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXeEfgGcsp%])")
+
+
+def to_python_format(fmt):
+    # Python's % operator understands everything but the length modifiers and %p
+    def replace(match):
+        flags, _, conversion = match.groups()
+        if conversion == "p":
+            return "0x%" + flags + "x"
+        return "%" + flags + conversion
+
+    return printf_regex.sub(replace, fmt)
+
+
+def parse_args(payload):
+    args = []
+    i = 0
+    while i < len(payload):
+        tag = chr(payload[i])
+        i += 1
+        if tag == "i":
+            args.append(struct.unpack_from("<i", payload, i)[0])
+            i += 4
+        elif tag == "u":
+            args.append(struct.unpack_from("<I", payload, i)[0])
+            i += 4
+        elif tag == "I":
+            args.append(struct.unpack_from("<q", payload, i)[0])
+            i += 8
+        elif tag == "U":
+            args.append(struct.unpack_from("<Q", payload, i)[0])
+            i += 8
+        elif tag == "d":
+            args.append(struct.unpack_from("<d", payload, i)[0])
+            i += 8
+        elif tag == "s":
+            length = payload[i]
+            args.append(payload[i + 1:i + 1 + length].decode("utf-8", "replace"))
+            i += 1 + length
+        else:
+            raise ValueError(f"Unknown argument tag {tag!r}")
+    return args
+
+
+def decode(data, table):
+    """Decodes the records of [data]. Bytes that don't belong to a record, such as boot messages, are skipped.
+    Returns the decoded lines, and the offset of the first incomplete record, if any."""
+    formats = table["formats"]
+    modules = table["modules"]
+    lines = []
+    i = 0
+    while i + HEADER_SIZE <= len(data):
+        if data[i] != SYNC:
+            i += 1
+            continue
+        length = data[i + 1]
+        end = i + 2 + length
+        timestamp, format_id, level_module = struct.unpack_from("<IIB", data, i + 2)
+        fmt = formats.get(str(format_id))
+        if fmt is None or length < HEADER_SIZE - 2:
+            i += 1
+            continue
+        if end > len(data):
+            break
+        try:
+            args = parse_args(data[i + HEADER_SIZE:end])
+            text = to_python_format(fmt) % tuple(args)
+        except (ValueError, TypeError, IndexError, struct.error) as e:
+            text = f"{fmt} <undecodable arguments: {e}>"
+        level = level_module >> 4
+        module = level_module & 0x0F
+        level_name = LEVELS[level] if level < len(LEVELS) else "?"
+        module_name = modules[module] if module < len(modules) else str(module)
+        lines.append(f"[{timestamp / 1000:10.3f}] {level_name} {module_name}: {text}")
+        i = end
+    return lines, min(i, len(data))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes binary log records.")
+    parser.add_argument("input", nargs="?", help="A file with the captured records. Reads stdin if missing.")
+    parser.add_argument("--port", help="Read the records live from a serial port (requires pyserial).")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--strings", default="log_strings.json", help="The table generated by log_strings.py.")
+    args = parser.parse_args()
+
+    with open(args.strings, "r") as stream:
+        table = json.load(stream)
+
+    if args.port:
+        import serial
+
+        pending = b""
+        with serial.Serial(args.port, args.baud, timeout=0.5) as port:
+            while True:
+                pending += port.read(4096)
+                lines, consumed = decode(pending, table)
+                for line in lines:
+                    print(line, flush=True)
+                pending = pending[consumed:]
+    else:
+        data = open(args.input, "rb").read() if args.input else sys.stdin.buffer.read()
+        lines, _ = decode(data, table)
+        for line in lines:
+            print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,207 @@
+import os
+import re
+
+# Generates include/glyph_atlas.h, the glyphs of enum Glyph in include/layout.h rasterized from a SMuFL font at every
+# staff space configured. The bitmaps are run-length encoded with 4 bits of coverage, see GlyphBitmap in glyphs.h.
+# Without the font, or without freetype-py, an empty atlas is generated and the glyphs are drawn from shapes.
+#
+# With the font "stand-in", the glyphs are ellipses computed without freetype, which test/bench_glyphs computes too for
+# checking the encoder and the blitters. Its atlas is generated with:
+#   GLYPH_FONT=stand-in GLYPH_STAFF_SPACES="8 11" GLYPH_ATLAS_OUTPUT=test/bench_glyphs/glyph_atlas_stand_in.h python glyph_atlas.py
+
+STAND_IN = "stand-in"
+
+layout_h = "./include/layout.h"
+target_h = os.environ.get("GLYPH_ATLAS_OUTPUT", "./include/glyph_atlas.h")
+
+try:
+    Import("env")
+    font_path = env.GetProjectOption("custom_glyph_font", "fonts/Bravura.otf")
+    staff_spaces = env.GetProjectOption("custom_glyph_staff_spaces", "8")
+except NameError:
+    font_path = os.environ.get("GLYPH_FONT", "fonts/Bravura.otf")
+    staff_spaces = os.environ.get("GLYPH_STAFF_SPACES", "8")
+staff_spaces = [int(space) for space in staff_spaces.replace(",", " ").split()]
+
+# SMuFL code points of the glyphs of the atlas. Lines, whose length depends on the layout, are drawn as lines.
+smufl = {
+    "GLYPH_CLEF_G": 0xE050,
+    "GLYPH_CLEF_F": 0xE062,
+    "GLYPH_CLEF_C": 0xE05C,
+    "GLYPH_SHARP": 0xE262,
+    "GLYPH_FLAT": 0xE260,
+    "GLYPH_NATURAL": 0xE261,
+    "GLYPH_DOUBLE_SHARP": 0xE263,
+    "GLYPH_DOUBLE_FLAT": 0xE264,
+    "GLYPH_NOTEHEAD_WHOLE": 0xE0A2,
+    "GLYPH_NOTEHEAD_HALF": 0xE0A3,
+    "GLYPH_NOTEHEAD_BLACK": 0xE0A4,
+    "GLYPH_FLAG_8TH_UP": 0xE240,
+    "GLYPH_FLAG_8TH_DOWN": 0xE241,
+    "GLYPH_FLAG_16TH_UP": 0xE242,
+    "GLYPH_FLAG_16TH_DOWN": 0xE243,
+    "GLYPH_FLAG_32ND_UP": 0xE244,
+    "GLYPH_FLAG_32ND_DOWN": 0xE245,
+    "GLYPH_REST_WHOLE": 0xE4E3,
+    "GLYPH_REST_HALF": 0xE4E4,
+    "GLYPH_REST_QUARTER": 0xE4E5,
+    "GLYPH_REST_8TH": 0xE4E6,
+    "GLYPH_REST_16TH": 0xE4E7,
+    "GLYPH_REST_32ND": 0xE4E8,
+    "GLYPH_DOT": 0xE1E7,
+}
+for digit in range(10):
+    smufl[f"GLYPH_TIME_{digit}"] = 0xE080 + digit
+
+
+def glyph_names():
+    """The names of enum Glyph, by value, without GLYPH_COUNT."""
+    with open(layout_h, "r") as stream:
+        body = re.search(r"enum Glyph\s*:\s*\w+\s*\{([^}]*)\}", stream.read()).group(1)
+    names = []
+    for entry in body.replace("\n", " ").split(","):
+        entry = entry.strip()
+        if not entry or entry == "GLYPH_COUNT":
+            continue
+        match = re.match(r"(\w+)\s*=\s*(\w+)\s*\+\s*(\d+)", entry)
+        if match:
+            # Values skipped by an assignment take the name of the base with their offset, as GLYPH_TIME_1
+            base = names.index(match.group(2))
+            prefix = match.group(2).rstrip("0123456789")
+            while len(names) < base + int(match.group(3)):
+                names.append(f"{prefix}{len(names) - base}")
+            entry = match.group(1)
+        names.append(entry)
+    return names
+
+
+def rasterize(face, code_point, space):
+    """Renders [code_point] for [space] pixels between staff lines. Gives the bitmap as rows of 4-bit coverage, and
+    its position from the origin of the glyph, in pixels to the right and down."""
+    import freetype
+
+    # The em of SMuFL fonts is 4 staff spaces
+    face.set_pixel_sizes(0, 4 * space)
+    face.load_char(chr(code_point), freetype.FT_LOAD_RENDER)
+    bitmap = face.glyph.bitmap
+    rows = []
+    for y in range(bitmap.rows):
+        line = bitmap.buffer[y * bitmap.pitch : y * bitmap.pitch + bitmap.width]
+        rows.append([(value * 15 + 127) // 255 for value in line])
+    return rows, face.glyph.bitmap_left, -face.glyph.bitmap_top
+
+
+def rasterize_stand_in(index, space):
+    """Renders an ellipse for the glyph [index], of a size of its own, with its origin in the center. The coverage of
+    every pixel is the amount of its 4x4 samples inside, in eighths of a pixel so integers are enough."""
+    width = space + index % 4 * space // 2
+    height = space + index % 3 * space // 2
+    rx, ry = 4 * width, 4 * height
+    rows = []
+    for y in range(height):
+        row = []
+        for x in range(width):
+            inside = 0
+            for sy in range(4):
+                for sx in range(4):
+                    dx = 8 * x + 2 * sx + 1 - rx
+                    dy = 8 * y + 2 * sy + 1 - ry
+                    inside += dx * dx * ry * ry + dy * dy * rx * rx <= rx * rx * ry * ry
+            row.append(inside * 15 // 16)
+        rows.append(row)
+    return rows, -(width // 2), -(height // 2)
+
+
+def encode(rows):
+    """Run-length encodes [rows]: every byte has the coverage in the high nibble, and the length of the run minus 1 in
+    the low one. Runs continue into the next row."""
+    runs = []
+    level, length = None, 0
+    for row in rows:
+        for value in row:
+            if value == level and length < 16:
+                length += 1
+                continue
+            if level is not None:
+                runs.append((level << 4) | (length - 1))
+            level, length = value, 1
+    if level is not None:
+        runs.append((level << 4) | (length - 1))
+    return runs
+
+
+def load_face():
+    if font_path == STAND_IN:
+        return STAND_IN
+    if not os.path.exists(font_path):
+        print(f"⚠️ No SMuFL font at {font_path}, glyphs are drawn from shapes.")
+        return None
+    try:
+        import freetype
+    except ImportError:
+        print("⚠️ freetype-py is not installed, glyphs are drawn from shapes.")
+        return None
+    return freetype.Face(font_path)
+
+
+names = glyph_names()
+face = load_face()
+if face is None:
+    staff_spaces = []
+
+runs = []
+bitmaps = []
+for space in staff_spaces:
+    entries = []
+    for name in names:
+        if name not in smufl:
+            entries.append("{0, 0, 0, 0, 0, 0}")
+            continue
+        if face == STAND_IN:
+            rows, left, top = rasterize_stand_in(names.index(name), space)
+        else:
+            rows, left, top = rasterize(face, smufl[name], space)
+        encoded = encode(rows)
+        width = len(rows[0]) if rows else 0
+        entries.append(f"{{{len(runs)}, {len(encoded)}, {width}, {len(rows)}, {left}, {top}}}")
+        runs.extend(encoded)
+    bitmaps.append(entries)
+
+f = open(target_h, "w")
+f.write("/**\n")
+f.write(" * @file glyph_atlas.h\n")
+f.write(" * @author Arnau Mora (arnyminer.z@gmail.com)\n")
+f.write(" * @brief This file was automatically generated by glyph_atlas.py")
+f.write(f" from {os.path.basename(font_path)}\n" if face else ", without a font\n")
+f.write(" * \n")
+f.write(" * @copyright Copyright (c) 2022\n")
+f.write(" * \n")
+f.write(" */\n")
+f.write("\n")
+f.write("#ifndef GLYPH_ATLAS_H\n")
+f.write("#define GLYPH_ATLAS_H\n")
+f.write("\n")
+f.write(f"static_assert(GLYPH_COUNT == {len(names)}, \"enum Glyph changed, run glyph_atlas.py again\");\n")
+f.write("\n")
+f.write(f"#define GLYPH_ATLAS_SIZES {len(staff_spaces)}\n")
+f.write("\n")
+# Arrays can't be empty, the atlas without sizes has a placeholder
+f.write(f"constexpr uint8_t glyphAtlasSpaces[] = {{{', '.join(str(space) for space in staff_spaces) or '0'}}};\n")
+f.write("\n")
+f.write(f"constexpr GlyphBitmap glyphAtlasBitmaps[][GLYPH_COUNT] = {{\n")
+for entries in bitmaps or [["{0, 0, 0, 0, 0, 0}"] * len(names)]:
+    f.write("    {\n")
+    for i in range(0, len(entries), 4):
+        f.write("        " + ", ".join(entries[i : i + 4]) + ",\n")
+    f.write("    },\n")
+f.write("};\n")
+f.write("\n")
+f.write("constexpr uint8_t glyphAtlasRuns[] = {\n")
+for i in range(0, max(len(runs), 1), 16):
+    f.write("    " + ", ".join(f"0x{run:02x}" for run in (runs[i : i + 16] or [0])) + ",\n")
+f.write("};\n")
+f.write("\n")
+f.write("#endif\n")
+f.close()
+
+print(f"🎼 Generated {sum(1 for entries in bitmaps for e in entries if e != '{0, 0, 0, 0, 0, 0}')} glyph bitmaps, {len(runs)} bytes.")
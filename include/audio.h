@@ -0,0 +1,40 @@
+/**
+ * @file audio.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Sources of audio for the score follower, so it doesn't depend on where the samples come from. See
+ * audio_i2s.h for the microphone of the device, and audio_wav.h for recordings.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+// Include libraries
+#include <Arduino.h>
+
+/**
+ * @brief A stream of mono 16-bit samples.
+ */
+class AudioSource
+{
+public:
+    virtual ~AudioSource() {}
+
+    /**
+     * @brief The samples per second of the stream.
+     */
+    virtual uint32_t sampleRate() = 0;
+
+    /**
+     * @brief Reads up to [count] samples into [samples], waiting for them when they come in real time.
+     *
+     * @return size_t The amount of samples read. 0 at the end of the stream.
+     */
+    virtual size_t read(int16_t *samples, size_t count) = 0;
+};
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file audio_i2s.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Reads the audio of an I2S MEMS microphone, as the INMP441, through the I2S driver of ESP-IDF. The samples
+ * come through DMA, so reading only waits for a buffer to be filled.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef AUDIO_I2S_H
+#define AUDIO_I2S_H
+
+// Include libraries
+#include <Arduino.h>
+#include <driver/i2s.h>
+
+// Include utils files
+#include "audio.h"
+#include "logger.h"
+
+#define AUDIO_I2S_PORT I2S_NUM_0
+#define AUDIO_I2S_SCK_PIN 14
+#define AUDIO_I2S_WS_PIN 15
+#define AUDIO_I2S_SD_PIN 34
+
+/**
+ * @brief The DMA buffers of the driver. They hold 64 ms at 16 kHz, enough for the follower to be late a frame.
+ */
+#define AUDIO_I2S_DMA_BUFFERS 4
+#define AUDIO_I2S_DMA_LENGTH 256
+
+/**
+ * @brief The microphone sends 24 bits left aligned in 32-bit slots. Dropping the lowest bits leaves enough gain for
+ * an instrument close to the device.
+ */
+#define AUDIO_I2S_SHIFT 14
+
+class I2sAudioSource : public AudioSource
+{
+public:
+    /**
+     * @brief Installs the driver, sampling at [rate].
+     *
+     * @return true If the driver was installed.
+     */
+    bool begin(uint32_t rate)
+    {
+        i2s_config_t config = {};
+        config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+        config.sample_rate = rate;
+        config.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;
+        config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+        config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+        config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+        config.dma_buf_count = AUDIO_I2S_DMA_BUFFERS;
+        config.dma_buf_len = AUDIO_I2S_DMA_LENGTH;
+
+        i2s_pin_config_t pins = {};
+        pins.bck_io_num = AUDIO_I2S_SCK_PIN;
+        pins.ws_io_num = AUDIO_I2S_WS_PIN;
+        pins.data_out_num = I2S_PIN_NO_CHANGE;
+        pins.data_in_num = AUDIO_I2S_SD_PIN;
+
+        if (i2s_driver_install(AUDIO_I2S_PORT, &config, 0, NULL) != ESP_OK)
+        {
+            LOGE(LOG_MUSIC, "Could not install the I2S driver");
+            return false;
+        }
+        if (i2s_set_pin(AUDIO_I2S_PORT, &pins) != ESP_OK)
+        {
+            LOGE(LOG_MUSIC, "Could not set the pins of the microphone");
+            i2s_driver_uninstall(AUDIO_I2S_PORT);
+            return false;
+        }
+        this->rate = rate;
+        return true;
+    }
+
+    uint32_t sampleRate() override { return rate; }
+
+    size_t read(int16_t *samples, size_t count) override
+    {
+        int32_t raw[AUDIO_I2S_DMA_LENGTH];
+        size_t done = 0;
+        while (done < count)
+        {
+            size_t bytes = 0;
+            size_t chunk = std::min(count - done, (size_t)AUDIO_I2S_DMA_LENGTH);
+            if (i2s_read(AUDIO_I2S_PORT, raw, chunk * sizeof(int32_t), &bytes, portMAX_DELAY) != ESP_OK || bytes == 0)
+                break;
+            chunk = bytes / sizeof(int32_t);
+            for (size_t i = 0; i < chunk; i++)
+                samples[done + i] = (int16_t)std::min(std::max(raw[i] >> AUDIO_I2S_SHIFT, (int32_t)INT16_MIN), (int32_t)INT16_MAX);
+            done += chunk;
+        }
+        return done;
+    }
+
+private:
+    uint32_t rate = 0;
+};
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file audio_wav.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Reads the audio of a 16-bit PCM WAV file of a Storage, mixing the channels down to mono.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef AUDIO_WAV_H
+#define AUDIO_WAV_H
+
+// Include cpp headers
+#include <memory>
+
+// Include utils files
+#include "audio.h"
+#include "storage.h"
+
+/**
+ * @brief The frames read from the file at once.
+ */
+#define AUDIO_WAV_CHUNK 256
+
+class WavAudioSource : public AudioSource
+{
+public:
+    WavAudioSource(std::unique_ptr<StorageFile> file) : file(std::move(file)) {}
+
+    /**
+     * @brief Reads the header of the file, up to the start of the samples.
+     *
+     * @return true If the file is a 16-bit PCM WAV file.
+     */
+    bool begin()
+    {
+        uint8_t riff[12];
+        if (!file || file->read(riff, sizeof(riff)) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+            return false;
+        bool format = false;
+        uint8_t chunk[8];
+        while (file->read(chunk, sizeof(chunk)) == sizeof(chunk))
+        {
+            uint32_t size = chunk[4] | chunk[5] << 8 | chunk[6] << 16 | (uint32_t)chunk[7] << 24;
+            if (memcmp(chunk, "fmt ", 4) == 0)
+            {
+                uint8_t fmt[16];
+                if (size < sizeof(fmt) || file->read(fmt, sizeof(fmt)) != sizeof(fmt))
+                    return false;
+                uint16_t encoding = fmt[0] | fmt[1] << 8;
+                channels = fmt[2] | fmt[3] << 8;
+                rate = fmt[4] | fmt[5] << 8 | fmt[6] << 16 | (uint32_t)fmt[7] << 24;
+                uint16_t bits = fmt[14] | fmt[15] << 8;
+                if (encoding != 1 || bits != 16 || channels == 0 || channels > 2)
+                    return false;
+                format = true;
+                size -= sizeof(fmt);
+            }
+            else if (memcmp(chunk, "data", 4) == 0)
+            {
+                remaining = size / (2 * channels);
+                return format;
+            }
+            // Chunks are padded to an even size
+            if (!file->seek(file->position() + size + (size & 1)))
+                return false;
+        }
+        return false;
+    }
+
+    uint32_t sampleRate() override { return rate; }
+
+    size_t read(int16_t *samples, size_t count) override
+    {
+        int16_t frames[AUDIO_WAV_CHUNK * 2];
+        size_t done = 0;
+        while (done < count && remaining > 0)
+        {
+            size_t chunk = std::min(std::min(count - done, (size_t)AUDIO_WAV_CHUNK), (size_t)remaining);
+            size_t bytes = file->read((uint8_t *)frames, chunk * 2 * channels);
+            chunk = bytes / (2 * channels);
+            if (chunk == 0)
+                break;
+            // Samples are little endian, as the ESP32
+            for (size_t i = 0; i < chunk; i++)
+                samples[done + i] = channels == 1 ? frames[i] : (int16_t)((frames[2 * i] + frames[2 * i + 1]) / 2);
+            done += chunk;
+            remaining -= chunk;
+        }
+        return done;
+    }
+
+private:
+    std::unique_ptr<StorageFile> file;
+    uint16_t channels = 0;
+    uint32_t rate = 0;
+
+    /**
+     * @brief The frames left in the data chunk.
+     */
+    uint32_t remaining = 0;
+};
+
+#endif
@@ -20,173 +20,150 @@
 #include "logger.h"
 #include "pref_consts.h"
 #include "hash.h"
+#include "metrics.h"
 
 /**
  * @brief The amount of time that will take a token to expire, in seconds.
  */
 #define SESSION_EXPIRATION_TIME_SECONDS 60 * 60 * 1000
 
+/**
+ * @brief The shortest token accepted for reading /metrics.
+ */
+#define METRICS_TOKEN_MIN_LENGTH 16
+
+MetricHistogram checkUserWebAuthLatency("checkUserWebAuth");
+
 bool checkUserWebAuth(AsyncWebServerRequest *request)
 {
-  debugln("Checking if user is authenticated...");
-  debug("  Checking if there's cookie header...");
+  MetricTimer timer(checkUserWebAuthLatency);
+  LOGD(LOG_AUTH, "Checking if user is authenticated...");
   if (request->hasHeader("Cookie"))
   {
     // The request has cookies stored.
-    debugln("ok");
-    debug("  Getting cookie header...");
-
     // Get the cookies header
     AsyncWebHeader *cookie = request->getHeader("Cookie");
     String cookieValue = cookie->value();
-    debugln("ok");
-    debug("  - Cookie header: ");
-    debugln(cookieValue);
+    LOGD(LOG_AUTH, "  - Cookie header: %s", cookieValue.c_str());
 
     // Find the SESSIONID value
-    debug("  Checking if cookie has SESSIONID...");
     if (cookieValue.indexOf("SESSIONID=") != -1) // There's an stored session id
     {
-      debugln("ok");
-
-      debug("  SESSIONID header: ");
       String cookieHash = cookieValue.substring(cookieValue.indexOf("SESSIONID=") + 10);
-      debugln(cookieHash);
+      LOGD(LOG_AUTH, "  SESSIONID header: %s", cookieHash.c_str());
 
       // Get the user's date for expired session ids
-      debug("  Cookie has SESSIONID. Getting browser User-Agent...");
       AsyncWebHeader *agentHeader = request->getHeader("User-Agent");
       String agent = agentHeader->value();
-      debugln("ok");
-      debug("  - User-Agent header: ");
-      debugln(agent);
-      debug("  Hashing user agent...");
+      LOGD(LOG_AUTH, "  - User-Agent header: %s", agent.c_str());
       String agentHash = hash(agent.c_str()); // Create hash for the User Agent
-      debugln("ok");
-      debug("  - User Hash: ");
-      debugln(agentHash);
+      LOGD(LOG_AUTH, "  - User Hash: %s", agentHash.c_str());
 
       // Get the current time for token expiration
-      debug("  Getting device time...");
       struct tm time;
       unsigned long currentTime = -1;
       if (getLocalTime(&time))
       {
-        debugln("ok");
         currentTime = time.tm_sec + time.tm_min * (60) + time.tm_hour * (60 * 60) + time.tm_mday * (60 * 60 * 24) + time.tm_mon * (60 * 60 * 24 * 30) + time.tm_year * (60 * 60 * 24 * 365);
-        debug("  - Current device time: ");
-        debugln(String(currentTime));
+        LOGD(LOG_AUTH, "  - Current device time: %lu", currentTime);
       }
       else
-      {
-        debugln("error!");
-        errln("ERROR! Could not get time info. Tokens won't expire.");
-      }
+        LOGE(LOG_AUTH, "ERROR! Could not get time info. Tokens won't expire.");
 
       // Get the amount of stored sessions
-      debug("  Getting sessions count...");
       unsigned int sessionsCount = preferences.getUShort(pref_sessionCount, 0U);
-      debugln("ok");
-      debug("  - Sessions count: ");
-      debugln(String(sessionsCount));
+      LOGD(LOG_AUTH, "  - Sessions count: %u", sessionsCount);
 
       // Iterate that much of times
-      debugln("  Iterating sessions...");
       for (int c = 0; c < sessionsCount; c++)
       {
-        debug("    Getting session at ");
-        debug(String(c));
-        debug("...");
-
         // Get the stored session id on that index
         String sessionId = preferences.getString((String(pref_sessionPrefix) + String(c)).c_str());
-        debugln("ok");
-        debug("    - Session id: ");
-        debugln(sessionId);
+        LOGD(LOG_AUTH, "    - Session id at %d: %s", c, sessionId.c_str());
 
         // Ignore all empty sets
         if (sessionId.length() <= 0)
         {
-          debugln("    Session id is empty. Jumping to next session.");
+          LOGD(LOG_AUTH, "    Session id is empty. Jumping to next session.");
           continue;
         }
 
         // Check if the found sessionId matches the User Agent hash
-        debug("    Checking if agent hash is correct...");
         if (cookieHash == sessionId && cookieHash == agentHash) // Hash is correct
         {
-          debugln("ok");
+          LOGD(LOG_AUTH, "    Agent hash is correct.");
 
           // There's no valid stored time, skip expiration check
           if (currentTime < 0)
           {
-            debugln("      System time could not be loaded. Expiration is disabled.");
+            LOGD(LOG_AUTH, "      System time could not be loaded. Expiration is disabled.");
             // TODO: Return result codes instead of boolean
             return true;
           }
 
           // Check if not expired
-          debugln("      Checking if session has expired.");
-          debug("      Getting session creation date...");
           unsigned int sessionCreation = preferences.getULong((String(pref_sessionExpPrefix) + String(c)).c_str());
-          debugln("ok");
 
           unsigned int difference = currentTime - sessionCreation;
           if (difference > SESSION_EXPIRATION_TIME_SECONDS)
           {
             // Token has expired
-            debugln("      Session is expired.");
-            debug("      Session age is: ");
-            debugln(String(sessionCreation));
-            debug("      And current time is: ");
-            debugln(String(currentTime));
-            debug("      Which difference is: ");
-            debugln(String(difference));
-            debug("      That is greater from the configured max age: ");
-            debugln(String(SESSION_EXPIRATION_TIME_SECONDS));
-
-            debugln("      Removing expired session...");
-            debug("        Reducing sessions count to ");
+            LOGD(LOG_AUTH, "      Session is expired. Created at %u, current time is %lu, difference %u > %u",
+                 sessionCreation, currentTime, difference, SESSION_EXPIRATION_TIME_SECONDS);
+
             sessionsCount--;
-            debug(String(sessionsCount));
-            debug("...");
+            LOGD(LOG_AUTH, "      Removing expired session, reducing sessions count to %u...", sessionsCount);
             preferences.putUShort(pref_sessionCount, sessionsCount);
-            debugln("ok");
             // Move all remaining sessions one position to the left
             for (int i = c; i < sessionsCount; i++)
             {
-              debug("        - Displacing session id at ");
-              debug(String(i + 1));
-              debug("...");
+              LOGD(LOG_AUTH, "        - Displacing session at %d", i + 1);
               String oldSessionId = preferences.getString((String(pref_sessionPrefix) + String(i + 1)).c_str());
               preferences.putString((String(pref_sessionPrefix) + String(i)).c_str(), oldSessionId);
-              debugln("ok");
 
-              debug("        - Displacing session expiration at ");
-              debug(String(i + 1));
-              debug("...");
               unsigned int sessionCreation = preferences.getUInt((String(pref_sessionExpPrefix) + String(i + 1)).c_str());
               preferences.putULong((String(pref_sessionExpPrefix) + String(i)).c_str(), sessionCreation);
-              debugln("ok");
             }
             continue;
           }
 
-          debugln("      Session not expired, returning ok.");
+          LOGD(LOG_AUTH, "      Session not expired, returning ok.");
           // TODO: Return result codes instead of boolean
           return true;
         }
         else
-          debugln("no");
+          LOGD(LOG_AUTH, "    Agent hash doesn't match.");
       }
     }
     else
-      debugln("no");
+      LOGD(LOG_AUTH, "  Cookie has no SESSIONID.");
   }
   else
-    debugln("no");
+    LOGD(LOG_AUTH, "  There's no cookie header.");
 
   return false;
 }
 
+/**
+ * @brief Checks whether [request] can read /metrics: it comes from a logged in user, or it has the header
+ * "Authorization: Bearer <token>" with the token stored at pref_metricsToken, for scrapers that can't log in.
+ */
+bool checkMetricsAuth(AsyncWebServerRequest *request)
+{
+  String token = preferences.getString(pref_metricsToken, "");
+  if (token.length() > 0 && request->hasHeader("Authorization"))
+  {
+    String authorization = request->getHeader("Authorization")->value();
+    String expected = "Bearer " + token;
+    // Compares every byte, so the time taken doesn't tell how much of the token matched
+    uint8_t difference = authorization.length() != expected.length();
+    for (unsigned int i = 0; i < authorization.length() && i < expected.length(); i++)
+      difference |= authorization[i] ^ expected[i];
+    if (difference == 0)
+      return true;
+    LOGD(LOG_AUTH, "  Wrong metrics token.");
+  }
+  return checkUserWebAuth(request);
+}
+
 #endif
@@ -0,0 +1,124 @@
+/**
+ * @file boot.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Timing of the boot phases, reported at /metrics.
+ * @version 0.1
+ * @date 2022-02-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+// Include cpp headers
+#include <atomic>
+
+// Include utils files
+#include "logger.h"
+
+/**
+ * @brief The maximum amount of phases recorded.
+ */
+#define BOOT_PHASES_MAX 16
+
+/**
+ * @brief A step of the boot, and how long it took.
+ */
+struct BootPhase
+{
+    const char *name;
+
+    /**
+     * @brief When the phase started, in microseconds since power on.
+     */
+    unsigned long start;
+
+    /**
+     * @brief How long the phase took, in microseconds.
+     */
+    unsigned long duration;
+};
+
+/**
+ * @brief The phases completed so far. Entries are only written while holding [bootPhaseLock], and published by
+ * increasing [bootPhaseCount].
+ */
+BootPhase bootPhases[BOOT_PHASES_MAX];
+std::atomic<uint8_t> bootPhaseCount{0};
+portMUX_TYPE bootPhaseLock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Whether all the boot work, including the deferred one, has finished.
+ */
+std::atomic<bool> bootComplete{false};
+
+/**
+ * @brief Records that the phase [name] started at [start] and took [duration], both in microseconds.
+ */
+void bootRecordPhase(const char *name, unsigned long start, unsigned long duration)
+{
+    portENTER_CRITICAL(&bootPhaseLock);
+    uint8_t index = bootPhaseCount.load();
+    if (index < BOOT_PHASES_MAX)
+    {
+        bootPhases[index] = {name, start, duration};
+        bootPhaseCount.store(index + 1);
+    }
+    portEXIT_CRITICAL(&bootPhaseLock);
+    LOGI(LOG_MAIN, "Boot phase %s took %lu ms", name, duration / 1000);
+}
+
+/**
+ * @brief Times a boot phase from its construction until it goes out of scope.
+ */
+class BootPhaseTimer
+{
+public:
+    BootPhaseTimer(const char *name) : name(name), start(micros()) {}
+
+    ~BootPhaseTimer()
+    {
+        bootRecordPhase(name, start, micros() - start);
+    }
+
+private:
+    const char *name;
+    unsigned long start;
+};
+
+/**
+ * @brief Appends the boot phases to [out] in the Prometheus text format.
+ */
+void bootWriteMetrics(String &out)
+{
+    char line[128];
+    uint8_t count = bootPhaseCount.load();
+
+    out += "# HELP ems_boot_phase_start_seconds When the boot phase started, since power on.\n";
+    out += "# TYPE ems_boot_phase_start_seconds gauge\n";
+    for (uint8_t i = 0; i < count; i++)
+    {
+        snprintf(line, sizeof(line), "ems_boot_phase_start_seconds{phase=\"%s\"} %.6f\n", bootPhases[i].name, bootPhases[i].start / 1e6);
+        out += line;
+    }
+
+    out += "# HELP ems_boot_phase_seconds How long the boot phase took.\n";
+    out += "# TYPE ems_boot_phase_seconds gauge\n";
+    for (uint8_t i = 0; i < count; i++)
+    {
+        snprintf(line, sizeof(line), "ems_boot_phase_seconds{phase=\"%s\"} %.6f\n", bootPhases[i].name, bootPhases[i].duration / 1e6);
+        out += line;
+    }
+
+    out += "# HELP ems_boot_complete Whether the deferred boot work has finished.\n";
+    out += "# TYPE ems_boot_complete gauge\n";
+    out += bootComplete.load() ? "ems_boot_complete 1\n" : "ems_boot_complete 0\n";
+}
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file captive_dns.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief DNS server for the captive portal, which resolves every name to the address of the access point. Runs in its
+ * own task, blocked on the socket until a query arrives, so replies are immediate and nothing is polled.
+ * @version 0.1
+ * @date 2022-02-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef CAPTIVE_DNS_H
+#define CAPTIVE_DNS_H
+
+// Include libraries
+#include <Arduino.h>
+#include <lwip/sockets.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Include utils files
+#include "logger.h"
+#include "metrics.h"
+
+#define CAPTIVE_DNS_TASK_STACK_SIZE 3072
+
+/**
+ * @brief The maximum size of a DNS message over UDP.
+ */
+#define DNS_MESSAGE_SIZE 512
+
+#define DNS_HEADER_SIZE 12
+
+/**
+ * @brief How long clients may cache the answers, in seconds. Kept short so they resolve again once out of the portal.
+ */
+#define DNS_TTL 60
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+
+/**
+ * @brief The address every name resolves to, in network order.
+ */
+uint32_t captiveDnsAddress;
+
+/**
+ * @brief The amount of queries answered.
+ */
+MetricCounter captiveDnsQueries;
+
+/**
+ * @brief Turns the query of [len] bytes in [message] into its answer, in place.
+ *
+ * @return size_t The size of the answer, or 0 if the query must be ignored.
+ */
+size_t captiveDnsAnswer(uint8_t *message, size_t len)
+{
+    if (len < DNS_HEADER_SIZE)
+        return 0;
+    uint16_t flags = (message[2] << 8) | message[3];
+    uint16_t questions = (message[4] << 8) | message[5];
+    // Only standard queries with a single question
+    if ((flags & 0xF800) != 0 || questions != 1)
+        return 0;
+
+    // Skip the name, made of labels ended by an empty one
+    size_t pos = DNS_HEADER_SIZE;
+    while (pos < len && message[pos] != 0)
+    {
+        if (message[pos] & 0xC0)
+            return 0;
+        pos += message[pos] + 1;
+    }
+    pos += 1 + 4;
+    if (pos > len)
+        return 0;
+    uint16_t type = (message[pos - 4] << 8) | message[pos - 3];
+    uint16_t cls = (message[pos - 2] << 8) | message[pos - 1];
+    bool answered = (type == DNS_TYPE_A || type == DNS_TYPE_ANY) && cls == DNS_CLASS_IN && pos + 16 <= DNS_MESSAGE_SIZE;
+
+    // Response, authoritative, keeping the recursion desired bit, recursion available
+    message[2] = 0x84 | (message[2] & 0x01);
+    message[3] = 0x80;
+    message[6] = 0;
+    message[7] = answered ? 1 : 0;
+    memset(message + 8, 0, 4);
+    if (!answered)
+        return pos;
+
+    const uint8_t answer[] = {
+        0xC0, DNS_HEADER_SIZE, // Name, pointing to the question
+        0, DNS_TYPE_A,
+        0, DNS_CLASS_IN,
+        0, 0, 0, DNS_TTL,
+        0, 4};
+    memcpy(message + pos, answer, sizeof(answer));
+    memcpy(message + pos + sizeof(answer), &captiveDnsAddress, 4);
+    return pos + sizeof(answer) + 4;
+}
+
+/**
+ * @brief Answers the queries received at [parameter], the socket, forever.
+ */
+void captiveDnsTask(void *parameter)
+{
+    int sock = (int)(intptr_t)parameter;
+    uint8_t message[DNS_MESSAGE_SIZE];
+    for (;;)
+    {
+        struct sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        int len = recvfrom(sock, message, sizeof(message), 0, (struct sockaddr *)&from, &fromLen);
+        if (len <= 0)
+            continue;
+        size_t answerLen = captiveDnsAnswer(message, len);
+        if (answerLen == 0)
+            continue;
+        sendto(sock, message, answerLen, 0, (struct sockaddr *)&from, fromLen);
+        captiveDnsQueries.add();
+    }
+}
+
+/**
+ * @brief Starts answering the queries received at [port] with [address].
+ *
+ * @return true If the server is running.
+ */
+bool captiveDnsBegin(uint16_t port, IPAddress address)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        LOGE(LOG_MAIN, "Could not create the DNS socket");
+        return false;
+    }
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, (struct sockaddr *)&local, sizeof(local)) != 0)
+    {
+        LOGE(LOG_MAIN, "Could not bind the DNS socket to port %u", port);
+        close(sock);
+        return false;
+    }
+
+    captiveDnsAddress = (uint32_t)address;
+    xTaskCreate(captiveDnsTask, "dns", CAPTIVE_DNS_TASK_STACK_SIZE, (void *)(intptr_t)sock, tskIDLE_PRIORITY + 2, NULL);
+    return true;
+}
+
+#endif
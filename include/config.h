@@ -17,19 +17,75 @@
 #include <Preferences.h>
 
 // Include cpp headers
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 
 // Include header files
 #include "pref_consts.h"
 #include "consts_err.h"
+#include "auth.h"
 #include "logger.h"
+#include "layout.h"
+#include "pedal.h"
+#include "pins.h"
+#include "follow.h"
+#include "sync.h"
+#include "metronome.h"
+#include "setlist.h"
 
 // Define config keys
 /**
  * @brief Used to delete auth sessions. The value must be a numeric value specifying the index of the session to remove.
  */
 #define CONFIG_KEY_REMOVE_SESSION "delSession"
+/**
+ * @brief Used to change the log level of a module at runtime. Must be followed by the module name, or "all", for
+ * example "logLevel.auth". The value must be numeric, from DEBUG_LOG (0) to DEBUG_ERR (3).
+ */
+#define CONFIG_KEY_LOG_LEVEL "logLevel."
+/**
+ * @brief Used to transpose the scores. The value must be the amount of semitones, from -12 to 12. Applied the next
+ * time a score is opened.
+ */
+#define CONFIG_KEY_TRANSPOSE "transpose"
+/**
+ * @brief Used to set up the pedals, must be followed by the setting:
+ * - "next" and "previous": the GPIO of the pedal that turns to the next or the previous page, or -1 to disable it.
+ *   Only the ones of [pinsFree] not taken by the other pedal or the metronome.
+ * - "debounce": the time the pedals take to settle, in milliseconds.
+ * - "invert": 1 for pedals that close when released, 0 otherwise.
+ * Applied right away.
+ */
+#define CONFIG_KEY_PEDAL "pedal."
+/**
+ * @brief Used to set up the score follower, must be followed by the setting:
+ * - "enabled": 1 for turning the pages by following the audio of the microphone, 0 otherwise.
+ * - "beats": the beats before the end of a page when it's turned, up to 8.
+ * Applied right away.
+ */
+#define CONFIG_KEY_FOLLOW "follow."
+/**
+ * @brief Used to set the role of the stand in its section: 0 for none, 1 for turning the pages of the other stands, 2
+ * for having the pages turned by the leader. Applied right away.
+ */
+#define CONFIG_KEY_SYNC_ROLE "sync.role"
+/**
+ * @brief Used to set up the metronome, must be followed by the setting:
+ * - "pin": the GPIO of the buzzer, or -1 for a silent metronome, the default. Only the ones of [pinsFree] not taken by
+ *   the pedals.
+ * - "scroll": the beats before the end of a page when it's turned, up to 8, or 0 for not turning the pages.
+ * Applied right away, stopping the metronome.
+ */
+#define CONFIG_KEY_METRONOME "metronome."
+/**
+ * @brief Used to set the token that scrapers send as "Authorization: Bearer <token>" for reading /metrics without
+ * logging in. At least METRICS_TOKEN_MIN_LENGTH characters, or empty so only logged in users can.
+ */
+#define CONFIG_KEY_METRICS_TOKEN "metrics.token"
 
 bool isNumber(const std::string& str)
 {
@@ -39,6 +95,51 @@ bool isNumber(const std::string& str)
     return true;
 }
 
+/**
+ * @brief Parses [value] as a decimal integer, with an optional minus sign, into [out].
+ *
+ * @param min The lowest value taken.
+ * @param max The highest value taken.
+ * @return NULL if [out] has been set, ERR_CONFIG_NUMERIC if [value] is not a number, or ERR_CONFIG_BOUNDS if it's
+ * out of [min] and [max], or of the range of int.
+ */
+const char *configParseInt(const std::string &value, long min, long max, int &out)
+{
+    // strtol also takes leading spaces and a plus sign
+    if (value.empty() || !(std::isdigit((unsigned char)value[0]) || value[0] == '-'))
+        return ERR_CONFIG_NUMERIC;
+    char *end;
+    errno = 0;
+    long number = strtol(value.c_str(), &end, 10);
+    if (end == value.c_str() || end != value.c_str() + value.length())
+        return ERR_CONFIG_NUMERIC;
+    if (errno == ERANGE || number < std::max(min, (long)INT_MIN) || number > std::min(max, (long)INT_MAX))
+        return ERR_CONFIG_BOUNDS;
+    out = number;
+    return NULL;
+}
+
+/**
+ * @brief Checks whether [pin] can be given to [key], the setting of a pedal or the metronome: it's -1, or one of
+ * [pinsFree] that none of the others has.
+ */
+bool configPinValid(int pin, const std::string &key)
+{
+    if (pin == -1)
+        return true;
+    if (!pinFree(pin))
+        return false;
+    const std::pair<std::string, int> taken[] = {
+        {CONFIG_KEY_PEDAL "next", preferences.getInt(pref_pedalNext, PEDAL_DEFAULT_NEXT_PIN)},
+        {CONFIG_KEY_PEDAL "previous", preferences.getInt(pref_pedalPrevious, PEDAL_DEFAULT_PREVIOUS_PIN)},
+        {CONFIG_KEY_METRONOME "pin", preferences.getInt(pref_metronomePin, METRONOME_DEFAULT_PIN)},
+    };
+    for (auto &other : taken)
+        if (other.first != key && other.second == pin)
+            return false;
+    return true;
+}
+
 /**
  * @brief Sets the specified [key] to value [value].
  *
@@ -50,73 +151,201 @@ const char *configure(std::string key, std::string value)
     // Check if key is CONFIG_KEY_REMOVE_SESSION
     if (key.rfind(CONFIG_KEY_REMOVE_SESSION) != std::string::npos)
     {
-        debugln("Received configure parameter CONFIG_KEY_REMOVE_SESSION.");
+        LOGD(LOG_CONFIG, "Received configure parameter CONFIG_KEY_REMOVE_SESSION.");
 
         // CONFIG_KEY_REMOVE_SESSION requires value to be numeric
         if (!isNumber(value))
         {
-            debug("The received value \"");
-            debug(value.c_str());
-            debugln("\" is not a numeric value");
+            LOGD(LOG_CONFIG, "The received value \"%s\" is not a numeric value", value.c_str());
             return ERR_CONFIG_NUMERIC;
         }
 
-        debug("Converting value to unsigned short...");
         // Convert value to short to use as index
         std::stringstream strVal;
         strVal << value;
         unsigned short index;
         strVal >> index;
-        debugln("ok");
 
         // Get the amount of stored sessions
-        debug("Getting sessionsCount...");
         unsigned short sessionsCount = preferences.getUShort(pref_sessionCount, 0U);
-        debugln("ok");
-        debug("  sessionsCount=");
-        debugln(String(sessionsCount));
+        LOGD(LOG_CONFIG, "  sessionsCount=%u", sessionsCount);
 
         if (index >= sessionsCount)
         {
-            debugln("The index specified is greater than the sessionsCount.");
+            LOGD(LOG_CONFIG, "The index specified is greater than the sessionsCount.");
             return ERR_CONFIG_BOUNDS;
         }
 
         // Iterate all sessions following the set index, and move them one position left
         for (unsigned short i = index; i < sessionsCount; i++)
         {
-            debug("Getting sessionId and sessionCreation at ");
-            debug(String(i + 1));
-            debug("...");
+            LOGD(LOG_CONFIG, "Moving sessionId and sessionCreation from %u to %u", i + 1, i);
             // Get the session id
             String sessionId = preferences.getString((String(pref_sessionPrefix) + String(i + 1)).c_str());
             // Get the session creation id
             unsigned int sessionCreation = preferences.getULong((String(pref_sessionExpPrefix) + String(i + 1)).c_str());
-            debugln("ok");
 
-            debug("Writing both elements at ");
-            debug(String(i));
-            debug("...");
             preferences.putString((String(pref_sessionPrefix) + String(i)).c_str(), sessionId);
             preferences.putULong((String(pref_sessionExpPrefix) + String(i)).c_str(), sessionCreation);
-            debugln("ok");
         }
 
         // Reduce by 1 the count at sessionsCount
         sessionsCount--;
 
         // Update the value for sessionsCount
-        debug("Writing ");
-        debug(String(sessionsCount));
-        debug(" for sessionsCount...");
+        LOGD(LOG_CONFIG, "Writing %u for sessionsCount...", sessionsCount);
         preferences.putUShort(pref_sessionCount, sessionsCount);
-        debugln("ok");
 
         return CONFIG_OK;
     }
 
-    debug("Got invalid key for config: ");
-    debugln(key.c_str());
+    // Check if key is CONFIG_KEY_LOG_LEVEL
+    if (key.rfind(CONFIG_KEY_LOG_LEVEL, 0) == 0)
+    {
+        std::string module = key.substr(strlen(CONFIG_KEY_LOG_LEVEL));
+        LOGD(LOG_CONFIG, "Received configure parameter CONFIG_KEY_LOG_LEVEL for \"%s\".", module.c_str());
+
+        int level;
+        const char *error = configParseInt(value, DEBUG_LOG, DEBUG_ERR, level);
+        if (error != NULL)
+            return error;
+
+        if (module == "all")
+        {
+            for (int i = 0; i < LOG_MODULE_COUNT; i++)
+                logModuleLevels[i] = level;
+            return CONFIG_OK;
+        }
+
+        int index = logModuleByName(module.c_str());
+        if (index < 0)
+            return ERR_CONFIG_KEY;
+
+        logModuleLevels[index] = level;
+        return CONFIG_OK;
+    }
+
+    if (key == CONFIG_KEY_TRANSPOSE)
+    {
+        int semitones;
+        const char *error = configParseInt(value, -12, 12, semitones);
+        if (error != NULL)
+            return error;
+
+        layoutGeometry.transpose = semitones;
+        preferences.putInt(pref_transpose, semitones);
+        // The setlist is laid out again for it
+        setlistRefresh();
+        return CONFIG_OK;
+    }
+
+    if (key.rfind(CONFIG_KEY_PEDAL, 0) == 0)
+    {
+        std::string setting = key.substr(strlen(CONFIG_KEY_PEDAL));
+        int number;
+        const char *error = configParseInt(value, INT_MIN, INT_MAX, number);
+        if (error != NULL)
+            return error;
+
+        if (setting == "next" || setting == "previous")
+        {
+            if (!configPinValid(number, key))
+                return ERR_CONFIG_BOUNDS;
+            preferences.putInt(setting == "next" ? pref_pedalNext : pref_pedalPrevious, number);
+        }
+        else if (setting == "debounce")
+        {
+            if (number < 1 || number > PEDAL_MAX_DEBOUNCE_MS)
+                return ERR_CONFIG_BOUNDS;
+            preferences.putUShort(pref_pedalDebounce, number);
+        }
+        else if (setting == "invert")
+        {
+            if (number < 0 || number > 1)
+                return ERR_CONFIG_BOUNDS;
+            preferences.putBool(pref_pedalInvert, number == 1);
+        }
+        else
+            return ERR_CONFIG_KEY;
+
+        pedalReconfigure();
+        return CONFIG_OK;
+    }
+
+    if (key.rfind(CONFIG_KEY_FOLLOW, 0) == 0)
+    {
+        std::string setting = key.substr(strlen(CONFIG_KEY_FOLLOW));
+        int number;
+        const char *error = configParseInt(value, 0, INT_MAX, number);
+        if (error != NULL)
+            return error;
+
+        if (setting == "enabled")
+        {
+            if (number > 1)
+                return ERR_CONFIG_BOUNDS;
+            preferences.putBool(pref_followEnabled, number == 1);
+            followBegin();
+        }
+        else if (setting == "beats")
+        {
+            if (number > FOLLOW_MAX_TURN_BEATS)
+                return ERR_CONFIG_BOUNDS;
+            preferences.putUChar(pref_followBeats, number);
+            followTurnBeats = number;
+        }
+        else
+            return ERR_CONFIG_KEY;
+        return CONFIG_OK;
+    }
+
+    if (key == CONFIG_KEY_SYNC_ROLE)
+    {
+        int number;
+        const char *error = configParseInt(value, SYNC_OFF, SYNC_FOLLOWER, number);
+        if (error != NULL)
+            return error;
+        preferences.putUChar(pref_syncRole, number);
+        syncReconfigure();
+        return CONFIG_OK;
+    }
+
+    if (key.rfind(CONFIG_KEY_METRONOME, 0) == 0)
+    {
+        std::string setting = key.substr(strlen(CONFIG_KEY_METRONOME));
+        int number;
+        const char *error = configParseInt(value, INT_MIN, INT_MAX, number);
+        if (error != NULL)
+            return error;
+
+        if (setting == "pin")
+        {
+            if (!configPinValid(number, key))
+                return ERR_CONFIG_BOUNDS;
+            preferences.putInt(pref_metronomePin, number);
+        }
+        else if (setting == "scroll")
+        {
+            if (number < 0 || number > METRONOME_MAX_SCROLL_BEATS)
+                return ERR_CONFIG_BOUNDS;
+            preferences.putUChar(pref_metronomeScroll, number);
+        }
+        else
+            return ERR_CONFIG_KEY;
+
+        metronomeReconfigure();
+        return CONFIG_OK;
+    }
+
+    if (key == CONFIG_KEY_METRICS_TOKEN)
+    {
+        if (!value.empty() && value.length() < METRICS_TOKEN_MIN_LENGTH)
+            return ERR_CONFIG_BOUNDS;
+        preferences.putString(pref_metricsToken, value.c_str());
+        return CONFIG_OK;
+    }
+
+    LOGD(LOG_CONFIG, "Got invalid key for config: %s", key.c_str());
 
     return ERR_CONFIG_KEY;
 }
@@ -22,5 +22,8 @@
 #define DEBUG_MODE
 #endif
 
+// Uncomment for writing logs as compact binary records instead of text. Decode them with decode_logs.py
+// #define LOG_BINARY
+
 // Disabled OTA until working with 16MB of flash
 // #define ENABLE_OTA
\ No newline at end of file
@@ -23,9 +23,12 @@
 #define MIME_PLAIN "text/plain"
 #define MIME_HTML "text/html"
 #define MIME_JSON "application/json"
+#define MIME_PROMETHEUS "text/plain; version=0.0.4"
 
 // HTTP result codes, see https://developer.mozilla.org/en-US/docs/Web/HTTP/Status
 #define HTTP_OK 200
 #define HTTP_BAD_REQUEST 400
+#define HTTP_UNAUTHORIZED 401
+#define HTTP_INSUFFICIENT_STORAGE 507
 
 #endif
\ No newline at end of file
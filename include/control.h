@@ -0,0 +1,179 @@
+/**
+ * @file control.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Control events, such as reboots, sent from the request handlers and tasks to the main loop, which sleeps
+ * until one arrives.
+ * @version 0.1
+ * @date 2022-02-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <atomic>
+
+// Include utils files
+#include "logger.h"
+
+/**
+ * @brief The amount of events that can wait to be handled. At most one of every type waits, so it's never full.
+ */
+#define CONTROL_QUEUE_LENGTH 8
+
+/**
+ * @brief The actions run by the main loop.
+ */
+enum ControlEventType
+{
+    CONTROL_REBOOT,
+
+    /**
+     * @brief Lays out the next score of the setlist that isn't in the cache.
+     */
+    CONTROL_SETLIST,
+
+    /**
+     * @brief Parses the next score stored that isn't in the index.
+     */
+    CONTROL_INDEX,
+
+    /**
+     * @brief Lays out the score open again, since some page of it was evicted from the cache.
+     */
+    CONTROL_LAYOUT,
+
+    /**
+     * @brief Opens the score or the setlist entry asked for by a request handler, see score_open.h.
+     */
+    CONTROL_OPEN,
+
+    CONTROL_EVENT_COUNT
+};
+
+struct ControlEvent
+{
+    ControlEventType type;
+
+    /**
+     * @brief Why the event was sent, logged when handled. Must be a string literal.
+     */
+    const char *reason;
+};
+
+QueueHandle_t controlEvents;
+
+/**
+ * @brief Whether an event of every type is waiting to be handled. Handling it covers the ones sent meanwhile, so
+ * they're not queued.
+ */
+std::atomic<bool> controlQueued[CONTROL_EVENT_COUNT];
+
+/**
+ * @brief The events sent later by controlPostAfter: the reason, or NULL if none is, and the tick it's sent at. Only
+ * used by the main loop.
+ */
+const char *controlDeferredReason[CONTROL_EVENT_COUNT];
+TickType_t controlDeferredAt[CONTROL_EVENT_COUNT];
+
+/**
+ * @brief Creates the queue of events. Must be called before any event is sent.
+ */
+void controlBegin()
+{
+    controlEvents = xQueueCreate(CONTROL_QUEUE_LENGTH, sizeof(ControlEvent));
+}
+
+/**
+ * @brief Sends the event [type] to the main loop, unless one of its type is waiting already. Reboots go before the
+ * events waiting. Never blocks, so it can be called from request handlers.
+ *
+ * @param type The action to run.
+ * @param reason Why the action is run. Must be a string literal. The one of the event waiting is kept.
+ * @return true If the event was queued, or one of its type was waiting.
+ */
+bool controlPost(ControlEventType type, const char *reason)
+{
+    if (controlQueued[type].exchange(true))
+        return true;
+    ControlEvent event = {type, reason};
+    BaseType_t sent = type == CONTROL_REBOOT ? xQueueSendToFront(controlEvents, &event, 0) : xQueueSend(controlEvents, &event, 0);
+    if (sent == pdTRUE)
+        return true;
+    controlQueued[type] = false;
+    LOGW(LOG_MAIN, "Control event dropped: %s", reason);
+    return false;
+}
+
+/**
+ * @brief Sends the event [type] to the main loop in [ms] milliseconds, for retrying what can't be done yet without
+ * blocking it meanwhile. Must be called from the main loop, which sends it while waiting in controlReceive.
+ *
+ * @param reason Why the action is run. Must be a string literal.
+ */
+void controlPostAfter(ControlEventType type, const char *reason, uint32_t ms)
+{
+    controlDeferredReason[type] = reason;
+    controlDeferredAt[type] = xTaskGetTickCount() + pdMS_TO_TICKS(ms);
+}
+
+/**
+ * @brief Sends the events of controlPostAfter that are due.
+ *
+ * @return The ticks until the next one is, or portMAX_DELAY if there's none.
+ */
+TickType_t controlPostDeferred()
+{
+    TickType_t wait = portMAX_DELAY;
+    TickType_t now = xTaskGetTickCount();
+    for (int type = 0; type < CONTROL_EVENT_COUNT; type++)
+    {
+        if (controlDeferredReason[type] == NULL)
+            continue;
+        TickType_t left = controlDeferredAt[type] - now;
+        // Wrapped around when it's due
+        if (left == 0 || left > portMAX_DELAY / 2)
+        {
+            controlPost((ControlEventType)type, controlDeferredReason[type]);
+            controlDeferredReason[type] = NULL;
+        }
+        else
+            wait = std::min(wait, left);
+    }
+    return wait;
+}
+
+/**
+ * @brief Waits until an event is sent, for at most [ticks], sending the ones of controlPostAfter as they're due.
+ * Events of its type sent from now on are queued again.
+ *
+ * @return true If [event] has been filled.
+ */
+bool controlReceive(ControlEvent &event, TickType_t ticks)
+{
+    TickType_t start = xTaskGetTickCount();
+    for (;;)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        TickType_t left = ticks == portMAX_DELAY ? portMAX_DELAY : ticks - std::min(elapsed, ticks);
+        TickType_t wait = std::min(left, controlPostDeferred());
+        if (xQueueReceive(controlEvents, &event, wait) == pdTRUE)
+            break;
+        // Otherwise woken up for an event of controlPostAfter
+        if (wait == left)
+            return false;
+    }
+    controlQueued[event.type] = false;
+    return true;
+}
+
+#endif
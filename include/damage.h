@@ -0,0 +1,266 @@
+/**
+ * @file damage.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Finds the parts of the display that change between two frame buffers, so only those are sent and refreshed.
+ * The buffers are compared a word at a time in tiles, and the dirty tiles are merged into a few rectangles. Every few
+ * partial refreshes the whole display is refreshed, which clears the ghosting left on e-paper.
+ * @version 0.1
+ * @date 2022-03-06
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include utils files
+#include "metrics.h"
+
+/**
+ * @brief The size of the areas compared, in pixels. The width must be a multiple of 32, the buffers are compared a
+ * word at a time. Displays can be up to 64 tiles wide.
+ */
+#define DAMAGE_TILE_WIDTH 64
+#define DAMAGE_TILE_HEIGHT 8
+
+/**
+ * @brief The most rectangles sent in a partial refresh. Closer ones are merged when there are more.
+ */
+#define DAMAGE_MAX_RECTS 16
+
+/**
+ * @brief The amount of partial refreshes after which the whole display is refreshed.
+ */
+#define DAMAGE_FULL_REFRESH_INTERVAL 10
+
+/**
+ * @brief The dirty area, in percent of the display, from which the whole display is refreshed instead.
+ */
+#define DAMAGE_FULL_REFRESH_PERCENT 60
+
+/**
+ * @brief A page drawn for the display, one bit per pixel with the most significant bit on the left. Set bits are
+ * black. Every row starts at a word boundary.
+ */
+struct FrameBuffer
+{
+    uint8_t *pixels;
+    uint16_t width;
+    uint16_t height;
+    uint16_t stride;
+
+    /**
+     * @brief The page drawn, or -1 if the buffer holds no page.
+     */
+    int32_t page;
+};
+
+/**
+ * @brief An area of the display, in pixels. Aligned to tiles, so [x] is a multiple of 8, and so is [width] unless the
+ * area reaches the right edge.
+ */
+struct DamageRect
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+/**
+ * @brief What to send to the display: the whole buffer if [full] is set, or only [rects] otherwise.
+ */
+struct Damage
+{
+    bool full;
+    uint8_t count;
+    DamageRect rects[DAMAGE_MAX_RECTS];
+};
+
+MetricCounter damagePartialRefreshes;
+MetricCounter damageFullRefreshes;
+MetricCounter damageBytesSent;
+
+uint32_t damageArea(const DamageRect &rect)
+{
+    return (uint32_t)rect.width * rect.height;
+}
+
+DamageRect damageUnion(const DamageRect &a, const DamageRect &b)
+{
+    uint16_t x = min(a.x, b.x), y = min(a.y, b.y);
+    uint16_t right = max(a.x + a.width, b.x + b.width), bottom = max(a.y + a.height, b.y + b.height);
+    return {x, y, (uint16_t)(right - x), (uint16_t)(bottom - y)};
+}
+
+/**
+ * @brief Adds [rect] to [out]. When there's no room, the two rectangles that grow the least when merged are merged.
+ */
+void damageAdd(Damage &out, const DamageRect &rect)
+{
+    if (out.count == DAMAGE_MAX_RECTS)
+    {
+        uint32_t best = UINT32_MAX;
+        int first = 0, second = 1;
+        for (int i = 0; i < DAMAGE_MAX_RECTS; i++)
+            for (int j = i + 1; j < DAMAGE_MAX_RECTS; j++)
+            {
+                uint32_t growth = damageArea(damageUnion(out.rects[i], out.rects[j])) - damageArea(out.rects[i]) - damageArea(out.rects[j]);
+                if (growth < best)
+                {
+                    best = growth;
+                    first = i;
+                    second = j;
+                }
+            }
+        out.rects[first] = damageUnion(out.rects[first], out.rects[second]);
+        out.rects[second] = out.rects[--out.count];
+    }
+    out.rects[out.count++] = rect;
+}
+
+/**
+ * @brief Finds the rectangles where [next] differs from [shown]. Both must have the same size.
+ */
+void damageCompute(const FrameBuffer &shown, const FrameBuffer &next, Damage &out)
+{
+    out.full = false;
+    out.count = 0;
+    const uint16_t columns = (next.width + DAMAGE_TILE_WIDTH - 1) / DAMAGE_TILE_WIDTH;
+    const uint16_t words = next.stride / 4;
+    const uint16_t wordsPerTile = DAMAGE_TILE_WIDTH / 32;
+
+    // Spans of dirty tiles in the previous tile row, extended down while the next row has the same span
+    DamageRect open[DAMAGE_MAX_RECTS];
+    uint8_t openCount = 0;
+
+    for (uint16_t top = 0; top < next.height; top += DAMAGE_TILE_HEIGHT)
+    {
+        uint16_t rows = min(DAMAGE_TILE_HEIGHT, next.height - top);
+        uint64_t dirty = 0;
+        for (uint16_t row = top; row < top + rows; row++)
+        {
+            const uint32_t *a = (const uint32_t *)(shown.pixels + row * shown.stride);
+            const uint32_t *b = (const uint32_t *)(next.pixels + row * next.stride);
+            for (uint16_t word = 0; word < words; word++)
+                if (a[word] != b[word])
+                    dirty |= 1ull << (word / wordsPerTile);
+        }
+
+        DamageRect spans[DAMAGE_MAX_RECTS];
+        uint8_t spanCount = 0;
+        for (uint16_t column = 0; column < columns;)
+        {
+            if (!(dirty & (1ull << column)))
+            {
+                column++;
+                continue;
+            }
+            uint16_t first = column;
+            while (column < columns && (dirty & (1ull << column)))
+                column++;
+            uint16_t x = first * DAMAGE_TILE_WIDTH;
+            uint16_t width = min(column * DAMAGE_TILE_WIDTH, (int)next.width) - x;
+            if (spanCount < DAMAGE_MAX_RECTS)
+                spans[spanCount++] = {x, top, width, rows};
+            else
+                spans[DAMAGE_MAX_RECTS - 1] = damageUnion(spans[DAMAGE_MAX_RECTS - 1], {x, top, width, rows});
+        }
+
+        // Spans that continue downwards stay open, the rest are done
+        DamageRect stillOpen[DAMAGE_MAX_RECTS];
+        uint8_t stillOpenCount = 0;
+        for (uint8_t i = 0; i < openCount; i++)
+        {
+            bool continued = false;
+            for (uint8_t j = 0; j < spanCount && !continued; j++)
+                if (spans[j].height > 0 && spans[j].x == open[i].x && spans[j].width == open[i].width)
+                {
+                    open[i].height += rows;
+                    spans[j].height = 0;
+                    continued = true;
+                }
+            if (continued)
+                stillOpen[stillOpenCount++] = open[i];
+            else
+                damageAdd(out, open[i]);
+        }
+        for (uint8_t j = 0; j < spanCount; j++)
+            if (spans[j].height > 0 && stillOpenCount < DAMAGE_MAX_RECTS)
+                stillOpen[stillOpenCount++] = spans[j];
+        memcpy(open, stillOpen, sizeof(DamageRect) * stillOpenCount);
+        openCount = stillOpenCount;
+    }
+    for (uint8_t i = 0; i < openCount; i++)
+        damageAdd(out, open[i]);
+}
+
+/**
+ * @brief The amount of bytes sent to the display for [damage] of [buffer].
+ */
+uint32_t damageBytes(const Damage &damage, const FrameBuffer &buffer)
+{
+    if (damage.full)
+        return (uint32_t)((buffer.width + 7) / 8) * buffer.height;
+    uint32_t bytes = 0;
+    for (uint8_t i = 0; i < damage.count; i++)
+        bytes += (uint32_t)((damage.rects[i].x + damage.rects[i].width + 7) / 8 - damage.rects[i].x / 8) * damage.rects[i].height;
+    return bytes;
+}
+
+/**
+ * @brief Decides how the display is refreshed, counting the partial refreshes since the last full one.
+ */
+class DamageTracker
+{
+public:
+    /**
+     * @brief Fills [out] with what must be sent for showing [next], when [shown] is on the display. [shown] is NULL
+     * when what's on the display is not known.
+     *
+     * @return true If something must be sent.
+     */
+    bool plan(const FrameBuffer *shown, const FrameBuffer &next, Damage &out)
+    {
+        if (shown == NULL || partials >= DAMAGE_FULL_REFRESH_INTERVAL)
+            return full(next, out);
+
+        damageCompute(*shown, next, out);
+        if (out.count == 0)
+            return false;
+        // Merged rectangles cover more than the tiles changed
+        uint32_t covered = 0;
+        for (uint8_t i = 0; i < out.count; i++)
+            covered += damageArea(out.rects[i]);
+        if (covered * 100 >= (uint32_t)next.width * next.height * DAMAGE_FULL_REFRESH_PERCENT)
+            return full(next, out);
+
+        partials++;
+        damagePartialRefreshes.add();
+        damageBytesSent.add(damageBytes(out, next));
+        return true;
+    }
+
+    /**
+     * @brief Partial refreshes since the last full one.
+     */
+    uint8_t partials = 0;
+
+private:
+    bool full(const FrameBuffer &next, Damage &out)
+    {
+        out.full = true;
+        out.count = 1;
+        out.rects[0] = {0, 0, next.width, next.height};
+        partials = 0;
+        damageFullRefreshes.add();
+        damageBytesSent.add(damageBytes(out, next));
+        return true;
+    }
+};
+
+#endif
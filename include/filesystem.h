@@ -15,47 +15,234 @@
 // Include libraries
 #include <Arduino.h>
 #include <SPIFFS.h>
+#include <LittleFS.h>
+
+// Include cpp headers
+#include <vector>
 
 // Utilities
 #include "utils.h"
+#include "logger.h"
+#include "storage.h"
+#include "storage_fs.h"
+#include "score_store.h"
+
+/**
+ * @brief The maximum amount of bytes copied from SPIFFS to LittleFS. Both share the partition, so the files are kept
+ * in RAM while it's formatted. If there are more, SPIFFS is kept.
+ */
+#define STORAGE_MIGRATION_MAX_BYTES (96 * 1024)
+
+/**
+ * @brief The size of the blocks of LittleFS. Every file takes whole blocks, and the directories and the superblock
+ * take [STORAGE_MIGRATION_OVERHEAD_BLOCKS] more, so it's checked that they fit before formatting SPIFFS.
+ */
+#define STORAGE_LITTLEFS_BLOCK_SIZE 4096
+#define STORAGE_MIGRATION_OVERHEAD_BLOCKS 8
+
+/**
+ * @brief The times writing a migrated file is tried, [STORAGE_MIGRATION_RETRY_MS] apart.
+ */
+#define STORAGE_MIGRATION_RETRIES 3
+#define STORAGE_MIGRATION_RETRY_MS 100
+
+/**
+ * @brief Where the log file was stored before there were directories. It's removed instead of being migrated.
+ */
+#define STORAGE_LEGACY_LOG_PATH "/log.bin"
+
+// The backends of [storage]
+FSStorage<fs::LittleFSFS> littleFsStorage(LittleFS, true, true);
+FSStorage<fs::SPIFFSFS> spiffsStorage(SPIFFS, false, false);
+
+/**
+ * @brief A file read from SPIFFS to be written to LittleFS.
+ */
+struct MigratedFile
+{
+  String name;
+  std::vector<uint8_t> bytes;
+};
+
+/**
+ * @brief The migrated files that could not be written to LittleFS. SPIFFS is gone then, so they are only kept here,
+ * and written again by storageMigrateRetry.
+ */
+std::vector<MigratedFile> storageUnmigrated;
 
 // function defaults
 String listFiles(bool ishtml = false);
 
 // list all of the files, if ishtml=true, return html rather than simple text
 /**
- * @brief Lists all the files in the SPIFFS.
+ * @brief Lists all the uploaded scores.
  * 
  * @param backend If true, the result will be in JSON, otherwise, the result will be in a "readable" format.
- * @return String The list of files in the SPIFFS.
+ * @return String The list of scores.
  */
 String listFiles(bool backend)
 {
   String returnText = "";
-  Serial.println("Listing files stored on SPIFFS");
-  File root = SPIFFS.open("/");
-  File foundfile = root.openNextFile();
+  LOGD(LOG_FS, "Listing stored scores");
   if (backend)
     returnText += "{\"files\":[";
-  while (foundfile)
+  std::map<String, String> manifest = scoreList();
+  for (auto &entry : manifest)
   {
-    String filename = String(foundfile.name());
-    size_t filesize = foundfile.size();
-    foundfile = root.openNextFile();
+    String filename = entry.first;
+    StorageStat info;
+    size_t filesize = storage->stat(scoreBlobPath(entry.second).c_str(), info) ? info.size : 0;
+    if (backend && filename != manifest.begin()->first)
+      returnText += ",";
+
     if (backend)
-      returnText += "{\"name\":\"" + filename + "\",\"size\":\"" + String(filesize) + "\"}";
+      returnText += "{\"name\":\"" + filename + "\",\"size\":\"" + String(filesize) + "\",\"id\":\"" + entry.second + "\"}";
     else
       returnText += "File: " + filename + " Size: " + humanReadableSize(filesize) + "\n";
-      
-    if (backend && foundfile)
-      returnText += ",";
   }
   if (backend)
     returnText = returnText + "]}";
 
-  root.close();
-  foundfile.close();
   return returnText;
 }
 
+/**
+ * @brief Writes the migrated [file] into the scores directory of LittleFS, trying again if it fails.
+ *
+ * @return true If the file was written.
+ */
+bool storageMigrateWrite(const MigratedFile &file)
+{
+  String path = String(STORAGE_DIR_SCORES "/") + file.name;
+  for (int attempt = 0; attempt < STORAGE_MIGRATION_RETRIES; attempt++)
+  {
+    if (attempt > 0)
+      delay(STORAGE_MIGRATION_RETRY_MS);
+    bool written;
+    {
+      std::unique_ptr<StorageFile> target = littleFsStorage.open(path.c_str(), "w");
+      written = target && target->write(file.bytes.data(), file.bytes.size()) == file.bytes.size();
+    }
+    if (written)
+      return true;
+    littleFsStorage.remove(path.c_str());
+  }
+  return false;
+}
+
+/**
+ * @brief Writes again the migrated files that could not be written, so the catalog scan imports them. The ones that
+ * still fail are kept in RAM.
+ */
+void storageMigrateRetry()
+{
+  std::vector<MigratedFile> files;
+  files.swap(storageUnmigrated);
+  for (MigratedFile &file : files)
+    if (storageMigrateWrite(file))
+      LOGI(LOG_FS, "Migrated \"%s\".", file.name.c_str());
+    else
+    {
+      LOGE(LOG_FS, "Could not migrate \"%s\", it's only kept in RAM until rebooting.", file.name.c_str());
+      storageUnmigrated.push_back(std::move(file));
+    }
+}
+
+/**
+ * @brief Copies the files at the root of SPIFFS into the scores directory of LittleFS, formatting the partition.
+ * SPIFFS must be mounted. Files that can't be written after formatting are kept in [storageUnmigrated].
+ *
+ * @return true If LittleFS is mounted with the files.
+ * @return false If the files don't fit in RAM or in LittleFS, and SPIFFS is still mounted without changes.
+ */
+bool storageMigrate()
+{
+  std::vector<MigratedFile> files;
+  size_t total = 0;
+  size_t blocks = STORAGE_MIGRATION_OVERHEAD_BLOCKS;
+
+  spiffsStorage.list("/", [&](const char *name, size_t size)
+                     {
+    if (strcmp(name, STORAGE_LEGACY_LOG_PATH + 1) == 0)
+      return;
+    files.push_back({String(name), std::vector<uint8_t>()});
+    total += size;
+    blocks += (size + STORAGE_LITTLEFS_BLOCK_SIZE - 1) / STORAGE_LITTLEFS_BLOCK_SIZE; });
+
+  if (total > STORAGE_MIGRATION_MAX_BYTES || total > ESP.getMaxAllocHeap() / 2)
+  {
+    LOGW(LOG_FS, "%u bytes don't fit in RAM for migrating to LittleFS, keeping SPIFFS.", (unsigned)total);
+    return false;
+  }
+  // SPIFFS gives less than the partition, so it's a lower bound of what LittleFS will have
+  if (blocks * STORAGE_LITTLEFS_BLOCK_SIZE + QUOTA_RESERVE_BYTES > SPIFFS.totalBytes())
+  {
+    LOGW(LOG_FS, "%u blocks don't fit in LittleFS, keeping SPIFFS.", (unsigned)blocks);
+    return false;
+  }
+
+  for (MigratedFile &file : files)
+  {
+    std::unique_ptr<StorageFile> source = spiffsStorage.open(("/" + file.name).c_str(), "r");
+    if (!source)
+      return false;
+    file.bytes.resize(source->size());
+    if (source->read(file.bytes.data(), file.bytes.size()) != file.bytes.size())
+      return false;
+  }
+
+  LOGI(LOG_FS, "Migrating %u files (%u bytes) from SPIFFS to LittleFS...", (unsigned)files.size(), (unsigned)total);
+  SPIFFS.end();
+  if (!LittleFS.begin(true))
+  {
+    LOGE(LOG_FS, "Could not format LittleFS, keeping SPIFFS.");
+    SPIFFS.begin(false);
+    return false;
+  }
+
+  littleFsStorage.mkdir(STORAGE_DIR_SCORES);
+  // From now on the files are only in RAM
+  storageUnmigrated.swap(files);
+  storageMigrateRetry();
+  return true;
+}
+
+/**
+ * @brief Mounts the file system, and sets [storage]. LittleFS is preferred, and SPIFFS contents are migrated to it
+ * on the first boot. Files left at the root by previous versions are moved to the scores directory, where
+ * scoreStoreBegin imports them.
+ *
+ * @return true If [storage] is ready.
+ */
+bool storageBegin()
+{
+  if (LittleFS.begin(false))
+    storage = &littleFsStorage;
+  else if (SPIFFS.begin(false))
+    storage = storageMigrate() ? (Storage *)&littleFsStorage : (Storage *)&spiffsStorage;
+  else if (LittleFS.begin(true))
+    storage = &littleFsStorage;
+  else
+    return false;
+
+  storage->mkdir(STORAGE_DIR_SCORES);
+  storage->mkdir(STORAGE_DIR_CACHE);
+  storage->mkdir(STORAGE_DIR_LOGS);
+
+  std::vector<String> legacy;
+  storage->list("/", [&](const char *name, size_t size)
+                { legacy.push_back(String(name)); });
+  for (String &name : legacy)
+  {
+    String path = "/" + name;
+    if (path == STORAGE_LEGACY_LOG_PATH)
+      storage->remove(path.c_str());
+    else if (scoreNameValid(name))
+      storage->rename(path.c_str(), (STORAGE_DIR_SCORES + path).c_str());
+  }
+
+  LOGI(LOG_FS, "Mounted %s", storage == &littleFsStorage ? "LittleFS" : "SPIFFS");
+  return true;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,583 @@
+/**
+ * @file follow.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Follows the score from what's played, and turns the page a few beats before it ends. Every hop of audio is
+ * reduced to a chroma, the energy of every pitch class, by a fixed-point FFT, and aligned against the chromas of the
+ * timeline of the score with an online dynamic time warping in a window that moves with the position.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Include cpp headers
+#include <math.h>
+#include <atomic>
+#include <vector>
+
+// Include utils files
+#include "audio.h"
+#include "audio_i2s.h"
+#include "layout.h"
+#include "logger.h"
+#include "metrics.h"
+#include "pref_consts.h"
+#include "renderer.h"
+#include "timeline.h"
+
+#define FOLLOW_SAMPLE_RATE 16000
+
+/**
+ * @brief The samples analysed at once, 128 ms at 16 kHz. Long enough to tell apart the semitones from 100 Hz up.
+ */
+#define FOLLOW_FFT_BITS 11
+#define FOLLOW_FFT_SIZE (1 << FOLLOW_FFT_BITS)
+
+/**
+ * @brief The samples between analyses, 32 ms at 16 kHz.
+ */
+#define FOLLOW_HOP 512
+
+/**
+ * @brief The frequencies taken into the chroma.
+ */
+#define FOLLOW_MIN_HZ 100
+#define FOLLOW_MAX_HZ 2500
+
+/**
+ * @brief The RMS level of a hop below which it's taken as silence, and not aligned.
+ */
+#define FOLLOW_SILENCE_RMS 150
+
+/**
+ * @brief The length of a step of the score, in timeline ticks: a sixteenth.
+ */
+#define FOLLOW_STEP_TICKS (TIMELINE_TICKS_PER_QUARTER / 4)
+
+/**
+ * @brief The steps of the score aligned around the position. The position is kept in the first quarter of it, so the
+ * performance can go ahead of it by up to 12 measures of 4/4 at once.
+ */
+#define FOLLOW_WINDOW 256
+
+/**
+ * @brief The tempo assumed until it's measured, and the ones it's kept between, in 1/256 ticks per hop: 100, 30 and
+ * 240 quarters per minute.
+ */
+#define FOLLOW_DEFAULT_TEMPO 328
+#define FOLLOW_MIN_TEMPO 98
+#define FOLLOW_MAX_TEMPO 786
+
+#define FOLLOW_INFINITE (UINT32_MAX / 4)
+
+#define FOLLOW_DEFAULT_TURN_BEATS 2
+#define FOLLOW_MAX_TURN_BEATS 8
+
+#define FOLLOW_TASK_STACK_SIZE 4096
+#define FOLLOW_TASK_PRIORITY (tskIDLE_PRIORITY + 2)
+
+/**
+ * @brief The core of the follower, the renderer runs on the other one.
+ */
+#define FOLLOW_CORE 0
+
+MetricCounter followFrames;
+MetricCounter followTurns;
+MetricHistogram followFrameLatency("ems_follow_frame_seconds", "How long following a frame of audio took.");
+
+/**
+ * @brief The beats before the end of a page when it's turned.
+ */
+std::atomic<uint8_t> followTurnBeats{FOLLOW_DEFAULT_TURN_BEATS};
+
+/**
+ * @brief Whether the pages are turned by the follower. The audio is still read while disabled.
+ */
+std::atomic<bool> followEnabled{false};
+
+/**
+ * @brief Whether [followTask] is running.
+ */
+std::atomic<bool> followRunning{false};
+
+/**
+ * @brief The timeline opened by [followOpen], taken by [followTask] before the next hop.
+ */
+std::atomic<Timeline *> followOpened{NULL};
+
+/**
+ * @brief The square root of [value], rounded down.
+ */
+uint32_t followSqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    for (uint64_t bit = 1ull << 62; bit > 0; bit >>= 2)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+    }
+    return (uint32_t)root;
+}
+
+/**
+ * @brief In place radix-2 FFT of [re] and [im], in Q15, with the [cosines] and [sines] of the first half of the
+ * circle. Every stage halves the values so they don't overflow, which scales the result by 1 / FOLLOW_FFT_SIZE.
+ */
+void followFFT(int16_t *re, int16_t *im, const int16_t *cosines, const int16_t *sines)
+{
+    for (uint32_t i = 1, j = 0; i < FOLLOW_FFT_SIZE; i++)
+    {
+        uint32_t bit = FOLLOW_FFT_SIZE >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    for (uint32_t length = 2; length <= FOLLOW_FFT_SIZE; length <<= 1)
+    {
+        uint32_t half = length >> 1, stride = FOLLOW_FFT_SIZE / length;
+        for (uint32_t start = 0; start < FOLLOW_FFT_SIZE; start += length)
+            for (uint32_t k = 0; k < half; k++)
+            {
+                int32_t wr = cosines[k * stride], wi = -sines[k * stride];
+                uint32_t a = start + k, b = a + half;
+                int32_t tr = (re[b] * wr - im[b] * wi) >> 15;
+                int32_t ti = (re[b] * wi + im[b] * wr) >> 15;
+                re[b] = (re[a] - tr) >> 1;
+                im[b] = (im[a] - ti) >> 1;
+                re[a] = (re[a] + tr) >> 1;
+                im[a] = (im[a] + ti) >> 1;
+            }
+    }
+}
+
+/**
+ * @brief Aligns the audio to a timeline. Everything is allocated when created, so it can run for as long as needed.
+ */
+class ScoreFollower
+{
+public:
+    /**
+     * @brief Prepares the tables for audio at [sampleRate].
+     */
+    ScoreFollower(uint32_t sampleRate)
+    {
+        for (int i = 0; i < FOLLOW_FFT_SIZE / 2; i++)
+        {
+            cosines[i] = (int16_t)lroundf(cosf(2 * M_PI * i / FOLLOW_FFT_SIZE) * 32767);
+            sines[i] = (int16_t)lroundf(sinf(2 * M_PI * i / FOLLOW_FFT_SIZE) * 32767);
+        }
+        for (int i = 0; i < FOLLOW_FFT_SIZE; i++)
+            window[i] = (int16_t)lroundf((0.5f - 0.5f * cosf(2 * M_PI * i / FOLLOW_FFT_SIZE)) * 32767);
+        for (int bin = 0; bin < FOLLOW_FFT_SIZE / 2; bin++)
+        {
+            float hz = (float)bin * sampleRate / FOLLOW_FFT_SIZE;
+            if (hz < FOLLOW_MIN_HZ || hz > FOLLOW_MAX_HZ)
+            {
+                binClasses[bin] = 0xFF;
+                continue;
+            }
+            int midi = (int)lroundf(69 + 12 * log2f(hz / 440));
+            binClasses[bin] = midi % 12;
+        }
+        memset(history, 0, sizeof(history));
+    }
+
+    /**
+     * @brief Starts following [timeline] from its beginning.
+     */
+    void open(const Timeline &timeline)
+    {
+        steps.clear();
+        pages = timeline.pages;
+        uint32_t end = pages.empty() ? 0 : pages.back().end;
+        std::vector<uint16_t> masks(end / FOLLOW_STEP_TICKS + 1, 0);
+        for (const TimelineNote &note : timeline.notes)
+        {
+            // Notes shorter than a step still take the step they start in
+            uint32_t first = note.tick / FOLLOW_STEP_TICKS;
+            uint32_t last = max(first, (note.tick + note.duration - 1) / FOLLOW_STEP_TICKS);
+            for (uint32_t step = first; step <= last && step < masks.size(); step++)
+                masks[step] |= 1 << (note.pitch % 12);
+        }
+        // Silence is not aligned, neither are the rests
+        for (size_t step = 0; step < masks.size(); step++)
+            if (masks[step] != 0)
+                steps.push_back({masks[step], (uint16_t)step, followTemplateNorm(masks[step])});
+        frames = 0;
+        low = 0;
+        position = 0;
+        hops = 0;
+        regionTick = 0;
+        regionHop = 0;
+        regionEnd = 0;
+        tempo = FOLLOW_DEFAULT_TEMPO;
+    }
+
+    /**
+     * @brief Takes the next FOLLOW_HOP samples of [hop].
+     *
+     * @return true If the hop was aligned, it wasn't silence.
+     */
+    bool push(const int16_t *hop)
+    {
+        hops++;
+        memmove(history, history + FOLLOW_HOP, (FOLLOW_FFT_SIZE - FOLLOW_HOP) * sizeof(int16_t));
+        memcpy(history + FOLLOW_FFT_SIZE - FOLLOW_HOP, hop, FOLLOW_HOP * sizeof(int16_t));
+
+        uint64_t energy = 0;
+        for (int i = 0; i < FOLLOW_HOP; i++)
+            energy += hop[i] * hop[i];
+        if (energy < (uint64_t)FOLLOW_SILENCE_RMS * FOLLOW_SILENCE_RMS * FOLLOW_HOP || steps.empty())
+            return false;
+
+        uint8_t chroma[12];
+        computeChroma(chroma);
+        align(chroma);
+        return true;
+    }
+
+    /**
+     * @brief Where the performance is, in timeline ticks.
+     */
+    uint32_t tick() const
+    {
+        if (steps.empty())
+            return 0;
+        return min(regionTick + (hops - regionHop) * tempo / 256, regionEnd);
+    }
+
+    /**
+     * @brief The page the performance is in, or the one after it if it's [beats] beats from its end.
+     */
+    int32_t page(uint8_t beats) const
+    {
+        return timelinePage(pages, tick(), beats);
+    }
+
+    /**
+     * @brief The hops aligned since the timeline was opened.
+     */
+    uint32_t frames = 0;
+
+private:
+    /**
+     * @brief A step of the score with sound: the pitch classes sounding, where it is, and the norm of its template.
+     */
+    struct Step
+    {
+        uint16_t mask;
+        uint16_t step;
+        uint16_t norm;
+    };
+
+    /**
+     * @brief Adds the weight of the pitch classes of the first harmonics of the notes of [mask] into [out]. The
+     * octaves fall in the same pitch class, the third harmonic a fifth up, and the fifth harmonic a third up.
+     */
+    static void followTemplate(uint16_t mask, uint8_t *out)
+    {
+        memset(out, 0, 12);
+        for (int pitchClass = 0; pitchClass < 12; pitchClass++)
+            if (mask & (1 << pitchClass))
+            {
+                out[pitchClass] += 6;
+                out[(pitchClass + 7) % 12] += 2;
+                out[(pitchClass + 4) % 12] += 1;
+            }
+    }
+
+    /**
+     * @brief The norm of the template of [mask], in Q4.
+     */
+    static uint16_t followTemplateNorm(uint16_t mask)
+    {
+        uint8_t weights[12];
+        followTemplate(mask, weights);
+        uint32_t squares = 0;
+        for (int i = 0; i < 12; i++)
+            squares += weights[i] * weights[i];
+        return followSqrt((uint64_t)squares << 8);
+    }
+
+    /**
+     * @brief Fills [chroma] with the magnitude of every pitch class in the last FOLLOW_FFT_SIZE samples, relative to
+     * the loudest one, from 0 to 255.
+     */
+    void computeChroma(uint8_t *chroma)
+    {
+        // Block floating point: the samples are scaled up to the full range, the chroma is relative anyway
+        int32_t peak = 1;
+        for (int i = 0; i < FOLLOW_FFT_SIZE; i++)
+            peak = max(peak, abs((int32_t)history[i]));
+        int shift = 0;
+        while ((peak << (shift + 1)) < 32768)
+            shift++;
+        for (int i = 0; i < FOLLOW_FFT_SIZE; i++)
+        {
+            re[i] = (int16_t)(((history[i] << shift) * window[i]) >> 15);
+            im[i] = 0;
+        }
+        followFFT(re, im, cosines, sines);
+
+        uint64_t energies[12] = {};
+        for (int bin = 0; bin < FOLLOW_FFT_SIZE / 2; bin++)
+            if (binClasses[bin] != 0xFF)
+                energies[binClasses[bin]] += (uint32_t)(re[bin] * re[bin]) + (uint32_t)(im[bin] * im[bin]);
+        uint64_t loudest = 1;
+        for (int i = 0; i < 12; i++)
+            loudest = max(loudest, energies[i]);
+        for (int i = 0; i < 12; i++)
+            chroma[i] = min(followSqrt((energies[i] << 16) / loudest), (uint32_t)255);
+    }
+
+    /**
+     * @brief The cost of matching [chroma], with norm [norm] in Q4, to [step], from 0 to 256.
+     */
+    uint32_t distance(const uint8_t *chroma, uint32_t norm, const Step &step)
+    {
+        uint8_t weights[12];
+        followTemplate(step.mask, weights);
+        uint32_t dot = 0;
+        for (int i = 0; i < 12; i++)
+            dot += chroma[i] * weights[i];
+        uint32_t cosine = ((uint64_t)dot << 16) / max((uint64_t)norm * step.norm, (uint64_t)1);
+        return 256 - min(cosine, (uint32_t)256);
+    }
+
+    /**
+     * @brief Extends the alignment with the frame of [chroma]. Every cell of the window takes the cheapest of staying
+     * in the step, which the performance being slower, of going to the next step, or of going through more than one
+     * step in the frame, when faster. The position is the cell with the lowest cost along its path, which falls
+     * behind in the notes held, so the tick in them is taken from the tempo by [track].
+     */
+    void align(const uint8_t *chroma)
+    {
+        uint32_t squares = 0;
+        for (int i = 0; i < 12; i++)
+            squares += chroma[i] * chroma[i];
+        uint32_t norm = followSqrt((uint64_t)squares << 8);
+
+        uint32_t *previous = costs[frames % 2], *current = costs[(frames + 1) % 2];
+        for (uint32_t j = 0; j < FOLLOW_WINDOW; j++)
+        {
+            uint32_t step = low + j;
+            if (step >= steps.size())
+            {
+                current[j] = FOLLOW_INFINITE;
+                continue;
+            }
+            uint32_t cost = distance(chroma, norm, steps[step]);
+            uint32_t best = FOLLOW_INFINITE;
+            if (frames == 0)
+                best = step == 0 ? 2 * cost : current[j - 1] + cost;
+            else
+            {
+                best = previous[j] + cost;
+                if (j > 0)
+                    best = min(best, min(previous[j - 1] + cost, current[j - 1] + cost));
+            }
+            current[j] = min(best, (uint32_t)FOLLOW_INFINITE);
+        }
+        frames++;
+
+        uint32_t best = 0;
+        for (uint32_t j = 1; j < FOLLOW_WINDOW && low + j < steps.size(); j++)
+            if (current[j] < current[best])
+                best = j;
+        position = low + best;
+        track();
+
+        if (best > FOLLOW_WINDOW / 2)
+        {
+            uint32_t shift = best - FOLLOW_WINDOW / 4;
+            memmove(current, current + shift, (FOLLOW_WINDOW - shift) * sizeof(uint32_t));
+            for (uint32_t j = FOLLOW_WINDOW - shift; j < FOLLOW_WINDOW; j++)
+                current[j] = FOLLOW_INFINITE;
+            low += shift;
+        }
+    }
+
+    /**
+     * @brief Follows the tempo from the time between the changes of the notes sounding. The notes sounding along
+     * some steps match all of them alike, so the position in them is taken from the tempo.
+     */
+    void track()
+    {
+        uint32_t first = position, last = position;
+        while (first > 0 && steps[first - 1].mask == steps[position].mask && steps[first - 1].step + 1 == steps[first].step)
+            first--;
+        while (last + 1 < steps.size() && steps[last + 1].mask == steps[position].mask && steps[last + 1].step == steps[last].step + 1)
+            last++;
+        uint32_t tick = steps[first].step * FOLLOW_STEP_TICKS;
+        if (tick == regionTick && frames > 1)
+            return;
+        if (tick > regionTick && hops > regionHop && frames > 1)
+        {
+            uint32_t measured = (tick - regionTick) * 256 / (hops - regionHop);
+            tempo = min(max((3 * tempo + measured) / 4, (uint32_t)FOLLOW_MIN_TEMPO), (uint32_t)FOLLOW_MAX_TEMPO);
+        }
+        regionTick = tick;
+        regionHop = hops;
+        regionEnd = (steps[last].step + 1) * FOLLOW_STEP_TICKS - 1;
+    }
+
+    /**
+     * @brief The hops taken since the timeline was opened, silent ones included.
+     */
+    uint32_t hops = 0;
+
+    /**
+     * @brief The steps with the same notes sounding as the position: where they start and end, in timeline ticks, and
+     * the hop the position got to them.
+     */
+    uint32_t regionTick = 0;
+    uint32_t regionHop = 0;
+    uint32_t regionEnd = 0;
+
+    /**
+     * @brief In 1/256 timeline ticks per hop.
+     */
+    uint32_t tempo = FOLLOW_DEFAULT_TEMPO;
+
+    int16_t history[FOLLOW_FFT_SIZE];
+    int16_t re[FOLLOW_FFT_SIZE];
+    int16_t im[FOLLOW_FFT_SIZE];
+    int16_t window[FOLLOW_FFT_SIZE];
+    int16_t cosines[FOLLOW_FFT_SIZE / 2];
+    int16_t sines[FOLLOW_FFT_SIZE / 2];
+
+    /**
+     * @brief The pitch class of every bin, or 0xFF if it's out of the range taken.
+     */
+    uint8_t binClasses[FOLLOW_FFT_SIZE / 2];
+
+    std::vector<Step> steps;
+    std::vector<TimelinePage> pages;
+
+    /**
+     * @brief The costs of the cells of the window for the last frame and the next one.
+     */
+    uint32_t costs[2][FOLLOW_WINDOW];
+
+    /**
+     * @brief The first step of the window, and the step of the position.
+     */
+    uint32_t low = 0;
+    uint32_t position = 0;
+};
+
+ScoreFollower *follower = NULL;
+
+/**
+ * @brief The last page turned to by the follower since the score was opened. Only used by [followTask].
+ */
+int32_t followTurned = 0;
+
+/**
+ * @brief Turns the page once the performance gets near its end.
+ */
+void followCheck()
+{
+    int32_t page = follower->page(followTurnBeats.load());
+    if (page <= followTurned)
+        return;
+    renderTurn(page - followTurned);
+    followTurns.add();
+    followTurned = page;
+}
+
+void followTask(void *parameter)
+{
+    AudioSource *source = (AudioSource *)parameter;
+    int16_t hop[FOLLOW_HOP];
+    while (source->read(hop, FOLLOW_HOP) == FOLLOW_HOP)
+    {
+        Timeline *opened = followOpened.exchange(NULL);
+        if (opened)
+        {
+            follower->open(*opened);
+            followTurned = 0;
+            delete opened;
+        }
+        if (!followEnabled.load())
+            continue;
+
+        bool aligned;
+        {
+            MetricTimer timer(followFrameLatency);
+            aligned = follower->push(hop);
+        }
+        followFrames.add();
+        if (aligned)
+            followCheck();
+    }
+    LOGI(LOG_MUSIC, "The audio of the follower ended");
+    delete source;
+    followRunning = false;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Follows [layout] from its first page. The follower keeps the timeline, so [layout] can be freed.
+ */
+void followOpen(const Layout &layout)
+{
+    delete followOpened.exchange(new Timeline(layout.timeline));
+}
+
+/**
+ * @brief Starts following the audio of [source], which is deleted when it ends.
+ *
+ * @return true If the follower started.
+ */
+bool followStart(AudioSource *source)
+{
+    if (followRunning.exchange(true))
+    {
+        delete source;
+        return false;
+    }
+    if (follower == NULL)
+        follower = new ScoreFollower(source->sampleRate());
+    xTaskCreatePinnedToCore(followTask, "follow", FOLLOW_TASK_STACK_SIZE, source, FOLLOW_TASK_PRIORITY, NULL, FOLLOW_CORE);
+    return true;
+}
+
+/**
+ * @brief Starts following the microphone, if enabled in the preferences.
+ */
+void followBegin()
+{
+    followTurnBeats = preferences.getUChar(pref_followBeats, FOLLOW_DEFAULT_TURN_BEATS);
+    followEnabled = preferences.getBool(pref_followEnabled, false);
+    if (!followEnabled.load())
+        return;
+    I2sAudioSource *microphone = new I2sAudioSource();
+    if (!microphone->begin(FOLLOW_SAMPLE_RATE))
+    {
+        delete microphone;
+        return;
+    }
+    followStart(microphone);
+}
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file glyphs.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief The bitmaps of the music glyphs, rasterized from a SMuFL font when building by glyph_atlas.py, and kept in
+ * flash. Every size is rendered for a staff space, and glyphs are drawn from shapes when their size isn't in the atlas.
+ * @version 0.1
+ * @date 2022-03-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef GLYPHS_H
+#define GLYPHS_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include utils files
+#include "layout.h"
+
+/**
+ * @brief The coverage from which a pixel is set when drawing into 1-bit buffers, from 0 to 15.
+ */
+#define GLYPH_THRESHOLD 8
+
+/**
+ * @brief A glyph of the atlas. Its runs are [length] bytes at [offset] of [glyphAtlasRuns], every one with the
+ * coverage in the high nibble and the length minus 1 in the low one, going through the rows of the bitmap.
+ */
+struct GlyphBitmap
+{
+    uint32_t offset;
+    uint16_t length;
+    uint16_t width;
+    uint16_t height;
+
+    /**
+     * @brief Where the top left corner of the bitmap is from the origin of the glyph, in pixels.
+     */
+    int16_t left;
+    int16_t top;
+};
+
+// The tests take an atlas of their own
+#ifdef GLYPH_ATLAS_HEADER
+#include GLYPH_ATLAS_HEADER
+#else
+#include "glyph_atlas.h"
+#endif
+
+/**
+ * @brief Gives the bitmap of [glyph] for [space] pixels between staff lines, or NULL if the atlas doesn't have it.
+ */
+const GlyphBitmap *glyphFind(uint16_t glyph, uint8_t space)
+{
+    if (glyph >= GLYPH_COUNT)
+        return NULL;
+    for (int size = 0; size < GLYPH_ATLAS_SIZES; size++)
+        if (glyphAtlasSpaces[size] == space)
+            return glyphAtlasBitmaps[size][glyph].length > 0 ? &glyphAtlasBitmaps[size][glyph] : NULL;
+    return NULL;
+}
+
+/**
+ * @brief Calls [span] with the position and the length of every run of [bitmap] with coverage, split at the end of
+ * the rows.
+ */
+template <typename Span>
+void glyphRuns(const GlyphBitmap &bitmap, Span span)
+{
+    const uint8_t *run = glyphAtlasRuns + bitmap.offset;
+    const uint8_t *end = run + bitmap.length;
+    uint16_t x = 0, y = 0;
+    for (; run < end; run++)
+    {
+        uint8_t level = *run >> 4;
+        uint16_t length = (*run & 0x0f) + 1;
+        while (length > 0)
+        {
+            uint16_t count = min(length, (uint16_t)(bitmap.width - x));
+            if (level > 0)
+                span(x, y, count, level);
+            length -= count;
+            x += count;
+            if (x == bitmap.width)
+            {
+                x = 0;
+                y++;
+            }
+        }
+    }
+}
+
+#endif
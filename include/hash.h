@@ -17,36 +17,66 @@
 #include <Arduino.h>
 
 /**
- * @brief Returns a hash of the [payload] as a [String].
- * 
- * @param payload The text to hash.
- * @return String The hashed text.
+ * @brief Computes the SHA-256 of some data received in chunks, such as an upload.
  */
-String hash(const char *payload)
+class HashBuilder
 {
-  byte shaResult[32];
-
-  mbedtls_md_context_t ctx;
-  mbedtls_md_type_t md_type = MBEDTLS_MD_SHA256;
+public:
+  HashBuilder()
+  {
+    mbedtls_md_init(&ctx);
+    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+    mbedtls_md_starts(&ctx);
+  }
 
-  const size_t payloadLength = strlen(payload);
+  ~HashBuilder()
+  {
+    mbedtls_md_free(&ctx);
+  }
 
-  mbedtls_md_init(&ctx);
-  mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(md_type), 0);
-  mbedtls_md_starts(&ctx);
-  mbedtls_md_update(&ctx, (const unsigned char *)payload, payloadLength);
-  mbedtls_md_finish(&ctx, shaResult);
-  mbedtls_md_free(&ctx);
+  /**
+   * @brief Adds [len] bytes of [data] to the hash.
+   */
+  void update(const uint8_t *data, size_t len)
+  {
+    mbedtls_md_update(&ctx, (const unsigned char *)data, len);
+  }
 
-  String builder = "";
-  for (int i = 0; i < sizeof(shaResult); i++)
+  /**
+   * @brief Finishes the hash. The builder can't be updated anymore.
+   *
+   * @return String The hash as 64 hex characters.
+   */
+  String finish()
   {
-    char str[3];
-    sprintf(str, "%02x", (int)shaResult[i]);
-    builder += str;
+    byte shaResult[32];
+    mbedtls_md_finish(&ctx, shaResult);
+
+    String builder = "";
+    for (int i = 0; i < sizeof(shaResult); i++)
+    {
+      char str[3];
+      sprintf(str, "%02x", (int)shaResult[i]);
+      builder += str;
+    }
+    return builder;
   }
 
-  return builder;
+private:
+  mbedtls_md_context_t ctx;
+};
+
+/**
+ * @brief Returns a hash of the [payload] as a [String].
+ * 
+ * @param payload The text to hash.
+ * @return String The hashed text.
+ */
+String hash(const char *payload)
+{
+  HashBuilder builder;
+  builder.update((const uint8_t *)payload, strlen(payload));
+  return builder.finish();
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,1147 @@
+/**
+ * @file layout.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Breaks scores into systems and pages for a display, producing a list of glyphs to draw for every page. The
+ * lists are cached next to the score, keyed by a hash of everything a page is made from, so when the geometry, the
+ * transposition or the score change, only the pages that differ are laid out again. Drawing a page is then a replay
+ * of its list.
+ * @version 0.1
+ * @date 2022-03-04
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+// Include libraries
+#include <Arduino.h>
+#include "mx/api/ScoreData.h"
+
+// Include cpp headers
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+// Include utils files
+#include "logger.h"
+#include "metrics.h"
+#include "musicxml.h"
+#include "pref_consts.h"
+#include "score_store.h"
+#include "storage_quota.h"
+#include "timeline.h"
+
+/**
+ * @brief The display the pages are laid out for by default, in pixels.
+ */
+#define LAYOUT_DEFAULT_WIDTH 800
+#define LAYOUT_DEFAULT_HEIGHT 480
+
+/**
+ * @brief The default distance between the lines of a staff, in pixels. Every other distance is relative to it.
+ */
+#define LAYOUT_DEFAULT_STAFF_SPACE 8
+
+/**
+ * @brief Changed whenever the output of the layout changes, so the lists cached by previous versions are not used.
+ */
+#define LAYOUT_VERSION 2
+
+#define LAYOUT_PAGE_MAGIC 0x4c444d45  // "EMDL"
+#define LAYOUT_INDEX_MAGIC 0x494c4d45 // "EMLI"
+
+/**
+ * @brief The amount of items read at once when replaying a page.
+ */
+#define LAYOUT_REPLAY_BATCH 64
+
+// Distances, in staff spaces
+#define LAYOUT_MARGIN 2
+#define LAYOUT_MARGIN_TOP 4
+#define LAYOUT_STAFF_DISTANCE 9
+#define LAYOUT_SYSTEM_DISTANCE 11
+#define LAYOUT_CLEF_WIDTH 3.5f
+#define LAYOUT_KEY_WIDTH 1.0f
+#define LAYOUT_TIME_WIDTH 2.5f
+#define LAYOUT_MEASURE_PADDING 1.5f
+#define LAYOUT_ACCIDENTAL_WIDTH 1.2f
+
+/**
+ * @brief The symbols of a display list. Lines are drawn from the position given: staves up to the right margin,
+ * barlines down to the bottom of the staff, and stems 3.5 spaces up or down.
+ */
+enum Glyph : uint16_t
+{
+    GLYPH_STAFF,
+    GLYPH_BARLINE,
+    GLYPH_BARLINE_FINAL,
+    GLYPH_CLEF_G,
+    GLYPH_CLEF_F,
+    GLYPH_CLEF_C,
+    GLYPH_TIME_0,
+    GLYPH_TIME_9 = GLYPH_TIME_0 + 9,
+    GLYPH_SHARP,
+    GLYPH_FLAT,
+    GLYPH_NATURAL,
+    GLYPH_DOUBLE_SHARP,
+    GLYPH_DOUBLE_FLAT,
+    GLYPH_NOTEHEAD_WHOLE,
+    GLYPH_NOTEHEAD_HALF,
+    GLYPH_NOTEHEAD_BLACK,
+    GLYPH_STEM_UP,
+    GLYPH_STEM_DOWN,
+    GLYPH_FLAG_8TH_UP,
+    GLYPH_FLAG_8TH_DOWN,
+    GLYPH_FLAG_16TH_UP,
+    GLYPH_FLAG_16TH_DOWN,
+    GLYPH_FLAG_32ND_UP,
+    GLYPH_FLAG_32ND_DOWN,
+    GLYPH_REST_WHOLE,
+    GLYPH_REST_HALF,
+    GLYPH_REST_QUARTER,
+    GLYPH_REST_8TH,
+    GLYPH_REST_16TH,
+    GLYPH_REST_32ND,
+    GLYPH_DOT,
+    GLYPH_LEDGER,
+    GLYPH_COUNT
+};
+
+/**
+ * @brief A glyph placed on the page, in pixels from the top left corner.
+ */
+struct DisplayItem
+{
+    uint16_t glyph;
+    int16_t x;
+    int16_t y;
+};
+
+/**
+ * @brief What the pages are laid out for.
+ */
+struct LayoutGeometry
+{
+    uint16_t width;
+    uint16_t height;
+    uint8_t staffSpace;
+
+    /**
+     * @brief The semitones every note is moved by.
+     */
+    int8_t transpose;
+};
+
+/**
+ * @brief The pages of a laid out score. Every page is identified by the hash of what it's made from.
+ */
+struct Layout
+{
+    String id;
+    std::vector<uint32_t> pages;
+    Timeline timeline;
+};
+
+LayoutGeometry layoutGeometry = {LAYOUT_DEFAULT_WIDTH, LAYOUT_DEFAULT_HEIGHT, LAYOUT_DEFAULT_STAFF_SPACE, 0};
+
+/**
+ * @brief The score currently open, laid out for [layoutGeometry].
+ */
+Layout scoreLayout;
+
+/**
+ * @brief Called by [layoutBuild] with every score it lays out, so what's read from it can be kept. Set by the score
+ * index.
+ */
+void (*layoutParsed)(const String &id, const mx::api::ScoreData &score) = NULL;
+
+MetricCounter layoutPagesBuilt;
+MetricCounter layoutPagesReused;
+MetricHistogram layoutLatency("ems_layout_duration_seconds", "How long laying out a score took.");
+
+/**
+ * @brief Adds [len] bytes of [data] to the FNV-1a hash [hash].
+ */
+uint32_t layoutHash(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+uint32_t layoutHashInt(uint32_t hash, int32_t value)
+{
+    return layoutHash(hash, &value, sizeof(value));
+}
+
+#define LAYOUT_HASH_SEED 2166136261u
+
+/**
+ * @brief How a staff is drawn from some measure on.
+ */
+struct LayoutStaffState
+{
+    uint16_t clefGlyph;
+
+    /**
+     * @brief The pitch of the bottom line, in steps from C0.
+     */
+    int8_t bottom;
+
+    /**
+     * @brief The line the clef sits on, from 1 at the bottom.
+     */
+    int8_t clefLine;
+
+    /**
+     * @brief The shift of the key signature from where it goes in the treble clef, in steps.
+     */
+    int8_t keyShift;
+
+    /**
+     * @brief The key signature, already transposed.
+     */
+    int8_t fifths;
+};
+
+struct LayoutOnset
+{
+    int tick;
+
+    /**
+     * @brief The distance from the start of the notes of the measure, in staff spaces.
+     */
+    float offset;
+};
+
+/**
+ * @brief What the layout needs to know about a measure, taken from all the parts.
+ */
+struct LayoutMeasure
+{
+    /**
+     * @brief The state of every staff once the attributes of the measure are applied.
+     */
+    std::vector<LayoutStaffState> staves;
+
+    /**
+     * @brief Which staves change their clef or key signature in this measure.
+     */
+    std::vector<bool> changes;
+    bool timeChange;
+    int beats;
+    int beatType;
+
+    std::vector<LayoutOnset> onsets;
+
+    /**
+     * @brief The width of the notes, without the attributes, in staff spaces.
+     */
+    float notesWidth;
+    uint32_t hash;
+};
+
+/**
+ * @brief Gives the state of a staff with [clef], keeping the key signature.
+ */
+LayoutStaffState layoutClef(const mx::api::ClefData &clef, int8_t fifths)
+{
+    using namespace mx::api;
+    LayoutStaffState state;
+    int line = clef.line > 0 ? clef.line : 2;
+    // The pitch of the line the clef sits on
+    int anchor = 32;
+    state.clefGlyph = GLYPH_CLEF_G;
+    state.keyShift = 0;
+    if (clef.symbol == ClefSymbol::f)
+    {
+        anchor = 24;
+        state.clefGlyph = GLYPH_CLEF_F;
+        state.keyShift = -2;
+    }
+    else if (clef.symbol == ClefSymbol::c)
+    {
+        anchor = 28;
+        state.clefGlyph = GLYPH_CLEF_C;
+        state.keyShift = -1;
+    }
+    state.bottom = anchor - (line - 1) * 2 + clef.octaveChange * 7;
+    state.clefLine = line;
+    state.fifths = fifths;
+    return state;
+}
+
+/**
+ * @brief Moves [fifths] by [semitones], keeping it between 6 flats and 6 sharps.
+ */
+int8_t layoutTransposeKey(int fifths, int semitones)
+{
+    if (semitones == 0)
+        return fifths;
+    int key = ((fifths + 7 * semitones) % 12 + 12) % 12;
+    return key > 6 ? key - 12 : key;
+}
+
+/**
+ * @brief Gives the alteration of [step] (0 for C) in the key with [fifths].
+ */
+int layoutKeyAlter(int step, int fifths)
+{
+    // The steps of the sharps, the flats go in the opposite order
+    const int order[7] = {3, 0, 4, 1, 5, 2, 6};
+    for (int i = 0; i < abs(fifths); i++)
+        if ((fifths > 0 ? order[i] : order[6 - i]) == step)
+            return fifths > 0 ? 1 : -1;
+    return 0;
+}
+
+/**
+ * @brief Gives the written pitch of [pitch] moved by [semitones], in steps from C0, and its alteration in [alter].
+ * Moved notes are spelled with sharps in sharp keys, and with flats in flat keys.
+ */
+int layoutPitch(const mx::api::PitchData &pitch, int semitones, int fifths, int &alter)
+{
+    int step = (int)pitch.step;
+    if (semitones == 0)
+    {
+        alter = pitch.alter;
+        return pitch.octave * 7 + step;
+    }
+
+    const int stepSemitones[7] = {0, 2, 4, 5, 7, 9, 11};
+    const int sharpSteps[12] = {0, 0, 1, 1, 2, 3, 3, 4, 4, 5, 5, 6};
+    const int flatSteps[12] = {0, 1, 1, 2, 2, 3, 4, 4, 5, 5, 6, 6};
+    int midi = pitch.octave * 12 + stepSemitones[step] + pitch.alter + semitones;
+    int octave = midi >= 0 ? midi / 12 : (midi - 11) / 12;
+    int pitchClass = midi - octave * 12;
+    step = fifths < 0 ? flatSteps[pitchClass] : sharpSteps[pitchClass];
+    alter = pitchClass - stepSemitones[step];
+    return octave * 7 + step;
+}
+
+/**
+ * @brief Gives the length of a note of type [name] in quarters, without dots.
+ */
+float layoutNameQuarters(mx::api::DurationName name)
+{
+    using namespace mx::api;
+    switch (name)
+    {
+    case DurationName::breve:
+        return 8;
+    case DurationName::whole:
+        return 4;
+    case DurationName::half:
+        return 2;
+    case DurationName::eighth:
+        return 0.5f;
+    case DurationName::dur16th:
+        return 0.25f;
+    case DurationName::dur32nd:
+        return 0.125f;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * @brief Gives the length of [note] in quarters.
+ */
+float layoutQuarters(const mx::api::NoteData &note, int ticksPerQuarter)
+{
+    if (ticksPerQuarter > 0 && note.durationData.durationTimeTicks > 0)
+        return (float)note.durationData.durationTimeTicks / ticksPerQuarter;
+    return layoutNameQuarters(note.durationData.durationName);
+}
+
+/**
+ * @brief Gives the space taken by a note lasting [quarters], in staff spaces. Grows with the logarithm of the length,
+ * as engravers do.
+ */
+float layoutSpacing(float quarters)
+{
+    return std::max(1.6f, 3.5f + 1.2f * log2f(quarters));
+}
+
+/**
+ * @brief Gives the staves of every part, which is the most used by any of its measures.
+ */
+std::vector<int> layoutPartStaves(const mx::api::ScoreData &score)
+{
+    std::vector<int> staves;
+    for (const auto &part : score.parts)
+    {
+        size_t count = 1;
+        for (const auto &measure : part.measures)
+            count = std::max(count, measure.staves.size());
+        staves.push_back(count);
+    }
+    return staves;
+}
+
+/**
+ * @brief Collects the attributes, onsets and widths of every measure of [score].
+ */
+std::vector<LayoutMeasure> layoutMeasures(const mx::api::ScoreData &score, const std::vector<int> &partStaves, int transpose)
+{
+    using namespace mx::api;
+    size_t measureCount = score.parts.empty() ? 0 : score.parts[0].measures.size();
+    std::vector<LayoutMeasure> measures(measureCount);
+
+    // Treble clef by default, and bass for the second staff of a part
+    std::vector<LayoutStaffState> state;
+    for (int staves : partStaves)
+        for (int s = 0; s < staves; s++)
+        {
+            ClefData clef;
+            if (s == 1)
+            {
+                clef.symbol = ClefSymbol::f;
+                clef.line = 4;
+            }
+            state.push_back(layoutClef(clef, layoutTransposeKey(0, transpose)));
+        }
+    int beats = 4;
+    int beatType = 4;
+
+    for (size_t m = 0; m < measureCount; m++)
+    {
+        LayoutMeasure &measure = measures[m];
+        measure.changes.assign(state.size(), m == 0);
+        measure.timeChange = m == 0;
+        uint32_t hash = LAYOUT_HASH_SEED;
+        std::vector<std::pair<int, float>> starts;
+        bool accidentals = false;
+
+        size_t first = 0;
+        for (size_t p = 0; p < score.parts.size(); first += partStaves[p], p++)
+        {
+            if (m >= score.parts[p].measures.size())
+                continue;
+            const MeasureData &data = score.parts[p].measures[m];
+
+            if (!data.timeSignature.isImplicit && (data.timeSignature.beats != beats || data.timeSignature.beatType != beatType))
+            {
+                beats = data.timeSignature.beats;
+                beatType = data.timeSignature.beatType;
+                measure.timeChange = true;
+            }
+            for (const KeyData &key : data.keys)
+                for (int s = 0; s < partStaves[p]; s++)
+                {
+                    int8_t fifths = layoutTransposeKey(key.fifths, transpose);
+                    measure.changes[first + s] = measure.changes[first + s] || state[first + s].fifths != fifths;
+                    state[first + s].fifths = fifths;
+                    hash = layoutHashInt(hash, key.fifths);
+                }
+
+            for (size_t s = 0; s < data.staves.size() && (int)s < partStaves[p]; s++)
+            {
+                const StaffData &staff = data.staves[s];
+                for (const ClefData &clef : staff.clefs)
+                {
+                    if (clef.tickTimePosition != 0)
+                        continue;
+                    LayoutStaffState changed = layoutClef(clef, state[first + s].fifths);
+                    measure.changes[first + s] = measure.changes[first + s] || changed.bottom != state[first + s].bottom || changed.clefGlyph != state[first + s].clefGlyph;
+                    state[first + s] = changed;
+                    hash = layoutHashInt(hash, (int)clef.symbol * 16 + clef.line);
+                }
+
+                for (const auto &voice : staff.voices)
+                    for (const NoteData &note : voice.second.notes)
+                    {
+                        float quarters = layoutQuarters(note, score.ticksPerQuarter);
+                        starts.push_back({note.tickTimePosition, quarters});
+                        accidentals |= !note.isRest && note.pitchData.alter != 0;
+
+                        int32_t fields[] = {(int32_t)(first + s), voice.first, note.isRest, note.isChord, (int)note.pitchData.step,
+                                            note.pitchData.alter, note.pitchData.octave, (int)note.durationData.durationName,
+                                            note.durationData.durationDots, note.tickTimePosition, note.durationData.durationTimeTicks};
+                        hash = layoutHash(hash, fields, sizeof(fields));
+                    }
+            }
+        }
+
+        // Every onset gets the space of the shortest note starting there
+        std::sort(starts.begin(), starts.end());
+        float offset = accidentals ? LAYOUT_ACCIDENTAL_WIDTH : 0;
+        for (size_t i = 0; i < starts.size(); i++)
+        {
+            if (i > 0 && starts[i].first == starts[i - 1].first)
+                continue;
+            measure.onsets.push_back({starts[i].first, offset});
+            offset += layoutSpacing(starts[i].second);
+        }
+        measure.notesWidth = std::max(offset, 4.0f) + LAYOUT_MEASURE_PADDING;
+        measure.staves = state;
+        measure.beats = beats;
+        measure.beatType = beatType;
+        hash = layoutHashInt(hash, beats * 256 + beatType);
+        // What's drawn also depends on the measures before, and the spacing on the ticks of a quarter
+        hash = layoutHashInt(hash, measure.timeChange);
+        for (bool changed : measure.changes)
+            hash = layoutHashInt(hash, changed);
+        hash = layoutHashInt(hash, score.ticksPerQuarter);
+        measure.hash = hash;
+    }
+    return measures;
+}
+
+/**
+ * @brief Gives the width taken by the key signature and clef of [state], in staff spaces.
+ */
+float layoutHeaderWidth(const std::vector<LayoutStaffState> &staves)
+{
+    int accidentals = 0;
+    for (const LayoutStaffState &staff : staves)
+        accidentals = std::max(accidentals, abs(staff.fifths));
+    return LAYOUT_CLEF_WIDTH + accidentals * LAYOUT_KEY_WIDTH + 1;
+}
+
+/**
+ * @brief Gives the width of the attributes drawn at the start of [measure], in staff spaces. At the start of a system
+ * the clefs and keys are already in the header.
+ */
+float layoutAttributesWidth(const LayoutMeasure &measure, bool systemStart)
+{
+    float width = measure.timeChange ? LAYOUT_TIME_WIDTH : 0;
+    if (systemStart)
+        return width;
+    int accidentals = 0;
+    bool clef = false;
+    for (size_t s = 0; s < measure.staves.size(); s++)
+        if (measure.changes[s])
+        {
+            clef = true;
+            accidentals = std::max(accidentals, abs(measure.staves[s].fifths));
+        }
+    return width + (clef ? LAYOUT_CLEF_WIDTH + accidentals * LAYOUT_KEY_WIDTH : 0);
+}
+
+/**
+ * @brief Builds display lists in pixels, from positions in staff spaces.
+ */
+class DisplayListBuilder
+{
+public:
+    DisplayListBuilder(float space) : space(space) {}
+
+    void add(uint16_t glyph, float x, float y)
+    {
+        items.push_back({glyph, (int16_t)lroundf(x), (int16_t)lroundf(y)});
+    }
+
+    /**
+     * @brief Adds the key signature of [staff], whose top line is at [top], starting at [x].
+     */
+    void addKey(const LayoutStaffState &staff, float x, float top)
+    {
+        // The positions in the treble clef, from the bottom line
+        const int sharps[7] = {8, 5, 9, 6, 3, 7, 4};
+        const int flats[7] = {4, 7, 3, 6, 2, 5, 1};
+        for (int i = 0; i < abs(staff.fifths); i++)
+        {
+            int position = (staff.fifths > 0 ? sharps[i] : flats[i]) + staff.keyShift;
+            add(staff.fifths > 0 ? GLYPH_SHARP : GLYPH_FLAT, x + i * LAYOUT_KEY_WIDTH * space, positionY(top, position));
+        }
+    }
+
+    void addClef(const LayoutStaffState &staff, float x, float top)
+    {
+        add(staff.clefGlyph, x, positionY(top, (staff.clefLine - 1) * 2));
+    }
+
+    void addTime(int beats, int beatType, float x, float top)
+    {
+        addNumber(beats, x, top + space);
+        addNumber(beatType, x, top + 3 * space);
+    }
+
+    /**
+     * @brief Gives the height of [position], in half spaces from the bottom line of the staff at [top].
+     */
+    float positionY(float top, int position)
+    {
+        return top + 4 * space - position * space / 2;
+    }
+
+    std::vector<DisplayItem> items;
+    float space;
+
+private:
+    void addNumber(int number, float x, float y)
+    {
+        String digits(number);
+        for (unsigned int i = 0; i < digits.length(); i++)
+            add(GLYPH_TIME_0 + digits[i] - '0', x + i * 1.2f * space, y);
+    }
+};
+
+/**
+ * @brief Adds the notes of [staff] of [data] to [list].
+ *
+ * @param top The height of the top line of the staff.
+ * @param left Where the notes of the measure start.
+ * @param scale How much the measure is stretched for filling the system.
+ */
+void layoutStaffNotes(DisplayListBuilder &list, const mx::api::ScoreData &score, const mx::api::StaffData &staff,
+                      const LayoutMeasure &measure, const LayoutStaffState &state, int transpose, float top, float left, float scale)
+{
+    using namespace mx::api;
+    float space = list.space;
+
+    // The alterations in effect in this measure, by pitch
+    std::map<int, int> alters;
+    bool voices = staff.voices.size() > 1;
+    int voiceIndex = 0;
+    for (const auto &voice : staff.voices)
+    {
+        const std::vector<NoteData> &notes = voice.second.notes;
+        for (size_t i = 0; i < notes.size();)
+        {
+            // The note and the rest of its chord
+            size_t end = i + 1;
+            while (end < notes.size() && notes[end].isChord)
+                end++;
+
+            const NoteData &note = notes[i];
+            auto onset = std::lower_bound(measure.onsets.begin(), measure.onsets.end(), note.tickTimePosition,
+                                          [](const LayoutOnset &o, int tick)
+                                          { return o.tick < tick; });
+            float offset = onset == measure.onsets.end() ? 0 : onset->offset;
+            float x = left + offset * scale * space;
+            DurationName duration = note.durationData.durationName;
+
+            if (note.isRest)
+            {
+                uint16_t glyph = GLYPH_REST_QUARTER;
+                int position = 4;
+                switch (duration)
+                {
+                case DurationName::breve:
+                case DurationName::whole:
+                    glyph = GLYPH_REST_WHOLE;
+                    position = 6;
+                    break;
+                case DurationName::half:
+                    glyph = GLYPH_REST_HALF;
+                    break;
+                case DurationName::eighth:
+                    glyph = GLYPH_REST_8TH;
+                    break;
+                case DurationName::dur16th:
+                    glyph = GLYPH_REST_16TH;
+                    break;
+                case DurationName::dur32nd:
+                case DurationName::dur64th:
+                    glyph = GLYPH_REST_32ND;
+                    break;
+                default:
+                    break;
+                }
+                list.add(glyph, x, list.positionY(top, position));
+                i = end;
+                continue;
+            }
+
+            // Positions of the chord, in half spaces from the bottom line
+            std::vector<int> positions;
+            int lowest = INT32_MAX, highest = INT32_MIN;
+            for (size_t n = i; n < end; n++)
+            {
+                int alter;
+                int pitch = layoutPitch(notes[n].pitchData, transpose, state.fifths, alter);
+                int position = pitch - state.bottom;
+                positions.push_back(position);
+                lowest = std::min(lowest, position);
+                highest = std::max(highest, position);
+
+                auto current = alters.find(pitch);
+                int expected = current != alters.end() ? current->second : layoutKeyAlter(pitch % 7, state.fifths);
+                if (alter != expected)
+                {
+                    const uint16_t glyphs[5] = {GLYPH_DOUBLE_FLAT, GLYPH_FLAT, GLYPH_NATURAL, GLYPH_SHARP, GLYPH_DOUBLE_SHARP};
+                    list.add(glyphs[std::max(-2, std::min(2, alter)) + 2], x - LAYOUT_ACCIDENTAL_WIDTH * space, list.positionY(top, position));
+                    alters[pitch] = alter;
+                }
+
+                // Ledger lines, for notes above or below the staff
+                for (int ledger = -2; ledger >= position; ledger -= 2)
+                    list.add(GLYPH_LEDGER, x, list.positionY(top, ledger));
+                for (int ledger = 10; ledger <= position; ledger += 2)
+                    list.add(GLYPH_LEDGER, x, list.positionY(top, ledger));
+            }
+
+            // Stems go up for the first voice and down for the second, or away from the middle line
+            bool up = voices ? voiceIndex % 2 == 0 : lowest + highest < 8;
+            uint16_t head = GLYPH_NOTEHEAD_BLACK;
+            uint16_t flag = 0;
+            switch (duration)
+            {
+            case DurationName::breve:
+            case DurationName::whole:
+                head = GLYPH_NOTEHEAD_WHOLE;
+                break;
+            case DurationName::half:
+                head = GLYPH_NOTEHEAD_HALF;
+                break;
+            case DurationName::eighth:
+                flag = up ? GLYPH_FLAG_8TH_UP : GLYPH_FLAG_8TH_DOWN;
+                break;
+            case DurationName::dur16th:
+                flag = up ? GLYPH_FLAG_16TH_UP : GLYPH_FLAG_16TH_DOWN;
+                break;
+            case DurationName::dur32nd:
+            case DurationName::dur64th:
+            case DurationName::dur128th:
+                flag = up ? GLYPH_FLAG_32ND_UP : GLYPH_FLAG_32ND_DOWN;
+                break;
+            default:
+                break;
+            }
+
+            for (int position : positions)
+            {
+                float y = list.positionY(top, position);
+                list.add(head, x, y);
+                if (head != GLYPH_NOTEHEAD_WHOLE)
+                    list.add(up ? GLYPH_STEM_UP : GLYPH_STEM_DOWN, x, y);
+                // Dots go in the space above notes on a line
+                for (int d = 0; d < note.durationData.durationDots; d++)
+                    list.add(GLYPH_DOT, x + (1.5f + d * 0.7f) * space, list.positionY(top, position | 1));
+            }
+            if (flag)
+                list.add(flag, x, list.positionY(top, up ? highest : lowest));
+
+            i = end;
+        }
+        voiceIndex++;
+    }
+}
+
+/**
+ * @brief A run of measures drawn in the same line.
+ */
+struct LayoutSystem
+{
+    size_t first;
+    size_t count;
+
+    /**
+     * @brief How much the measures are stretched for filling the line.
+     */
+    float scale;
+};
+
+/**
+ * @brief Breaks [measures] into systems that fit in [width] staff spaces. Every measure takes at least its minimum
+ * width, and systems are stretched for filling the whole line.
+ */
+std::vector<LayoutSystem> layoutBreakSystems(const std::vector<LayoutMeasure> &measures, float width)
+{
+    std::vector<LayoutSystem> systems;
+    size_t m = 0;
+    while (m < measures.size())
+    {
+        LayoutSystem system = {m, 0, 1};
+        float available = width - layoutHeaderWidth(measures[m].staves);
+        float used = 0;
+        while (m < measures.size())
+        {
+            float measureWidth = layoutAttributesWidth(measures[m], system.count == 0) + measures[m].notesWidth;
+            if (system.count > 0 && used + measureWidth > available)
+                break;
+            used += measureWidth;
+            system.count++;
+            m++;
+        }
+        system.scale = used > 0 ? std::max(available / used, 0.5f) : 1;
+        systems.push_back(system);
+    }
+    return systems;
+}
+
+/**
+ * @brief Gives the key of the page made of [systems] of [measures], which changes whenever anything drawn in the page
+ * does.
+ */
+uint32_t layoutPageKey(uint32_t geometryKey, const std::vector<LayoutMeasure> &measures, const LayoutSystem *systems, size_t count)
+{
+    uint32_t key = geometryKey;
+    for (size_t i = 0; i < count; i++)
+    {
+        key = layoutHashInt(key, systems[i].count);
+        // The first measure carries the clefs and keys of the header
+        const LayoutMeasure &first = measures[systems[i].first];
+        for (const LayoutStaffState &staff : first.staves)
+            key = layoutHash(key, &staff, sizeof(staff));
+        for (size_t m = systems[i].first; m < systems[i].first + systems[i].count; m++)
+            key = layoutHashInt(key, measures[m].hash);
+        // Whether the last barline is the final one
+        key = layoutHashInt(key, systems[i].first + systems[i].count == measures.size());
+    }
+    return key;
+}
+
+uint32_t layoutGeometryKey(const LayoutGeometry &geometry)
+{
+    int32_t fields[] = {LAYOUT_VERSION, geometry.width, geometry.height, geometry.staffSpace, geometry.transpose};
+    return layoutHash(LAYOUT_HASH_SEED, fields, sizeof(fields));
+}
+
+/**
+ * @brief Gives the type of cache file of the page or index with [key]. Kept short for the 32 characters of SPIFFS.
+ */
+String layoutCacheKind(char prefix, uint32_t key)
+{
+    char kind[8];
+    snprintf(kind, sizeof(kind), "%c%06x", prefix, (unsigned)(key & 0xFFFFFF));
+    return String(kind);
+}
+
+/**
+ * @brief Draws [systems] of the score into [list].
+ */
+void layoutPage(DisplayListBuilder &list, const mx::api::ScoreData &score, const std::vector<int> &partStaves,
+                const std::vector<LayoutMeasure> &measures, const LayoutSystem *systems, size_t count, const LayoutGeometry &geometry)
+{
+    float space = geometry.staffSpace;
+    float left = LAYOUT_MARGIN * space;
+    int staffCount = measures[0].staves.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        const LayoutSystem &system = systems[i];
+        float systemTop = LAYOUT_MARGIN_TOP * space + i * ((staffCount - 1) * LAYOUT_STAFF_DISTANCE + LAYOUT_SYSTEM_DISTANCE) * space;
+        const LayoutMeasure &first = measures[system.first];
+
+        // Staves, clefs and key signatures
+        for (int s = 0; s < staffCount; s++)
+        {
+            float top = systemTop + s * LAYOUT_STAFF_DISTANCE * space;
+            list.add(GLYPH_STAFF, left, top);
+            list.addClef(first.staves[s], left + 0.5f * space, top);
+            list.addKey(first.staves[s], left + LAYOUT_CLEF_WIDTH * space, top);
+        }
+
+        float x = left + layoutHeaderWidth(first.staves) * space;
+        for (size_t m = system.first; m < system.first + system.count; m++)
+        {
+            const LayoutMeasure &measure = measures[m];
+            bool systemStart = m == system.first;
+            float attributes = layoutAttributesWidth(measure, systemStart) * system.scale * space;
+
+            // Attributes changed by the measure
+            float attributeX = x;
+            if (!systemStart)
+            {
+                bool clef = false;
+                for (int s = 0; s < staffCount; s++)
+                    if (measure.changes[s])
+                    {
+                        float top = systemTop + s * LAYOUT_STAFF_DISTANCE * space;
+                        list.addClef(measure.staves[s], attributeX, top);
+                        list.addKey(measure.staves[s], attributeX + LAYOUT_CLEF_WIDTH * space, top);
+                        clef = true;
+                    }
+                if (clef)
+                    attributeX = x + attributes - LAYOUT_TIME_WIDTH * system.scale * space;
+            }
+            if (measure.timeChange)
+                for (int s = 0; s < staffCount; s++)
+                    list.addTime(measure.beats, measure.beatType, attributeX, systemTop + s * LAYOUT_STAFF_DISTANCE * space);
+
+            // Notes
+            float notesX = x + attributes + LAYOUT_MEASURE_PADDING * 0.5f * system.scale * space;
+            int s = 0;
+            for (size_t p = 0; p < score.parts.size(); s += partStaves[p], p++)
+            {
+                if (m >= score.parts[p].measures.size())
+                    continue;
+                const mx::api::MeasureData &data = score.parts[p].measures[m];
+                for (size_t staff = 0; staff < data.staves.size() && (int)staff < partStaves[p]; staff++)
+                    layoutStaffNotes(list, score, data.staves[staff], measure, measure.staves[s + staff], geometry.transpose,
+                                     systemTop + (s + staff) * LAYOUT_STAFF_DISTANCE * space, notesX, system.scale);
+            }
+
+            x += attributes + measure.notesWidth * system.scale * space;
+            uint16_t barline = m + 1 == measures.size() ? GLYPH_BARLINE_FINAL : GLYPH_BARLINE;
+            for (int staff = 0; staff < staffCount; staff++)
+                list.add(barline, x, systemTop + staff * LAYOUT_STAFF_DISTANCE * space);
+        }
+    }
+}
+
+/**
+ * @brief Collects the notes of [score] into [out], on the pages of [systems] laid out [perPage] systems a page.
+ */
+void layoutTimeline(const mx::api::ScoreData &score, const std::vector<int> &partStaves, const std::vector<LayoutMeasure> &measures,
+                    const std::vector<LayoutSystem> &systems, size_t perPage, Timeline &out)
+{
+    using namespace mx::api;
+    const int stepSemitones[7] = {0, 2, 4, 5, 7, 9, 11};
+    int ticksPerQuarter = std::max(score.ticksPerQuarter, 1);
+    out.notes.clear();
+    out.pages.clear();
+    out.tempos.clear();
+    out.meters.clear();
+
+    uint32_t start = 0;
+    for (size_t i = 0; i < systems.size(); i++)
+    {
+        if (i % perPage == 0)
+        {
+            if (!out.pages.empty())
+                out.pages.back().end = start;
+            out.pages.push_back({start, start, TIMELINE_TICKS_PER_QUARTER, (uint32_t)systems[i].first});
+        }
+        for (size_t m = systems[i].first; m < systems[i].first + systems[i].count; m++)
+        {
+            uint32_t beat = TIMELINE_TICKS_PER_QUARTER * 4 / std::max(measures[m].beatType, 1);
+            if (measures[m].timeChange)
+                out.meters.push_back({start, (uint8_t)measures[m].beats, (uint8_t)measures[m].beatType, 0});
+            for (size_t p = 0; p < score.parts.size(); p++)
+            {
+                if (m >= score.parts[p].measures.size())
+                    continue;
+                const MeasureData &data = score.parts[p].measures[m];
+                for (size_t s = 0; s < data.staves.size() && (int)s < partStaves[p]; s++)
+                {
+                    for (const DirectionData &direction : data.staves[s].directions)
+                        for (const TempoData &tempo : direction.tempos)
+                        {
+                            if (tempo.tempoType != TempoType::beatsPerMinute || tempo.beatsPerMinute.beatsPerMinute <= 0)
+                                continue;
+                            // Every dot adds half of what the last one added
+                            float quarters = layoutNameQuarters(tempo.beatsPerMinute.durationName) * (2 - 1.0f / (1 << tempo.beatsPerMinute.dots));
+                            out.tempos.push_back({start + (uint32_t)(direction.tickTimePosition * TIMELINE_TICKS_PER_QUARTER / ticksPerQuarter),
+                                                  (uint32_t)(60000000 / (tempo.beatsPerMinute.beatsPerMinute * quarters))});
+                        }
+                    for (const auto &voice : data.staves[s].voices)
+                        for (const NoteData &note : voice.second.notes)
+                        {
+                            if (note.isRest)
+                                continue;
+                            int pitch = (note.pitchData.octave + 1) * 12 + stepSemitones[(int)note.pitchData.step] + note.pitchData.alter;
+                            float quarters = layoutQuarters(note, score.ticksPerQuarter);
+                            out.notes.push_back({start + (uint32_t)(note.tickTimePosition * TIMELINE_TICKS_PER_QUARTER / ticksPerQuarter),
+                                                 (uint16_t)(quarters * TIMELINE_TICKS_PER_QUARTER), (uint8_t)std::min(std::max(pitch, 0), 127), 0});
+                        }
+                }
+            }
+            start += measures[m].beats * beat;
+            out.pages.back().beat = beat;
+        }
+    }
+    if (!out.pages.empty())
+        out.pages.back().end = start;
+    std::stable_sort(out.notes.begin(), out.notes.end(), [](const TimelineNote &a, const TimelineNote &b)
+                     { return a.tick < b.tick; });
+
+    // The tempo of every part is the same, the first one given at a tick is taken
+    std::stable_sort(out.tempos.begin(), out.tempos.end(), [](const TimelineTempo &a, const TimelineTempo &b)
+                     { return a.tick < b.tick; });
+    out.tempos.erase(std::unique(out.tempos.begin(), out.tempos.end(), [](const TimelineTempo &a, const TimelineTempo &b)
+                                 { return a.tick == b.tick; }),
+                     out.tempos.end());
+    if (out.tempos.empty() || out.tempos[0].tick > 0)
+        out.tempos.insert(out.tempos.begin(), {0, TIMELINE_DEFAULT_QUARTER_US});
+    if (out.meters.empty() || out.meters[0].tick > 0)
+        out.meters.insert(out.meters.begin(), {0, 4, 4, 0});
+}
+
+/**
+ * @brief Writes the display list of the page with [key] of the score [id] to the cache.
+ *
+ * @return true If the page was stored.
+ */
+bool layoutWritePage(const String &id, uint32_t key, const std::vector<DisplayItem> &items)
+{
+    uint32_t header[3] = {LAYOUT_PAGE_MAGIC, key, (uint32_t)items.size()};
+    size_t itemsSize = items.size() * sizeof(DisplayItem);
+    QuotaReservation reservation(sizeof(header) + itemsSize);
+    if (!reservation.valid())
+        return false;
+    return scoreCacheWrite(id, layoutCacheKind('p', key).c_str(), [&](StorageFile &file)
+                           { return file.write((const uint8_t *)header, sizeof(header)) == sizeof(header) &&
+                                    file.write((const uint8_t *)items.data(), itemsSize) == itemsSize; });
+}
+
+bool layoutWriteIndex(const Layout &layout, uint32_t geometryKey)
+{
+    uint32_t header[3] = {LAYOUT_INDEX_MAGIC, geometryKey, (uint32_t)layout.pages.size()};
+    size_t pagesSize = layout.pages.size() * sizeof(uint32_t);
+    QuotaReservation reservation(sizeof(header) + pagesSize);
+    if (!reservation.valid())
+        return false;
+    return scoreCacheWrite(layout.id, layoutCacheKind('i', geometryKey).c_str(), [&](StorageFile &file)
+                           { return file.write((const uint8_t *)header, sizeof(header)) == sizeof(header) &&
+                                    file.write((const uint8_t *)layout.pages.data(), pagesSize) == pagesSize; });
+}
+
+/**
+ * @brief Checks whether the page with [key] of the score [id] is in the cache.
+ */
+bool layoutHasPage(const String &id, uint32_t key)
+{
+    StorageStat stat;
+    return storage->stat(scoreCachePath(id, layoutCacheKind('p', key).c_str()).c_str(), stat);
+}
+
+/**
+ * @brief Lays out [score], with id [id], for [geometry] into [out]. Only the pages missing from the cache are drawn.
+ *
+ * @return true If every page is in the cache.
+ */
+bool layoutBuild(const String &id, const mx::api::ScoreData &score, const LayoutGeometry &geometry, Layout &out)
+{
+    MetricTimer timer(layoutLatency);
+    out.id = id;
+    out.pages.clear();
+    if (layoutParsed)
+        layoutParsed(id, score);
+
+    std::vector<int> partStaves = layoutPartStaves(score);
+    std::vector<LayoutMeasure> measures = layoutMeasures(score, partStaves, geometry.transpose);
+    if (measures.empty())
+        return false;
+
+    float space = geometry.staffSpace;
+    std::vector<LayoutSystem> systems = layoutBreakSystems(measures, geometry.width / space - 2 * LAYOUT_MARGIN);
+    int staffCount = measures[0].staves.size();
+    float systemHeight = ((staffCount - 1) * LAYOUT_STAFF_DISTANCE + LAYOUT_SYSTEM_DISTANCE) * space;
+    size_t perPage = std::max(1, (int)((geometry.height - LAYOUT_MARGIN_TOP * space) / systemHeight));
+
+    uint32_t geometryKey = layoutGeometryKey(geometry);
+    bool stored = true;
+    size_t built = 0;
+    for (size_t first = 0; first < systems.size(); first += perPage)
+    {
+        size_t count = std::min(perPage, systems.size() - first);
+        uint32_t key = layoutPageKey(geometryKey, measures, &systems[first], count);
+        out.pages.push_back(key);
+        if (layoutHasPage(id, key))
+        {
+            layoutPagesReused.add();
+            continue;
+        }
+
+        DisplayListBuilder list(space);
+        layoutPage(list, score, partStaves, measures, &systems[first], count, geometry);
+        stored &= layoutWritePage(id, key, list.items);
+        layoutPagesBuilt.add();
+        built++;
+    }
+    stored &= layoutWriteIndex(out, geometryKey);
+    layoutTimeline(score, partStaves, measures, systems, perPage, out.timeline);
+    stored &= timelineWrite(id, geometryKey, out.timeline, layoutCacheKind('t', geometryKey));
+
+    LOGI(LOG_MUSIC, "Laid out %u measures in %u systems and %u pages, %u drawn", (unsigned)measures.size(), (unsigned)systems.size(),
+         (unsigned)out.pages.size(), (unsigned)built);
+    return stored;
+}
+
+/**
+ * @brief Reads the pages of the score [id] laid out for [geometry] from the cache into [out].
+ *
+ * @return true If the layout and all its pages are in the cache.
+ */
+bool layoutLoad(const String &id, const LayoutGeometry &geometry, Layout &out)
+{
+    uint32_t geometryKey = layoutGeometryKey(geometry);
+    std::unique_ptr<StorageFile> file = scoreCacheOpen(id, layoutCacheKind('i', geometryKey).c_str(), "r");
+    if (!file)
+        return false;
+    uint32_t header[3];
+    if (file->read((uint8_t *)header, sizeof(header)) != sizeof(header) || header[0] != LAYOUT_INDEX_MAGIC || header[1] != geometryKey)
+        return false;
+
+    // A damaged file could ask for more than the heap has
+    if ((uint64_t)header[2] * sizeof(uint32_t) != file->size() - sizeof(header))
+    {
+        LOGW(LOG_MUSIC, "Layout of %s damaged in the cache", id.c_str());
+        return false;
+    }
+
+    out.id = id;
+    out.pages.resize(header[2]);
+    size_t pagesSize = out.pages.size() * sizeof(uint32_t);
+    if (file->read((uint8_t *)out.pages.data(), pagesSize) != pagesSize)
+        return false;
+    for (uint32_t key : out.pages)
+        if (!layoutHasPage(id, key))
+            return false;
+    return timelineLoad(id, geometryKey, out.timeline, layoutCacheKind('t', geometryKey));
+}
+
+/**
+ * @brief Lays out the score called [name] for [geometry] into [out]. The score is only parsed if some page is not in
+ * the cache.
+ *
+ * @return true If the score is laid out.
+ */
+bool layoutScore(const String &name, const LayoutGeometry &geometry, Layout &out)
+{
+    String id = scoreId(name);
+    if (id.length() == 0)
+    {
+        LOGE(LOG_MUSIC, "No score called \"%s\"", name.c_str());
+        return false;
+    }
+    if (layoutLoad(id, geometry, out))
+    {
+        LOGI(LOG_MUSIC, "Layout of \"%s\" cached, %u pages", name.c_str(), (unsigned)out.pages.size());
+        return true;
+    }
+
+    mx::api::ScoreData score;
+    if (!parseScore(scoreBlobPath(id), score))
+        return false;
+    return layoutBuild(id, score, geometry, out);
+}
+
+/**
+ * @brief Draws the page [page] of [layout], calling [draw] for every item.
+ *
+ * @return true If the page was drawn. It could have been evicted from the cache, and must be laid out again then.
+ */
+bool layoutReplay(const Layout &layout, size_t page, std::function<void(const DisplayItem &item)> draw)
+{
+    if (page >= layout.pages.size())
+        return false;
+    uint32_t key = layout.pages[page];
+    std::unique_ptr<StorageFile> file = scoreCacheOpen(layout.id, layoutCacheKind('p', key).c_str(), "r");
+    if (!file)
+        return false;
+    uint32_t header[3];
+    if (file->read((uint8_t *)header, sizeof(header)) != sizeof(header) || header[0] != LAYOUT_PAGE_MAGIC || header[1] != key)
+        return false;
+
+    DisplayItem items[LAYOUT_REPLAY_BATCH];
+    uint32_t remaining = header[2];
+    while (remaining > 0)
+    {
+        size_t count = std::min(remaining, (uint32_t)LAYOUT_REPLAY_BATCH);
+        if (file->read((uint8_t *)items, count * sizeof(DisplayItem)) != count * sizeof(DisplayItem))
+            return false;
+        for (size_t i = 0; i < count; i++)
+            draw(items[i]);
+        remaining -= count;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the layout settings from the preferences.
+ */
+void layoutBegin()
+{
+    layoutGeometry.transpose = preferences.getInt(pref_transpose, 0);
+}
+
+#endif
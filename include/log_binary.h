@@ -0,0 +1,189 @@
+/**
+ * @file log_binary.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Compact binary log records. Instead of formatting the message on the device, only an id of the format
+ * string and the raw arguments are stored. The text is rebuilt by decode_logs.py using the table generated at build
+ * time by log_strings.py.
+ * @version 0.1
+ * @date 2022-02-21
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include cpp headers
+#include <type_traits>
+
+// Include utils files
+#include "logger_levels.h"
+#include "log_buffer.h"
+
+/**
+ * @brief The first byte of every binary record, used by the decoder for finding record boundaries.
+ */
+#define LOG_RECORD_SYNC 0xA5
+
+/**
+ * @brief The size of the record header: sync, length, timestamp, format id and level/module.
+ */
+#define LOG_RECORD_HEADER_SIZE 11
+
+/**
+ * @brief The format id reserved for the "messages dropped" record written by the drain task.
+ */
+#define LOG_ID_DROPPED 0
+
+// Argument type tags, must match decode_logs.py
+#define LOG_ARG_INT32 'i'
+#define LOG_ARG_UINT32 'u'
+#define LOG_ARG_INT64 'I'
+#define LOG_ARG_UINT64 'U'
+#define LOG_ARG_DOUBLE 'd'
+#define LOG_ARG_STRING 's'
+
+/**
+ * @brief Computes the 32 bit FNV-1a hash of a format string. Must match log_strings.py.
+ *
+ * @param format The format string.
+ * @return uint32_t The id of the format string. Never LOG_ID_DROPPED.
+ */
+constexpr uint32_t logFormatId(const char *format)
+{
+    uint32_t hash = 2166136261u;
+    for (; *format; format++)
+        hash = (hash ^ (uint8_t)*format) * 16777619u;
+    return hash == LOG_ID_DROPPED ? 1 : hash;
+}
+
+/**
+ * @brief Builds a binary record in place, truncating the arguments that don't fit in a buffer slot.
+ */
+class LogRecord
+{
+public:
+    LogRecord(uint32_t id, uint8_t level, uint8_t module)
+    {
+        uint32_t now = millis();
+        data[0] = LOG_RECORD_SYNC;
+        memcpy(data + 2, &now, sizeof(now));
+        memcpy(data + 6, &id, sizeof(id));
+        data[10] = (level << 4) | module;
+        length = LOG_RECORD_HEADER_SIZE;
+    }
+
+    /**
+     * @brief Adds an integer argument, using 32 bits when the type allows it.
+     */
+    template <typename T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type = 0>
+    void add(T value)
+    {
+        if (sizeof(T) <= 4)
+        {
+            uint32_t v = (uint32_t)value;
+            put(std::is_signed<T>::value ? LOG_ARG_INT32 : LOG_ARG_UINT32, &v, sizeof(v));
+        }
+        else
+        {
+            uint64_t v = (uint64_t)value;
+            put(std::is_signed<T>::value ? LOG_ARG_INT64 : LOG_ARG_UINT64, &v, sizeof(v));
+        }
+    }
+
+    /**
+     * @brief Adds a floating point argument. Floats are promoted to double, as printf would do.
+     */
+    void add(double value) { put(LOG_ARG_DOUBLE, &value, sizeof(value)); }
+
+    /**
+     * @brief Adds a string argument. It is truncated to the room left in the record.
+     */
+    void add(const char *value)
+    {
+        if (!value)
+            value = "(null)";
+        size_t len = strlen(value);
+        if (length + 2 > sizeof(data))
+            return;
+        size_t room = sizeof(data) - length - 2;
+        if (len > room)
+            len = room;
+        data[length++] = LOG_ARG_STRING;
+        data[length++] = len;
+        memcpy(data + length, value, len);
+        length += len;
+    }
+
+    /**
+     * @brief Pointers other than strings (%p) are stored as their address.
+     */
+    void add(const void *value) { add((uintptr_t)value); }
+
+    /**
+     * @brief Writes the length of the record. Must be called once all the arguments have been added.
+     */
+    void finish() { data[1] = length - 2; }
+
+    /**
+     * @brief Queues the record into the log buffer.
+     */
+    void commit()
+    {
+        finish();
+        logBuffer.push((const char *)data, length);
+    }
+
+    const uint8_t *bytes() const { return data; }
+
+    size_t size() const { return length; }
+
+private:
+    void put(uint8_t tag, const void *value, size_t len)
+    {
+        if (length + 1 + len > sizeof(data))
+            return;
+        data[length++] = tag;
+        memcpy(data + length, value, len);
+        length += len;
+    }
+
+    uint8_t data[LOG_BUFFER_SLOT_SIZE];
+    size_t length;
+};
+
+static_assert(LOG_BUFFER_SLOT_SIZE <= 257, "binary records store their length in a single byte");
+
+/**
+ * @brief Adds all the arguments to [record].
+ */
+inline void logAddArgs(LogRecord &record) {}
+
+template <typename T, typename... Args>
+void logAddArgs(LogRecord &record, T value, Args... args)
+{
+    record.add(value);
+    logAddArgs(record, args...);
+}
+
+/**
+ * @brief Builds and queues a binary record. Use the LOG macros instead of calling it directly.
+ *
+ * @param id The id of the format string, see logFormatId.
+ * @param level The level of the message.
+ * @param module The module that logs the message.
+ * @param args The arguments of the format string.
+ */
+template <typename... Args>
+void logBinary(uint32_t id, uint8_t level, uint8_t module, Args... args)
+{
+    LogRecord record(id, level, module);
+    logAddArgs(record, args...);
+    record.commit();
+}
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * @file log_buffer.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Lock-free ring buffer that decouples log calls from the Serial output.
+ * @version 0.1
+ * @date 2022-02-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <atomic>
+
+/**
+ * @brief The amount of slots in the log ring buffer. Must be a power of two.
+ */
+#ifndef LOG_BUFFER_SLOTS
+#define LOG_BUFFER_SLOTS 64
+#endif
+
+/**
+ * @brief The maximum amount of bytes stored in a single slot. Longer messages are split across slots.
+ */
+#ifndef LOG_BUFFER_SLOT_SIZE
+#define LOG_BUFFER_SLOT_SIZE 120
+#endif
+
+/**
+ * @brief The maximum amount of slots taken by a single line. Longer lines are truncated.
+ */
+#define LOG_BUFFER_LINE_SLOTS 4
+
+static_assert((LOG_BUFFER_SLOTS & (LOG_BUFFER_SLOTS - 1)) == 0, "LOG_BUFFER_SLOTS must be a power of two");
+static_assert(LOG_BUFFER_LINE_SLOTS <= LOG_BUFFER_SLOTS, "a line must fit in the buffer");
+
+/**
+ * @brief A single entry of the ring buffer.
+ */
+struct LogSlot
+{
+    /**
+     * @brief The sequence number used for synchronizing producers with the consumer.
+     */
+    std::atomic<uint32_t> sequence;
+
+    /**
+     * @brief The amount of valid bytes in [data].
+     */
+    uint16_t length;
+
+    /**
+     * @brief The contents of the slot.
+     */
+    char data[LOG_BUFFER_SLOT_SIZE];
+};
+
+/**
+ * @brief Bounded multi-producer, single-consumer queue of log lines, split in fragments of a slot.
+ * Producers never wait: if the buffer is full the line is dropped and counted.
+ */
+class LogBuffer
+{
+public:
+    LogBuffer()
+    {
+        for (uint32_t i = 0; i < LOG_BUFFER_SLOTS; i++)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Stores [len] bytes of [data], followed by a line break if [newline], into as many consecutive slots as
+     * required. The slots are reserved at once, so the fragments of a line are never interleaved with the ones of other
+     * producers, and the line is either stored or dropped as a whole.
+     *
+     * @param data The bytes to store.
+     * @param len The amount of bytes to store. Must not be greater than LOG_BUFFER_LINE_SLOTS * LOG_BUFFER_SLOT_SIZE,
+     * counting the line break.
+     * @param newline If true, a line break is appended to the bytes.
+     * @return true If the bytes were stored.
+     * @return false If the buffer didn't have room for them all, and the line has been dropped.
+     */
+    bool push(const char *data, size_t len, bool newline = false)
+    {
+        size_t total = len + (newline ? 1 : 0);
+        if (total == 0)
+            return true;
+        uint32_t count = (total + LOG_BUFFER_SLOT_SIZE - 1) / LOG_BUFFER_SLOT_SIZE;
+
+        // The consumer frees the slots in order, so if the last one is free all the ones before are too
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            uint32_t last = pos + count - 1;
+            uint32_t seq = slots[last & (LOG_BUFFER_SLOTS - 1)].sequence.load(std::memory_order_acquire);
+            int32_t dif = (int32_t)(seq - last);
+            if (dif == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            LogSlot *slot = &slots[(pos + i) & (LOG_BUFFER_SLOTS - 1)];
+            size_t fragment = std::min(len, (size_t)LOG_BUFFER_SLOT_SIZE);
+            memcpy(slot->data, data, fragment);
+            data += fragment;
+            len -= fragment;
+            if (fragment < LOG_BUFFER_SLOT_SIZE && i == count - 1 && newline)
+                slot->data[fragment++] = '\n';
+            slot->length = fragment;
+            slot->sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest fragment from the buffer. Must only be called from a single task.
+     *
+     * @param out Where to copy the fragment to. Must hold at least LOG_BUFFER_SLOT_SIZE bytes.
+     * @return size_t The amount of bytes copied, or 0 if the buffer is empty.
+     */
+    size_t pop(char *out)
+    {
+        LogSlot *slot = &slots[dequeuePos & (LOG_BUFFER_SLOTS - 1)];
+        uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+        if ((int32_t)(seq - (dequeuePos + 1)) != 0)
+            return 0;
+
+        size_t len = slot->length;
+        memcpy(out, slot->data, len);
+        slot->sequence.store(dequeuePos + LOG_BUFFER_SLOTS, std::memory_order_release);
+        dequeuePos++;
+        return len;
+    }
+
+    /**
+     * @brief Gets and resets the amount of lines dropped since the last call.
+     */
+    uint32_t takeDropped()
+    {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    LogSlot slots[LOG_BUFFER_SLOTS];
+    std::atomic<uint32_t> enqueuePos{0};
+    std::atomic<uint32_t> dropped{0};
+    uint32_t dequeuePos = 0;
+};
+
+/**
+ * @brief The buffer all the log functions write to.
+ */
+LogBuffer logBuffer;
+
+/**
+ * @brief The amount of lines truncated for being longer than LOG_BUFFER_LINE_SLOTS slots.
+ */
+std::atomic<uint32_t> logTruncatedLines{0};
+
+/**
+ * @brief Queues [len] bytes of [message] for being sent through Serial, as a single line in consecutive slots.
+ *
+ * @param message The message to queue.
+ * @param len The length of [message]. Longer messages than LOG_BUFFER_LINE_SLOTS slots are truncated.
+ * @param newline If true, a line break is appended to the message.
+ */
+void logWrite(const char *message, size_t len, bool newline)
+{
+    const size_t max = LOG_BUFFER_LINE_SLOTS * LOG_BUFFER_SLOT_SIZE - (newline ? 1 : 0);
+    if (len > max)
+    {
+        len = max;
+        logTruncatedLines.fetch_add(1, std::memory_order_relaxed);
+    }
+    logBuffer.push(message, len, newline);
+}
+
+#endif
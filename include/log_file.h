@@ -0,0 +1,242 @@
+/**
+ * @file log_file.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Persistent log, fed by the log drain task. Kept in a ring of segment files that are only appended to.
+ * @version 0.1
+ * @date 2022-02-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef LOG_FILE_H
+#define LOG_FILE_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <atomic>
+
+// Include utils files
+#include "storage.h"
+
+/**
+ * @brief Where the log was kept before it was split into segments. Removed by logFileBegin.
+ */
+#define LOG_FILE_LEGACY_PATH STORAGE_DIR_LOGS "/log.bin"
+
+/**
+ * @brief The size of every segment of the log. The log is kept in segments that are only appended to, named after
+ * their number in hex, since rewriting a file in place makes LittleFS copy its blocks again.
+ */
+#define LOG_FILE_SEGMENT_SIZE (8 * 1024)
+
+/**
+ * @brief The amount of segments kept. The oldest one is removed when a new one is started, so between
+ * LOG_FILE_SEGMENTS - 1 and LOG_FILE_SEGMENTS segments of log are kept.
+ */
+#define LOG_FILE_SEGMENTS 8
+
+/**
+ * @brief The amount of log bytes kept at most.
+ */
+#define LOG_FILE_CAPACITY (LOG_FILE_SEGMENTS * LOG_FILE_SEGMENT_SIZE)
+
+/**
+ * @brief The content type of the log contents, as served by /logs.
+ */
+#ifdef LOG_BINARY
+#define LOG_FILE_MIME "application/octet-stream"
+#else
+#define LOG_FILE_MIME "text/plain"
+#endif
+
+/**
+ * @brief The amount of bytes gathered in RAM before writing them, the size of a flash block. A batch ends at the next
+ * multiple of it in the log, so every full batch fills a block of its own, and a segment is a whole amount of them.
+ */
+#define LOG_FILE_BATCH_SIZE 4096
+
+/**
+ * @brief The maximum time, in milliseconds, that an incomplete batch is kept in RAM before being written.
+ */
+#define LOG_FILE_FLUSH_INTERVAL_MS (10 * 1000)
+
+/**
+ * @brief The amount of log bytes ever written to the file. Used as the cursor of the since parameter of /logs.
+ */
+std::atomic<uint32_t> logFileHead{0};
+
+/**
+ * @brief The number of the oldest segment stored.
+ */
+std::atomic<uint32_t> logFileFirst{0};
+
+/**
+ * @brief Whether the log file has been opened. Until then, the drain task only writes to Serial.
+ */
+std::atomic<bool> logFileReady{false};
+
+/**
+ * @brief The log bytes that could not be written, such as when the storage is full.
+ */
+std::atomic<uint32_t> logFileLostBytes{0};
+
+/**
+ * @brief The bytes waiting to be written to the log file. Only touched while holding logDrainLock.
+ */
+uint8_t logFileBatch[LOG_FILE_BATCH_SIZE];
+size_t logFileBatchLength = 0;
+unsigned long logFileBatchStart = 0;
+
+/**
+ * @brief Gets the path of the segment number [segment].
+ */
+String logFileSegmentPath(uint32_t segment)
+{
+    char path[32];
+    snprintf(path, sizeof(path), STORAGE_DIR_LOGS "/%08x", (unsigned)segment);
+    return path;
+}
+
+/**
+ * @brief Finds the segments stored, and continues the log after the last one. Must be called once the storage has
+ * been set.
+ *
+ * @return true If the log file is ready.
+ */
+bool logFileBegin()
+{
+    storage->remove(LOG_FILE_LEGACY_PATH);
+
+    bool found = false;
+    uint32_t first = 0, last = 0;
+    size_t lastSize = 0;
+    bool listed = storage->list(STORAGE_DIR_LOGS, [&](const char *name, size_t size)
+                                {
+        if (strlen(name) != 8 || strspn(name, "0123456789abcdef") != 8)
+            return;
+        uint32_t segment = strtoul(name, NULL, 16);
+        if (!found || segment < first)
+            first = segment;
+        if (!found || segment > last)
+        {
+            last = segment;
+            lastSize = size;
+        }
+        found = true; });
+    if (!listed)
+        return false;
+
+    logFileFirst.store(first);
+    logFileHead.store(last * LOG_FILE_SEGMENT_SIZE + std::min(lastSize, (size_t)LOG_FILE_SEGMENT_SIZE));
+    logFileReady.store(true);
+    return true;
+}
+
+/**
+ * @brief Writes the pending batch to the log file, appending it to the last segment, or starting a new one and
+ * removing the oldest. Only called by logFlush, holding logDrainLock.
+ */
+void logFileFlush()
+{
+    if (logFileBatchLength == 0 || !logFileReady.load())
+        return;
+
+    uint32_t head = logFileHead.load();
+    uint32_t segment = head / LOG_FILE_SEGMENT_SIZE;
+    if (head % LOG_FILE_SEGMENT_SIZE == 0)
+        // Moved first, so /logs doesn't read the segments being removed
+        while (segment - logFileFirst.load() >= LOG_FILE_SEGMENTS)
+        {
+            uint32_t oldest = logFileFirst.load();
+            logFileFirst.store(oldest + 1);
+            storage->remove(logFileSegmentPath(oldest).c_str());
+        }
+
+    // The segment may hold less than the head says if a write failed, the head follows what's stored
+    size_t stored = head % LOG_FILE_SEGMENT_SIZE;
+    std::unique_ptr<StorageFile> file = storage->open(logFileSegmentPath(segment).c_str(), "a");
+    if (file)
+    {
+        file->write(logFileBatch, logFileBatchLength);
+        stored = std::min(file->size(), (size_t)LOG_FILE_SEGMENT_SIZE);
+        file.reset();
+    }
+    uint32_t written = segment * LOG_FILE_SEGMENT_SIZE + stored - head;
+    if (written < logFileBatchLength)
+        logFileLostBytes.fetch_add(logFileBatchLength - written);
+    logFileHead.store(segment * LOG_FILE_SEGMENT_SIZE + stored);
+    logFileBatchLength = 0;
+}
+
+/**
+ * @brief Adds [len] bytes of [data] to the pending batch, writing it when full. Only called by logFlush, holding
+ * logDrainLock.
+ */
+void logFileAppend(const char *data, size_t len)
+{
+    if (!logFileReady.load())
+        return;
+
+    while (len > 0)
+    {
+        if (logFileBatchLength == 0)
+            logFileBatchStart = millis();
+        // Up to the end of the block, which a batch written before the interval may have left partly filled
+        size_t room = LOG_FILE_BATCH_SIZE - (logFileHead.load() + logFileBatchLength) % LOG_FILE_BATCH_SIZE;
+        size_t chunk = std::min(len, room);
+        memcpy(logFileBatch + logFileBatchLength, data, chunk);
+        logFileBatchLength += chunk;
+        data += chunk;
+        len -= chunk;
+        if (chunk == room)
+            logFileFlush();
+    }
+}
+
+/**
+ * @brief Writes the pending batch if it has been waiting for longer than LOG_FILE_FLUSH_INTERVAL_MS.
+ */
+void logFileTick()
+{
+    if (logFileBatchLength > 0 && millis() - logFileBatchStart >= LOG_FILE_FLUSH_INTERVAL_MS)
+        logFileFlush();
+}
+
+/**
+ * @brief Gets the oldest cursor still stored in the log file.
+ */
+uint32_t logFileTail()
+{
+    return logFileFirst.load() * LOG_FILE_SEGMENT_SIZE;
+}
+
+/**
+ * @brief Reads up to [maxLen] log bytes starting at the cursor [position], without crossing [end] or the end of its
+ * segment.
+ *
+ * @param position The cursor to start reading from. Must not be older than logFileTail().
+ * @param end The cursor to stop reading at.
+ * @param buffer Where to store the bytes.
+ * @param maxLen The size of [buffer].
+ * @return size_t The amount of bytes read. 0 once [end] is reached, or if the segment has been removed.
+ */
+size_t logFileRead(uint32_t position, uint32_t end, uint8_t *buffer, size_t maxLen)
+{
+    if (position >= end || position < logFileTail())
+        return 0;
+
+    uint32_t segment = position / LOG_FILE_SEGMENT_SIZE;
+    size_t offset = position % LOG_FILE_SEGMENT_SIZE;
+    size_t len = std::min((size_t)(end - position), maxLen);
+    len = std::min(len, (size_t)LOG_FILE_SEGMENT_SIZE - offset);
+    std::unique_ptr<StorageFile> file = storage->open(logFileSegmentPath(segment).c_str(), "r");
+    if (!file || !file->seek(offset))
+        return 0;
+    return file->read(buffer, len);
+}
+
+#endif
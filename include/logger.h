@@ -1,233 +1,242 @@
-#include <Arduino.h>
-#include "logger_levels.h"
+/**
+ * @file logger.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief printf-style logging macros. Arguments are only evaluated when the level is enabled, both at compile
+ * time (DEBUG_LEVEL) and at runtime (per module levels, see logModuleLevels).
+ * @version 0.2
+ * @date 2022-02-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
 
 #ifndef LOGGER_H
 #define LOGGER_H
 
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+// Include cpp headers
+#include <stdarg.h>
+
+// Include utils files
+#include "logger_levels.h"
+#include "log_buffer.h"
+#include "log_binary.h"
+#include "log_file.h"
+
 #ifndef DEBUG_LEVEL
 #warning "DEBUG_LEVEL not defined, defaulting to DEBUG_LOG."
 
 #define DEBUG_LEVEL DEBUG_LOG
 #endif
 
-#pragma region "Debug functions"
-
 /**
- * @brief Sends a message through Serial with Debug (DEBUG_LOG) log level.
- *
- * @param message The message to send
+ * @brief The maximum length of a formatted log line. Longer lines are truncated.
  */
-void debug(const char *message)
-{
-#if DEBUG_LEVEL <= DEBUG_LOG
-    Serial.print(message);
-#endif
-}
+#define LOG_LINE_MAX 256
 
 /**
- * @brief Sends a message through Serial with Debug (DEBUG_LOG) log level.
- *
- * @param message The message to send
+ * @brief The priority of the drain task. Just above idle so it never competes with the network tasks.
  */
-void debug(String message)
-{
-#if DEBUG_LEVEL <= DEBUG_LOG
-    Serial.print(message);
-#endif
-}
+#define LOG_DRAIN_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
 
 /**
- * @brief Sends a message through Serial with Debug (DEBUG_LOG) log level.
- *
- * @param message The message to send
+ * @brief The stack size, in bytes, of the drain task.
  */
-void debugln(const char *message)
-{
-#if DEBUG_LEVEL <= DEBUG_LOG
-    Serial.println(message);
-#endif
-}
+#define LOG_DRAIN_TASK_STACK 2048
 
 /**
- * @brief Sends a message through Serial with Debug (DEBUG_LOG) log level.
- *
- * @param message The message to send
+ * @brief How often, in milliseconds, the drain task checks the buffer for new messages.
  */
-void debugln(String message)
-{
-#if DEBUG_LEVEL <= DEBUG_LOG
-    Serial.println(message);
-#endif
-}
-
-#pragma endregion "Debug functions"
-
-#pragma region "Info functions"
+#define LOG_DRAIN_INTERVAL_MS 20
 
 /**
- * @brief Sends a message through Serial with Info (DEBUG_INFO) log level.
- *
- * @param message The message to send
+ * @brief The modules that can have their log level adjusted independently.
  */
-void info(const char *message)
+enum LogModule : uint8_t
 {
-#if DEBUG_LEVEL <= DEBUG_INFO
-    Serial.print(message);
-#endif
-}
+    LOG_MAIN,
+    LOG_AUTH,
+    LOG_SERVER,
+    LOG_FS,
+    LOG_MUSIC,
+    LOG_CONFIG,
+    LOG_MODULE_COUNT
+};
 
 /**
- * @brief Sends a message through Serial with Info (DEBUG_INFO) log level.
- *
- * @param message The message to send
+ * @brief The names of the modules, as used by the logLevel config key. Indexed by LogModule.
  */
-void info(String message)
-{
-#if DEBUG_LEVEL <= DEBUG_INFO
-    Serial.print(message);
-#endif
-}
+const char *logModuleNames[LOG_MODULE_COUNT] = {"main", "auth", "server", "fs", "music", "config"};
 
 /**
- * @brief Sends a message through Serial with Info (DEBUG_INFO) log level.
- *
- * @param message The message to send
+ * @brief The runtime log level of each module. Can only make the output quieter than DEBUG_LEVEL, since the calls
+ * below it are not even compiled.
  */
-void infoln(const char *message)
-{
-#if DEBUG_LEVEL <= DEBUG_INFO
-    Serial.println(message);
-#endif
-}
+volatile uint8_t logModuleLevels[LOG_MODULE_COUNT] = {DEBUG_LEVEL, DEBUG_LEVEL, DEBUG_LEVEL, DEBUG_LEVEL, DEBUG_LEVEL, DEBUG_LEVEL};
 
 /**
- * @brief Sends a message through Serial with Info (DEBUG_INFO) log level.
- *
- * @param message The message to send
+ * @brief Checks whether messages of [level] from [module] should be logged. The first comparison is constant, so
+ * calls below DEBUG_LEVEL are removed by the compiler together with their arguments.
  */
-void infoln(String message)
-{
-#if DEBUG_LEVEL <= DEBUG_INFO
-    Serial.println(message);
-#endif
-}
+#define LOG_ENABLED(module, level) ((level) >= DEBUG_LEVEL && (level) >= logModuleLevels[module])
 
+#ifdef LOG_BINARY
 /**
- * @brief Sends a message through Serial with Info (DEBUG_INFO) log level.
- *
- * @param message The message to send
+ * @brief Logs a printf-style message with the given level as a binary record. The format string is only used for
+ * computing its id and checking the arguments, so it's not stored in flash. Prefer the LOGD/LOGI/LOGW/LOGE shortcuts.
  */
-void infoln(IPAddress message)
-{
-#if DEBUG_LEVEL <= DEBUG_INFO
-    Serial.println(message);
+#define LOG_AT(level, module, format, ...)                    \
+    do                                                        \
+    {                                                         \
+        if (LOG_ENABLED(module, level))                       \
+        {                                                     \
+            constexpr uint32_t logId = logFormatId(format);   \
+            logBinary(logId, level, module, ##__VA_ARGS__);   \
+        }                                                     \
+        if (false)                                            \
+            logPrintf(format, ##__VA_ARGS__);                 \
+    } while (0)
+#else
+/**
+ * @brief Logs a printf-style message with the given level. Prefer the LOGD/LOGI/LOGW/LOGE shortcuts.
+ */
+#define LOG_AT(level, module, ...)            \
+    do                                        \
+    {                                         \
+        if (LOG_ENABLED(module, level))       \
+            logPrintf(__VA_ARGS__);           \
+    } while (0)
 #endif
-}
 
-#pragma endregion "Info functions"
+/**
+ * @brief Logs a message with Debug (DEBUG_LOG) log level.
+ */
+#define LOGD(module, ...) LOG_AT(DEBUG_LOG, module, __VA_ARGS__)
 
-#pragma region "Warning functions"
+/**
+ * @brief Logs a message with Info (DEBUG_INFO) log level.
+ */
+#define LOGI(module, ...) LOG_AT(DEBUG_INFO, module, __VA_ARGS__)
 
 /**
- * @brief Sends a message through Serial with Warning (DEBUG_WARN) log level.
- *
- * @param message The message to send
+ * @brief Logs a message with Warning (DEBUG_WARN) log level.
  */
-void warn(const char *message)
-{
-#if DEBUG_LEVEL <= DEBUG_WARN
-    Serial.print(message);
-#endif
-}
+#define LOGW(module, ...) LOG_AT(DEBUG_WARN, module, __VA_ARGS__)
 
 /**
- * @brief Sends a message through Serial with Warning (DEBUG_WARN) log level.
- *
- * @param message The message to send
+ * @brief Logs a message with Error (DEBUG_ERR) log level.
  */
-void warn(String message)
-{
-#if DEBUG_LEVEL <= DEBUG_WARN
-    Serial.print(message);
-#endif
-}
+#define LOGE(module, ...) LOG_AT(DEBUG_ERR, module, __VA_ARGS__)
 
 /**
- * @brief Sends a message through Serial with Warning (DEBUG_WARN) log level.
+ * @brief Formats a message and queues it as a line for Serial. Use the LOG macros instead of calling it directly,
+ * so the arguments are not evaluated for disabled levels.
  *
- * @param message The message to send
+ * @param format The printf-style format of the message.
  */
-void warnln(const char *message)
+void logPrintf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+void logPrintf(const char *format, ...)
 {
-#if DEBUG_LEVEL <= DEBUG_WARN
-    Serial.println(message);
-#endif
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (len < 0)
+        return;
+    if (len >= (int)sizeof(line))
+        len = sizeof(line) - 1;
+    logWrite(line, len, true);
 }
 
 /**
- * @brief Sends a message through Serial with Warning (DEBUG_WARN) log level.
+ * @brief Finds the module called [name].
  *
- * @param message The message to send
+ * @param name The name of the module, as in logModuleNames.
+ * @return int The index of the module, or -1 if there's no module with that name.
  */
-void warnln(String message)
+int logModuleByName(const char *name)
 {
-#if DEBUG_LEVEL <= DEBUG_WARN
-    Serial.println(message);
-#endif
+    for (int i = 0; i < LOG_MODULE_COUNT; i++)
+        if (strcmp(logModuleNames[i], name) == 0)
+            return i;
+    return -1;
 }
 
-#pragma endregion "Warning functions"
-
-#pragma region "Error functions"
-
 /**
- * @brief Sends a message through Serial with Error (DEBUG_ERR) log level.
- *
- * @param message The message to send
+ * @brief Held while the buffer is drained, since it has a single consumer, and by the log file while it's written.
+ * Created by loggerBegin, before that there's no other task draining.
  */
-void err(const char *message)
-{
-#if DEBUG_LEVEL <= DEBUG_ERR
-    Serial.print(message);
-#endif
-}
+SemaphoreHandle_t logDrainLock = NULL;
 
 /**
- * @brief Sends a message through Serial with Error (DEBUG_ERR) log level.
+ * @brief Writes all the queued messages into Serial and the log file. Waits for the drain task if it's draining, so
+ * it can be called from any task.
  *
- * @param message The message to send
+ * @param sync Whether the pending batch of the log file is written too, even if it's not full, as before rebooting.
  */
-void err(String message)
+void logFlush(bool sync = false)
 {
-#if DEBUG_LEVEL <= DEBUG_ERR
-    Serial.print(message);
+    if (logDrainLock)
+        xSemaphoreTake(logDrainLock, portMAX_DELAY);
+    char fragment[LOG_BUFFER_SLOT_SIZE];
+    size_t len;
+    while ((len = logBuffer.pop(fragment)) > 0)
+    {
+        Serial.write((const uint8_t *)fragment, len);
+        logFileAppend(fragment, len);
+    }
+
+    uint32_t dropped = logBuffer.takeDropped();
+    if (dropped > 0)
+    {
+#ifdef LOG_BINARY
+        LogRecord record(LOG_ID_DROPPED, DEBUG_WARN, LOG_MAIN);
+        record.add(dropped);
+        record.finish();
+        const char *message = (const char *)record.bytes();
+        len = record.size();
+#else
+        char message[48];
+        len = snprintf(message, sizeof(message), "[log] %u messages dropped\n", dropped);
 #endif
+        Serial.write((const uint8_t *)message, len);
+        logFileAppend(message, len);
+    }
+
+    if (sync)
+        logFileFlush();
+    else
+        logFileTick();
+    if (logDrainLock)
+        xSemaphoreGive(logDrainLock);
 }
 
 /**
- * @brief Sends a message through Serial with Error (DEBUG_ERR) log level.
- *
- * @param message The message to send
+ * @brief The body of the drain task. Periodically writes all the queued messages into Serial.
  */
-void errln(const char *message)
+void logDrainTask(void *)
 {
-#if DEBUG_LEVEL <= DEBUG_ERR
-    Serial.println(message);
-#endif
+    for (;;)
+    {
+        logFlush();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
 }
 
 /**
- * @brief Sends a message through Serial with Error (DEBUG_ERR) log level.
- *
- * @param message The message to send
+ * @brief Starts the task that drains the log buffer into Serial. Serial must have been started before.
  */
-void errln(String message)
+void loggerBegin()
 {
-#if DEBUG_LEVEL <= DEBUG_ERR
-    Serial.println(message);
-#endif
+    logDrainLock = xSemaphoreCreateMutex();
+    xTaskCreate(logDrainTask, "log", LOG_DRAIN_TASK_STACK, NULL, LOG_DRAIN_TASK_PRIORITY, NULL);
 }
 
-#pragma endregion "Error functions"
-
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,226 @@
+/**
+ * @file metrics.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Counters and latency histograms, exported at /metrics in the Prometheus text format. Recording only takes
+ * relaxed atomic increments, so it's left enabled everywhere.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Include cpp headers
+#include <atomic>
+
+/**
+ * @brief The maximum amount of histograms. Any histogram created after that is not exported.
+ */
+#define METRICS_HISTOGRAMS_MAX 32
+
+/**
+ * @brief The amount of latency buckets, without the last one, which counts everything.
+ */
+#define METRICS_BUCKETS 10
+
+/**
+ * @brief The upper bounds of the latency buckets, in microseconds.
+ */
+const uint32_t metricsBucketBounds[METRICS_BUCKETS] = {100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000};
+
+/**
+ * @brief The tasks whose stack usage is exported. Tasks not running are skipped.
+ */
+const char *metricsTasks[] = {"loopTask", "async_tcp", "log", "boot", "wifi", "dns", "render", "follow", "sync", "metronome"};
+
+/**
+ * @brief The histogram of the request handlers and the code they run, labelled by handler.
+ */
+#define METRICS_HANDLER_HISTOGRAM "ems_handler_duration_seconds"
+
+/**
+ * @brief A value that only grows. Wraps around at 2^32.
+ */
+class MetricCounter
+{
+public:
+    void add(uint32_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    uint32_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value{0};
+};
+
+class MetricHistogram;
+
+MetricHistogram *metricsHistograms[METRICS_HISTOGRAMS_MAX];
+std::atomic<uint8_t> metricsHistogramCount{0};
+
+/**
+ * @brief The call count and latency distribution of a handler, or of other code, exported as a histogram of its own.
+ */
+class MetricHistogram
+{
+public:
+    /**
+     * @param name The value of the handler label. Must live as long as the histogram.
+     */
+    MetricHistogram(const char *name) : MetricHistogram(name, METRICS_HANDLER_HISTOGRAM, "How long the handler took to run.") {}
+
+    /**
+     * @param metric The name of the histogram, which has no labels.
+     * @param help What's measured. Both must live as long as the histogram.
+     */
+    MetricHistogram(const char *metric, const char *help) : MetricHistogram(NULL, metric, help) {}
+
+    /**
+     * @brief Records a call that took [micros] microseconds.
+     */
+    void record(uint32_t micros)
+    {
+        uint8_t bucket = 0;
+        while (bucket < METRICS_BUCKETS && micros > metricsBucketBounds[bucket])
+            bucket++;
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        // Wraps around after 71 minutes of accumulated time, which Prometheus takes as a counter reset
+        sum.fetch_add(micros, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief The value of the handler label, NULL for the histograms of their own.
+     */
+    const char *name;
+    const char *metric;
+    const char *help;
+    std::atomic<uint32_t> buckets[METRICS_BUCKETS + 1] = {};
+    std::atomic<uint32_t> sum{0};
+
+private:
+    MetricHistogram(const char *name, const char *metric, const char *help) : name(name), metric(metric), help(help)
+    {
+        uint8_t index = metricsHistogramCount.fetch_add(1);
+        if (index < METRICS_HISTOGRAMS_MAX)
+            metricsHistograms[index] = this;
+    }
+};
+
+/**
+ * @brief Records the time from its construction until it goes out of scope into a histogram.
+ */
+class MetricTimer
+{
+public:
+    MetricTimer(MetricHistogram &histogram) : histogram(histogram), start(micros()) {}
+
+    ~MetricTimer() { histogram.record(micros() - start); }
+
+private:
+    MetricHistogram &histogram;
+    unsigned long start;
+};
+
+/**
+ * @brief Appends the header of the metric [name] to [out].
+ */
+void metricsWriteHeader(String &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+}
+
+/**
+ * @brief Appends the metric [name] with a single [value] to [out].
+ */
+void metricsWriteValue(String &out, const char *name, const char *type, const char *help, uint32_t value)
+{
+    metricsWriteHeader(out, name, type, help);
+    out += name;
+    out += " ";
+    out += String(value);
+    out += "\n";
+}
+
+/**
+ * @brief Appends the buckets, the sum and the count of [histogram] to [out].
+ */
+void metricsWriteHistogram(String &out, const MetricHistogram &histogram)
+{
+    char labels[48] = "";
+    if (histogram.name != NULL)
+        snprintf(labels, sizeof(labels), "handler=\"%s\",", histogram.name);
+    char line[160];
+    // Buckets are cumulative in Prometheus
+    uint32_t total = 0;
+    for (uint8_t b = 0; b <= METRICS_BUCKETS; b++)
+    {
+        total += histogram.buckets[b].load(std::memory_order_relaxed);
+        if (b < METRICS_BUCKETS)
+            snprintf(line, sizeof(line), "%s_bucket{%sle=\"%g\"} %u\n", histogram.metric, labels, metricsBucketBounds[b] / 1e6, total);
+        else
+            snprintf(line, sizeof(line), "%s_bucket{%sle=\"+Inf\"} %u\n", histogram.metric, labels, total);
+        out += line;
+    }
+    char series[48] = "";
+    if (histogram.name != NULL)
+        snprintf(series, sizeof(series), "{handler=\"%s\"}", histogram.name);
+    snprintf(line, sizeof(line), "%s_sum%s %.6f\n", histogram.metric, series, histogram.sum.load(std::memory_order_relaxed) / 1e6);
+    out += line;
+    snprintf(line, sizeof(line), "%s_count%s %u\n", histogram.metric, series, total);
+    out += line;
+}
+
+/**
+ * @brief Appends all the histograms to [out]: the one of the handlers, and then the ones of their own.
+ */
+void metricsWriteHistograms(String &out)
+{
+    uint8_t count = std::min(metricsHistogramCount.load(), (uint8_t)METRICS_HISTOGRAMS_MAX);
+    metricsWriteHeader(out, METRICS_HANDLER_HISTOGRAM, "histogram", "How long the handler took to run.");
+    for (uint8_t i = 0; i < count; i++)
+        if (metricsHistograms[i]->name != NULL)
+            metricsWriteHistogram(out, *metricsHistograms[i]);
+    for (uint8_t i = 0; i < count; i++)
+        if (metricsHistograms[i]->name == NULL)
+        {
+            metricsWriteHeader(out, metricsHistograms[i]->metric, "histogram", metricsHistograms[i]->help);
+            metricsWriteHistogram(out, *metricsHistograms[i]);
+        }
+}
+
+/**
+ * @brief Appends the heap usage and the stack usage of every task to [out].
+ */
+void metricsWriteSystem(String &out)
+{
+    metricsWriteValue(out, "ems_heap_free_bytes", "gauge", "Free heap.", ESP.getFreeHeap());
+    metricsWriteValue(out, "ems_heap_min_free_bytes", "gauge", "Lowest free heap since boot.", ESP.getMinFreeHeap());
+    metricsWriteValue(out, "ems_heap_largest_free_block_bytes", "gauge", "Largest block that can be allocated.", ESP.getMaxAllocHeap());
+
+    char line[96];
+    metricsWriteHeader(out, "ems_task_stack_free_bytes", "gauge", "Lowest free stack of the task since it started.");
+    for (const char *name : metricsTasks)
+    {
+        TaskHandle_t task = xTaskGetHandle(name);
+        if (task == NULL)
+            continue;
+        snprintf(line, sizeof(line), "ems_task_stack_free_bytes{task=\"%s\"} %u\n", name, (unsigned)uxTaskGetStackHighWaterMark(task));
+        out += line;
+    }
+}
+
+#endif
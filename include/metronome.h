@@ -0,0 +1,404 @@
+/**
+ * @file metronome.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Counts the beats of the score opened, following its changes of tempo and time signature. A hardware timer
+ * fires at every beat, at a time computed from the start with the tempo map, so the delays of the tasks never add up.
+ * Its interrupt sends the click to a buzzer, longer on the first beat of the measure, and wakes a task that runs the
+ * beat callbacks, which may scroll the pages.
+ * @version 0.1
+ * @date 2022-03-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef METRONOME_H
+#define METRONOME_H
+
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+// Include cpp headers
+#include <atomic>
+
+// Include utils files
+#include "layout.h"
+#include "logger.h"
+#include "metrics.h"
+#include "pref_consts.h"
+#include "renderer.h"
+#include "timeline.h"
+
+/**
+ * @brief The hardware timer of the metronome, before the ones of the pedals.
+ */
+#define METRONOME_TIMER 1
+
+/**
+ * @brief Divides the 80 MHz of the timer down to a tick per microsecond.
+ */
+#define METRONOME_TIMER_DIVIDER 80
+
+/**
+ * @brief Silent until a buzzer is wired and set with metronome.pin.
+ */
+#define METRONOME_DEFAULT_PIN -1
+
+/**
+ * @brief How long the buzzer sounds for a beat, and for the first one of a measure, in microseconds.
+ */
+#define METRONOME_CLICK_US 1000
+#define METRONOME_ACCENT_US 3000
+
+/**
+ * @brief The time from starting until the first beat, in microseconds.
+ */
+#define METRONOME_LEAD_US 100000
+
+/**
+ * @brief The earliest an alarm is set from now, in microseconds. An alarm set in the past would never fire.
+ */
+#define METRONOME_MIN_ALARM_US 10
+
+#define METRONOME_MAX_SCROLL_BEATS 8
+
+#define METRONOME_QUEUE_LENGTH 16
+#define METRONOME_TASK_STACK_SIZE 3072
+
+/**
+ * @brief Above every other task, the beat callbacks run as close to the beat as they can.
+ */
+#define METRONOME_TASK_PRIORITY (tskIDLE_PRIORITY + 5)
+
+struct MetronomeBeat
+{
+    uint32_t tick;
+
+    /**
+     * @brief The beat in the measure, from 0, and the beats of the measure.
+     */
+    uint8_t beat;
+    uint8_t beats;
+    uint16_t reserved;
+
+    /**
+     * @brief The page to show, turned [metronomeScrollBeats] beats before the end of the page the beat is in.
+     */
+    int32_t page;
+
+    /**
+     * @brief When the beat should have been and when it was, in microseconds since the metronome started.
+     */
+    uint64_t due;
+    uint64_t fired;
+};
+
+/**
+ * @brief Where the metronome is in a timeline.
+ */
+struct MetronomeCursor
+{
+    /**
+     * @brief The tempo and the time signature at [tick].
+     */
+    size_t tempo;
+    size_t meter;
+    size_t page;
+
+    /**
+     * @brief Where the tempo is counted from, and when that is, in microseconds.
+     */
+    uint32_t tempoTick;
+    uint64_t tempoMicros;
+
+    /**
+     * @brief The tick of the next beat.
+     */
+    uint32_t tick;
+};
+
+/**
+ * @brief Called by [metronomeTask] with every beat. Set by the features that follow the beats.
+ */
+void (*metronomeOnBeat)(const MetronomeBeat &beat) = NULL;
+
+/**
+ * @brief The GPIO of the buzzer, or -1 if silent.
+ */
+int8_t metronomePin = -1;
+
+/**
+ * @brief The beats before the end of a page when it's turned, or 0 for not turning the pages.
+ */
+std::atomic<uint8_t> metronomeScrollBeats{0};
+
+std::atomic<bool> metronomeRunning{false};
+
+MetricCounter metronomeBeatCount;
+
+/**
+ * @brief From when a beat is due until its interrupt runs.
+ */
+MetricHistogram metronomeLate("ems_metronome_late_seconds", "How late the beats of the metronome fired.");
+
+/**
+ * @brief Guards the timeline and the state of the interrupt.
+ */
+portMUX_TYPE metronomeLock = portMUX_INITIALIZER_UNLOCKED;
+hw_timer_t *metronomeTimer = NULL;
+QueueHandle_t metronomeBeats = NULL;
+Timeline *metronomeTimeline = NULL;
+MetronomeCursor metronomeCursor;
+
+/**
+ * @brief The beat the timer is set for, and whether the buzzer is sounding until the timer fires.
+ */
+MetronomeBeat metronomeNextBeat;
+bool metronomeClicking = false;
+bool metronomeEnding = false;
+
+/**
+ * @brief Gives when [tick] is played, in microseconds, moving the tempo of [cursor] up to it. The ticks given must not
+ * go back.
+ */
+uint64_t IRAM_ATTR metronomeTime(const Timeline &timeline, MetronomeCursor &cursor, uint32_t tick)
+{
+    while (cursor.tempo + 1 < timeline.tempos.size() && timeline.tempos[cursor.tempo + 1].tick <= tick)
+    {
+        const TimelineTempo &next = timeline.tempos[cursor.tempo + 1];
+        cursor.tempoMicros += (uint64_t)(next.tick - cursor.tempoTick) * timeline.tempos[cursor.tempo].quarterMicros / TIMELINE_TICKS_PER_QUARTER;
+        cursor.tempoTick = next.tick;
+        cursor.tempo++;
+    }
+    return cursor.tempoMicros + (uint64_t)(tick - cursor.tempoTick) * timeline.tempos[cursor.tempo].quarterMicros / TIMELINE_TICKS_PER_QUARTER;
+}
+
+/**
+ * @brief Places [cursor] at [tick] of [timeline], which is played at [micros] microseconds. The first beat is the first
+ * one from [tick] on.
+ */
+void metronomeSeek(const Timeline &timeline, MetronomeCursor &cursor, uint32_t tick, uint64_t micros)
+{
+    cursor = {0, 0, 0, tick, micros, tick};
+    while (cursor.tempo + 1 < timeline.tempos.size() && timeline.tempos[cursor.tempo + 1].tick <= tick)
+        cursor.tempo++;
+    while (cursor.meter + 1 < timeline.meters.size() && timeline.meters[cursor.meter + 1].tick <= tick)
+        cursor.meter++;
+    while (cursor.page + 1 < timeline.pages.size() && timeline.pages[cursor.page].end <= tick)
+        cursor.page++;
+    if (timeline.meters.empty())
+        return;
+    const TimelineMeter &meter = timeline.meters[cursor.meter];
+    uint32_t beatTicks = TIMELINE_TICKS_PER_QUARTER * 4 / max(meter.beatType, (uint8_t)1);
+    cursor.tick = meter.tick + (tick - meter.tick + beatTicks - 1) / beatTicks * beatTicks;
+}
+
+/**
+ * @brief Gives the beat of [timeline] at [cursor] into [beat], turning the page [scrollBeats] beats before its end,
+ * and moves [cursor] to the next beat.
+ *
+ * @return true If there was a beat, false at the end of the timeline.
+ */
+bool IRAM_ATTR metronomeNext(const Timeline &timeline, MetronomeCursor &cursor, uint8_t scrollBeats, MetronomeBeat &beat)
+{
+    if (timeline.pages.empty() || timeline.meters.empty() || timeline.tempos.empty() || cursor.tick >= timeline.pages.back().end)
+        return false;
+    uint32_t tick = cursor.tick;
+    while (cursor.meter + 1 < timeline.meters.size() && timeline.meters[cursor.meter + 1].tick <= tick)
+        cursor.meter++;
+    const TimelineMeter &meter = timeline.meters[cursor.meter];
+    uint32_t beatTicks = TIMELINE_TICKS_PER_QUARTER * 4 / max(meter.beatType, (uint8_t)1);
+    uint8_t beats = max(meter.beats, (uint8_t)1);
+    while (cursor.page + 1 < timeline.pages.size() && tick + scrollBeats * timeline.pages[cursor.page].beat >= timeline.pages[cursor.page].end)
+        cursor.page++;
+
+    beat.tick = tick;
+    beat.beat = (tick - meter.tick) / beatTicks % beats;
+    beat.beats = beats;
+    beat.reserved = 0;
+    beat.page = cursor.page;
+    beat.due = metronomeTime(timeline, cursor, tick);
+    beat.fired = 0;
+
+    // A measure cut short by a change of time signature ends its last beat
+    cursor.tick = tick + beatTicks;
+    if (cursor.meter + 1 < timeline.meters.size())
+        cursor.tick = min(cursor.tick, timeline.meters[cursor.meter + 1].tick);
+    return true;
+}
+
+/**
+ * @brief Sets the timer to fire at [alarm] microseconds, or right away if that's gone. Must be called holding
+ * [metronomeLock].
+ */
+void IRAM_ATTR metronomeAlarm(uint64_t alarm, uint64_t now)
+{
+    timerAlarmWrite(metronomeTimer, max(alarm, now + METRONOME_MIN_ALARM_US), false);
+    timerAlarmEnable(metronomeTimer);
+}
+
+/**
+ * @brief Sounds the beat the timer was set for and sets it for the next one, or ends the click sounding.
+ */
+void IRAM_ATTR metronomeISR()
+{
+    BaseType_t woken = pdFALSE;
+    portENTER_CRITICAL_ISR(&metronomeLock);
+    uint64_t now = timerRead(metronomeTimer);
+    if (!metronomeRunning.load())
+    {
+        // Stopped while the timer was firing
+    }
+    else if (metronomeClicking)
+    {
+        digitalWrite(metronomePin, LOW);
+        metronomeClicking = false;
+        if (metronomeEnding)
+            metronomeRunning.store(false);
+        else
+            metronomeAlarm(metronomeNextBeat.due, now);
+    }
+    else
+    {
+        MetronomeBeat beat = metronomeNextBeat;
+        beat.fired = now;
+        xQueueSendFromISR(metronomeBeats, &beat, &woken);
+        metronomeEnding = !metronomeNext(*metronomeTimeline, metronomeCursor, metronomeScrollBeats.load(), metronomeNextBeat);
+        if (metronomePin >= 0)
+        {
+            digitalWrite(metronomePin, HIGH);
+            metronomeClicking = true;
+            metronomeAlarm(beat.due + (beat.beat == 0 ? METRONOME_ACCENT_US : METRONOME_CLICK_US), now);
+        }
+        else if (metronomeEnding)
+            metronomeRunning.store(false);
+        else
+            metronomeAlarm(metronomeNextBeat.due, now);
+    }
+    portEXIT_CRITICAL_ISR(&metronomeLock);
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief Runs the callbacks of every beat, and turns the pages if scrolling.
+ */
+void metronomeTask(void *parameter)
+{
+    MetronomeBeat beat;
+    int32_t scrolled = -1;
+    while (true)
+    {
+        if (xQueueReceive(metronomeBeats, &beat, portMAX_DELAY) != pdTRUE)
+            continue;
+        metronomeBeatCount.add();
+        metronomeLate.record(beat.fired > beat.due ? beat.fired - beat.due : 0);
+        if (metronomeOnBeat)
+            metronomeOnBeat(beat);
+        // Only the turns of the metronome, so the pages can still be turned by hand
+        if (metronomeScrollBeats.load() > 0 && beat.page != scrolled && beat.page != renderPage.load())
+            renderGoTo(beat.page);
+        scrolled = beat.page;
+    }
+}
+
+/**
+ * @brief Stops counting the beats.
+ */
+void metronomeStop()
+{
+    portENTER_CRITICAL(&metronomeLock);
+    if (metronomeTimer)
+        timerAlarmDisable(metronomeTimer);
+    if (metronomeClicking)
+        digitalWrite(metronomePin, LOW);
+    metronomeClicking = false;
+    metronomeRunning.store(false);
+    portEXIT_CRITICAL(&metronomeLock);
+}
+
+/**
+ * @brief Counts the beats of the score opened from [tick] on, until its end.
+ *
+ * @return true If there's a beat from [tick] on.
+ */
+bool metronomeStart(uint32_t tick)
+{
+    metronomeStop();
+    portENTER_CRITICAL(&metronomeLock);
+    bool started = metronomeTimer && metronomeTimeline;
+    if (started)
+    {
+        metronomeSeek(*metronomeTimeline, metronomeCursor, tick, METRONOME_LEAD_US);
+        started = metronomeNext(*metronomeTimeline, metronomeCursor, metronomeScrollBeats.load(), metronomeNextBeat);
+    }
+    if (started)
+    {
+        metronomeEnding = false;
+        metronomeRunning.store(true);
+        timerWrite(metronomeTimer, 0);
+        metronomeAlarm(metronomeNextBeat.due, 0);
+    }
+    portEXIT_CRITICAL(&metronomeLock);
+    return started;
+}
+
+/**
+ * @brief Counts the beats from the start of [page] of the score opened.
+ *
+ * @return true If the page has beats.
+ */
+bool metronomeStartPage(int32_t page)
+{
+    uint32_t tick = 0;
+    portENTER_CRITICAL(&metronomeLock);
+    if (metronomeTimeline && page >= 0 && page < (int32_t)metronomeTimeline->pages.size())
+        tick = metronomeTimeline->pages[page].start;
+    portEXIT_CRITICAL(&metronomeLock);
+    return metronomeStart(tick);
+}
+
+/**
+ * @brief Counts the beats of [layout] from now on, stopping the metronome. Takes a copy of its timeline.
+ */
+void metronomeOpen(const Layout &layout)
+{
+    Timeline *timeline = new Timeline(layout.timeline);
+    metronomeStop();
+    portENTER_CRITICAL(&metronomeLock);
+    std::swap(metronomeTimeline, timeline);
+    portEXIT_CRITICAL(&metronomeLock);
+    delete timeline;
+}
+
+/**
+ * @brief Takes the buzzer and the scrolling as set in the preferences, after they changed.
+ */
+void metronomeReconfigure()
+{
+    int8_t pin = preferences.getInt(pref_metronomePin, METRONOME_DEFAULT_PIN);
+    metronomeStop();
+    metronomePin = pin;
+    if (pin >= 0)
+    {
+        pinMode(pin, OUTPUT);
+        digitalWrite(pin, LOW);
+    }
+    metronomeScrollBeats = preferences.getUChar(pref_metronomeScroll, 0);
+}
+
+/**
+ * @brief Takes the timer of the metronome, and starts [metronomeTask].
+ */
+void metronomeBegin()
+{
+    metronomeBeats = xQueueCreate(METRONOME_QUEUE_LENGTH, sizeof(MetronomeBeat));
+    metronomeTimer = timerBegin(METRONOME_TIMER, METRONOME_TIMER_DIVIDER, true);
+    timerAttachInterrupt(metronomeTimer, metronomeISR, true);
+    metronomeReconfigure();
+    xTaskCreate(metronomeTask, "metronome", METRONOME_TASK_STACK_SIZE, NULL, METRONOME_TASK_PRIORITY, NULL);
+}
+
+#endif
@@ -13,52 +13,68 @@
 #define MUSICXML_H
 
 // Include dependencies
-#include <SPIFFS.h>
-#include <fstream>
+#include <istream>
 #include "mx/api/DocumentManager.h"
 #include "mx/api/ScoreData.h"
 
 // Include utils files
 #include "logger.h"
+#include "storage.h"
+#include "metrics.h"
 
 #define LOAD_MUSIC_RESULT_OK 0
 #define LOAD_MUSIC_RESULT_FAIL 1
 
-int loadMusic(String path)
-{
-    infoln("Started parsing MusicXML at \"" + path + "\"...");
-    if (!SPIFFS.exists(path)){
-        errln("Could not open file at \"" + path + "\". File doesn't exist.");
-        return LOAD_MUSIC_RESULT_FAIL;
-        }
+MetricHistogram loadMusicLatency("loadMusic");
+
+MetricCounter scoresParsed;
 
-    debugln("Reading file...");
+/**
+ * @brief Parses the MusicXML file at [path] into [score].
+ *
+ * @return true If the file could be opened.
+ */
+bool parseScore(const String &path, mx::api::ScoreData &score)
+{
+    std::unique_ptr<StorageFile> file = storage->open(path.c_str(), "r");
+    if (!file)
+    {
+        LOGE(LOG_MUSIC, "Could not open file at \"%s\". File doesn't exist.", path.c_str());
+        return false;
+    }
 
     // Once the XML is read, parse it
-    debugln("Using MX namespace.");
     using namespace mx::api;
+    scoresParsed.add();
 
     // Create a reference to the singleton which holds documents in memory for us
-    debugln("Getting mgr instance...");
     auto &mgr = DocumentManager::getInstance();
-    debug("Opening ifstream of \"");
-    debug(path);
-    debugln("\"...");
-    std::ifstream istr(path.c_str());
+    LOGD(LOG_MUSIC, "Opening stream of \"%s\"...", path.c_str());
+    StorageStreamBuf buffer(*file);
+    std::istream istr(&buffer);
 
     // Ask the document manager to parse the xml into memory for us, returns a document ID.
-    debugln("Creating documentId from stream...");
+    LOGD(LOG_MUSIC, "Creating documentId from stream...");
     const auto documentId = mgr.createFromStream(istr);
 
     // Get the structural representation of the score from the document manager
-    debugln("Getting score data...");
-    const auto score = mgr.getData(documentId);
+    score = mgr.getData(documentId);
 
     // We need to explicitly destroy the document from memory
-    debug("Destroying document \"");
-    debug(String(documentId));
-    debugln("\"...");
+    LOGD(LOG_MUSIC, "Destroying document \"%d\"...", documentId);
     mgr.destroyDocument(documentId);
+    return true;
+}
+
+int loadMusic(String path)
+{
+    MetricTimer timer(loadMusicLatency);
+    LOGI(LOG_MUSIC, "Started parsing MusicXML at \"%s\"...", path.c_str());
+
+    using namespace mx::api;
+    ScoreData score;
+    if (!parseScore(path, score))
+        return LOAD_MUSIC_RESULT_FAIL;
 
     if (score.parts.size() != 1)
         return LOAD_MUSIC_RESULT_FAIL;
@@ -74,7 +90,7 @@ int loadMusic(String path)
         note.pitchData.step != Step::c)
         return LOAD_MUSIC_RESULT_FAIL;
 
-    infoln("Finished parsing MusicXML");
+    LOGI(LOG_MUSIC, "Finished parsing MusicXML");
 
     return LOAD_MUSIC_RESULT_OK;
 }
@@ -0,0 +1,43 @@
+/**
+ * @file mutex.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Recursive FreeRTOS mutex, for the state shared by the request handlers, the tasks and the main loop that's
+ * held across file system calls, where a critical section can't be.
+ * @version 0.1
+ * @date 2022-03-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+// Include libraries
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Include cpp headers
+#include <mutex>
+
+/**
+ * @brief A mutex that the task holding it can take again. Created with the globals, before any task starts. Held with
+ * std::lock_guard.
+ */
+class RecursiveMutex
+{
+public:
+    RecursiveMutex() : handle(xSemaphoreCreateRecursiveMutex()) {}
+
+    RecursiveMutex(const RecursiveMutex &) = delete;
+    RecursiveMutex &operator=(const RecursiveMutex &) = delete;
+
+    void lock() { xSemaphoreTakeRecursive(handle, portMAX_DELAY); }
+
+    void unlock() { xSemaphoreGiveRecursive(handle); }
+
+private:
+    SemaphoreHandle_t handle;
+};
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * @file pedal.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Turns pages with foot pedals. Every pedal is a switch to ground on a GPIO, whose interrupt sends the turn
+ * straight to the renderer on the first edge, and ignores the bounces after it until a hardware timer sees the contact
+ * settled. The pins, the debounce time and the polarity are kept in the preferences.
+ * @version 0.1
+ * @date 2022-03-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef PEDAL_H
+#define PEDAL_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include utils files
+#include "logger.h"
+#include "metrics.h"
+#include "pref_consts.h"
+#include "renderer.h"
+
+/**
+ * @brief The amount of pedals: the first turns to the next page, the second to the previous one.
+ */
+#define PEDAL_INPUTS 2
+
+#define PEDAL_DEFAULT_NEXT_PIN 32
+#define PEDAL_DEFAULT_PREVIOUS_PIN 33
+
+/**
+ * @brief The time that the contacts take to settle after an edge, in milliseconds.
+ */
+#define PEDAL_DEFAULT_DEBOUNCE_MS 30
+#define PEDAL_MAX_DEBOUNCE_MS 500
+
+/**
+ * @brief The hardware timer of the first pedal, the rest take the ones after it.
+ */
+#define PEDAL_TIMER_FIRST 2
+
+/**
+ * @brief Divides the 80 MHz of the timers down to a tick per microsecond.
+ */
+#define PEDAL_TIMER_DIVIDER 80
+
+struct Pedal
+{
+    /**
+     * @brief The GPIO of the pedal, or -1 if disabled.
+     */
+    int8_t pin;
+
+    /**
+     * @brief The pages turned when pressed.
+     */
+    int32_t pages;
+
+    hw_timer_t *timer;
+
+    /**
+     * @brief Set from an edge until the timer fires, edges are bounces meanwhile.
+     */
+    volatile bool settling;
+
+    /**
+     * @brief The state of the pedal after the last edge taken.
+     */
+    volatile bool pressed;
+};
+
+Pedal pedals[PEDAL_INPUTS] = {{-1, 1}, {-1, -1}};
+
+/**
+ * @brief The level of the pins while pressed. Pedals are normally open switches to ground, unless inverted.
+ */
+volatile uint8_t pedalPressedLevel = LOW;
+
+MetricCounter pedalPresses;
+MetricCounter pedalBounces;
+
+/**
+ * @brief Handles an edge of the pedal at [index]. The turn is sent on the first edge of a press, so the debounce time
+ * doesn't delay it.
+ */
+void IRAM_ATTR pedalEdge(int index)
+{
+    Pedal &pedal = pedals[index];
+    if (pedal.settling)
+    {
+        pedalBounces.add();
+        return;
+    }
+    bool pressed = digitalRead(pedal.pin) == pedalPressedLevel;
+    if (pressed == pedal.pressed)
+        return;
+    pedal.pressed = pressed;
+    if (pressed)
+    {
+        renderTurnFromISR(pedal.pages, micros());
+        pedalPresses.add();
+    }
+    pedal.settling = true;
+    timerWrite(pedal.timer, 0);
+    timerAlarmEnable(pedal.timer);
+}
+
+/**
+ * @brief Ends the debounce time of the pedal at [index]. The pin may have settled at the other level after the edges
+ * ignored, which is taken as an edge.
+ */
+void IRAM_ATTR pedalSettled(int index)
+{
+    Pedal &pedal = pedals[index];
+    pedal.settling = false;
+    if ((digitalRead(pedal.pin) == pedalPressedLevel) != pedal.pressed)
+        pedalEdge(index);
+}
+
+template <int index>
+void IRAM_ATTR pedalEdgeISR() { pedalEdge(index); }
+
+template <int index>
+void IRAM_ATTR pedalSettledISR() { pedalSettled(index); }
+
+void (*const pedalEdgeISRs[PEDAL_INPUTS])() = {pedalEdgeISR<0>, pedalEdgeISR<1>};
+void (*const pedalSettledISRs[PEDAL_INPUTS])() = {pedalSettledISR<0>, pedalSettledISR<1>};
+
+/**
+ * @brief Attaches the pedals to [next] and [previous], -1 disabling them, settling in [debounceMs] milliseconds.
+ * [invert] takes pedals that close when released. Must be called after [pedalBegin] took the timers.
+ */
+void pedalConfigure(int8_t next, int8_t previous, uint16_t debounceMs, bool invert)
+{
+    const int8_t pins[PEDAL_INPUTS] = {next, previous};
+    pedalPressedLevel = invert ? HIGH : LOW;
+    for (int i = 0; i < PEDAL_INPUTS; i++)
+    {
+        Pedal &pedal = pedals[i];
+        if (pedal.pin >= 0)
+            detachInterrupt(digitalPinToInterrupt(pedal.pin));
+        timerAlarmDisable(pedal.timer);
+        timerAlarmWrite(pedal.timer, (uint64_t)debounceMs * 1000, false);
+        pedal.settling = false;
+        pedal.pin = pins[i];
+        if (pedal.pin < 0)
+            continue;
+        pinMode(pedal.pin, INPUT_PULLUP);
+        pedal.pressed = digitalRead(pedal.pin) == pedalPressedLevel;
+        attachInterrupt(digitalPinToInterrupt(pedal.pin), pedalEdgeISRs[i], CHANGE);
+        LOGI(LOG_MUSIC, "Pedal %d on GPIO %d", i, pedal.pin);
+    }
+}
+
+/**
+ * @brief Attaches the pedals as set in the preferences, after they changed.
+ */
+void pedalReconfigure()
+{
+    pedalConfigure(preferences.getInt(pref_pedalNext, PEDAL_DEFAULT_NEXT_PIN),
+                   preferences.getInt(pref_pedalPrevious, PEDAL_DEFAULT_PREVIOUS_PIN),
+                   preferences.getUShort(pref_pedalDebounce, PEDAL_DEFAULT_DEBOUNCE_MS),
+                   preferences.getBool(pref_pedalInvert, false));
+}
+
+/**
+ * @brief Takes the timers of the pedals, and attaches them as set in the preferences.
+ */
+void pedalBegin()
+{
+    for (int i = 0; i < PEDAL_INPUTS; i++)
+    {
+        pedals[i].timer = timerBegin(PEDAL_TIMER_FIRST + i, PEDAL_TIMER_DIVIDER, true);
+        timerAttachInterrupt(pedals[i].timer, pedalSettledISRs[i], true);
+    }
+    pedalReconfigure();
+}
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ * @file pins.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief The GPIOs that can be given to the pedals and the metronome through the configuration.
+ * @version 0.1
+ * @date 2022-03-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef PINS_H
+#define PINS_H
+
+// Include libraries
+#include <Arduino.h>
+
+/**
+ * @brief The GPIOs free for inputs with a pull-up and for outputs. The rest are taken by the flash (6 to 11), UART0
+ * (1 and 3) or the microphone (14, 15 and 34, see audio_i2s.h), change how the chip boots when pulled (0, 2, 5, 12
+ * and 15), or are input only without pull-ups (34 to 39).
+ */
+const int8_t pinsFree[] = {4, 13, 16, 17, 18, 19, 21, 22, 23, 25, 26, 27, 32, 33};
+
+/**
+ * @brief Checks whether [pin] is in [pinsFree].
+ */
+bool pinFree(int pin)
+{
+    for (int8_t free : pinsFree)
+        if (free == pin)
+            return true;
+    return false;
+}
+
+#endif
@@ -12,8 +12,88 @@
 #ifndef PREF_CONSTS_H
 #define PREF_CONSTS_H
 
+// Include libraries
+#include <Preferences.h>
+
+// Include utils files
+#include "metrics.h"
+
+/**
+ * @brief The amount of writes to NVS since boot. Every one of them wears the flash.
+ */
+MetricCounter nvsWrites;
+
+/**
+ * @brief Preferences that count the writes into [nvsWrites].
+ */
+class MeteredPreferences : public Preferences
+{
+public:
+    template <typename... Args>
+    size_t putInt(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putInt(args...);
+    }
+
+    template <typename... Args>
+    size_t putUInt(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putUInt(args...);
+    }
+
+    template <typename... Args>
+    size_t putUShort(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putUShort(args...);
+    }
+
+    template <typename... Args>
+    size_t putULong(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putULong(args...);
+    }
+
+    template <typename... Args>
+    size_t putUChar(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putUChar(args...);
+    }
+
+    template <typename... Args>
+    size_t putBool(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putBool(args...);
+    }
+
+    template <typename... Args>
+    size_t putString(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putString(args...);
+    }
+
+    template <typename... Args>
+    size_t putBytes(Args... args)
+    {
+        nvsWrites.add();
+        return Preferences::putBytes(args...);
+    }
+
+    bool remove(const char *key)
+    {
+        nvsWrites.add();
+        return Preferences::remove(key);
+    }
+};
+
 // For storing key-value data
-Preferences preferences;
+MeteredPreferences preferences;
 
 /**
  * @brief The name of the preferences storage.
@@ -66,6 +146,80 @@ const char *pref_timezone = "tz";
  */
 const char *pref_wifiTimeout = "wifi-to";
 
+/**
+ * @brief The preferences key for storing the name of the last score opened, which is opened again on boot.
+ */
+const char *pref_lastScore = "last-score";
+
+/**
+ * @brief The preferences key for storing the access point, channel and address of the last WiFi connection, used for
+ * reconnecting without scanning.
+ */
+const char *pref_wifiCache = "wifi-cache";
+
+/**
+ * @brief The preferences key for storing the semitones the scores are transposed by.
+ */
+const char *pref_transpose = "transpose";
+
+/**
+ * @brief The preferences keys for storing the GPIOs of the pedals that turn to the next and the previous page, -1 if
+ * disabled.
+ */
+const char *pref_pedalNext = "pedal-next";
+const char *pref_pedalPrevious = "pedal-prev";
+
+/**
+ * @brief The preferences key for storing the time the pedals take to settle, in milliseconds.
+ */
+const char *pref_pedalDebounce = "pedal-db";
+
+/**
+ * @brief The preferences key for storing whether the pedals close when released.
+ */
+const char *pref_pedalInvert = "pedal-inv";
+
+/**
+ * @brief The preferences key for storing whether the pages are turned by following the audio of the microphone.
+ */
+const char *pref_followEnabled = "follow-on";
+
+/**
+ * @brief The preferences key for storing the beats before the end of a page when the follower turns it.
+ */
+const char *pref_followBeats = "follow-beats";
+
+/**
+ * @brief The preferences key for storing the role of the stand in the section, see [SyncRole].
+ */
+const char *pref_syncRole = "sync-role";
+
+/**
+ * @brief The preferences key for storing the GPIO of the buzzer of the metronome, -1 if silent.
+ */
+const char *pref_metronomePin = "metro-pin";
+
+/**
+ * @brief The preferences key for storing the beats before the end of a page when the metronome turns it, 0 if it
+ * doesn't.
+ */
+const char *pref_metronomeScroll = "metro-scroll";
+
+/**
+ * @brief The preferences key for storing the names of the scores of the setlist, one per line.
+ */
+const char *pref_setlist = "setlist";
+
+/**
+ * @brief The preferences key for storing the entry of the setlist open, -1 if none.
+ */
+const char *pref_setlistPosition = "setlist-pos";
+
+/**
+ * @brief The preferences key for storing the token that scrapers send for reading /metrics, empty if none can.
+ */
+const char *pref_metricsToken = "metrics-token";
+
 
 /**
  * @brief The amount of time in milliseconds that the device will try until giving up on connecting to a wifi network.
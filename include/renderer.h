@@ -0,0 +1,772 @@
+/**
+ * @file renderer.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Draws the pages of the open score into 1-bit frame buffers, with the bitmaps of the glyph atlas. While a page is shown, the next and the previous
+ * ones are drawn ahead of time by a task on the core not used by the network stack, so turning the page is swapping
+ * the buffer shown. Pages not drawn yet when turned to are drawn by the same task before being shown.
+ * @version 0.1
+ * @date 2022-03-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+// Include cpp headers
+#include <atomic>
+#include <math.h>
+
+// Include utils files
+#include "control.h"
+#include "damage.h"
+#include "glyphs.h"
+#include "layout.h"
+#include "logger.h"
+#include "metrics.h"
+
+/**
+ * @brief The amount of frame buffers: the page shown, the next one and the previous one. Less are used when they
+ * don't fit in the heap, the next page is drawn ahead first.
+ */
+#define RENDER_BUFFERS 3
+
+/**
+ * @brief The heap left free for the web server and the parser when allocating the frame buffers, in bytes.
+ */
+#define RENDER_HEAP_RESERVE (64 * 1024)
+
+/**
+ * @brief The amount of turns that can wait to be served.
+ */
+#define RENDER_QUEUE_LENGTH 8
+
+#define RENDER_TASK_STACK_SIZE 4096
+#define RENDER_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+
+/**
+ * @brief The core the pages are drawn on. WiFi and lwIP run on core 0.
+ */
+#define RENDER_CORE 1
+
+FrameBuffer renderBuffers[RENDER_BUFFERS];
+uint8_t renderBufferCount = 0;
+
+/**
+ * @brief The index of the buffer shown, or -1. Only changed by [renderTask].
+ */
+int renderShown = -1;
+
+/**
+ * @brief Sends the parts of [buffer] in [damage] to the display, and refreshes them. Set by the display driver,
+ * nothing is sent while it's not set.
+ */
+void (*renderDisplay)(const FrameBuffer &buffer, const Damage &damage) = NULL;
+
+/**
+ * @brief Tracks what's on the display, for only sending what changes. Only used by [renderTask].
+ */
+DamageTracker renderDamage;
+
+/**
+ * @brief Called by [renderTask] with the page that should be shown of [layout] whenever it changes, the first one of a
+ * score opened included, before it's drawn.
+ */
+void (*renderTurned)(const Layout &layout, int32_t page) = NULL;
+
+/**
+ * @brief A request for [renderTask]: turning [pages] pages, or showing the score opened when 0. When [absolute],
+ * showing the page [pages] instead.
+ */
+struct RenderRequest
+{
+    int32_t pages;
+
+    /**
+     * @brief When the request was made, in microseconds.
+     */
+    uint32_t requested;
+    bool absolute;
+};
+
+QueueHandle_t renderRequests = NULL;
+
+/**
+ * @brief The page that should be shown, and the amount of pages of the open score. Only changed by [renderTask].
+ */
+std::atomic<int32_t> renderPage{0};
+std::atomic<int32_t> renderPageCount{0};
+
+/**
+ * @brief When the turn not served yet was requested, in microseconds. Only used by [renderTask].
+ */
+bool renderTurnPending = false;
+uint32_t renderTurnRequested = 0;
+
+/**
+ * @brief The layout opened by [renderOpen], taken by [renderTask] before drawing anything else.
+ */
+std::atomic<Layout *> renderOpened{NULL};
+
+/**
+ * @brief The layout drawn by [renderTask]. Only used by it.
+ */
+Layout *renderLayout = NULL;
+
+/**
+ * @brief Whether [renderLayout] was asked to be laid out again, since a page of it is not in the cache. Asked once, so
+ * a score that can't be stored doesn't keep the main loop laying it out. Only used by [renderTask].
+ */
+bool renderRelayOutRequested = false;
+
+MetricCounter renderPagesDrawn;
+MetricCounter renderTurnsPrefetched;
+MetricCounter renderTurnsMissed;
+
+/**
+ * @brief From a page turn being requested to the new page being sent to the display.
+ */
+MetricHistogram renderTurnLatency("ems_page_turn_seconds", "How long from asking for a page turn until the page was shown.");
+
+void renderFillRect(FrameBuffer &buffer, int x, int y, int w, int h)
+{
+    int x0 = max(x, 0), x1 = min(x + w, (int)buffer.width);
+    int y0 = max(y, 0), y1 = min(y + h, (int)buffer.height);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    int first = x0 >> 3, last = (x1 - 1) >> 3;
+    uint8_t firstMask = 0xff >> (x0 & 7);
+    uint8_t lastMask = 0xff << (7 - ((x1 - 1) & 7));
+    for (int row = y0; row < y1; row++)
+    {
+        uint8_t *line = buffer.pixels + row * buffer.stride;
+        if (first == last)
+        {
+            line[first] |= firstMask & lastMask;
+            continue;
+        }
+        line[first] |= firstMask;
+        memset(line + first + 1, 0xff, last - first - 1);
+        line[last] |= lastMask;
+    }
+}
+
+void renderHLine(FrameBuffer &buffer, int x0, int x1, int y)
+{
+    renderFillRect(buffer, x0, y, x1 - x0 + 1, 1);
+}
+
+void renderVLine(FrameBuffer &buffer, int x, int y0, int y1)
+{
+    renderFillRect(buffer, x, y0, 1, y1 - y0 + 1);
+}
+
+void renderLine(FrameBuffer &buffer, int x0, int y0, int x1, int y1)
+{
+    int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+    int error = dx + dy;
+    while (true)
+    {
+        renderFillRect(buffer, x0, y0, 1, 1);
+        if (x0 == x1 && y0 == y1)
+            return;
+        int e2 = 2 * error;
+        if (e2 >= dy)
+        {
+            error += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx)
+        {
+            error += dx;
+            y0 += sy;
+        }
+    }
+}
+
+/**
+ * @brief Fills the ellipse centered at [cx], [cy] with radii [rx] and [ry], except the ellipse with radii [irx] and
+ * [iry] inside it. It's filled completely when the inner radii are 0.
+ */
+void renderEllipse(FrameBuffer &buffer, float cx, float cy, float rx, float ry, float irx = 0, float iry = 0)
+{
+    for (int y = (int)floorf(cy - ry); y <= (int)ceilf(cy + ry); y++)
+    {
+        float dy = (y - cy) / ry;
+        if (dy * dy > 1)
+            continue;
+        float half = rx * sqrtf(1 - dy * dy);
+        float inner = -1;
+        if (irx > 0 && fabsf(y - cy) < iry)
+        {
+            float idy = (y - cy) / iry;
+            inner = irx * sqrtf(1 - idy * idy);
+        }
+        int left = lroundf(cx - half), right = lroundf(cx + half);
+        if (inner < 0)
+        {
+            renderHLine(buffer, left, right, y);
+            continue;
+        }
+        renderHLine(buffer, left, lroundf(cx - inner) - 1, y);
+        renderHLine(buffer, lroundf(cx + inner) + 1, right, y);
+    }
+}
+
+/**
+ * @brief Draws the digit [digit] centered vertically at [y], two spaces high.
+ */
+void renderDigit(FrameBuffer &buffer, int digit, float x, float y, float space)
+{
+    // 3x5 cells, one row in every 3 bits
+    const uint16_t font[10] = {075557, 026227, 071747, 071717, 055711, 074717, 074757, 071111, 075757, 075717};
+    float cell = space * 2 / 5;
+    for (int row = 0; row < 5; row++)
+        for (int column = 0; column < 3; column++)
+            if (font[digit] & (1 << ((4 - row) * 3 + 2 - column)))
+                renderFillRect(buffer, lroundf(x + column * cell), lroundf(y - space + row * cell), ceilf(cell), ceilf(cell));
+}
+
+/**
+ * @brief Draws the flag of [count] beams from the end of the stem at [x], [y].
+ */
+void renderFlags(FrameBuffer &buffer, int count, float x, float y, float space, bool up)
+{
+    float direction = up ? 1 : -1;
+    for (int i = 0; i < count; i++)
+    {
+        float from = y + direction * i * 0.75f * space;
+        renderLine(buffer, lroundf(x), lroundf(from), lroundf(x + 0.8f * space), lroundf(from + direction * space));
+        renderLine(buffer, lroundf(x), lroundf(from + direction), lroundf(x + 0.8f * space), lroundf(from + direction * (space + 1)));
+    }
+}
+
+void renderSharp(FrameBuffer &buffer, float x, float y, float s)
+{
+    renderVLine(buffer, lroundf(x + 0.35f * s), lroundf(y - 1.3f * s), lroundf(y + 1.3f * s));
+    renderVLine(buffer, lroundf(x + 0.75f * s), lroundf(y - 1.3f * s), lroundf(y + 1.3f * s));
+    renderFillRect(buffer, lroundf(x + 0.1f * s), lroundf(y - 0.5f * s), lroundf(0.9f * s), 2);
+    renderFillRect(buffer, lroundf(x + 0.1f * s), lroundf(y + 0.3f * s), lroundf(0.9f * s), 2);
+}
+
+void renderFlat(FrameBuffer &buffer, float x, float y, float s)
+{
+    renderVLine(buffer, lroundf(x + 0.3f * s), lroundf(y - 2 * s), lroundf(y + 0.5f * s));
+    renderEllipse(buffer, x + 0.6f * s, y, 0.35f * s, 0.5f * s, 0.2f * s, 0.3f * s);
+}
+
+/**
+ * @brief Draws [bitmap] with its origin at [x], [y] into [buffer], setting the pixels covered enough.
+ */
+void renderBlit1(FrameBuffer &buffer, const GlyphBitmap &bitmap, int x, int y)
+{
+    int left = x + bitmap.left, top = y + bitmap.top;
+    glyphRuns(bitmap, [&](uint16_t column, uint16_t row, uint16_t count, uint8_t level)
+              {
+        if (level >= GLYPH_THRESHOLD)
+            renderFillRect(buffer, left + column, top + row, count, 1); });
+}
+
+/**
+ * @brief Draws [bitmap] with its origin at [x], [y] into a 4-bit grayscale buffer of [width] by [height] pixels, two
+ * per byte with the left one in the high nibble, and 15 for black. Pixels keep the darkest of both.
+ */
+void renderBlit4(uint8_t *pixels, uint16_t stride, uint16_t width, uint16_t height, const GlyphBitmap &bitmap, int x, int y)
+{
+    int left = x + bitmap.left, top = y + bitmap.top;
+    glyphRuns(bitmap, [&](uint16_t column, uint16_t row, uint16_t count, uint8_t level)
+              {
+        int py = top + row;
+        if (py < 0 || py >= height)
+            return;
+        for (int px = max(left + column, 0); px < min(left + column + count, (int)width); px++)
+        {
+            uint8_t &pair = pixels[py * stride + px / 2];
+            uint8_t shift = px & 1 ? 0 : 4;
+            if (level > ((pair >> shift) & 0x0f))
+                pair = (pair & ~(0x0f << shift)) | (level << shift);
+        } });
+}
+
+/**
+ * @brief Gives where the origin of the SMuFL glyph of [item] goes. Flags are placed at the end of the stem, and dots
+ * by their center.
+ */
+void renderGlyphOrigin(const DisplayItem &item, float s, int &x, int &y)
+{
+    x = item.x;
+    y = item.y;
+    switch (item.glyph)
+    {
+    case GLYPH_FLAG_8TH_UP:
+    case GLYPH_FLAG_16TH_UP:
+    case GLYPH_FLAG_32ND_UP:
+        x = lroundf(item.x + 1.2f * s) - 1;
+        y = lroundf(item.y - 3.5f * s);
+        break;
+    case GLYPH_FLAG_8TH_DOWN:
+    case GLYPH_FLAG_16TH_DOWN:
+    case GLYPH_FLAG_32ND_DOWN:
+        y = lroundf(item.y + 3.5f * s);
+        break;
+    case GLYPH_DOT:
+        x = lroundf(item.x - 0.2f * s);
+        break;
+    }
+}
+
+/**
+ * @brief Draws [item] into [buffer], for pages laid out with [space] pixels between staff lines. Glyphs not in the atlas
+ * are drawn from shapes.
+ */
+void renderGlyph(FrameBuffer &buffer, const DisplayItem &item, float s)
+{
+    const GlyphBitmap *bitmap = glyphFind(item.glyph, lroundf(s));
+    if (bitmap)
+    {
+        int x, y;
+        renderGlyphOrigin(item, s, x, y);
+        renderBlit1(buffer, *bitmap, x, y);
+        return;
+    }
+
+    float x = item.x, y = item.y;
+    switch (item.glyph)
+    {
+    case GLYPH_STAFF:
+        for (int line = 0; line < 5; line++)
+            renderHLine(buffer, item.x, lroundf(buffer.width - LAYOUT_MARGIN * s), lroundf(y + line * s));
+        break;
+    case GLYPH_BARLINE:
+        renderVLine(buffer, item.x, item.y, lroundf(y + 4 * s));
+        break;
+    case GLYPH_BARLINE_FINAL:
+        renderVLine(buffer, lroundf(x - 0.9f * s), item.y, lroundf(y + 4 * s));
+        renderFillRect(buffer, lroundf(x - 0.5f * s), item.y, lroundf(0.5f * s), lroundf(4 * s) + 1);
+        break;
+    case GLYPH_CLEF_G:
+        // Curled around the G line
+        renderVLine(buffer, lroundf(x + 1.2f * s), lroundf(y - 4 * s), lroundf(y + 2 * s));
+        renderEllipse(buffer, x + 1.2f * s, y, s, s, s - 1.5f, s - 1.5f);
+        renderEllipse(buffer, x + 0.9f * s, y + 2 * s, 0.3f * s, 0.3f * s);
+        break;
+    case GLYPH_CLEF_F:
+        // Curled around the F line, with a dot on each side of it
+        renderEllipse(buffer, x + 0.5f * s, y, 0.45f * s, 0.45f * s);
+        renderEllipse(buffer, x + 1.2f * s, y + 0.5f * s, s, 1.2f * s, s - 1.5f, 1.2f * s - 1.5f);
+        renderEllipse(buffer, x + 2.8f * s, y - 0.5f * s, 0.2f * s, 0.2f * s);
+        renderEllipse(buffer, x + 2.8f * s, y + 0.5f * s, 0.2f * s, 0.2f * s);
+        break;
+    case GLYPH_CLEF_C:
+        renderFillRect(buffer, item.x, lroundf(y - 2 * s), lroundf(0.4f * s), lroundf(4 * s) + 1);
+        renderVLine(buffer, lroundf(x + 0.7f * s), lroundf(y - 2 * s), lroundf(y + 2 * s));
+        renderLine(buffer, lroundf(x + 0.7f * s), item.y, lroundf(x + 2.2f * s), lroundf(y - 1.5f * s));
+        renderLine(buffer, lroundf(x + 0.7f * s), item.y, lroundf(x + 2.2f * s), lroundf(y + 1.5f * s));
+        break;
+    case GLYPH_SHARP:
+        renderSharp(buffer, x, y, s);
+        break;
+    case GLYPH_FLAT:
+        renderFlat(buffer, x, y, s);
+        break;
+    case GLYPH_NATURAL:
+        renderVLine(buffer, lroundf(x + 0.3f * s), lroundf(y - 1.3f * s), lroundf(y + 0.5f * s));
+        renderVLine(buffer, lroundf(x + 0.8f * s), lroundf(y - 0.5f * s), lroundf(y + 1.3f * s));
+        renderFillRect(buffer, lroundf(x + 0.3f * s), lroundf(y - 0.5f * s), lroundf(0.5f * s) + 1, 2);
+        renderFillRect(buffer, lroundf(x + 0.3f * s), lroundf(y + 0.3f * s), lroundf(0.5f * s) + 1, 2);
+        break;
+    case GLYPH_DOUBLE_SHARP:
+        renderLine(buffer, lroundf(x + 0.2f * s), lroundf(y - 0.4f * s), lroundf(x + s), lroundf(y + 0.4f * s));
+        renderLine(buffer, lroundf(x + 0.2f * s), lroundf(y + 0.4f * s), lroundf(x + s), lroundf(y - 0.4f * s));
+        break;
+    case GLYPH_DOUBLE_FLAT:
+        renderFlat(buffer, x - 0.5f * s, y, s);
+        renderFlat(buffer, x + 0.2f * s, y, s);
+        break;
+    case GLYPH_NOTEHEAD_WHOLE:
+        renderEllipse(buffer, x + 0.6f * s, y, 0.6f * s, 0.45f * s, 0.3f * s, 0.3f * s);
+        break;
+    case GLYPH_NOTEHEAD_HALF:
+        renderEllipse(buffer, x + 0.6f * s, y, 0.6f * s, 0.45f * s, 0.6f * s - 1.5f, 0.45f * s - 1.5f);
+        break;
+    case GLYPH_NOTEHEAD_BLACK:
+        renderEllipse(buffer, x + 0.6f * s, y, 0.6f * s, 0.45f * s);
+        break;
+    case GLYPH_STEM_UP:
+        renderVLine(buffer, lroundf(x + 1.2f * s) - 1, lroundf(y - 3.5f * s), item.y);
+        break;
+    case GLYPH_STEM_DOWN:
+        renderVLine(buffer, item.x, item.y, lroundf(y + 3.5f * s));
+        break;
+    case GLYPH_FLAG_8TH_UP:
+    case GLYPH_FLAG_16TH_UP:
+    case GLYPH_FLAG_32ND_UP:
+        renderFlags(buffer, (item.glyph - GLYPH_FLAG_8TH_UP) / 2 + 1, x + 1.2f * s - 1, y - 3.5f * s, s, true);
+        break;
+    case GLYPH_FLAG_8TH_DOWN:
+    case GLYPH_FLAG_16TH_DOWN:
+    case GLYPH_FLAG_32ND_DOWN:
+        renderFlags(buffer, (item.glyph - GLYPH_FLAG_8TH_DOWN) / 2 + 1, x, y + 3.5f * s, s, false);
+        break;
+    case GLYPH_REST_WHOLE:
+        // Hangs from the line
+        renderFillRect(buffer, item.x, item.y, lroundf(1.2f * s), lroundf(0.5f * s));
+        break;
+    case GLYPH_REST_HALF:
+        // Sits on the line
+        renderFillRect(buffer, item.x, lroundf(y - 0.5f * s), lroundf(1.2f * s), lroundf(0.5f * s));
+        break;
+    case GLYPH_REST_QUARTER:
+    {
+        const float zigzag[5][2] = {{0.3f, -1.5f}, {0.9f, -0.5f}, {0.3f, 0.3f}, {0.9f, 1.2f}, {0.5f, 1.5f}};
+        for (int i = 0; i < 4; i++)
+            for (int offset = 0; offset < 2; offset++)
+                renderLine(buffer, lroundf(x + zigzag[i][0] * s) + offset, lroundf(y + zigzag[i][1] * s),
+                           lroundf(x + zigzag[i + 1][0] * s) + offset, lroundf(y + zigzag[i + 1][1] * s));
+        break;
+    }
+    case GLYPH_REST_8TH:
+    case GLYPH_REST_16TH:
+    case GLYPH_REST_32ND:
+        renderLine(buffer, lroundf(x + s), lroundf(y - s), lroundf(x + 0.4f * s), lroundf(y + 1.5f * s));
+        for (int i = 0; i <= item.glyph - GLYPH_REST_8TH; i++)
+            renderEllipse(buffer, x + 0.4f * s, y - s + i * 0.75f * s, 0.25f * s, 0.25f * s);
+        break;
+    case GLYPH_DOT:
+        renderEllipse(buffer, x, y, max(0.2f * s, 1.0f), max(0.2f * s, 1.0f));
+        break;
+    case GLYPH_LEDGER:
+        renderHLine(buffer, lroundf(x - 0.4f * s), lroundf(x + 1.6f * s), item.y);
+        break;
+    default:
+        if (item.glyph >= GLYPH_TIME_0 && item.glyph <= GLYPH_TIME_9)
+            renderDigit(buffer, item.glyph - GLYPH_TIME_0, x, y, s);
+        break;
+    }
+}
+
+/**
+ * @brief Gives the buffer holding [page], or -1.
+ */
+int renderFindBuffer(int32_t page)
+{
+    for (int i = 0; i < renderBufferCount; i++)
+        if (renderBuffers[i].page == page)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief Gives a buffer that can be drawn into without losing the page shown or the pages around [page], or -1.
+ */
+int renderFreeBuffer(int32_t page)
+{
+    int free = -1;
+    for (int i = 0; i < renderBufferCount; i++)
+    {
+        if (i == renderShown)
+            continue;
+        if (renderBuffers[i].page < 0)
+            return i;
+        if (abs(renderBuffers[i].page - page) > 1)
+            free = i;
+    }
+    return free;
+}
+
+/**
+ * @brief Gives the page [pages] pages away from [page], within the pages of the open score.
+ */
+int32_t renderTarget(int32_t page, int32_t pages)
+{
+    return max((int32_t)0, min(page + pages, renderPageCount.load() - 1));
+}
+
+/**
+ * @brief Gives the page that [request] turns to from [renderPage].
+ */
+int32_t renderRequestTarget(const RenderRequest &request)
+{
+    return request.absolute ? renderTarget(0, request.pages) : renderTarget(renderPage.load(), request.pages);
+}
+
+/**
+ * @brief Whether drawing [page] should be stopped, because a score was opened, or the next turn waiting goes away from
+ * it.
+ */
+bool renderCancelled(int32_t page)
+{
+    RenderRequest next;
+    if (renderOpened.load() != NULL)
+        return true;
+    return xQueuePeek(renderRequests, &next, 0) == pdTRUE && abs(renderRequestTarget(next) - page) > 1;
+}
+
+/**
+ * @brief Draws [page] of [renderLayout] into the buffer [index].
+ *
+ * @return true If the page was drawn completely.
+ */
+bool renderDraw(int index, int32_t page)
+{
+    FrameBuffer &buffer = renderBuffers[index];
+    buffer.page = -1;
+    memset(buffer.pixels, 0, buffer.stride * buffer.height);
+
+    float space = layoutGeometry.staffSpace;
+    bool cancelled = false;
+    size_t drawn = 0;
+    bool replayed = layoutReplay(*renderLayout, page, [&](const DisplayItem &item)
+                                 {
+        // Checked in batches, the check is more expensive than most glyphs
+        if (cancelled || (++drawn % LAYOUT_REPLAY_BATCH == 0 && (cancelled = renderCancelled(page))))
+            return;
+        renderGlyph(buffer, item, space); });
+    if (cancelled)
+        return false;
+    if (!replayed)
+    {
+        // Left undrawn, so it's drawn once laid out again
+        LOGE(LOG_MUSIC, "Page %d of %s is not in the cache, laying it out again", page, renderLayout->id.c_str());
+        if (!renderRelayOutRequested)
+            renderRelayOutRequested = controlPost(CONTROL_LAYOUT, "Open score evicted");
+        return false;
+    }
+
+    buffer.page = page;
+    renderPagesDrawn.add();
+    return true;
+}
+
+/**
+ * @brief Records the latency of the turn waiting for the page shown, if any.
+ */
+void renderTurnServed()
+{
+    if (!renderTurnPending)
+        return;
+    renderTurnPending = false;
+    renderTurnLatency.record(micros() - renderTurnRequested);
+}
+
+/**
+ * @brief Makes the buffer [index] the one shown.
+ */
+void renderShow(int index)
+{
+    // The buffer shown is kept as it is while shown, unless there's no other buffer for drawing into
+    const FrameBuffer *shown = renderShown >= 0 && renderShown != index ? &renderBuffers[renderShown] : NULL;
+    renderShown = index;
+    Damage damage;
+    if (renderDisplay && renderDamage.plan(shown, renderBuffers[index], damage))
+        renderDisplay(renderBuffers[index], damage);
+    renderTurnServed();
+}
+
+/**
+ * @brief Takes the score opened by [renderOpen], if any, and applies [request].
+ */
+void renderApply(const RenderRequest &request)
+{
+    Layout *opened = renderOpened.exchange(NULL);
+    if (opened)
+    {
+        delete renderLayout;
+        renderLayout = opened;
+        renderShown = -1;
+        for (int i = 0; i < renderBufferCount; i++)
+            renderBuffers[i].page = -1;
+        renderPageCount.store(opened->pages.size());
+        renderPage.store(0);
+        renderTurnPending = false;
+        renderRelayOutRequested = false;
+    }
+
+    int32_t target = renderRequestTarget(request);
+    if (target == renderPage.load())
+    {
+        if (opened && renderTurned)
+            renderTurned(*renderLayout, target);
+        return;
+    }
+    renderPage.store(target);
+    if (renderTurned)
+        renderTurned(*renderLayout, target);
+    // Measured from the first turn of a burst
+    if (!renderTurnPending)
+    {
+        renderTurnPending = true;
+        renderTurnRequested = request.requested;
+    }
+}
+
+/**
+ * @brief Shows [renderPage], and then draws the pages around it.
+ */
+void renderUpdate()
+{
+    if (renderLayout == NULL || renderLayout->pages.empty() || renderBufferCount == 0)
+        return;
+
+    int32_t page = renderPage.load();
+    if (renderShown < 0 || renderBuffers[renderShown].page != page)
+    {
+        // Showing the first page of a score opened is not a turn
+        bool turn = renderTurnPending;
+        int index = renderFindBuffer(page);
+        if (index >= 0)
+            renderTurnsPrefetched.add(turn);
+        else
+        {
+            index = renderFreeBuffer(page);
+            // With a single buffer, the page shown is drawn over
+            if (index < 0)
+                index = renderShown >= 0 ? renderShown : 0;
+            if (!renderDraw(index, page))
+                return;
+            renderTurnsMissed.add(turn);
+        }
+        renderShow(index);
+    }
+    else
+        // Turned back to the page shown before it changed
+        renderTurnServed();
+
+    // The next page first, it's the one usually turned to
+    for (int32_t around : {page + 1, page - 1})
+    {
+        if (around < 0 || around >= (int32_t)renderLayout->pages.size() || renderFindBuffer(around) >= 0)
+            continue;
+        int index = renderFreeBuffer(page);
+        if (index < 0 || uxQueueMessagesWaiting(renderRequests) > 0 || !renderDraw(index, around))
+            return;
+    }
+}
+
+void renderTask(void *parameter)
+{
+    RenderRequest request;
+    while (true)
+    {
+        if (xQueueReceive(renderRequests, &request, portMAX_DELAY) != pdTRUE)
+            continue;
+        // Every turn waiting is applied before drawing
+        do
+            renderApply(request);
+        while (xQueueReceive(renderRequests, &request, 0) == pdTRUE);
+        renderUpdate();
+    }
+}
+
+/**
+ * @brief Shows [page] of [layout], drawing the pages around it in the background. Takes a copy, so [layout] can be
+ * changed afterwards. Its cache files are evicted last while open.
+ */
+void renderOpen(const Layout &layout, int32_t page = 0)
+{
+    quotaSetOpen(layout.id);
+    // Opened again before being drawn
+    delete renderOpened.exchange(new Layout(layout));
+    RenderRequest request = {page, (uint32_t)micros(), true};
+    if (renderRequests)
+        xQueueSend(renderRequests, &request, 0);
+}
+
+/**
+ * @brief Lays out the score open again, as asked by [renderTask] when a page of it is not in the cache any more, and
+ * shows the same page. Run by the main loop, it parses the score.
+ *
+ * @return true If every page is in the cache again.
+ */
+bool renderRelayOut()
+{
+    Layout layout;
+    mx::api::ScoreData score;
+    String id = scoreLayout.id;
+    if (id.length() == 0 || !parseScore(scoreBlobPath(id), score) || !layoutBuild(id, score, layoutGeometry, layout))
+    {
+        LOGE(LOG_MUSIC, "Could not lay out %s again", id.c_str());
+        return false;
+    }
+    renderOpen(layout, renderPage.load());
+    return true;
+}
+
+/**
+ * @brief Turns [pages] pages forward, or backward when negative. The turn is served by [renderTask]: a buffer swap if
+ * the page was drawn ahead, or drawing it otherwise.
+ *
+ * @return int32_t The page that will be shown, unless other turns are waiting.
+ */
+int32_t renderTurn(int32_t pages)
+{
+    RenderRequest request = {pages, (uint32_t)micros()};
+    if (renderRequests == NULL || xQueueSend(renderRequests, &request, 0) != pdTRUE)
+    {
+        LOGW(LOG_MUSIC, "Page turn dropped");
+        return renderPage.load();
+    }
+    return renderTarget(renderPage.load(), pages);
+}
+
+/**
+ * @brief Shows [page] of the open score, or the closest one to it.
+ */
+void renderGoTo(int32_t page)
+{
+    RenderRequest request = {page, (uint32_t)micros(), true};
+    if (renderRequests == NULL || xQueueSend(renderRequests, &request, 0) != pdTRUE)
+        LOGW(LOG_MUSIC, "Page turn dropped");
+}
+
+/**
+ * @brief Turns [pages] pages from an interrupt, requested at [requested] microseconds.
+ */
+void IRAM_ATTR renderTurnFromISR(int32_t pages, uint32_t requested)
+{
+    RenderRequest request = {pages, requested};
+    BaseType_t woken = pdFALSE;
+    if (renderRequests)
+        xQueueSendFromISR(renderRequests, &request, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief Allocates the frame buffers for [layoutGeometry], as many as fit in the heap, and starts [renderTask].
+ *
+ * @return true If there's at least one buffer.
+ */
+bool renderBegin()
+{
+    // Rows start at a word boundary, they're compared a word at a time
+    uint16_t stride = (layoutGeometry.width + 31) / 32 * 4;
+    size_t size = (size_t)stride * layoutGeometry.height;
+    while (renderBufferCount < RENDER_BUFFERS && ESP.getMaxAllocHeap() >= size && ESP.getFreeHeap() >= size + RENDER_HEAP_RESERVE)
+    {
+        uint8_t *pixels = (uint8_t *)malloc(size);
+        if (pixels == NULL)
+            break;
+        renderBuffers[renderBufferCount++] = {pixels, layoutGeometry.width, layoutGeometry.height, stride, -1};
+    }
+    if (renderBufferCount == 0)
+    {
+        LOGE(LOG_MUSIC, "No heap for a frame buffer of %u bytes", (unsigned)size);
+        return false;
+    }
+    if (renderBufferCount < RENDER_BUFFERS)
+        LOGW(LOG_MUSIC, "Only %u frame buffers fit in the heap, less pages are drawn ahead", renderBufferCount);
+
+    renderRequests = xQueueCreate(RENDER_QUEUE_LENGTH, sizeof(RenderRequest));
+    xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK_SIZE, NULL, RENDER_TASK_PRIORITY, NULL, RENDER_CORE);
+    return true;
+}
+
+#endif
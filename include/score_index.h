@@ -0,0 +1,514 @@
+/**
+ * @file score_index.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Keeps what's read from every score, its title, composer, parts, key, duration and measures, in a single file
+ * with a line per score, so scores can be searched without opening them. Scores are indexed when laid out, and the
+ * ones uploaded are parsed for it by the main loop, one at a time.
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef SCORE_INDEX_H
+#define SCORE_INDEX_H
+
+// Include libraries
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <functional>
+#include <istream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Include utils files
+#include "control.h"
+#include "layout.h"
+#include "logger.h"
+#include "metrics.h"
+#include "musicxml.h"
+#include "score_store.h"
+#include "storage_quota.h"
+#include "timeline.h"
+#include "utils.h"
+
+/**
+ * @brief The first line of the index. Indexes with another one are written again from the start.
+ */
+#define SCORE_INDEX_HEADER "EMSI 1"
+
+/**
+ * @brief The most scores answered by a search.
+ */
+#define SCORE_SEARCH_MAX_RESULTS 50
+
+/**
+ * @brief The heap left free while a score is parsed for the index, in bytes. Below it, the score is parsed
+ * [SCORE_INDEX_RETRY_MS] later, handling other events meanwhile.
+ */
+#define SCORE_INDEX_HEAP_RESERVE (96 * 1024)
+#define SCORE_INDEX_RETRY_MS 1000
+
+/**
+ * @brief The share of the lines of the index, in percent, left by scores removed or indexed twice, past which it's
+ * written again without them. Until then, scores are appended to it.
+ */
+#define SCORE_INDEX_STALE_PERCENT 25
+
+/**
+ * @brief What's read from a score.
+ */
+struct ScoreInfo
+{
+    String title;
+    String composer;
+    std::vector<String> parts;
+
+    /**
+     * @brief The key at the start, in sharps, or flats when negative.
+     */
+    int8_t fifths;
+    uint32_t seconds;
+    uint32_t measures;
+};
+
+/**
+ * @brief The ids of the scores stored that are in the index, and the ones that couldn't be parsed since boot. Guarded
+ * by [scoreIndexLock], as the index file.
+ */
+std::set<String> scoreIndexed;
+std::set<String> scoreIndexFailed;
+SemaphoreHandle_t scoreIndexLock = NULL;
+
+/**
+ * @brief The lines of the index file, including the ones of scores removed since, and whether it has the header of
+ * this version, so lines can be appended to it.
+ */
+size_t scoreIndexLines = 0;
+bool scoreIndexCurrent = false;
+
+MetricCounter scoreIndexAdded;
+MetricHistogram scoreSearchLatency("search");
+
+/**
+ * @brief Reads [score], at the tempos of its metronome marks.
+ */
+ScoreInfo scoreInfo(const mx::api::ScoreData &score)
+{
+    ScoreInfo info = {String(score.workTitle.c_str()), String(score.composer.c_str()), {}, 0, 0, 0};
+    for (const mx::api::PartData &part : score.parts)
+        if (!part.name.empty())
+            info.parts.push_back(String(part.name.c_str()));
+    if (!score.parts.empty() && !score.parts[0].measures.empty() && !score.parts[0].measures[0].keys.empty())
+        info.fifths = score.parts[0].measures[0].keys[0].fifths;
+
+    std::vector<int> partStaves = layoutPartStaves(score);
+    std::vector<LayoutMeasure> measures = layoutMeasures(score, partStaves, 0);
+    info.measures = measures.size();
+    if (measures.empty())
+        return info;
+    // The tempo map of a single system
+    Timeline timeline;
+    layoutTimeline(score, partStaves, measures, {{0, measures.size(), 1}}, 1, timeline);
+    info.seconds = (timelineMicros(timeline, timeline.pages.back().end) + 500000) / 1000000;
+    return info;
+}
+
+/**
+ * @brief Gives [text] without the tabs and line breaks that separate the fields of the index.
+ */
+String scoreIndexField(const String &text)
+{
+    String field = text;
+    for (unsigned int i = 0; i < field.length(); i++)
+        if (field[i] == '\t' || field[i] == '\r' || field[i] == '\n')
+            field.setCharAt(i, ' ');
+    return field;
+}
+
+/**
+ * @brief Gives the line of the index for the score [id]: its id, key, measures and seconds, title, composer and parts,
+ * separated by tabs.
+ */
+String scoreIndexLine(const String &id, const ScoreInfo &info)
+{
+    String line = id + "\t" + String(info.fifths) + "\t" + String(info.measures) + "\t" + String(info.seconds) + "\t" +
+                  scoreIndexField(info.title) + "\t" + scoreIndexField(info.composer);
+    for (const String &part : info.parts)
+        line += "\t" + scoreIndexField(part);
+    return line + "\n";
+}
+
+/**
+ * @brief Reads a line of the index into [id] and [info].
+ *
+ * @return true If the line has every field.
+ */
+bool scoreIndexParse(const std::string &line, String &id, ScoreInfo &info)
+{
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true)
+    {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos)
+            break;
+        start = tab + 1;
+    }
+    if (fields.size() < 6 || fields[0].size() != SCORE_ID_LENGTH)
+        return false;
+    id = String(fields[0].c_str());
+    info.fifths = atoi(fields[1].c_str());
+    info.measures = strtoul(fields[2].c_str(), NULL, 10);
+    info.seconds = strtoul(fields[3].c_str(), NULL, 10);
+    info.title = String(fields[4].c_str());
+    info.composer = String(fields[5].c_str());
+    info.parts.clear();
+    for (size_t i = 6; i < fields.size(); i++)
+        info.parts.push_back(String(fields[i].c_str()));
+    return true;
+}
+
+/**
+ * @brief Calls [line] with every line of the index after its header, if it has the one of this version. Must be
+ * called holding [scoreIndexLock].
+ *
+ * @return true If the index has the header of this version.
+ */
+bool scoreIndexRead(std::function<void(const std::string &line)> line)
+{
+    std::unique_ptr<StorageFile> file = storage->open(SCORE_INDEX_PATH, "r");
+    if (!file)
+        return false;
+    StorageStreamBuf buffer(*file);
+    std::istream stream(&buffer);
+    std::string text;
+    if (!std::getline(stream, text) || text != SCORE_INDEX_HEADER)
+        return false;
+    while (std::getline(stream, text))
+        line(text);
+    return true;
+}
+
+/**
+ * @brief Writes the index again with a line for every score of [stored] in it, dropping the ones of scores removed
+ * and the repeated ones. It's written to a temporary file first, as the manifest. Must be called holding
+ * [scoreIndexLock].
+ *
+ * @return true If the index was written.
+ */
+bool scoreIndexCompact(const std::set<String> &stored)
+{
+    StorageStat stat;
+    size_t size = storage->stat(SCORE_INDEX_PATH, stat) ? stat.size : 0;
+    QuotaReservation reservation(size + sizeof(SCORE_INDEX_HEADER));
+    if (!reservation.valid())
+        return false;
+
+    String tempPath = String(SCORE_TEMP_PREFIX) + "index";
+    std::set<String> indexed;
+    bool written;
+    {
+        std::unique_ptr<StorageFile> file = storage->open(tempPath.c_str(), "w");
+        written = file != nullptr;
+        auto write = [&](const String &text)
+        {
+            written = written && file->write((const uint8_t *)text.c_str(), text.length()) == text.length();
+        };
+        write(SCORE_INDEX_HEADER "\n");
+        scoreIndexRead([&](const std::string &line)
+                       {
+            String lineId = String(line.substr(0, SCORE_ID_LENGTH).c_str());
+            if (stored.count(lineId) == 0 || indexed.count(lineId) > 0)
+                return;
+            write(String(line.c_str()) + "\n");
+            indexed.insert(lineId); });
+    }
+    written = written && storage->rename(tempPath.c_str(), SCORE_INDEX_PATH);
+    if (written)
+    {
+        LOGI(LOG_FS, "Index compacted from %u to %u scores", (unsigned)scoreIndexLines, (unsigned)indexed.size());
+        scoreIndexed.swap(indexed);
+        scoreIndexLines = scoreIndexed.size();
+        scoreIndexCurrent = true;
+    }
+    else
+        storage->remove(tempPath.c_str());
+    quotaInvalidate();
+    return written;
+}
+
+/**
+ * @brief Drops the scores removed from [scoreIndexed], leaving their lines in the index file. Must be called holding
+ * [scoreIndexLock].
+ */
+void scoreIndexPrune(const std::set<String> &stored)
+{
+    for (auto indexed = scoreIndexed.begin(); indexed != scoreIndexed.end();)
+        indexed = stored.count(*indexed) > 0 ? std::next(indexed) : scoreIndexed.erase(indexed);
+}
+
+/**
+ * @brief Appends [info] of the score [id] to the index. The index is written again first if it's from another
+ * version, or too many of its lines are of scores removed.
+ *
+ * @return true If the index was written.
+ */
+bool scoreIndexWrite(const String &id, const ScoreInfo &info)
+{
+    std::set<String> stored;
+    for (auto &entry : scoreList())
+        stored.insert(entry.second);
+    String added = scoreIndexLine(id, info);
+    QuotaReservation reservation(added.length());
+    if (!reservation.valid())
+        return false;
+
+    xSemaphoreTake(scoreIndexLock, portMAX_DELAY);
+    scoreIndexPrune(stored);
+    size_t stale = scoreIndexLines - scoreIndexed.size();
+    bool written = true;
+    if (!scoreIndexCurrent || stale * 100 > scoreIndexLines * SCORE_INDEX_STALE_PERCENT)
+        written = scoreIndexCompact(stored);
+    if (written)
+    {
+        std::unique_ptr<StorageFile> file = storage->open(SCORE_INDEX_PATH, "a");
+        written = file && file->write((const uint8_t *)added.c_str(), added.length()) == added.length();
+    }
+    if (written)
+    {
+        scoreIndexed.insert(id);
+        scoreIndexLines++;
+    }
+    else
+        // A line could have been cut, so it's written again from the start next time
+        scoreIndexCurrent = false;
+    xSemaphoreGive(scoreIndexLock);
+    quotaInvalidate();
+    if (written)
+        scoreIndexAdded.add();
+    return written;
+}
+
+/**
+ * @brief Adds [score], with id [id], to the index if it isn't yet. Called with every score laid out.
+ */
+void scoreIndexAdd(const String &id, const mx::api::ScoreData &score)
+{
+    xSemaphoreTake(scoreIndexLock, portMAX_DELAY);
+    bool indexed = scoreIndexed.count(id) > 0;
+    xSemaphoreGive(scoreIndexLock);
+    if (!indexed && !scoreIndexWrite(id, scoreInfo(score)))
+        LOGW(LOG_MUSIC, "Could not index score %s", id.c_str());
+}
+
+/**
+ * @brief Parses the first score stored that isn't in the index, and adds it. Called by the main loop.
+ *
+ * @return true If there are scores left, so it must be called again. False too when waiting for heap, since it's
+ * called again later then.
+ */
+bool scoreIndexNext()
+{
+    String id;
+    std::map<String, String> manifest = scoreList();
+    xSemaphoreTake(scoreIndexLock, portMAX_DELAY);
+    for (auto &entry : manifest)
+        if (scoreIndexed.count(entry.second) == 0 && scoreIndexFailed.count(entry.second) == 0)
+        {
+            id = entry.second;
+            break;
+        }
+    xSemaphoreGive(scoreIndexLock);
+    if (id.length() == 0)
+        return false;
+    if (ESP.getFreeHeap() < SCORE_INDEX_HEAP_RESERVE)
+    {
+        LOGD(LOG_MUSIC, "Index waiting for heap to parse %s", id.c_str());
+        controlPostAfter(CONTROL_INDEX, "Index waiting for heap", SCORE_INDEX_RETRY_MS);
+        return false;
+    }
+
+    LOGI(LOG_MUSIC, "Indexing score %s...", id.c_str());
+    // Only this score is in memory, until it's indexed
+    bool indexed;
+    {
+        mx::api::ScoreData score;
+        indexed = parseScore(scoreBlobPath(id), score) && scoreIndexWrite(id, scoreInfo(score));
+    }
+    if (!indexed)
+    {
+        LOGW(LOG_MUSIC, "Could not index score %s", id.c_str());
+        xSemaphoreTake(scoreIndexLock, portMAX_DELAY);
+        scoreIndexFailed.insert(id);
+        xSemaphoreGive(scoreIndexLock);
+    }
+    return true;
+}
+
+/**
+ * @brief Splits [text] into lowercase words. Bytes out of ASCII are kept in the words, so accented letters don't
+ * split them.
+ */
+std::vector<std::string> scoreSearchTokens(const String &text)
+{
+    std::vector<std::string> tokens;
+    std::string token;
+    for (unsigned int i = 0; i <= text.length(); i++)
+    {
+        uint8_t c = i < text.length() ? text[i] : ' ';
+        if (isalnum(c) || c >= 0x80)
+            token += (char)tolower(c);
+        else if (!token.empty())
+        {
+            tokens.push_back(token);
+            token.clear();
+        }
+    }
+    return tokens;
+}
+
+/**
+ * @brief Gives how well [fields] match the words of [query]: 2 for every word found, 1 for every word starting one of
+ * the fields, and 4 more if [fields] start with the whole query. 0 if any word of the query isn't in [fields].
+ */
+int scoreSearchRank(const std::vector<std::string> &query, const String &lowerQuery, const std::vector<String> &fields)
+{
+    std::vector<std::string> tokens;
+    bool starts = false;
+    for (const String &field : fields)
+    {
+        std::vector<std::string> fieldTokens = scoreSearchTokens(field);
+        tokens.insert(tokens.end(), fieldTokens.begin(), fieldTokens.end());
+        String lower = field;
+        lower.toLowerCase();
+        starts = starts || (lowerQuery.length() > 0 && lower.startsWith(lowerQuery));
+    }
+    int rank = starts ? 4 : 0;
+    for (const std::string &word : query)
+    {
+        int best = 0;
+        for (const std::string &token : tokens)
+            if (token == word)
+                best = 2;
+            else if (best == 0 && token.compare(0, word.size(), word) == 0)
+                best = 1;
+        if (best == 0)
+            return 0;
+        rank += best;
+    }
+    return std::max(rank, 1);
+}
+
+/**
+ * @brief Gives the scores matching [query] in JSON, best first, read from the index and the manifest. Every word of
+ * the query must start a word of the name, title, composer or parts of a score. Scores not indexed yet are matched by
+ * their name.
+ */
+String scoreSearch(const String &query)
+{
+    MetricTimer timer(scoreSearchLatency);
+    std::vector<std::string> words = scoreSearchTokens(query);
+    String lowerQuery = query;
+    lowerQuery.trim();
+    lowerQuery.toLowerCase();
+    std::map<String, String> manifest = scoreList();
+    std::multimap<String, String> names;
+    for (auto &entry : manifest)
+        names.insert({entry.second, entry.first});
+
+    // The rank, the name and the result of every score matched
+    std::vector<std::pair<std::pair<int, String>, String>> results;
+    std::set<String> found;
+    auto add = [&](int rank, const String &name, const String &result)
+    {
+        results.push_back({{-rank, name}, result});
+        // Only the best ones are kept
+        if (results.size() >= 2 * SCORE_SEARCH_MAX_RESULTS)
+        {
+            std::sort(results.begin(), results.end());
+            results.resize(SCORE_SEARCH_MAX_RESULTS);
+        }
+    };
+
+    xSemaphoreTake(scoreIndexLock, portMAX_DELAY);
+    scoreIndexRead([&](const std::string &line)
+                   {
+        String id;
+        ScoreInfo info;
+        if (!scoreIndexParse(line, id, info))
+            return;
+        auto range = names.equal_range(id);
+        for (auto entry = range.first; entry != range.second; entry++)
+        {
+            // Indexed twice since the index was compacted
+            if (!found.insert(entry->second).second)
+                continue;
+            std::vector<String> fields = {entry->second, info.title, info.composer};
+            fields.insert(fields.end(), info.parts.begin(), info.parts.end());
+            int rank = scoreSearchRank(words, lowerQuery, fields);
+            if (rank == 0)
+                continue;
+            String result = "{\"name\":\"" + jsonEscape(entry->second) + "\",\"title\":\"" + jsonEscape(info.title) +
+                            "\",\"composer\":\"" + jsonEscape(info.composer) + "\",\"parts\":[";
+            for (size_t i = 0; i < info.parts.size(); i++)
+                result += (i > 0 ? ",\"" : "\"") + jsonEscape(info.parts[i]) + "\"";
+            result += "],\"key\":" + String(info.fifths) + ",\"seconds\":" + String(info.seconds) + ",\"measures\":" +
+                      String(info.measures) + "}";
+            add(rank, entry->second, result);
+        } });
+    xSemaphoreGive(scoreIndexLock);
+
+    for (auto &entry : manifest)
+    {
+        if (found.count(entry.first) > 0)
+            continue;
+        int rank = scoreSearchRank(words, lowerQuery, {entry.first});
+        if (rank > 0)
+            add(rank, entry.first, "{\"name\":\"" + jsonEscape(entry.first) + "\"}");
+    }
+
+    std::sort(results.begin(), results.end());
+    String out = "{\"results\":[";
+    for (size_t i = 0; i < results.size() && i < SCORE_SEARCH_MAX_RESULTS; i++)
+        out += (i > 0 ? "," : "") + results[i].second;
+    return out + "]}";
+}
+
+/**
+ * @brief Reads the ids in the index, writing it again without the lines of the scores removed, indexes every score
+ * laid out from now on, and has the main loop index the rest. Must be called after [scoreStoreBegin] and
+ * [controlBegin].
+ */
+void scoreIndexBegin()
+{
+    if (!scoreIndexLock)
+        scoreIndexLock = xSemaphoreCreateMutex();
+    std::set<String> stored;
+    for (auto &entry : scoreList())
+        stored.insert(entry.second);
+    xSemaphoreTake(scoreIndexLock, portMAX_DELAY);
+    scoreIndexed.clear();
+    scoreIndexLines = 0;
+    scoreIndexCurrent = scoreIndexRead([](const std::string &line)
+                                       {
+        scoreIndexed.insert(String(line.substr(0, SCORE_ID_LENGTH).c_str()));
+        scoreIndexLines++; });
+    scoreIndexPrune(stored);
+    if (!scoreIndexCurrent || scoreIndexLines > scoreIndexed.size())
+        scoreIndexCompact(stored);
+    xSemaphoreGive(scoreIndexLock);
+    LOGI(LOG_FS, "%u scores indexed", (unsigned)scoreIndexed.size());
+    layoutParsed = scoreIndexAdd;
+    controlPost(CONTROL_INDEX, "Indexing scores");
+}
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file score_open.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Opens scores asked for by the request handlers. Laying out a score can take seconds, and writes
+ * [scoreLayout], which the main loop reads, so the handlers only post CONTROL_OPEN and the main loop opens it.
+ * @version 0.1
+ * @date 2022-03-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef SCORE_OPEN_H
+#define SCORE_OPEN_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include cpp headers
+#include <mutex>
+
+// Include utils files
+#include "control.h"
+#include "follow.h"
+#include "layout.h"
+#include "metronome.h"
+#include "mutex.h"
+#include "renderer.h"
+#include "setlist.h"
+#include "sync.h"
+
+/**
+ * @brief What the next CONTROL_OPEN opens: the score called [scoreOpenName], or the entry [scoreOpenEntry] of the
+ * setlist when the name is empty. Only the last one asked for is opened.
+ */
+RecursiveMutex scoreOpenLock;
+String scoreOpenName;
+int32_t scoreOpenEntry = -1;
+
+/**
+ * @brief Shows [scoreLayout] on the display, and gives it to the follower, the metronome and the sync group.
+ */
+void scoreShow()
+{
+    renderOpen(scoreLayout);
+    followOpen(scoreLayout);
+    metronomeOpen(scoreLayout);
+    syncOpen(scoreLayout);
+}
+
+/**
+ * @brief Lays out the score called [name] into [scoreLayout], and shows it. Only called from setup() and the main
+ * loop.
+ *
+ * @return true If the score could be laid out.
+ */
+bool scoreOpen(const String &name)
+{
+    if (!layoutScore(name, layoutGeometry, scoreLayout))
+        return false;
+    scoreShow();
+    return true;
+}
+
+/**
+ * @brief Asks the main loop to open the score called [name]. Never blocks, so it can be called from request handlers.
+ */
+void scoreOpenLater(const String &name)
+{
+    {
+        std::lock_guard<RecursiveMutex> guard(scoreOpenLock);
+        scoreOpenName = name;
+        scoreOpenEntry = -1;
+    }
+    controlPost(CONTROL_OPEN, "Score asked for");
+}
+
+/**
+ * @brief Asks the main loop to open the entry [index] of the setlist. Never blocks, so it can be called from request
+ * handlers.
+ */
+void scoreOpenEntryLater(int32_t index)
+{
+    {
+        std::lock_guard<RecursiveMutex> guard(scoreOpenLock);
+        scoreOpenName = "";
+        scoreOpenEntry = index;
+    }
+    controlPost(CONTROL_OPEN, "Setlist entry asked for");
+}
+
+/**
+ * @brief Opens what was asked for last by scoreOpenLater or scoreOpenEntryLater. Run by the main loop.
+ */
+void scoreOpenAsked()
+{
+    String name;
+    int32_t entry;
+    {
+        std::lock_guard<RecursiveMutex> guard(scoreOpenLock);
+        name = scoreOpenName;
+        entry = scoreOpenEntry;
+    }
+    if (name.length() > 0)
+    {
+        if (!scoreOpen(name))
+            LOGE(LOG_MUSIC, "Could not open \"%s\"", name.c_str());
+    }
+    else if (setlistOpen(entry, scoreLayout))
+        scoreShow();
+    else
+        LOGE(LOG_MUSIC, "Could not open the setlist entry %d", entry);
+}
+
+#endif
@@ -0,0 +1,519 @@
+/**
+ * @file score_store.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Content-addressed store of the uploaded scores. Every score is stored once under the hash of its contents,
+ * and a manifest maps the names given by the user to those hashes.
+ * @version 0.1
+ * @date 2022-02-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef SCORE_STORE_H
+#define SCORE_STORE_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include cpp headers
+#include <atomic>
+#include <functional>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Include utils files
+#include "hash.h"
+#include "logger.h"
+#include "mutex.h"
+#include "storage.h"
+#include "storage_quota.h"
+
+/**
+ * @brief The amount of hex characters of the SHA-256 used as score id. Collisions stay out of reach for a few
+ * thousand scores. LittleFS takes longer names, but SPIFFS is kept when the migration doesn't fit (see
+ * storageMigrate), and it allows 31 characters, which the longest paths, such as "/cache/<id>.p000000", take.
+ */
+#define SCORE_ID_LENGTH 16
+
+/**
+ * @brief The file that maps score names to ids, one "<id> <name>" per line.
+ */
+#define SCORE_MANIFEST_PATH STORAGE_DIR_SCORES "/manifest"
+
+/**
+ * @brief The file with what's read from every score, such as its title, one line per id. Kept by score_index.h.
+ */
+#define SCORE_INDEX_PATH STORAGE_DIR_SCORES "/index"
+
+/**
+ * @brief The prefix of the files being uploaded. Files with this prefix are removed on boot.
+ */
+#define SCORE_TEMP_PREFIX STORAGE_DIR_SCORES "/.up"
+
+/**
+ * @brief Where the manifest is written before replacing it. Read instead of the manifest if a reboot left it missing.
+ */
+#define SCORE_MANIFEST_TEMP_PATH SCORE_TEMP_PREFIX "manifest"
+
+/**
+ * @brief The prefix of the cache files being written, moved to their path once complete. Short, since SPIFFS takes 31
+ * characters. Files with this prefix are removed on boot, and never evicted.
+ */
+#define SCORE_CACHE_TEMP_PREFIX STORAGE_DIR_CACHE "/.tmp"
+
+/**
+ * @brief The ids of the stored scores, by name. Only accessed with [scoreManifestLock] held, read through scoreId and
+ * scoreList by the other files.
+ */
+std::map<String, String> scoreManifest;
+
+/**
+ * @brief Guards [scoreManifest], and the blobs being linked or released, since the boot task, the main loop and the
+ * request handlers use them at the same time. Recursive, as linking a name releases the score it pointed to.
+ */
+RecursiveMutex scoreManifestLock;
+
+/**
+ * @brief Whether a manifest was read on boot. Without it, the scores stored can't be told from the unreferenced ones,
+ * so none is removed.
+ */
+bool scoreManifestLoaded = false;
+
+/**
+ * @brief Used for giving a different temporary file to every upload.
+ */
+unsigned int scoreUploadCounter = 0;
+
+/**
+ * @brief Used for giving a different temporary file to every cache file written, by the main loop or the handlers.
+ */
+std::atomic<unsigned int> scoreCacheCounter{0};
+
+/**
+ * @brief Checks whether [name] can be used for a score. Names can't contain directories, line breaks, or start with
+ * a dot, which is reserved for temporary files.
+ */
+bool scoreNameValid(const String &name)
+{
+    if (name.length() == 0 || name[0] == '.')
+        return false;
+    for (unsigned int i = 0; i < name.length(); i++)
+        if (name[i] == '/' || (uint8_t)name[i] < ' ')
+            return false;
+    return true;
+}
+
+/**
+ * @brief Gets the path of the contents of the score with id [id].
+ */
+String scoreBlobPath(const String &id)
+{
+    return String(STORAGE_DIR_SCORES "/") + id;
+}
+
+/**
+ * @brief Gets the path of the contents of the score called [name].
+ *
+ * @return String The path, or an empty string if there's no score called [name].
+ */
+String scorePath(const String &name)
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    auto entry = scoreManifest.find(name[0] == '/' ? name.substring(1) : name);
+    if (entry == scoreManifest.end())
+        return String();
+    return scoreBlobPath(entry->second);
+}
+
+/**
+ * @brief Gets the id of the score called [name].
+ *
+ * @return String The id, or an empty string if there's no score called [name].
+ */
+String scoreId(const String &name)
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    auto entry = scoreManifest.find(name[0] == '/' ? name.substring(1) : name);
+    return entry == scoreManifest.end() ? String() : entry->second;
+}
+
+/**
+ * @brief Gets a copy of the manifest, the ids of the stored scores by name, for going through it without holding the
+ * lock.
+ */
+std::map<String, String> scoreList()
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    return scoreManifest;
+}
+
+/**
+ * @brief Gets the path of the artifact of type [kind] derived from the score with id [id], such as a compiled score
+ * or a preview. Since the id is the hash of the contents, an existing file is always up to date.
+ *
+ * @param id The id of the score.
+ * @param kind The type of artifact, used as extension.
+ */
+String scoreCachePath(const String &id, const char *kind)
+{
+    return String(STORAGE_DIR_CACHE "/") + id + "." + kind;
+}
+
+/**
+ * @brief Opens the artifact of type [kind] derived from the score with id [id], marking it as used so it's evicted
+ * last. Cache files are written with scoreCacheWrite.
+ *
+ * @return std::unique_ptr<StorageFile> The file, or nullptr if it doesn't exist or can't be created.
+ */
+std::unique_ptr<StorageFile> scoreCacheOpen(const String &id, const char *kind, const char *mode)
+{
+    String path = scoreCachePath(id, kind);
+    std::unique_ptr<StorageFile> file = storage->open(path.c_str(), mode);
+    if (file)
+        quotaTouch(path);
+    if (mode[0] != 'r')
+        quotaInvalidate();
+    return file;
+}
+
+/**
+ * @brief Writes the artifact of type [kind] derived from the score with id [id] with [write]. It's written to a
+ * temporary file first, and only moved to its path once complete, so a failed write or a reboot never leave it cut.
+ * Before writing, the expected size must be reserved with a QuotaReservation.
+ *
+ * @param write Writes the contents into the file given, returning whether all of them were written.
+ * @return true If the artifact was stored.
+ */
+bool scoreCacheWrite(const String &id, const char *kind, std::function<bool(StorageFile &file)> write)
+{
+    String tempPath = String(SCORE_CACHE_TEMP_PREFIX) + String(scoreCacheCounter++);
+    bool written;
+    {
+        std::unique_ptr<StorageFile> file = storage->open(tempPath.c_str(), "w");
+        written = file != nullptr && write(*file);
+    }
+    String path = scoreCachePath(id, kind);
+    written = written && storage->rename(tempPath.c_str(), path.c_str());
+    if (written)
+        quotaTouch(path);
+    else
+        storage->remove(tempPath.c_str());
+    quotaInvalidate();
+    return written;
+}
+
+/**
+ * @brief Writes the manifest. It's written to a temporary file first, so a reboot never leaves it half written.
+ *
+ * @return true If the manifest was written.
+ */
+bool scoreSaveManifest()
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    {
+        std::unique_ptr<StorageFile> file = storage->open(SCORE_MANIFEST_TEMP_PATH, "w");
+        if (!file)
+            return false;
+        for (auto &entry : scoreManifest)
+        {
+            String line = entry.second + " " + entry.first + "\n";
+            if (file->write((const uint8_t *)line.c_str(), line.length()) != line.length())
+                return false;
+        }
+    }
+    return storage->rename(SCORE_MANIFEST_TEMP_PATH, SCORE_MANIFEST_PATH);
+}
+
+/**
+ * @brief Removes the contents of the score [id] and everything derived from it, if no name refers to it anymore.
+ */
+void scoreRelease(const String &id)
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    for (auto &entry : scoreManifest)
+        if (entry.second == id)
+            return;
+
+    LOGD(LOG_FS, "Removing score %s", id.c_str());
+    storage->remove(scoreBlobPath(id).c_str());
+    quotaInvalidate();
+
+    std::vector<String> derived;
+    storage->list(STORAGE_DIR_CACHE, [&](const char *name, size_t size)
+                  {
+        if (strncmp(name, id.c_str(), id.length()) == 0 && name[id.length()] == '.')
+            derived.push_back(String(STORAGE_DIR_CACHE "/") + name); });
+    for (String &path : derived)
+    {
+        storage->remove(path.c_str());
+        quotaForget(path);
+    }
+}
+
+/**
+ * @brief Points [name] to the score [id], releasing the score it pointed to before.
+ *
+ * @return true If the manifest was updated.
+ */
+bool scoreLink(const String &name, const String &id)
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    String previous = scoreManifest.count(name) ? scoreManifest[name] : String();
+    scoreManifest[name] = id;
+    quotaInvalidate();
+    if (!scoreSaveManifest())
+        return false;
+    if (previous.length() > 0 && previous != id)
+        scoreRelease(previous);
+    return true;
+}
+
+/**
+ * @brief Removes the score called [name]. The contents are only removed if no other name refers to them.
+ *
+ * @return true If the score existed.
+ */
+bool scoreRemove(const String &name)
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    auto entry = scoreManifest.find(name);
+    if (entry == scoreManifest.end())
+        return false;
+    String id = entry->second;
+    scoreManifest.erase(entry);
+    scoreSaveManifest();
+    scoreRelease(id);
+    return true;
+}
+
+/**
+ * @brief Renames the score [from] to [to], replacing [to] if it exists. Only the manifest is written.
+ *
+ * @return true If the score has been renamed.
+ */
+bool scoreRename(const String &from, const String &to)
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    auto entry = scoreManifest.find(from);
+    if (entry == scoreManifest.end() || !scoreNameValid(to))
+        return false;
+    if (from == to)
+        return true;
+    String id = entry->second;
+    scoreManifest.erase(entry);
+    return scoreLink(to, id);
+}
+
+/**
+ * @brief Moves the file at [path] into the store, with the name [name].
+ *
+ * @return true If the file has been stored.
+ */
+bool scoreImport(const String &path, const String &name)
+{
+    HashBuilder builder;
+    {
+        std::unique_ptr<StorageFile> file = storage->open(path.c_str(), "r");
+        if (!file)
+            return false;
+        uint8_t buffer[256];
+        size_t len;
+        while ((len = file->read(buffer, sizeof(buffer))) > 0)
+            builder.update(buffer, len);
+    }
+
+    String id = builder.finish().substring(0, SCORE_ID_LENGTH);
+    String blobPath = scoreBlobPath(id);
+    // Linked before the scan or another upload can release it
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    if (storage->exists(blobPath.c_str()))
+        storage->remove(path.c_str());
+    else if (!storage->rename(path.c_str(), blobPath.c_str()))
+        return false;
+    return scoreLink(name, id);
+}
+
+/**
+ * @brief An upload being stored. The contents are hashed while being written to a temporary file, which is then
+ * moved to its id, or removed if the score was already stored.
+ */
+class ScoreUpload
+{
+public:
+    /**
+     * @param reserve The bytes expected, reserved until the upload finishes so other writes don't take them meanwhile.
+     */
+    ScoreUpload(const String &name, size_t reserve = 0)
+        : name(name), tempPath(String(SCORE_TEMP_PREFIX) + String(scoreUploadCounter++)), reservation(reserve)
+    {
+        if (scoreNameValid(name) && reservation.valid())
+            file = storage->open(tempPath.c_str(), "w");
+    }
+
+    ~ScoreUpload()
+    {
+        // The client went away before finishing
+        if (file)
+        {
+            file.reset();
+            storage->remove(tempPath.c_str());
+        }
+    }
+
+    /**
+     * @brief Whether the upload can be written.
+     */
+    bool valid() { return file != nullptr; }
+
+    /**
+     * @brief Whether the bytes expected fit in the storage.
+     */
+    bool reserved() { return reservation.valid(); }
+
+    /**
+     * @brief Stores [len] bytes of [data].
+     *
+     * @return true If all the bytes of the upload have been written so far.
+     */
+    bool write(const uint8_t *data, size_t len)
+    {
+        builder.update(data, len);
+        if (file->write(data, len) != len)
+            failed = true;
+        reservation.written(len);
+        return !failed;
+    }
+
+    /**
+     * @brief Completes the upload, storing the score.
+     *
+     * @return String The id of the score, or an empty string if it could not be stored, for example because a write
+     * failed when running out of space.
+     */
+    String finish()
+    {
+        file.reset();
+        reservation.release();
+        quotaInvalidate();
+        if (failed)
+        {
+            storage->remove(tempPath.c_str());
+            return String();
+        }
+        String id = builder.finish().substring(0, SCORE_ID_LENGTH);
+        String blobPath = scoreBlobPath(id);
+        // Linked before the scan or another upload can release it
+        std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+        if (storage->exists(blobPath.c_str()))
+        {
+            LOGI(LOG_FS, "Score %s already stored, linking \"%s\" to it", id.c_str(), name.c_str());
+            storage->remove(tempPath.c_str());
+        }
+        else if (!storage->rename(tempPath.c_str(), blobPath.c_str()))
+        {
+            storage->remove(tempPath.c_str());
+            return String();
+        }
+        return scoreLink(name, id) ? id : String();
+    }
+
+private:
+    String name;
+    String tempPath;
+    QuotaReservation reservation;
+    std::unique_ptr<StorageFile> file;
+    HashBuilder builder;
+    bool failed = false;
+};
+
+/**
+ * @brief Loads the manifest. Only reads a single file, so it's done in the critical path of the boot. If a reboot
+ * happened while it was being replaced, the one written to the temporary file is taken.
+ */
+void scoreStoreBegin()
+{
+    std::lock_guard<RecursiveMutex> guard(scoreManifestLock);
+    scoreManifest.clear();
+    if (!storage->exists(SCORE_MANIFEST_PATH) && storage->exists(SCORE_MANIFEST_TEMP_PATH))
+    {
+        LOGW(LOG_FS, "Manifest missing, recovering the one being written");
+        storage->rename(SCORE_MANIFEST_TEMP_PATH, SCORE_MANIFEST_PATH);
+    }
+    std::unique_ptr<StorageFile> file = storage->open(SCORE_MANIFEST_PATH, "r");
+    scoreManifestLoaded = file != nullptr;
+    if (file)
+    {
+        StorageStreamBuf buffer(*file);
+        std::istream stream(&buffer);
+        std::string line;
+        // A line without its line break was cut by the reboot
+        while (std::getline(stream, line) && !stream.eof())
+        {
+            size_t space = line.find(' ');
+            if (space != SCORE_ID_LENGTH)
+                continue;
+            String id = String(line.substr(0, space).c_str());
+            if (storage->exists(scoreBlobPath(id).c_str()))
+                scoreManifest[String(line.substr(space + 1).c_str())] = id;
+        }
+    }
+    LOGI(LOG_FS, "%u scores stored", (unsigned)scoreManifest.size());
+}
+
+/**
+ * @brief Removes the files a reboot left half written: uploads, the manifest and the index in the scores directory,
+ * and cache files. Must be called in setup() after scoreStoreBegin, before anything writes them again.
+ */
+void scoreStoreCleanTemps()
+{
+    std::vector<String> temps;
+    storage->list(STORAGE_DIR_SCORES, [&](const char *name, size_t size)
+                  {
+        String path = String(STORAGE_DIR_SCORES "/") + name;
+        if (path.startsWith(SCORE_TEMP_PREFIX))
+            temps.push_back(path); });
+    storage->list(STORAGE_DIR_CACHE, [&](const char *name, size_t size)
+                  {
+        String path = String(STORAGE_DIR_CACHE "/") + name;
+        if (path.startsWith(SCORE_CACHE_TEMP_PREFIX))
+            temps.push_back(path); });
+    for (String &path : temps)
+        storage->remove(path.c_str());
+}
+
+/**
+ * @brief Goes through all the files in the scores directory. The ones not yet in the store, such as the ones stored
+ * by previous versions, are imported with their file name, and unreferenced scores are removed, if the manifest was
+ * read. Must be called after scoreStoreBegin. It can run while the web server stores uploads and the main loop writes
+ * the index and the cache, since every score is linked or released with the manifest locked, and the files being
+ * written are left alone.
+ */
+void scoreStoreScan()
+{
+    std::vector<String> names;
+    storage->list(STORAGE_DIR_SCORES, [&](const char *name, size_t size)
+                  { names.push_back(String(name)); });
+    for (String &name : names)
+    {
+        String path = String(STORAGE_DIR_SCORES "/") + name;
+        if (path == SCORE_MANIFEST_PATH || path == SCORE_INDEX_PATH || path.startsWith(SCORE_TEMP_PREFIX))
+            continue;
+        if (name.length() == SCORE_ID_LENGTH && strspn(name.c_str(), "0123456789abcdef") == SCORE_ID_LENGTH)
+        {
+            // Removed if a reboot happened before the manifest referenced it
+            if (scoreManifestLoaded)
+                scoreRelease(name);
+            else
+                LOGW(LOG_FS, "Keeping score %s, there's no manifest", name.c_str());
+        }
+        else if (!scoreNameValid(name))
+            storage->remove(path.c_str());
+        else if (scoreImport(path, name))
+            LOGI(LOG_FS, "Imported score \"%s\"", name.c_str());
+    }
+}
+
+#endif
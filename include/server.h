@@ -4,7 +4,7 @@
 
 // Include libraries
 #include <ESPAsyncWebServer.h>
-#include <SPIFFS.h>
+#include <map>
 
 // Include utils file
 #include "logger.h"
@@ -14,6 +14,16 @@
 #include "hash.h"
 #include "musicxml.h"
 #include "config.h"
+#include "storage.h"
+#include "score_store.h"
+#include "boot.h"
+#include "control.h"
+#include "metrics.h"
+#include "captive_dns.h"
+#include "renderer.h"
+#include "score_index.h"
+#include "setlist.h"
+#include "score_open.h"
 
 // Include webpages data
 #include "webpages.h"
@@ -22,6 +32,12 @@
 #include "consts_net.h"
 #include "consts_err.h"
 
+/**
+ * @brief Logs the client address and url of [request], followed by [result].
+ */
+#define LOG_REQUEST(request, result) \
+    LOGI(LOG_SERVER, "Client:%s %s %s", (request)->client()->remoteIP().toString().c_str(), (request)->url().c_str(), result)
+
 /**
  * @brief Send the 404 error page through [request].
  *
@@ -29,8 +45,7 @@
  */
 void notFound(AsyncWebServerRequest *request)
 {
-    String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
-    infoln(logmessage);
+    LOG_REQUEST(request, "Not found");
     request->send(404, MIME_PLAIN, "Not found");
 }
 
@@ -41,9 +56,12 @@ void notFound(AsyncWebServerRequest *request)
  *
  * @param var The data to get. Can be:
  * - FIRMWARE: Returns the Firmware version
- * - FREESPIFFS: Returns the free SPIFFS memory
- * - USEDSPIFFS: Returns the used SPIFFS memory
- * - TOTALSPIFFS: Returns the total available SPIFFS memory
+ * - FREESPIFFS: Returns the free storage memory
+ * - USEDSPIFFS: Returns the used storage memory
+ * - TOTALSPIFFS: Returns the total available storage memory
+ * - USEDSCORES, USEDCACHE, USEDLOGS: Returns the memory used by every kind of file
+ * - EVICTED: Returns the amount and size of the cache files removed for making room
+ * - REJECTEDUPLOADS: Returns the amount of uploads refused for not fitting
  * @return String
  */
 String processor(const String &var)
@@ -53,15 +71,25 @@ String processor(const String &var)
     if (var == "FIRMWARE")
         result = FIRMWARE_VERSION;
     else if (var == "FREESPIFFS")
-        result = humanReadableSize((SPIFFS.totalBytes() - SPIFFS.usedBytes()));
+        result = humanReadableSize((storage->totalBytes() - storage->usedBytes()));
     else if (var == "USEDSPIFFS")
-        result = humanReadableSize(SPIFFS.usedBytes());
+        result = humanReadableSize(storage->usedBytes());
     else if (var == "TOTALSPIFFS")
-        result = humanReadableSize(SPIFFS.totalBytes());
+        result = humanReadableSize(storage->totalBytes());
     else if (var == "USEDSPIFFS_INT")
-        result = String(SPIFFS.usedBytes());
+        result = String(storage->usedBytes());
     else if (var == "TOTALSPIFFS_INT")
-        result = String(SPIFFS.totalBytes());
+        result = String(storage->totalBytes());
+    else if (var == "USEDSCORES")
+        result = humanReadableSize(quotaCategoryBytes(STORAGE_SCORES));
+    else if (var == "USEDCACHE")
+        result = humanReadableSize(quotaCategoryBytes(STORAGE_CACHE));
+    else if (var == "USEDLOGS")
+        result = humanReadableSize(quotaCategoryBytes(STORAGE_LOGS));
+    else if (var == "EVICTED")
+        result = String(quotaStats.evictedFiles) + " (" + humanReadableSize(quotaStats.evictedBytes) + ")";
+    else if (var == "REJECTEDUPLOADS")
+        result = String(quotaStats.rejectedUploads);
     else if (var == "AUTH_SESSIONS")
     {
         unsigned int sessionsCount = preferences.getUShort(pref_sessionCount, 0U);
@@ -93,6 +121,12 @@ String configProcessor(const String &var)
     return String();
 }
 
+/**
+ * @brief The scores being uploaded, by request. Can't be stored in the request, since it frees its temp object with
+ * free().
+ */
+std::map<AsyncWebServerRequest *, std::unique_ptr<ScoreUpload>> uploads;
+
 /**
  * @brief Handles uploading to the server.
  *
@@ -107,64 +141,150 @@ void handleUpload(AsyncWebServerRequest *request, String filename, size_t index,
     // make sure authenticated before allowing upload
     if (checkUserWebAuth(request))
     {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
-        Serial.println(logmessage);
+        LOG_REQUEST(request, "Upload");
 
         if (!index)
         {
-            logmessage = "Upload Start: " + String(filename);
-            // open the file on first call and store the file handle in the request object
-            request->_tempFile = SPIFFS.open("/" + filename, "w");
-            Serial.println(logmessage);
+            LOGI(LOG_SERVER, "Upload Start: %s", filename.c_str());
+            // make room before writing anything, kept until finished. The body length includes the form encoding, so
+            // it's an upper bound. The file is opened on first call, and discarded if the client goes away before
+            // finishing
+            std::unique_ptr<ScoreUpload> created(new ScoreUpload(filename, request->contentLength()));
+            if (!created->reserved())
+            {
+                quotaStats.rejectedUploads++;
+                LOGW(LOG_SERVER, "Upload of %s refused: %u bytes don't fit", filename.c_str(), (unsigned)request->contentLength());
+                created.reset();
+            }
+            uploads[request] = std::move(created);
+            request->onDisconnect([request]()
+                                  { uploads.erase(request); });
+        }
+
+        auto upload = uploads.find(request);
+        if (upload == uploads.end() || !upload->second || !upload->second->valid())
+        {
+            if (final && upload != uploads.end() && !upload->second)
+                request->send(HTTP_INSUFFICIENT_STORAGE, MIME_PLAIN, "ERROR: not enough space for the file");
+            else if (final)
+                request->send(500, MIME_PLAIN, "ERROR: could not store the file");
+            return;
         }
 
         if (len)
         {
             // stream the incoming chunk to the opened file
-            request->_tempFile.write(data, len);
-            logmessage = "Writing file: " + String(filename) + " index=" + String(index) + " len=" + String(len);
-            Serial.println(logmessage);
+            upload->second->write(data, len);
+            LOGD(LOG_SERVER, "Writing file: %s index=%u len=%u", filename.c_str(), (unsigned)index, (unsigned)len);
         }
 
         if (final)
         {
-            logmessage = "Upload Complete: " + String(filename) + ",size: " + String(index + len);
-            // close the file handle as the upload is now done
-            request->_tempFile.close();
-            Serial.println(logmessage);
+            // store the score as the upload is now done
+            String id = upload->second->finish();
+            uploads.erase(upload);
+            if (id.length() == 0)
+            {
+                request->send(500, MIME_PLAIN, "ERROR: could not store the file");
+                return;
+            }
+            LOGI(LOG_SERVER, "Upload Complete: %s,size: %u,id: %s", filename.c_str(), (unsigned)(index + len), id.c_str());
+            setlistRefresh();
+            controlPost(CONTROL_INDEX, "Score uploaded");
             request->redirect("/");
         }
     }
     else
     {
-        Serial.println("Auth: Failed");
+        LOG_REQUEST(request, "Auth: Failed");
         return request->requestAuthentication();
     }
 }
 
+/**
+ * @brief Adds [handler] for requests to [uri], recording how long every call takes.
+ */
+void onRoute(AsyncWebServer *server, const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction handler)
+{
+    // Never freed, routes live as long as the server
+    MetricHistogram *latency = new MetricHistogram(uri);
+    server->on(uri, method, [latency, handler](AsyncWebServerRequest *request)
+               {
+        MetricTimer timer(*latency);
+        handler(request); });
+}
+
+MetricHistogram notFoundLatency("notFound");
+MetricHistogram uploadLatency("upload");
+
+/**
+ * @brief Appends all the metrics to [out], in the Prometheus text format.
+ */
+void writeMetrics(String &out)
+{
+    bootWriteMetrics(out);
+    metricsWriteHistograms(out);
+    metricsWriteSystem(out);
+    quotaWriteMetrics(out);
+    metricsWriteValue(out, "ems_nvs_writes_total", "counter", "Writes to the preferences storage.", nvsWrites.get());
+    metricsWriteValue(out, "ems_flash_writes_total", "counter", "Writes to the file system.", flashWrites.get());
+    metricsWriteValue(out, "ems_flash_written_bytes_total", "counter", "Bytes written to the file system.", flashWriteBytes.get());
+    metricsWriteValue(out, "ems_storage_unmigrated_files", "gauge", "Files migrated from SPIFFS only kept in RAM, as they could not be written.", storageUnmigrated.size());
+    metricsWriteValue(out, "ems_log_lost_bytes_total", "counter", "Log bytes that could not be written to the log file.", logFileLostBytes.load());
+    metricsWriteValue(out, "ems_log_truncated_lines_total", "counter", "Log lines truncated for not fitting in the log buffer.", logTruncatedLines.load());
+    metricsWriteValue(out, "ems_layout_pages_built_total", "counter", "Pages laid out and drawn.", layoutPagesBuilt.get());
+    metricsWriteValue(out, "ems_layout_pages_reused_total", "counter", "Pages taken from the cache when laying out.", layoutPagesReused.get());
+    metricsWriteValue(out, "ems_render_pages_drawn_total", "counter", "Pages drawn into a frame buffer.", renderPagesDrawn.get());
+    metricsWriteValue(out, "ems_render_turns_prefetched_total", "counter", "Page turns to a page drawn ahead.", renderTurnsPrefetched.get());
+    metricsWriteValue(out, "ems_render_turns_missed_total", "counter", "Page turns that waited for the page to be drawn.", renderTurnsMissed.get());
+    metricsWriteValue(out, "ems_display_partial_refreshes_total", "counter", "Refreshes of only the parts of the display changed.", damagePartialRefreshes.get());
+    metricsWriteValue(out, "ems_display_full_refreshes_total", "counter", "Refreshes of the whole display.", damageFullRefreshes.get());
+    metricsWriteValue(out, "ems_display_sent_bytes_total", "counter", "Bytes sent to the display.", damageBytesSent.get());
+    metricsWriteValue(out, "ems_pedal_presses_total", "counter", "Presses of the pedals.", pedalPresses.get());
+    metricsWriteValue(out, "ems_pedal_bounces_total", "counter", "Pedal edges ignored while the contacts settled.", pedalBounces.get());
+    metricsWriteValue(out, "ems_follow_frames_total", "counter", "Frames of audio aligned to the score.", followFrames.get());
+    metricsWriteValue(out, "ems_follow_turns_total", "counter", "Pages turned by following the score.", followTurns.get());
+    metricsWriteValue(out, "ems_sync_sent_total", "counter", "Page turn messages sent to the section.", syncSent.get());
+    metricsWriteValue(out, "ems_sync_received_total", "counter", "Page turn messages received from the section.", syncReceived.get());
+    metricsWriteValue(out, "ems_sync_applied_total", "counter", "Pages turned by the leader of the section.", syncApplied.get());
+    metricsWriteValue(out, "ems_metronome_beats_total", "counter", "Beats counted by the metronome.", metronomeBeatCount.get());
+    metricsWriteValue(out, "ems_scores_parsed_total", "counter", "Scores parsed.", scoresParsed.get());
+    metricsWriteValue(out, "ems_scores_indexed_total", "counter", "Scores added to the index.", scoreIndexAdded.get());
+    metricsWriteValue(out, "ems_setlist_laid_out_total", "counter", "Scores of the setlist laid out ahead.", setlistLaidOut.get());
+    metricsWriteValue(out, "ems_setlist_misses_total", "counter", "Scores of the setlist opened before being laid out.", setlistMisses.get());
+    metricsWriteValue(out, "ems_dns_queries_total", "counter", "Queries answered by the DNS server of the access point.", captiveDnsQueries.get());
+}
+
 /**
  * @brief Adds all the handlers for the server.
  */
-void configureWebServer(AsyncWebServer *server, boolean *shouldReboot)
+void configureWebServer(AsyncWebServer *server)
 {
     // configure web server
 
     // if url isn't found
-    server->onNotFound(notFound);
+    server->onNotFound([](AsyncWebServerRequest *request)
+                       {
+        MetricTimer timer(notFoundLatency);
+        notFound(request); });
 
     // run handleUpload function when any file is uploaded
-    server->onFileUpload(handleUpload);
+    server->onFileUpload([](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)
+                         {
+        MetricTimer timer(uploadLatency);
+        handleUpload(request, filename, index, data, len, final); });
 
     // The file for styles
-    server->on("/styles.css", HTTP_GET, [](AsyncWebServerRequest *request)
+    onRoute(server, "/styles.css", HTTP_GET, [](AsyncWebServerRequest *request)
                { request->send_P(200, "text/css", styles_css, processor); });
 
     // The file for scripts
-    server->on("/scripts.js", HTTP_GET, [](AsyncWebServerRequest *request)
+    onRoute(server, "/scripts.js", HTTP_GET, [](AsyncWebServerRequest *request)
                { request->send_P(200, "application/javascript", scripts_js, processor); });
 
     // visiting this page will cause you to be logged out
-    server->on(
+    onRoute(
+        server,
         "/logout",
         HTTP_GET,
         [](AsyncWebServerRequest *request)
@@ -175,115 +295,113 @@ void configureWebServer(AsyncWebServer *server, boolean *shouldReboot)
             request->send(response);
         });
 
-    server->on("/", HTTP_GET, [](AsyncWebServerRequest *request)
+    onRoute(server, "/", HTTP_GET, [](AsyncWebServerRequest *request)
                {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + +" " + request->url();
-
         if (checkUserWebAuth(request)) {
-            logmessage += " Auth: Success";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Success");
             request->send_P(200, MIME_HTML, index_html, processor);
         } else {
-            logmessage += " Auth: Failed";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Failed");
             request->send_P(200, MIME_HTML, login_html, processor);
         } });
 
-    server->on("/reboot", HTTP_GET, [shouldReboot](AsyncWebServerRequest *request)
+    onRoute(server, "/reboot", HTTP_GET, [](AsyncWebServerRequest *request)
                {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
-
         if (checkUserWebAuth(request)) {
             request->send(200, MIME_HTML, reboot_html);
-            logmessage += " Auth: Success";
-            infoln(logmessage);
-            *shouldReboot = true;
+            LOG_REQUEST(request, "Auth: Success");
+            controlPost(CONTROL_REBOOT, "Web Admin Initiated Reboot");
         } else {
-            logmessage += " Auth: Failed";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Failed");
             request->send_P(200, MIME_HTML, login_html, processor);
         } });
 
-    server->on("/listfiles", HTTP_GET, [](AsyncWebServerRequest *request)
+    onRoute(server, "/listfiles", HTTP_GET, [](AsyncWebServerRequest *request)
                {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
         if (checkUserWebAuth(request)) {
-            logmessage += " Auth: Success";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Success");
             request->send(200, MIME_PLAIN, listFiles(true));
         } else {
-            logmessage += " Auth: Failed";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Failed");
             request->send_P(200, MIME_HTML, login_html, processor);
         } });
 
-    server->on("/loadxml", HTTP_GET, [](AsyncWebServerRequest *request)
+    onRoute(server, "/loadxml", HTTP_GET, [](AsyncWebServerRequest *request)
                {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
         if (checkUserWebAuth(request)) {
-            logmessage += " Auth: Success";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Success");
             if (request->hasParam("path"))
             {
                 AsyncWebParameter *path = request->getParam("path");
-                loadMusic(path->value());
+                String filePath = scorePath(path->value());
+                // Opened again on the next boot
+                if (filePath.length() > 0)
+                    preferences.putString(pref_lastScore, path->value());
+                // Laid out by the main loop, it can take seconds
+                scoreOpenLater(path->value());
                 request->send(200, MIME_PLAIN, "See log");
             } else
                 request->send(500, MIME_PLAIN, "Path parameter not found.");
         } else {
-            logmessage += " Auth: Failed";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Failed");
             request->send_P(200, MIME_HTML, login_html, processor);
         } });
 
-    server->on("/file", HTTP_GET, [](AsyncWebServerRequest *request)
+    onRoute(server, "/file", HTTP_GET, [](AsyncWebServerRequest *request)
                {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
         if (checkUserWebAuth(request)) {
-            logmessage += " Auth: Success";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Success");
 
             if (request->hasParam("name") && request->hasParam("action")) {
-                const char *fileName = request->getParam("name")->value().c_str();
-                const char *fileAction = request->getParam("action")->value().c_str();
-
-                logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url() + "?name=" +
-                             String(fileName) + "&action=" + String(fileAction);
-
-                if (!SPIFFS.exists(fileName)) {
-                    infoln(logmessage + " ERROR: file does not exist");
+                String fileNameStr = request->getParam("name")->value();
+                String fileActionStr = request->getParam("action")->value();
+                String filePath = scorePath(fileNameStr);
+                const char *fileName = fileNameStr.c_str();
+                const char *fileAction = fileActionStr.c_str();
+
+                StorageStat fileStat;
+                if (filePath.length() == 0 || !storage->stat(filePath.c_str(), fileStat)) {
+                    LOGI(LOG_SERVER, "File %s ERROR: file does not exist", fileName);
                     request->send(400, MIME_PLAIN, "ERROR: file does not exist");
                 } else {
-                    info(logmessage + " file exists");
                     if (strcmp(fileAction, "download") == 0) {
-                        logmessage += " downloaded";
-                        request->send(SPIFFS, fileName, "application/octet-stream");
+                        LOGI(LOG_SERVER, "File %s downloaded", fileName);
+                        std::shared_ptr<StorageFile> file = storage->open(filePath.c_str(), "r");
+                        request->send(request->beginResponse("application/octet-stream", fileStat.size,
+                            [file](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+                            { return file ? file->read(buffer, maxLen) : 0; }));
                     } else if (strcmp(fileAction, "delete") == 0) {
-                        logmessage += " deleted";
-                        SPIFFS.remove(fileName);
-                        request->send(200, MIME_PLAIN, "Deleted File: " + String(fileName));
+                        LOGI(LOG_SERVER, "File %s deleted", fileName);
+                        scoreRemove(fileNameStr);
+                        setlistRefresh();
+                        request->send(200, MIME_PLAIN, "Deleted File: " + fileNameStr);
+                    } else if (strcmp(fileAction, "rename") == 0 && request->hasParam("to")) {
+                        // Only the manifest changes, the contents stay where they are
+                        String target = request->getParam("to")->value();
+                        if (scoreRename(fileNameStr, target)) {
+                            LOGI(LOG_SERVER, "File %s renamed to %s", fileName, target.c_str());
+                            setlistRefresh();
+                            request->send(200, MIME_PLAIN, "Renamed File: " + target);
+                        } else
+                            request->send(400, MIME_PLAIN, "ERROR: invalid name");
                     } else {
-                        logmessage += " ERROR: invalid action param supplied";
+                        LOGI(LOG_SERVER, "File %s ERROR: invalid action param supplied", fileName);
                         request->send(400, MIME_PLAIN, "ERROR: invalid action param supplied");
                     }
-                    infoln(logmessage);
                 }
             } else {
                 request->send(400, MIME_PLAIN, "ERROR: name and action params required");
             }
         } else {
-            logmessage += " Auth: Failed";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Failed");
             request->send_P(200, MIME_HTML, login_html, processor);
         } });
 
     // Process configuration updates
-    server->on("/config", HTTP_GET, [](AsyncWebServerRequest *request)
+    onRoute(server, "/config", HTTP_GET, [](AsyncWebServerRequest *request)
                {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
         if (checkUserWebAuth(request)) {
-            logmessage += " Auth: Success";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Success");
 
             bool hasKey = request->hasParam("key");
             bool hasValue = request->hasParam("value");
@@ -320,17 +438,148 @@ void configureWebServer(AsyncWebServer *server, boolean *shouldReboot)
             } else
                 request->send_P(HTTP_BAD_REQUEST, MIME_JSON, "{\"error\":\"%ERR_CONFIG_PARAMS%\"}", configProcessor);
         } else {
-            logmessage += " Auth: Failed";
-            infoln(logmessage);
+            LOG_REQUEST(request, "Auth: Failed");
             request->send_P(HTTP_OK, MIME_JSON, "{\"error\":\"%ERR_AUTH%\"}", configProcessor);
         } });
 
+    // Stream the persistent log. The since parameter is the X-Log-Cursor header of a previous response.
+    onRoute(server, "/logs", HTTP_GET, [](AsyncWebServerRequest *request)
+               {
+        if (!checkUserWebAuth(request)) {
+            LOG_REQUEST(request, "Auth: Failed");
+            request->send_P(200, MIME_HTML, login_html, processor);
+            return;
+        }
+        LOG_REQUEST(request, "Auth: Success");
+
+        uint32_t end = logFileHead.load();
+        uint32_t start = logFileTail();
+        if (request->hasParam("since"))
+            start = std::max(start, (uint32_t)strtoul(request->getParam("since")->value().c_str(), NULL, 10));
+        start = std::min(start, end);
+
+        AsyncWebServerResponse *response = request->beginChunkedResponse(LOG_FILE_MIME,
+            [start, end](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+            {
+                return logFileRead(start + index, end, buffer, maxLen);
+            });
+        response->addHeader("X-Log-Start", String(start));
+        response->addHeader("X-Log-Cursor", String(end));
+        request->send(response); });
+
+    // Turns the page of the open score, with turn=next or turn=previous. Answers the page shown and the amount of pages
+    onRoute(server, "/page", HTTP_GET, [](AsyncWebServerRequest *request)
+               {
+        if (checkUserWebAuth(request)) {
+            LOG_REQUEST(request, "Auth: Success");
+            int32_t page = renderPage.load();
+            String turn = request->hasParam("turn") ? request->getParam("turn")->value() : String();
+            if (turn == "next")
+                page = renderTurn(1);
+            else if (turn == "previous")
+                page = renderTurn(-1);
+            else if (turn.length() > 0) {
+                request->send(400, MIME_PLAIN, "turn must be next or previous.");
+                return;
+            }
+            request->send(200, MIME_PLAIN, String(page + 1) + "/" + String(renderPageCount.load()));
+        } else {
+            LOG_REQUEST(request, "Auth: Failed");
+            request->send_P(200, MIME_HTML, login_html, processor);
+        } });
+
+    // Starts the metronome from the page shown with run=start, or stops it with run=stop. Answers whether it's running
+    onRoute(server, "/metronome", HTTP_GET, [](AsyncWebServerRequest *request)
+               {
+        if (checkUserWebAuth(request)) {
+            LOG_REQUEST(request, "Auth: Success");
+            String run = request->hasParam("run") ? request->getParam("run")->value() : String();
+            if (run == "start")
+                metronomeStartPage(renderPage.load());
+            else if (run == "stop")
+                metronomeStop();
+            else if (run.length() > 0) {
+                request->send(400, MIME_PLAIN, "run must be start or stop.");
+                return;
+            }
+            request->send(200, MIME_PLAIN, metronomeRunning.load() ? "running" : "stopped");
+        } else {
+            LOG_REQUEST(request, "Auth: Failed");
+            request->send_P(200, MIME_HTML, login_html, processor);
+        } });
+
+    // Sets the setlist with set, the names of the scores one per line, and opens its entries with go=next, go=previous
+    // or go=<number>. Answers the setlist, with the state of every entry. The entry is opened by the main loop after
+    // answering, so the position answered is still the one before
+    onRoute(server, "/setlist", HTTP_GET, [](AsyncWebServerRequest *request)
+               {
+        if (checkUserWebAuth(request)) {
+            LOG_REQUEST(request, "Auth: Success");
+            if (request->hasParam("set")) {
+                String unknown;
+                if (!setlistSet(request->getParam("set")->value(), unknown)) {
+                    request->send(400, MIME_PLAIN, unknown.length() > 0 ? "No score called " + unknown : String("Could not store the setlist."));
+                    return;
+                }
+            }
+            if (request->hasParam("go")) {
+                String go = request->getParam("go")->value();
+                int32_t position = setlistPosition.load();
+                if (go == "next")
+                    position++;
+                else if (go == "previous")
+                    position--;
+                else if (isNumber(go.c_str()) && go.length() > 0)
+                    position = go.toInt() - 1;
+                else {
+                    request->send(400, MIME_PLAIN, "go must be next, previous or the number of an entry.");
+                    return;
+                }
+                if (!setlistEntryStored(*setlistEntries(), position)) {
+                    request->send(400, MIME_PLAIN, "No entry to open.");
+                    return;
+                }
+                // Opened by the main loop, since it may have to be laid out
+                scoreOpenEntryLater(position);
+            }
+            request->send(200, MIME_JSON, setlistStatus());
+        } else {
+            LOG_REQUEST(request, "Auth: Failed");
+            request->send_P(200, MIME_HTML, login_html, processor);
+        } });
+
+    // Searches the scores with q, by the words starting their name, title, composer or parts. Answers the scores
+    // found, best first
+    onRoute(server, "/search", HTTP_GET, [](AsyncWebServerRequest *request)
+               {
+        if (checkUserWebAuth(request)) {
+            LOG_REQUEST(request, "Auth: Success");
+            if (request->hasParam("q"))
+                request->send(200, MIME_JSON, scoreSearch(request->getParam("q")->value()));
+            else
+                request->send(400, MIME_PLAIN, "q parameter not found.");
+        } else {
+            LOG_REQUEST(request, "Auth: Failed");
+            request->send_P(200, MIME_HTML, login_html, processor);
+        } });
+
+    // Metrics for monitoring, in the Prometheus text format. Scrapers authenticate with the token of metrics.token
+    onRoute(server, "/metrics", HTTP_GET, [](AsyncWebServerRequest *request)
+               {
+        if (!checkMetricsAuth(request)) {
+            LOG_REQUEST(request, "Auth: Failed");
+            request->send(HTTP_UNAUTHORIZED, MIME_PLAIN, "Log in or send the metrics token.");
+            return;
+        }
+        LOG_REQUEST(request, "Auth: Success");
+        String metrics;
+        writeMetrics(metrics);
+        request->send(HTTP_OK, MIME_PROMETHEUS, metrics); });
+
     // Process a login request
-    server->on("/login", HTTP_POST, [](AsyncWebServerRequest *request)
+    onRoute(server, "/login", HTTP_POST, [](AsyncWebServerRequest *request)
                {
-        String logmessage = "Client:" + request->client()->remoteIP().toString() + " " + request->url();
         int paramsCount = request->params();
-        logmessage += " Params (" + String(paramsCount) + "){";
 
         String username = String();
         String password = String();
@@ -340,17 +589,12 @@ void configureWebServer(AsyncWebServer *server, boolean *shouldReboot)
 
             String strName = p->name();
             String strValue = p->value();
-            const char *name = strName.c_str();
-            const char *value = strValue.c_str();
 
             if (strName == "username")
                 username = strValue;
             else if (strName == "password")
                 password = strValue;
-
-            logmessage += strName + "=" + strValue + ", ";
         }
-        logmessage += "}";
 
         if (username.length() > 0 && password.length() > 0)
         {
@@ -359,7 +603,7 @@ void configureWebServer(AsyncWebServer *server, boolean *shouldReboot)
 
             if (username == correctUsername && password == correctPassword)
             {
-                logmessage += ". Auth OK.";
+                LOGI(LOG_SERVER, "Login of \"%s\". Auth OK.", username.c_str());
 
                 // Create session
                 unsigned int sessionsCount = preferences.getUShort(pref_sessionCount, 0);
@@ -384,34 +628,31 @@ void configureWebServer(AsyncWebServer *server, boolean *shouldReboot)
             }
             else
             {
-                logmessage += ". Auth NO.";
+                LOGI(LOG_SERVER, "Login of \"%s\". Auth NO.", username.c_str());
                 // TODO: Failed login should give the user a message
                 request->redirect("/");
             }
-            infoln(logmessage);
             return;
         }
-        else logmessage += ". No auth parameters.";
+        else LOG_REQUEST(request, "No auth parameters.");
 
         // TODO: Failed login should give the user a message
-        request->redirect("/");
-        infoln(logmessage); });
+        request->redirect("/"); });
 
 // Requests for debug mode
 #ifdef DEBUG_MODE
-    server->on(
+    onRoute(
+        server,
         "/clear-auth",
         HTTP_GET,
         [](AsyncWebServerRequest *request)
         {
-            debugln("Clearing auth sessions...");
-            debug("Setting session count to 0...");
+            LOGD(LOG_AUTH, "Clearing auth sessions...");
             preferences.putUShort(pref_sessionCount, 0U);
-            debugln("ok");
 
             request->redirect("/");
         });
 #endif
 }
 
-#endif
\ No newline at end of file
+#endif
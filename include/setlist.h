@@ -0,0 +1,320 @@
+/**
+ * @file setlist.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief The scores of a concert, in the order they're played. The main loop lays out every score of the setlist
+ * missing from the cache beforehand, one at a time, so only one score is in memory, and their cache files are evicted
+ * last. Moving to another piece then reads its layout from the cache, without parsing it.
+ * @version 0.1
+ * @date 2022-03-11
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef SETLIST_H
+#define SETLIST_H
+
+// Include libraries
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <set>
+#include <vector>
+
+// Include utils files
+#include "control.h"
+#include "layout.h"
+#include "logger.h"
+#include "metrics.h"
+#include "musicxml.h"
+#include "pref_consts.h"
+#include "score_store.h"
+#include "storage_quota.h"
+#include "utils.h"
+
+/**
+ * @brief The most scores in a setlist. Their names are kept in the preferences, which take strings of up to 4000
+ * bytes.
+ */
+#define SETLIST_MAX_ENTRIES 64
+
+/**
+ * @brief The heap left free for the web server and the renderer while a score is parsed, in bytes. Below it, the
+ * score is laid out [SETLIST_RETRY_MS] later, handling other events meanwhile.
+ */
+#define SETLIST_HEAP_RESERVE (96 * 1024)
+#define SETLIST_RETRY_MS 1000
+
+enum SetlistState
+{
+    SETLIST_PENDING,
+    SETLIST_READY,
+
+    /**
+     * @brief There's no score with the name of the entry.
+     */
+    SETLIST_MISSING,
+
+    /**
+     * @brief The score couldn't be parsed, or its layout doesn't fit in the cache.
+     */
+    SETLIST_FAILED
+};
+
+const char *setlistStateNames[] = {"pending", "ready", "missing", "failed"};
+
+struct SetlistEntry
+{
+    String name;
+
+    /**
+     * @brief The id of the score called [name] when the setlist was read, or empty if there was none.
+     */
+    String id;
+
+    std::atomic<uint8_t> state{SETLIST_PENDING};
+};
+
+/**
+ * @brief The entries of the setlist. Replaced as a whole when it changes, so it can be read while being laid out.
+ */
+typedef std::vector<std::unique_ptr<SetlistEntry>> SetlistEntries;
+
+std::shared_ptr<const SetlistEntries> setlist = std::make_shared<SetlistEntries>();
+portMUX_TYPE setlistLock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief The entry open, or -1.
+ */
+std::atomic<int32_t> setlistPosition{-1};
+
+/**
+ * @brief Whether the setlist, the scores or the geometry changed since the setlist was read.
+ */
+std::atomic<bool> setlistChanged{true};
+
+MetricCounter setlistLaidOut;
+
+/**
+ * @brief Entries opened that weren't in the cache, so they were parsed.
+ */
+MetricCounter setlistMisses;
+
+MetricHistogram setlistOpenLatency("setlistOpen");
+
+/**
+ * @brief Gives the entries of the setlist.
+ */
+std::shared_ptr<const SetlistEntries> setlistEntries()
+{
+    portENTER_CRITICAL(&setlistLock);
+    std::shared_ptr<const SetlistEntries> entries = setlist;
+    portEXIT_CRITICAL(&setlistLock);
+    return entries;
+}
+
+/**
+ * @brief Splits [text] into the names of the scores, one per line. Empty lines are skipped.
+ */
+std::vector<String> setlistNames(const String &text)
+{
+    std::vector<String> names;
+    int start = 0;
+    while (start <= (int)text.length())
+    {
+        int end = text.indexOf('\n', start);
+        if (end < 0)
+            end = text.length();
+        String name = text.substring(start, end);
+        if (name.length() > 0 && name[name.length() - 1] == '\r')
+            name = name.substring(0, name.length() - 1);
+        if (name.length() > 0)
+            names.push_back(name);
+        start = end + 1;
+    }
+    return names;
+}
+
+/**
+ * @brief Has the setlist read again and laid out by the main loop. Must be called after the setlist, the scores or
+ * [layoutGeometry] change.
+ */
+void setlistRefresh()
+{
+    setlistChanged = true;
+    controlPost(CONTROL_SETLIST, "Setlist changed");
+}
+
+/**
+ * @brief Replaces the setlist with the scores in [text], one name per line.
+ *
+ * @param unknown Set to the first name without a score, if any.
+ * @return true If the setlist was stored.
+ */
+bool setlistSet(const String &text, String &unknown)
+{
+    std::vector<String> names = setlistNames(text);
+    if (names.size() > SETLIST_MAX_ENTRIES)
+        return false;
+    String stored;
+    for (const String &name : names)
+    {
+        if (scoreId(name).length() == 0)
+        {
+            unknown = name;
+            return false;
+        }
+        stored += name + "\n";
+    }
+    if (stored.length() > 0 && preferences.putString(pref_setlist, stored) == 0)
+        return false;
+    if (stored.length() == 0)
+        preferences.remove(pref_setlist);
+    preferences.putInt(pref_setlistPosition, -1);
+    setlistPosition = -1;
+    LOGI(LOG_MUSIC, "Setlist of %u scores", (unsigned)names.size());
+    setlistRefresh();
+    return true;
+}
+
+/**
+ * @brief Reads the setlist from the preferences, giving every entry the score called like it now. Their cache files
+ * are pinned, and the ones of the scores that left the setlist are not anymore.
+ */
+void setlistRead()
+{
+    std::shared_ptr<SetlistEntries> entries = std::make_shared<SetlistEntries>();
+    std::set<String> pinned;
+    for (const String &name : setlistNames(preferences.getString(pref_setlist, "")))
+    {
+        std::unique_ptr<SetlistEntry> entry(new SetlistEntry());
+        entry->name = name;
+        entry->id = scoreId(name);
+        if (entry->id.length() == 0)
+            entry->state = SETLIST_MISSING;
+        else
+            pinned.insert(entry->id);
+        entries->push_back(std::move(entry));
+    }
+    quotaSetPinned(pinned);
+
+    // The previous entries are freed out of the lock, once nobody reads them
+    std::shared_ptr<const SetlistEntries> previous = entries;
+    portENTER_CRITICAL(&setlistLock);
+    std::swap(setlist, previous);
+    portEXIT_CRITICAL(&setlistLock);
+}
+
+/**
+ * @brief Lays out the first entry of the setlist that's pending, if it's not in the cache. Called by the main loop,
+ * reading the setlist again first if it changed.
+ *
+ * @return true If there are entries left, so it must be called again. False too when waiting for heap, since it's
+ * called again later then.
+ */
+bool setlistLayOutNext()
+{
+    if (setlistChanged.exchange(false))
+        setlistRead();
+    std::shared_ptr<const SetlistEntries> entries = setlistEntries();
+    auto next = std::find_if(entries->begin(), entries->end(), [](const std::unique_ptr<SetlistEntry> &entry)
+                             { return entry->state.load() == SETLIST_PENDING; });
+    if (next == entries->end())
+        return false;
+    SetlistEntry &entry = **next;
+
+    Layout layout;
+    if (layoutLoad(entry.id, layoutGeometry, layout))
+    {
+        entry.state = SETLIST_READY;
+        return true;
+    }
+    if (ESP.getFreeHeap() < SETLIST_HEAP_RESERVE)
+    {
+        LOGD(LOG_MUSIC, "Setlist waiting for heap to lay out \"%s\"", entry.name.c_str());
+        controlPostAfter(CONTROL_SETLIST, "Setlist waiting for heap", SETLIST_RETRY_MS);
+        return false;
+    }
+
+    LOGI(LOG_MUSIC, "Setlist laying out \"%s\"...", entry.name.c_str());
+    // Only this score is in memory, until it's laid out
+    bool stored;
+    {
+        mx::api::ScoreData score;
+        stored = parseScore(scoreBlobPath(entry.id), score) && layoutBuild(entry.id, score, layoutGeometry, layout);
+    }
+    entry.state = stored ? SETLIST_READY : SETLIST_FAILED;
+    setlistLaidOut.add();
+    if (!stored)
+        LOGW(LOG_MUSIC, "Setlist entry \"%s\" could not be laid out", entry.name.c_str());
+    return true;
+}
+
+/**
+ * @brief Whether [entries] has an entry [index] with a score stored, which setlistOpen can open.
+ */
+bool setlistEntryStored(const SetlistEntries &entries, int32_t index)
+{
+    return index >= 0 && index < (int32_t)entries.size() && entries[index]->id.length() > 0;
+}
+
+/**
+ * @brief Gives the layout of the entry [index] of the setlist into [out], and makes it the one open. It's read from
+ * the cache, and only parsed if it isn't there.
+ *
+ * @return true If the entry is laid out.
+ */
+bool setlistOpen(int32_t index, Layout &out)
+{
+    std::shared_ptr<const SetlistEntries> entries = setlistEntries();
+    if (!setlistEntryStored(*entries, index))
+        return false;
+    const SetlistEntry &entry = *(*entries)[index];
+
+    MetricTimer timer(setlistOpenLatency);
+    if (!layoutLoad(entry.id, layoutGeometry, out))
+    {
+        setlistMisses.add();
+        LOGW(LOG_MUSIC, "Setlist entry \"%s\" not laid out yet", entry.name.c_str());
+        if (!layoutScore(entry.name, layoutGeometry, out))
+            return false;
+    }
+    // Opened again on the next boot
+    setlistPosition = index;
+    preferences.putInt(pref_setlistPosition, index);
+    preferences.putString(pref_lastScore, entry.name);
+    return true;
+}
+
+/**
+ * @brief Gives the setlist in JSON, with the state of every entry and the one open.
+ */
+String setlistStatus()
+{
+    std::shared_ptr<const SetlistEntries> entries = setlistEntries();
+    String status = "{\"position\":" + String(setlistPosition.load()) + ",\"entries\":[";
+    for (size_t i = 0; i < entries->size(); i++)
+    {
+        const SetlistEntry &entry = *(*entries)[i];
+        if (i > 0)
+            status += ",";
+        status += "{\"name\":\"" + jsonEscape(entry.name) + "\",\"state\":\"" + setlistStateNames[entry.state.load()] + "\"}";
+    }
+    return status + "]}";
+}
+
+/**
+ * @brief Reads the entry open, and has the setlist laid out. Must be called after [controlBegin].
+ */
+void setlistBegin()
+{
+    setlistPosition = preferences.getInt(pref_setlistPosition, -1);
+    setlistRefresh();
+}
+
+#endif
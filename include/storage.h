@@ -0,0 +1,191 @@
+/**
+ * @file storage.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Storage interface used by all the code that reads or writes files, so it doesn't depend on a specific file
+ * system. See storage_fs.h for the device backends, and storage_posix.h and storage_ram.h for the host ones.
+ * @version 0.1
+ * @date 2022-02-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+// Include cpp headers
+#include <functional>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+/**
+ * @brief The directory of the scores uploaded by the user.
+ */
+#define STORAGE_DIR_SCORES "/scores"
+
+/**
+ * @brief The directory of the files derived from the scores, that can be built again if removed.
+ */
+#define STORAGE_DIR_CACHE "/cache"
+
+/**
+ * @brief The directory of the log file.
+ */
+#define STORAGE_DIR_LOGS "/logs"
+
+/**
+ * @brief The size of the buffer used by StorageStreamBuf.
+ */
+#define STORAGE_STREAM_BUFFER_SIZE 512
+
+/**
+ * @brief Information about a path, as returned by Storage::stat.
+ */
+struct StorageStat
+{
+    /**
+     * @brief Whether the path is a directory.
+     */
+    bool isDirectory;
+
+    /**
+     * @brief The size in bytes of the file. 0 for directories.
+     */
+    size_t size;
+};
+
+/**
+ * @brief An open file of a Storage. The file is closed when destroyed.
+ */
+class StorageFile
+{
+public:
+    virtual ~StorageFile() {}
+
+    /**
+     * @brief Reads up to [len] bytes into [buffer].
+     *
+     * @return size_t The amount of bytes read. 0 at the end of the file.
+     */
+    virtual size_t read(uint8_t *buffer, size_t len) = 0;
+
+    /**
+     * @brief Writes [len] bytes of [data].
+     *
+     * @return size_t The amount of bytes written.
+     */
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+
+    /**
+     * @brief Moves the cursor to [position], counted from the start of the file.
+     */
+    virtual bool seek(size_t position) = 0;
+
+    /**
+     * @brief Gets the position of the cursor.
+     */
+    virtual size_t position() = 0;
+
+    /**
+     * @brief Gets the size of the file.
+     */
+    virtual size_t size() = 0;
+};
+
+/**
+ * @brief A file system. Paths are absolute, and use '/' as separator.
+ */
+class Storage
+{
+public:
+    virtual ~Storage() {}
+
+    /**
+     * @brief Opens the file at [path].
+     *
+     * @param path The path of the file.
+     * @param mode "r" for reading, "r+" for reading and writing without truncating, "w" for creating or truncating,
+     * and "a" for appending.
+     * @return std::unique_ptr<StorageFile> The file, or nullptr if it could not be opened.
+     */
+    virtual std::unique_ptr<StorageFile> open(const char *path, const char *mode) = 0;
+
+    /**
+     * @brief Gets information about [path].
+     *
+     * @return true If [path] exists, and [out] has been filled.
+     */
+    virtual bool stat(const char *path, StorageStat &out) = 0;
+
+    /**
+     * @brief Calls [callback] with the name and size of every file inside the directory [path].
+     *
+     * @return true If [path] is a directory that could be listed.
+     */
+    virtual bool list(const char *path, std::function<void(const char *name, size_t size)> callback) = 0;
+
+    /**
+     * @brief Renames the file at [from] to [to], replacing [to] if it exists.
+     */
+    virtual bool rename(const char *from, const char *to) = 0;
+
+    /**
+     * @brief Deletes the file at [path].
+     */
+    virtual bool remove(const char *path) = 0;
+
+    /**
+     * @brief Creates the directory at [path]. Storages without directories just return true.
+     */
+    virtual bool mkdir(const char *path) = 0;
+
+    /**
+     * @brief Gets the total size of the storage, in bytes.
+     */
+    virtual size_t totalBytes() = 0;
+
+    /**
+     * @brief Gets the amount of bytes in use.
+     */
+    virtual size_t usedBytes() = 0;
+
+    /**
+     * @brief Checks whether there's something at [path].
+     */
+    bool exists(const char *path)
+    {
+        StorageStat info;
+        return stat(path, info);
+    }
+};
+
+/**
+ * @brief The storage used for all the files. Set in setup once the file system has been mounted.
+ */
+Storage *storage = nullptr;
+
+/**
+ * @brief Adapts a StorageFile for being read with std::istream.
+ */
+class StorageStreamBuf : public std::streambuf
+{
+public:
+    StorageStreamBuf(StorageFile &file) : file(file) {}
+
+protected:
+    int_type underflow() override
+    {
+        size_t len = file.read((uint8_t *)buffer, STORAGE_STREAM_BUFFER_SIZE);
+        if (len == 0)
+            return traits_type::eof();
+        setg(buffer, buffer, buffer + len);
+        return traits_type::to_int_type(buffer[0]);
+    }
+
+private:
+    StorageFile &file;
+    char buffer[STORAGE_STREAM_BUFFER_SIZE];
+};
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * @file storage_fs.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Storage backend for the Arduino file systems, SPIFFS and LittleFS.
+ * @version 0.1
+ * @date 2022-02-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef STORAGE_FS_H
+#define STORAGE_FS_H
+
+// Include libraries
+#include <Arduino.h>
+#include <FS.h>
+
+// Include cpp headers
+#include <string>
+
+// Include utils files
+#include "storage.h"
+#include "metrics.h"
+
+/**
+ * @brief The writes into the flash file systems since boot, and the bytes written by them.
+ */
+MetricCounter flashWrites;
+MetricCounter flashWriteBytes;
+
+/**
+ * @brief A StorageFile backed by an Arduino File.
+ */
+class FSStorageFile : public StorageFile
+{
+public:
+    FSStorageFile(File file) : file(file) {}
+
+    ~FSStorageFile() { file.close(); }
+
+    size_t read(uint8_t *buffer, size_t len) override { return file.read(buffer, len); }
+
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        flashWrites.add();
+        flashWriteBytes.add(len);
+        return file.write(data, len);
+    }
+
+    bool seek(size_t position) override { return file.seek(position); }
+
+    size_t position() override { return file.position(); }
+
+    size_t size() override { return file.size(); }
+
+private:
+    File file;
+};
+
+/**
+ * @brief Storage backed by an Arduino file system.
+ *
+ * @tparam FileSystem The type of the file system, fs::SPIFFSFS or fs::LittleFSFS. They don't share a base class
+ * for totalBytes and usedBytes.
+ */
+template <class FileSystem>
+class FSStorage : public Storage
+{
+public:
+    /**
+     * @param fs The file system, already mounted.
+     * @param directories Whether the file system supports directories. SPIFFS doesn't, and stores paths with slashes
+     * as plain file names.
+     * @param replaces Whether renaming replaces the target atomically, as LittleFS does. SPIFFS fails if the target
+     * exists, so it's removed first, and a reboot in between leaves neither file at the target.
+     */
+    FSStorage(FileSystem &fs, bool directories, bool replaces) : fs(fs), directories(directories), replaces(replaces) {}
+
+    std::unique_ptr<StorageFile> open(const char *path, const char *mode) override
+    {
+        File file = fs.open(path, mode);
+        if (!file || file.isDirectory())
+            return nullptr;
+        return std::unique_ptr<StorageFile>(new FSStorageFile(file));
+    }
+
+    bool stat(const char *path, StorageStat &out) override
+    {
+        if (!fs.exists(path))
+            return false;
+        File file = fs.open(path, "r");
+        if (!file)
+            return false;
+        out.isDirectory = file.isDirectory();
+        out.size = out.isDirectory ? 0 : file.size();
+        file.close();
+        return true;
+    }
+
+    bool list(const char *path, std::function<void(const char *name, size_t size)> callback) override
+    {
+        // Without directories every file is in the root, so its path is matched against [path] instead
+        File root = fs.open(directories ? path : "/", "r");
+        if (!root || !root.isDirectory())
+            return false;
+        std::string prefix = path;
+        if (prefix.back() != '/')
+            prefix += '/';
+        File file = root.openNextFile();
+        while (file)
+        {
+            const char *filePath = file.path();
+            if (!file.isDirectory() && strncmp(filePath, prefix.c_str(), prefix.size()) == 0 &&
+                strchr(filePath + prefix.size(), '/') == nullptr)
+                callback(filePath + prefix.size(), file.size());
+            file.close();
+            file = root.openNextFile();
+        }
+        root.close();
+        return true;
+    }
+
+    bool rename(const char *from, const char *to) override
+    {
+        if (!replaces && fs.exists(to))
+            fs.remove(to);
+        return fs.rename(from, to);
+    }
+
+    bool remove(const char *path) override { return fs.remove(path); }
+
+    bool mkdir(const char *path) override { return !directories || fs.exists(path) || fs.mkdir(path); }
+
+    size_t totalBytes() override { return fs.totalBytes(); }
+
+    size_t usedBytes() override { return fs.usedBytes(); }
+
+private:
+    FileSystem &fs;
+    bool directories;
+    bool replaces;
+};
+
+#endif
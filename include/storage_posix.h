@@ -0,0 +1,135 @@
+/**
+ * @file storage_posix.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Storage backend for host builds, that keeps the files in a directory of the host.
+ * @version 0.1
+ * @date 2022-02-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef STORAGE_POSIX_H
+#define STORAGE_POSIX_H
+
+// Include cpp headers
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+// Include utils files
+#include "storage.h"
+
+/**
+ * @brief A StorageFile backed by a stdio FILE.
+ */
+class PosixStorageFile : public StorageFile
+{
+public:
+    PosixStorageFile(FILE *file) : file(file) {}
+
+    ~PosixStorageFile() { fclose(file); }
+
+    size_t read(uint8_t *buffer, size_t len) override { return fread(buffer, 1, len, file); }
+
+    size_t write(const uint8_t *data, size_t len) override { return fwrite(data, 1, len, file); }
+
+    bool seek(size_t position) override { return fseek(file, position, SEEK_SET) == 0; }
+
+    size_t position() override { return ftell(file); }
+
+    size_t size() override
+    {
+        struct stat info;
+        fflush(file);
+        return fstat(fileno(file), &info) == 0 ? info.st_size : 0;
+    }
+
+private:
+    FILE *file;
+};
+
+/**
+ * @brief Storage that maps the paths inside a directory of the host.
+ */
+class PosixStorage : public Storage
+{
+public:
+    /**
+     * @param root The directory that holds the files. Created if it doesn't exist.
+     */
+    PosixStorage(const std::string &root) : root(root)
+    {
+        ::mkdir(root.c_str(), 0755);
+    }
+
+    std::unique_ptr<StorageFile> open(const char *path, const char *mode) override
+    {
+        const char *hostMode = mode[0] == 'w' ? "wb" : mode[0] == 'a' ? "ab" : mode[1] == '+' ? "r+b" : "rb";
+        FILE *file = fopen(hostPath(path).c_str(), hostMode);
+        if (!file)
+            return nullptr;
+        return std::unique_ptr<StorageFile>(new PosixStorageFile(file));
+    }
+
+    bool stat(const char *path, StorageStat &out) override
+    {
+        struct stat info;
+        if (::stat(hostPath(path).c_str(), &info) != 0)
+            return false;
+        out.isDirectory = S_ISDIR(info.st_mode);
+        out.size = out.isDirectory ? 0 : info.st_size;
+        return true;
+    }
+
+    bool list(const char *path, std::function<void(const char *name, size_t size)> callback) override
+    {
+        std::string dirPath = hostPath(path);
+        DIR *dir = opendir(dirPath.c_str());
+        if (!dir)
+            return false;
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            struct stat info;
+            std::string child = dirPath + "/" + entry->d_name;
+            if (::stat(child.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+                callback(entry->d_name, info.st_size);
+        }
+        closedir(dir);
+        return true;
+    }
+
+    bool rename(const char *from, const char *to) override { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+
+    bool remove(const char *path) override { return ::unlink(hostPath(path).c_str()) == 0; }
+
+    bool mkdir(const char *path) override
+    {
+        return ::mkdir(hostPath(path).c_str(), 0755) == 0 || exists(path);
+    }
+
+    size_t totalBytes() override
+    {
+        struct statvfs info;
+        return statvfs(root.c_str(), &info) == 0 ? info.f_blocks * info.f_frsize : 0;
+    }
+
+    size_t usedBytes() override
+    {
+        struct statvfs info;
+        return statvfs(root.c_str(), &info) == 0 ? (info.f_blocks - info.f_bavail) * info.f_frsize : 0;
+    }
+
+private:
+    std::string root;
+
+    std::string hostPath(const char *path)
+    {
+        return path[0] == '/' ? root + path : root + "/" + path;
+    }
+};
+
+#endif
@@ -0,0 +1,320 @@
+/**
+ * @file storage_quota.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Keeps track of the space used by every kind of file, and makes room for new files by evicting the derived
+ * artifacts that can be built again.
+ * @version 0.1
+ * @date 2022-02-26
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef STORAGE_QUOTA_H
+#define STORAGE_QUOTA_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <map>
+#include <set>
+
+// Include utils files
+#include "logger.h"
+#include "storage.h"
+#include "metrics.h"
+#include "mutex.h"
+
+/**
+ * @brief The bytes always kept free, for the file system metadata and for rewriting the manifest.
+ */
+#define QUOTA_RESERVE_BYTES (16 * 1024)
+
+/**
+ * @brief The kinds of files, by directory.
+ */
+enum StorageCategory
+{
+    STORAGE_SCORES,
+    STORAGE_CACHE,
+    STORAGE_LOGS,
+    STORAGE_CATEGORY_COUNT
+};
+
+const char *storageCategoryDirs[STORAGE_CATEGORY_COUNT] = {STORAGE_DIR_SCORES, STORAGE_DIR_CACHE, STORAGE_DIR_LOGS};
+
+/**
+ * @brief The bytes used by every category. Only valid while [quotaDirty] is false. Both are guarded by [quotaLock].
+ */
+size_t quotaBytes[STORAGE_CATEGORY_COUNT] = {0};
+
+/**
+ * @brief Whether the files changed since [quotaBytes] was computed.
+ */
+bool quotaDirty = true;
+
+/**
+ * @brief The decisions taken since boot, shown in the web interface.
+ */
+struct QuotaStats
+{
+    unsigned int evictedFiles;
+    size_t evictedBytes;
+    unsigned int rejectedUploads;
+} quotaStats = {0, 0, 0};
+
+/**
+ * @brief When every cache file was used last, as a counter. Files not used since boot are missing, and evicted first.
+ * Guarded by [quotaLock], like [quotaPinned].
+ */
+std::map<String, unsigned long> quotaCacheUses;
+unsigned long quotaUseCounter = 0;
+
+/**
+ * @brief The ids of the scores whose cache files are evicted only when no other can be, such as the ones of the
+ * setlist.
+ */
+std::set<String> quotaPinned;
+
+/**
+ * @brief The id of the score open, whose cache files are evicted only when no other can be either.
+ */
+String quotaOpen;
+
+/**
+ * @brief The bytes reserved by the writes that haven't finished yet. They're already counted as used.
+ */
+size_t quotaReserved = 0;
+
+/**
+ * @brief Guards the reservations, the uses and the scores pinned, and the files evicted for them, as uploads, layouts,
+ * the setlist and the index write at the same time.
+ */
+RecursiveMutex quotaLock;
+
+/**
+ * @brief Must be called after files are written or removed, so the bytes of every category are computed again.
+ */
+void quotaInvalidate()
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    quotaDirty = true;
+}
+
+/**
+ * @brief Gets the amount of bytes used by the files of [category].
+ */
+size_t quotaCategoryBytes(StorageCategory category)
+{
+    // Called from the request handlers as well as the writers
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    if (quotaDirty)
+    {
+        for (int c = 0; c < STORAGE_CATEGORY_COUNT; c++)
+        {
+            quotaBytes[c] = 0;
+            storage->list(storageCategoryDirs[c], [c](const char *name, size_t size)
+                          { quotaBytes[c] += size; });
+        }
+        quotaDirty = false;
+    }
+    return quotaBytes[category];
+}
+
+/**
+ * @brief Marks the cache file at [path] as just used.
+ */
+void quotaTouch(const String &path)
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    quotaCacheUses[path] = ++quotaUseCounter;
+}
+
+/**
+ * @brief Forgets the uses of the cache file at [path], once removed.
+ */
+void quotaForget(const String &path)
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    quotaCacheUses.erase(path);
+}
+
+/**
+ * @brief Gets the amount of bytes that can still be written, leaving QUOTA_RESERVE_BYTES free, and the bytes reserved.
+ */
+size_t quotaFreeBytes()
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    size_t total = storage->totalBytes();
+    size_t used = storage->usedBytes() + QUOTA_RESERVE_BYTES + quotaReserved;
+    return used < total ? total - used : 0;
+}
+
+/**
+ * @brief Makes [id] the score open, so its cache files are evicted last.
+ */
+void quotaSetOpen(const String &id)
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    quotaOpen = id;
+}
+
+/**
+ * @brief Makes the scores of [pinned] the ones whose cache files are evicted last, instead of the ones before. [pinned]
+ * is given the ones before.
+ */
+void quotaSetPinned(std::set<String> &pinned)
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    quotaPinned.swap(pinned);
+}
+
+/**
+ * @brief Removes the least recently used cache file, leaving the ones of [quotaPinned] and [quotaOpen] for last.
+ *
+ * @return true If a file was removed.
+ */
+bool quotaEvict()
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    String oldest;
+    unsigned long oldestUse = 0;
+    size_t oldestSize = 0;
+    bool oldestPinned = false;
+    storage->list(STORAGE_DIR_CACHE, [&](const char *name, size_t size)
+                  {
+        // Being written
+        if (name[0] == '.')
+            return;
+        String path = String(STORAGE_DIR_CACHE "/") + name;
+        auto use = quotaCacheUses.find(path);
+        unsigned long lastUse = use == quotaCacheUses.end() ? 0 : use->second;
+        // Cache files are named after the id of their score
+        const char *dot = strchr(name, '.');
+        String id = dot != NULL ? String(name).substring(0, dot - name) : String();
+        bool pinned = id.length() > 0 && (id == quotaOpen || quotaPinned.count(id) > 0);
+        if (oldest.length() == 0 || pinned < oldestPinned || (pinned == oldestPinned && lastUse < oldestUse))
+        {
+            oldest = path;
+            oldestUse = lastUse;
+            oldestSize = size;
+            oldestPinned = pinned;
+        } });
+    if (oldest.length() == 0 || !storage->remove(oldest.c_str()))
+        return false;
+
+    LOGI(LOG_FS, "Evicted %s (%u bytes)", oldest.c_str(), (unsigned)oldestSize);
+    quotaCacheUses.erase(oldest);
+    quotaStats.evictedFiles++;
+    quotaStats.evictedBytes += oldestSize;
+    quotaInvalidate();
+    return true;
+}
+
+/**
+ * @brief Reserves [bytes] for writing, evicting cache files if required. They're counted as used until quotaRelease
+ * is called, so writes at the same time don't take the same free bytes. Prefer QuotaReservation.
+ *
+ * @return true If there's enough space.
+ * @return false If the bytes don't fit even without any cache file. Nothing is evicted nor reserved then.
+ */
+bool quotaReserve(size_t bytes)
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    size_t available = quotaFreeBytes();
+    if (available < bytes)
+    {
+        if (available + quotaCategoryBytes(STORAGE_CACHE) < bytes)
+        {
+            LOGW(LOG_FS, "Refusing %u bytes, only %u can be freed", (unsigned)bytes, (unsigned)(available + quotaBytes[STORAGE_CACHE]));
+            return false;
+        }
+        while (quotaFreeBytes() < bytes)
+            if (!quotaEvict())
+                return false;
+    }
+    quotaReserved += bytes;
+    return true;
+}
+
+/**
+ * @brief Gives back [bytes] reserved by quotaReserve, once written or given up.
+ */
+void quotaRelease(size_t bytes)
+{
+    std::lock_guard<RecursiveMutex> guard(quotaLock);
+    quotaReserved -= std::min(bytes, quotaReserved);
+}
+
+/**
+ * @brief Bytes reserved while the object lives, given back as they're written.
+ */
+class QuotaReservation
+{
+public:
+    QuotaReservation(size_t bytes) : bytes(bytes), held(quotaReserve(bytes)) {}
+
+    ~QuotaReservation() { release(); }
+
+    QuotaReservation(const QuotaReservation &) = delete;
+    QuotaReservation &operator=(const QuotaReservation &) = delete;
+
+    /**
+     * @brief Whether the bytes fit, and are reserved.
+     */
+    bool valid() const { return held; }
+
+    /**
+     * @brief Gives back [len] bytes of the reservation once written, since they're counted as used by the storage now.
+     */
+    void written(size_t len)
+    {
+        if (!held)
+            return;
+        len = std::min(len, bytes);
+        quotaRelease(len);
+        bytes -= len;
+    }
+
+    /**
+     * @brief Gives back the rest of the bytes, once the write completed or failed.
+     */
+    void release()
+    {
+        if (held)
+            quotaRelease(bytes);
+        held = false;
+        bytes = 0;
+    }
+
+private:
+    size_t bytes;
+    bool held;
+};
+
+/**
+ * @brief Appends the storage usage and the decisions taken to [out], in the Prometheus text format.
+ */
+void quotaWriteMetrics(String &out)
+{
+    metricsWriteValue(out, "ems_storage_total_bytes", "gauge", "Size of the storage.", storage->totalBytes());
+    metricsWriteValue(out, "ems_storage_used_bytes", "gauge", "Bytes used in the storage, including metadata.", storage->usedBytes());
+    metricsWriteValue(out, "ems_storage_reserved_bytes", "gauge", "Bytes reserved by the writes in progress.", quotaReserved);
+
+    const char *categoryNames[STORAGE_CATEGORY_COUNT] = {"scores", "cache", "logs"};
+    char line[96];
+    metricsWriteHeader(out, "ems_storage_category_bytes", "gauge", "Bytes used by every kind of file.");
+    for (int c = 0; c < STORAGE_CATEGORY_COUNT; c++)
+    {
+        snprintf(line, sizeof(line), "ems_storage_category_bytes{category=\"%s\"} %u\n", categoryNames[c], (unsigned)quotaCategoryBytes((StorageCategory)c));
+        out += line;
+    }
+
+    metricsWriteValue(out, "ems_storage_evicted_files_total", "counter", "Cache files removed for making room.", quotaStats.evictedFiles);
+    metricsWriteValue(out, "ems_storage_evicted_bytes_total", "counter", "Bytes of the cache files removed for making room.", quotaStats.evictedBytes);
+    metricsWriteValue(out, "ems_storage_rejected_uploads_total", "counter", "Uploads refused for not fitting.", quotaStats.rejectedUploads);
+}
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ * @file storage_ram.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Storage backend that keeps the files in RAM. Used by host builds for measuring the code without the cost
+ * of a real file system.
+ * @version 0.1
+ * @date 2022-02-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef STORAGE_RAM_H
+#define STORAGE_RAM_H
+
+// Include cpp headers
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+
+// Include utils files
+#include "storage.h"
+
+/**
+ * @brief The contents of a file of a RamStorage, and the bytes still available in the storage.
+ */
+struct RamStorageData
+{
+    std::vector<uint8_t> bytes;
+    size_t *used;
+    size_t capacity;
+};
+
+/**
+ * @brief A StorageFile of a RamStorage. Keeps the contents alive even if the file is removed while open.
+ */
+class RamStorageFile : public StorageFile
+{
+public:
+    RamStorageFile(std::shared_ptr<RamStorageData> data, size_t position) : data(data), cursor(position) {}
+
+    size_t read(uint8_t *buffer, size_t len) override
+    {
+        if (cursor >= data->bytes.size())
+            return 0;
+        len = std::min(len, data->bytes.size() - cursor);
+        memcpy(buffer, data->bytes.data() + cursor, len);
+        cursor += len;
+        return len;
+    }
+
+    size_t write(const uint8_t *bytes, size_t len) override
+    {
+        size_t end = cursor + len;
+        if (end > data->bytes.size())
+        {
+            size_t available = data->capacity > *data->used ? data->capacity - *data->used : 0;
+            size_t growth = std::min(end - data->bytes.size(), available);
+            end = data->bytes.size() + growth;
+            len = end > cursor ? end - cursor : 0;
+            *data->used += growth;
+            data->bytes.resize(end);
+        }
+        memcpy(data->bytes.data() + cursor, bytes, len);
+        cursor += len;
+        return len;
+    }
+
+    bool seek(size_t position) override
+    {
+        cursor = position;
+        return true;
+    }
+
+    size_t position() override { return cursor; }
+
+    size_t size() override { return data->bytes.size(); }
+
+private:
+    std::shared_ptr<RamStorageData> data;
+    size_t cursor;
+};
+
+/**
+ * @brief Storage that keeps every file in a vector.
+ */
+class RamStorage : public Storage
+{
+public:
+    /**
+     * @param capacity The maximum amount of bytes stored, so out of space conditions can be tested.
+     */
+    RamStorage(size_t capacity) : capacity(capacity)
+    {
+        directories.insert("/");
+    }
+
+    std::unique_ptr<StorageFile> open(const char *path, const char *mode) override
+    {
+        auto file = files.find(path);
+        if (mode[0] == 'r')
+        {
+            if (file == files.end())
+                return nullptr;
+            return std::unique_ptr<StorageFile>(new RamStorageFile(file->second, 0));
+        }
+
+        if (!directories.count(parent(path)))
+            return nullptr;
+        if (file == files.end())
+        {
+            auto data = std::make_shared<RamStorageData>();
+            data->used = &used;
+            data->capacity = capacity;
+            file = files.emplace(path, data).first;
+        }
+        else if (mode[0] == 'w')
+        {
+            used -= file->second->bytes.size();
+            file->second->bytes.clear();
+        }
+        size_t position = mode[0] == 'a' ? file->second->bytes.size() : 0;
+        return std::unique_ptr<StorageFile>(new RamStorageFile(file->second, position));
+    }
+
+    bool stat(const char *path, StorageStat &out) override
+    {
+        auto file = files.find(path);
+        out.isDirectory = file == files.end();
+        if (out.isDirectory && !directories.count(path))
+            return false;
+        out.size = out.isDirectory ? 0 : file->second->bytes.size();
+        return true;
+    }
+
+    bool list(const char *path, std::function<void(const char *name, size_t size)> callback) override
+    {
+        if (!directories.count(path))
+            return false;
+        for (auto &file : files)
+            if (parent(file.first) == path)
+                callback(file.first.c_str() + file.first.find_last_of('/') + 1, file.second->bytes.size());
+        return true;
+    }
+
+    bool rename(const char *from, const char *to) override
+    {
+        auto file = files.find(from);
+        if (file == files.end() || !directories.count(parent(to)))
+            return false;
+        std::shared_ptr<RamStorageData> data = file->second;
+        files.erase(file);
+        remove(to);
+        files[to] = data;
+        return true;
+    }
+
+    bool remove(const char *path) override
+    {
+        auto file = files.find(path);
+        if (file == files.end())
+            return false;
+        used -= file->second->bytes.size();
+        // Files still open keep their contents, but can't grow anymore
+        file->second->capacity = 0;
+        files.erase(file);
+        return true;
+    }
+
+    bool mkdir(const char *path) override
+    {
+        if (!directories.count(parent(path)))
+            return false;
+        directories.insert(path);
+        return true;
+    }
+
+    size_t totalBytes() override { return capacity; }
+
+    size_t usedBytes() override { return used; }
+
+private:
+    std::map<std::string, std::shared_ptr<RamStorageData>> files;
+    std::set<std::string> directories;
+    size_t capacity;
+    size_t used = 0;
+
+    static std::string parent(const std::string &path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+    }
+};
+
+#endif
@@ -0,0 +1,465 @@
+/**
+ * @file sync.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Turns the pages of every stand of a section with the stand of its leader. The leader sends every page turn to
+ * a UDP multicast group, with the score, the measure at the top of the page and a sequence number, and the followers
+ * show the page with that measure of their own layout. Messages that arrive late are dropped by their sequence number.
+ * Stands joining late ask the group, and any stand that knows the state answers.
+ * @version 0.1
+ * @date 2022-03-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef SYNC_H
+#define SYNC_H
+
+// Include libraries
+#include <Arduino.h>
+#include <lwip/sockets.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// Include utils files
+#include "layout.h"
+#include "logger.h"
+#include "metrics.h"
+#include "mutex.h"
+#include "pref_consts.h"
+#include "renderer.h"
+#include "score_store.h"
+
+/**
+ * @brief The multicast group of the stands, in the scope of the organization, and its port.
+ */
+#define SYNC_GROUP IPAddress(239, 255, 77, 83)
+#define SYNC_PORT 4747
+
+#define SYNC_MAGIC 0x59534d45 // "EMSY"
+#define SYNC_VERSION 1
+
+#define SYNC_TYPE_STATE 1
+#define SYNC_TYPE_QUERY 2
+
+/**
+ * @brief How often the leader sends the state again, in milliseconds, in case a message was lost. Followers that
+ * don't know the state ask for it as often.
+ */
+#define SYNC_HEARTBEAT_MS 1000
+
+#define SYNC_TASK_STACK_SIZE 3072
+
+/**
+ * @brief Above the renderer, the turns received are queued for it right away.
+ */
+#define SYNC_TASK_PRIORITY (tskIDLE_PRIORITY + 4)
+
+enum SyncRole : uint8_t
+{
+    SYNC_OFF = 0,
+    SYNC_LEADER = 1,
+    SYNC_FOLLOWER = 2,
+};
+
+/**
+ * @brief A message between the stands, sent as it is: every stand is little endian.
+ */
+struct SyncMessage
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint16_t reserved;
+
+    /**
+     * @brief The stand that sent the message, and the leader the state comes from. Picked at random on boot.
+     */
+    uint32_t sender;
+    uint32_t leader;
+
+    /**
+     * @brief Increased by the leader with every turn.
+     */
+    uint32_t sequence;
+
+    /**
+     * @brief The id of the score, the hash of its contents.
+     */
+    char score[SCORE_ID_LENGTH];
+
+    /**
+     * @brief The page shown by the leader, and the first measure in it.
+     */
+    int32_t page;
+    uint32_t measure;
+};
+
+static_assert(sizeof(SyncMessage) == 44, "SyncMessage is sent as it is");
+
+MetricCounter syncSent;
+MetricCounter syncReceived;
+MetricCounter syncApplied;
+
+/**
+ * @brief A stand of the section. Receives the messages of the group in its own task, blocked on the socket until one
+ * arrives.
+ */
+class SyncNode
+{
+public:
+    /**
+     * @brief Shows [page] of the score opened. Called from the task of the node.
+     */
+    std::function<void(int32_t page)> turn;
+
+    /**
+     * @brief Joins the group at [port] through the interface with [address], starting to receive its messages the
+     * first time. Called again when the interface got an address, the group is left and joined again through it.
+     *
+     * @return true If the group was joined.
+     */
+    bool begin(uint32_t address, uint16_t port = SYNC_PORT)
+    {
+        std::lock_guard<RecursiveMutex> guard(joinLock);
+        if (sock < 0 && !openSocket(port))
+            return false;
+
+        if (joined)
+            setsockopt(sock, IPPROTO_IP, IP_DROP_MEMBERSHIP, &membership, sizeof(membership));
+        joined = false;
+        membership.imr_multiaddr.s_addr = (uint32_t)SYNC_GROUP;
+        membership.imr_interface.s_addr = address;
+        struct in_addr interface;
+        interface.s_addr = address;
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0 ||
+            setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) != 0)
+        {
+            LOGE(LOG_MAIN, "Could not join the sync group");
+            return false;
+        }
+        joined = true;
+        query();
+        return true;
+    }
+
+    /**
+     * @brief Takes [role] in the section. A leader starts its own state from the next turn.
+     */
+    void setRole(SyncRole role)
+    {
+        if (this->role.exchange(role) != role && role == SYNC_FOLLOWER)
+            query();
+    }
+
+    SyncRole getRole() const { return role.load(); }
+
+    /**
+     * @brief Follows [layout] from now on, turning to the page of the leader if it shows the same score.
+     */
+    void open(const Layout &layout)
+    {
+        std::vector<uint32_t> measures;
+        for (const TimelinePage &page : layout.timeline.pages)
+            measures.push_back(page.measure);
+
+        portENTER_CRITICAL(&lock);
+        memset(score, 0, sizeof(score));
+        memcpy(score, layout.id.c_str(), std::min((size_t)layout.id.length(), sizeof(score)));
+        pageMeasures.swap(measures);
+        int32_t page = known ? localPage(state) : -1;
+        portEXIT_CRITICAL(&lock);
+
+        if (role.load() != SYNC_FOLLOWER)
+            return;
+        if (page >= 0)
+            apply(page);
+        else
+            query();
+    }
+
+    /**
+     * @brief Sends that the leader shows [page] of the score [id], starting at [measure]. Only sent by leaders.
+     */
+    void publish(const String &id, int32_t page, uint32_t measure)
+    {
+        if (role.load() != SYNC_LEADER || sock < 0)
+            return;
+        portENTER_CRITICAL(&lock);
+        state.sequence = known && state.leader == this->id ? state.sequence + 1 : 1;
+        state.leader = this->id;
+        memset(state.score, 0, sizeof(state.score));
+        memcpy(state.score, id.c_str(), std::min((size_t)id.length(), sizeof(state.score)));
+        state.page = page;
+        state.measure = measure;
+        known = true;
+        SyncMessage message = state;
+        portEXIT_CRITICAL(&lock);
+        send(message);
+    }
+
+    /**
+     * @brief Gives the state known, which is false if none is.
+     */
+    bool current(SyncMessage &out)
+    {
+        portENTER_CRITICAL(&lock);
+        out = state;
+        bool result = known;
+        portEXIT_CRITICAL(&lock);
+        return result;
+    }
+
+private:
+    /**
+     * @brief Creates the socket bound to [port], and the task receiving from it.
+     */
+    bool openSocket(uint16_t port)
+    {
+        id = esp_random();
+        sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock < 0)
+        {
+            LOGE(LOG_MAIN, "Could not create the sync socket");
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        // Only within the network, and back to the stands on this host
+        uint8_t ttl = 1, loop = 1;
+        struct timeval timeout = {SYNC_HEARTBEAT_MS / 1000, (SYNC_HEARTBEAT_MS % 1000) * 1000};
+        if (bind(sock, (struct sockaddr *)&local, sizeof(local)) != 0 ||
+            setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+            setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0 ||
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0)
+        {
+            LOGE(LOG_MAIN, "Could not bind the sync socket to port %u", port);
+            close(sock);
+            sock = -1;
+            return false;
+        }
+
+        memset(&group, 0, sizeof(group));
+        group.sin_family = AF_INET;
+        group.sin_port = htons(port);
+        group.sin_addr.s_addr = (uint32_t)SYNC_GROUP;
+        xTaskCreate(task, "sync", SYNC_TASK_STACK_SIZE, this, SYNC_TASK_PRIORITY, NULL);
+        return true;
+    }
+
+    static void task(void *parameter)
+    {
+        ((SyncNode *)parameter)->run();
+    }
+
+    /**
+     * @brief Handles the messages received, and sends the state again every SYNC_HEARTBEAT_MS, forever.
+     */
+    void run()
+    {
+        for (;;)
+        {
+            SyncMessage message;
+            int len = recv(sock, &message, sizeof(message), 0);
+            if (len == sizeof(message) && message.magic == SYNC_MAGIC && message.version == SYNC_VERSION && message.sender != id)
+            {
+                syncReceived.add();
+                receive(message);
+            }
+
+            if (millis() - lastSent < SYNC_HEARTBEAT_MS)
+                continue;
+            SyncRole now = role.load();
+            if (now == SYNC_LEADER && current(message))
+                send(message);
+            else if (now == SYNC_FOLLOWER && !current(message))
+                query();
+        }
+    }
+
+    /**
+     * @brief Applies the state in [message], if it's newer than the one known, or answers with the state known if
+     * [message] asks for it.
+     */
+    void receive(const SyncMessage &message)
+    {
+        SyncRole now = role.load();
+        if (now == SYNC_OFF)
+            return;
+        if (message.type == SYNC_TYPE_QUERY)
+        {
+            SyncMessage answer;
+            if (current(answer))
+                send(answer);
+            return;
+        }
+        if (message.type != SYNC_TYPE_STATE || now != SYNC_FOLLOWER)
+            return;
+
+        portENTER_CRITICAL(&lock);
+        // A leader taking over, or the same one booted again, starts its own sequence
+        bool newer = !known || message.leader != state.leader || message.sequence > state.sequence;
+        int32_t page = -1;
+        if (newer)
+        {
+            state = message;
+            known = true;
+            page = localPage(state);
+        }
+        portEXIT_CRITICAL(&lock);
+        if (page >= 0)
+            apply(page);
+    }
+
+    /**
+     * @brief Gives the page of the score opened with the measure of [message], or -1 if it's another score. Must be
+     * called holding [lock].
+     */
+    int32_t localPage(const SyncMessage &message)
+    {
+        if (memcmp(message.score, score, sizeof(score)) != 0)
+            return -1;
+        // Without a timeline, as laid out for the leader
+        if (pageMeasures.empty())
+            return message.page;
+        int32_t page = 0;
+        while (page + 1 < (int32_t)pageMeasures.size() && pageMeasures[page + 1] <= message.measure)
+            page++;
+        return page;
+    }
+
+    void apply(int32_t page)
+    {
+        syncApplied.add();
+        if (turn)
+            turn(page);
+    }
+
+    /**
+     * @brief Asks the group for the state.
+     */
+    void query()
+    {
+        SyncMessage message;
+        memset(&message, 0, sizeof(message));
+        send(message, SYNC_TYPE_QUERY);
+    }
+
+    void send(SyncMessage message, uint8_t type = SYNC_TYPE_STATE)
+    {
+        if (sock < 0)
+            return;
+        message.magic = SYNC_MAGIC;
+        message.version = SYNC_VERSION;
+        message.type = type;
+        message.sender = id;
+        lastSent = millis();
+        if (sendto(sock, &message, sizeof(message), 0, (struct sockaddr *)&group, sizeof(group)) == sizeof(message))
+            syncSent.add();
+    }
+
+    int sock = -1;
+    uint32_t id = 0;
+
+    /**
+     * @brief Guards the socket and the membership, changed by the WiFi task and by the configuration.
+     */
+    RecursiveMutex joinLock;
+    struct ip_mreq membership = {};
+    bool joined = false;
+
+    std::atomic<SyncRole> role{SYNC_OFF};
+    struct sockaddr_in group;
+    std::atomic<unsigned long> lastSent{0};
+
+    /**
+     * @brief Guards the state and the score opened, changed by the task of the node and by the task opening or turning.
+     */
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    SyncMessage state = {};
+    bool known = false;
+    char score[SCORE_ID_LENGTH] = {};
+
+    /**
+     * @brief The first measure of every page of the score opened.
+     */
+    std::vector<uint32_t> pageMeasures;
+};
+
+/**
+ * @brief The stand of this device.
+ */
+SyncNode syncNode;
+
+/**
+ * @brief Sends every page shown to the section, if leading it. Called by the renderer.
+ */
+void syncTurned(const Layout &layout, int32_t page)
+{
+    uint32_t measure = page < (int32_t)layout.timeline.pages.size() ? layout.timeline.pages[page].measure : 0;
+    syncNode.publish(layout.id, page, measure);
+}
+
+/**
+ * @brief Follows [layout] with the section. Must be called after it's opened by the renderer, so the page of the
+ * leader is turned to after the first one is shown.
+ */
+void syncOpen(const Layout &layout)
+{
+    syncNode.open(layout);
+}
+
+/**
+ * @brief The address the network is up with, 0 until it is.
+ */
+std::atomic<uint32_t> syncAddress{0};
+
+/**
+ * @brief Takes the role in the section set in the preferences, joining the group the first time it's not off once the
+ * network is up. Called again after the role changed.
+ */
+void syncReconfigure()
+{
+    SyncRole role = (SyncRole)preferences.getUChar(pref_syncRole, SYNC_OFF);
+    syncNode.setRole(role);
+    uint32_t address = syncAddress.load();
+    if (role == SYNC_OFF || address == 0)
+        return;
+    if (syncNode.begin(address))
+        LOGI(LOG_MAIN, "Sync as %s of the section", role == SYNC_LEADER ? "leader" : "follower");
+}
+
+/**
+ * @brief Joins the group through the interface that got [address]. Called by the WiFi task every time it connects,
+ * so the group is joined again after the connection was lost.
+ */
+void syncOnline(uint32_t address)
+{
+    syncAddress.store(address);
+    syncReconfigure();
+}
+
+/**
+ * @brief Turns the pages of the renderer for the section, and sends the ones it shows. Must be called before the
+ * renderer starts, the group is joined by [syncOnline].
+ */
+void syncBegin()
+{
+    syncNode.turn = renderGoTo;
+    renderTurned = syncTurned;
+    syncReconfigure();
+}
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * @file timeline.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief The notes of a score in the order they're played, with the page every one is shown on and the changes of
+ * tempo and time signature, compiled with the layout and cached next to its pages. It's what the score follower aligns
+ * the audio against, and what the metronome counts.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+// Include libraries
+#include <Arduino.h>
+
+// Include cpp headers
+#include <algorithm>
+#include <vector>
+
+// Include utils files
+#include "score_store.h"
+#include "storage_quota.h"
+
+/**
+ * @brief The resolution of the timeline, in ticks per quarter. Divisible by 8 for 32nds, and by 3 for triplets.
+ */
+#define TIMELINE_TICKS_PER_QUARTER 24
+
+/**
+ * @brief The tempo until the score sets one, in microseconds per quarter: 120 quarters per minute.
+ */
+#define TIMELINE_DEFAULT_QUARTER_US 500000
+
+#define TIMELINE_MAGIC 0x334c4d45 // "EML3"
+
+/**
+ * @brief A note of the score, as sounding, not transposed.
+ */
+struct TimelineNote
+{
+    uint32_t tick;
+    uint16_t duration;
+
+    /**
+     * @brief The MIDI note number.
+     */
+    uint8_t pitch;
+    uint8_t reserved;
+};
+
+struct TimelinePage
+{
+    /**
+     * @brief Where the page starts and ends, in ticks.
+     */
+    uint32_t start;
+    uint32_t end;
+
+    /**
+     * @brief The length of a beat at the end of the page, in ticks.
+     */
+    uint32_t beat;
+
+    /**
+     * @brief The index of the first measure of the page, the same whatever the geometry.
+     */
+    uint32_t measure;
+};
+
+/**
+ * @brief A change of tempo, from [tick] on.
+ */
+struct TimelineTempo
+{
+    uint32_t tick;
+    uint32_t quarterMicros;
+};
+
+/**
+ * @brief A change of time signature, at the start of a measure.
+ */
+struct TimelineMeter
+{
+    uint32_t tick;
+    uint8_t beats;
+    uint8_t beatType;
+    uint16_t reserved;
+};
+
+struct Timeline
+{
+    /**
+     * @brief Sorted by [TimelineNote::tick].
+     */
+    std::vector<TimelineNote> notes;
+    std::vector<TimelinePage> pages;
+
+    /**
+     * @brief Sorted by tick, the first ones at tick 0.
+     */
+    std::vector<TimelineTempo> tempos;
+    std::vector<TimelineMeter> meters;
+};
+
+/**
+ * @brief Gives the page of [pages] with [tick], or the one after it if [tick] is [beats] beats from its end.
+ */
+int32_t timelinePage(const std::vector<TimelinePage> &pages, uint32_t tick, uint8_t beats)
+{
+    for (size_t i = 0; i < pages.size(); i++)
+        if (tick < pages[i].end)
+            return tick + beats * pages[i].beat >= pages[i].end && i + 1 < pages.size() ? i + 1 : i;
+    return pages.empty() ? 0 : pages.size() - 1;
+}
+
+/**
+ * @brief Gives when [tick] is played, in microseconds from the start, following the tempos of [timeline].
+ */
+uint64_t timelineMicros(const Timeline &timeline, uint32_t tick)
+{
+    uint64_t micros = 0;
+    for (size_t i = 0; i < timeline.tempos.size() && timeline.tempos[i].tick < tick; i++)
+    {
+        uint32_t end = i + 1 < timeline.tempos.size() ? std::min(timeline.tempos[i + 1].tick, tick) : tick;
+        micros += (uint64_t)(end - timeline.tempos[i].tick) * timeline.tempos[i].quarterMicros / TIMELINE_TICKS_PER_QUARTER;
+    }
+    return micros;
+}
+
+/**
+ * @brief Writes [timeline] of the score [id] to the cache, keyed by the geometry it was laid out for.
+ *
+ * @return true If the timeline was stored.
+ */
+bool timelineWrite(const String &id, uint32_t geometryKey, const Timeline &timeline, const String &kind)
+{
+    uint32_t header[6] = {TIMELINE_MAGIC, geometryKey, (uint32_t)timeline.pages.size(), (uint32_t)timeline.notes.size(),
+                          (uint32_t)timeline.tempos.size(), (uint32_t)timeline.meters.size()};
+    size_t pagesSize = timeline.pages.size() * sizeof(TimelinePage);
+    size_t notesSize = timeline.notes.size() * sizeof(TimelineNote);
+    size_t temposSize = timeline.tempos.size() * sizeof(TimelineTempo);
+    size_t metersSize = timeline.meters.size() * sizeof(TimelineMeter);
+    QuotaReservation reservation(sizeof(header) + pagesSize + notesSize + temposSize + metersSize);
+    if (!reservation.valid())
+        return false;
+    return scoreCacheWrite(id, kind.c_str(), [&](StorageFile &file)
+                           { return file.write((const uint8_t *)header, sizeof(header)) == sizeof(header) &&
+                                    file.write((const uint8_t *)timeline.pages.data(), pagesSize) == pagesSize &&
+                                    file.write((const uint8_t *)timeline.notes.data(), notesSize) == notesSize &&
+                                    file.write((const uint8_t *)timeline.tempos.data(), temposSize) == temposSize &&
+                                    file.write((const uint8_t *)timeline.meters.data(), metersSize) == metersSize; });
+}
+
+/**
+ * @brief Reads the timeline of the score [id] from the cache into [out].
+ *
+ * @return true If the timeline is in the cache.
+ */
+bool timelineLoad(const String &id, uint32_t geometryKey, Timeline &out, const String &kind)
+{
+    std::unique_ptr<StorageFile> file = scoreCacheOpen(id, kind.c_str(), "r");
+    if (!file)
+        return false;
+    uint32_t header[6];
+    if (file->read((uint8_t *)header, sizeof(header)) != sizeof(header) || header[0] != TIMELINE_MAGIC || header[1] != geometryKey)
+        return false;
+    // A damaged file could ask for more than the heap has
+    if ((uint64_t)header[2] * sizeof(TimelinePage) + (uint64_t)header[3] * sizeof(TimelineNote) +
+            (uint64_t)header[4] * sizeof(TimelineTempo) + (uint64_t)header[5] * sizeof(TimelineMeter) !=
+        file->size() - sizeof(header))
+    {
+        LOGW(LOG_MUSIC, "Timeline of %s damaged in the cache", id.c_str());
+        return false;
+    }
+    out.pages.resize(header[2]);
+    out.notes.resize(header[3]);
+    out.tempos.resize(header[4]);
+    out.meters.resize(header[5]);
+    size_t pagesSize = out.pages.size() * sizeof(TimelinePage);
+    size_t notesSize = out.notes.size() * sizeof(TimelineNote);
+    size_t temposSize = out.tempos.size() * sizeof(TimelineTempo);
+    size_t metersSize = out.meters.size() * sizeof(TimelineMeter);
+    return file->read((uint8_t *)out.pages.data(), pagesSize) == pagesSize &&
+           file->read((uint8_t *)out.notes.data(), notesSize) == notesSize &&
+           file->read((uint8_t *)out.tempos.data(), temposSize) == temposSize &&
+           file->read((uint8_t *)out.meters.data(), metersSize) == metersSize;
+}
+
+#endif
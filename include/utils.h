@@ -29,4 +29,27 @@ String humanReadableSize(const size_t bytes)
     return String(bytes / 1024.0 / 1024.0 / 1024.0) + " GB";
 }
 
+/**
+ * @brief Escapes [text] for putting it between quotes in JSON.
+ */
+String jsonEscape(const String &text)
+{
+  String escaped;
+  for (unsigned int i = 0; i < text.length(); i++)
+  {
+    char c = text[i];
+    if (c == '"' || c == '\\')
+      escaped += String("\\") + c;
+    else if ((uint8_t)c < ' ')
+    {
+      char code[7];
+      snprintf(code, sizeof(code), "\\u%04x", (uint8_t)c);
+      escaped += code;
+    }
+    else
+      escaped += c;
+  }
+  return escaped;
+}
+
 #endif
\ No newline at end of file
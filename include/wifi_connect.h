@@ -0,0 +1,387 @@
+/**
+ * @file wifi_connect.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Event-driven WiFi connection. Reconnects to the last access point without scanning, falls back to a full
+ * scan, and then to an access point with a captive DNS server. Never blocks the caller.
+ * @version 0.1
+ * @date 2022-02-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef WIFI_CONNECT_H
+#define WIFI_CONNECT_H
+
+// Include libraries
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+
+// Include cpp headers
+#include <atomic>
+#include <time.h>
+
+// Include utils files
+#include "logger.h"
+#include "boot.h"
+#include "pref_consts.h"
+#include "consts_net.h"
+#include "captive_dns.h"
+
+/**
+ * @brief The time given to the connection with the cached access point before scanning, in milliseconds.
+ */
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 4000
+
+/**
+ * @brief How long before its expiry a cached lease is no longer reused, in seconds.
+ */
+#define WIFI_LEASE_MARGIN_S 60
+
+/**
+ * @brief How often the clock is checked, while it's not set, for storing when the lease expires, in milliseconds.
+ */
+#define WIFI_LEASE_CHECK_MS 10000
+
+/**
+ * @brief Times before this one, in seconds since the epoch, mean that the clock wasn't set by NTP yet.
+ */
+#define WIFI_CLOCK_VALID_AFTER 1600000000
+
+/**
+ * @brief The name of the access point created when no network could be joined.
+ */
+#define WIFI_AP_SSID "ESP32-DNSServer"
+
+#define WIFI_TASK_STACK_SIZE 4096
+
+/**
+ * @brief The amount of events that can wait to be handled.
+ */
+#define WIFI_EVENT_QUEUE_LENGTH 8
+
+/**
+ * @brief The steps of the connection.
+ */
+enum WifiState
+{
+    WIFI_STATE_IDLE,
+    // Joining the cached access point, with the cached lease while it lasts
+    WIFI_STATE_FAST,
+    // Joining any access point with the SSID, after a scan
+    WIFI_STATE_SCAN,
+    WIFI_STATE_CONNECTED,
+    // Serving the captive portal
+    WIFI_STATE_AP
+};
+
+/**
+ * @brief What's kept in NVS about the last successful connection.
+ */
+struct WifiCache
+{
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+
+    /**
+     * @brief When the lease of [ip] expires, in seconds since the epoch, or 0 if unknown.
+     */
+    uint32_t leaseExpiry;
+};
+
+std::atomic<uint8_t> wifiState{WIFI_STATE_IDLE};
+
+/**
+ * @brief The events of the WiFi driver, handled by [wifiTask].
+ */
+QueueHandle_t wifiEvents;
+
+String wifiSsid;
+String wifiPassword;
+
+/**
+ * @brief When the connection started, in milliseconds and microseconds, and until when the current state can last.
+ */
+unsigned long wifiStartMillis;
+unsigned long wifiStartMicros;
+unsigned long wifiDeadline;
+
+/**
+ * @brief The maximum time given to joining a network, before creating the access point.
+ */
+unsigned long wifiTimeout;
+
+/**
+ * @brief The lease given by DHCP in the current connection: how long it lasts in seconds, and when it was given, in
+ * milliseconds. [wifiLeaseSeconds] is 0 if the address is the cached one, or the lease is already stored.
+ */
+uint32_t wifiLeaseSeconds;
+unsigned long wifiLeaseMillis;
+
+/**
+ * @brief When the cached lease expires, in seconds since the epoch, if it's being reused.
+ */
+uint32_t wifiLeaseExpiry;
+
+IPAddress apIP(8, 8, 4, 4); // The default android DNS
+
+/**
+ * @brief Called from [wifiTask] with the address of the station every time it connects, and of the access point once
+ * it's created.
+ */
+void (*wifiOnline)(uint32_t address) = NULL;
+
+/**
+ * @brief Reads the cached connection for [ssid] into [cache].
+ *
+ * @return true If there's a cached connection for [ssid].
+ */
+bool wifiLoadCache(WifiCache &cache, const String &ssid)
+{
+    if (preferences.getBytes(pref_wifiCache, &cache, sizeof(cache)) != sizeof(cache))
+        return false;
+    cache.ssid[sizeof(cache.ssid) - 1] = '\0';
+    return ssid == cache.ssid && cache.channel != 0;
+}
+
+/**
+ * @brief Gives the current time in seconds since the epoch, or 0 if the clock isn't set yet.
+ */
+uint32_t wifiClock()
+{
+    time_t now = time(NULL);
+    return now > WIFI_CLOCK_VALID_AFTER ? (uint32_t)now : 0;
+}
+
+/**
+ * @brief Gives how long the DHCP lease of the station lasts, in seconds, or 0 if it has none.
+ */
+uint32_t wifiDhcpLease()
+{
+    struct netif *netif = (struct netif *)esp_netif_get_netif_impl(esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"));
+    struct dhcp *dhcp = netif != NULL ? netif_dhcp_data(netif) : NULL;
+    return dhcp != NULL && dhcp->state == DHCP_STATE_BOUND ? dhcp->offered_t0_lease : 0;
+}
+
+/**
+ * @brief Stores the current connection, if it changed, so the next boot can skip the scan, and DHCP while the lease
+ * lasts. The expiry of a new lease is only stored once the clock is set, until then it's unknown.
+ */
+void wifiSaveCache()
+{
+    WifiCache cache;
+    memset(&cache, 0, sizeof(cache));
+    strncpy(cache.ssid, wifiSsid.c_str(), sizeof(cache.ssid) - 1);
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+    cache.ip = WiFi.localIP();
+    cache.gateway = WiFi.gatewayIP();
+    cache.subnet = WiFi.subnetMask();
+    cache.dns = WiFi.dnsIP(0);
+    uint32_t now = wifiClock();
+    if (wifiLeaseSeconds == 0)
+        cache.leaseExpiry = wifiLeaseExpiry;
+    else if (now != 0)
+    {
+        cache.leaseExpiry = now - (millis() - wifiLeaseMillis) / 1000 + wifiLeaseSeconds;
+        wifiLeaseSeconds = 0;
+    }
+
+    // Only written when it changed, for sparing the flash
+    WifiCache stored;
+    if (preferences.getBytes(pref_wifiCache, &stored, sizeof(stored)) == sizeof(stored) && memcmp(&stored, &cache, sizeof(cache)) == 0)
+        return;
+    preferences.putBytes(pref_wifiCache, &cache, sizeof(cache));
+}
+
+/**
+ * @brief Joins the network with a full scan, and the address given by DHCP.
+ */
+void wifiConnectScan()
+{
+    LOGI(LOG_MAIN, "Scanning for Wifi (%s)...", wifiSsid.c_str());
+    wifiState.store(WIFI_STATE_SCAN);
+    wifiDeadline = wifiStartMillis + wifiTimeout;
+    WiFi.disconnect();
+    // An empty address enables DHCP again
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());
+    wifiLeaseExpiry = 0;
+    WiFi.begin(wifiSsid.c_str(), wifiPassword.c_str());
+}
+
+/**
+ * @brief Creates the access point with the captive DNS server.
+ */
+void wifiStartAP()
+{
+    LOGW(LOG_MAIN, "Wifi connection timeout!");
+    wifiState.store(WIFI_STATE_AP);
+
+    LOGI(LOG_MAIN, "Setting up AP...");
+    WiFi.mode(WIFI_AP);
+    WiFi.softAP(WIFI_AP_SSID);
+    WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
+
+    LOGI(LOG_MAIN, "Setting up DNS server...");
+    captiveDnsBegin(DNS_PORT, apIP);
+
+    if (wifiOnline)
+        wifiOnline(apIP);
+
+    bootRecordPhase("network", wifiStartMicros, micros() - wifiStartMicros);
+}
+
+/**
+ * @brief Called once the station got an address.
+ */
+void wifiConnected()
+{
+    uint8_t previous = wifiState.exchange(WIFI_STATE_CONNECTED);
+    if (previous == WIFI_STATE_FAST || previous == WIFI_STATE_SCAN)
+        bootRecordPhase("network", wifiStartMicros, micros() - wifiStartMicros);
+
+    LOGI(LOG_MAIN, "Network Configuration:");
+    LOGI(LOG_MAIN, "----------------------");
+    LOGI(LOG_MAIN, "         SSID: %s", WiFi.SSID().c_str());
+    LOGI(LOG_MAIN, "  Wifi Status: %d", WiFi.status());
+    LOGI(LOG_MAIN, "Wifi Strength: %d dBm", WiFi.RSSI());
+    LOGI(LOG_MAIN, "      Channel: %d", (int)WiFi.channel());
+    LOGI(LOG_MAIN, "        BSSID: %s", WiFi.BSSIDstr().c_str());
+    LOGI(LOG_MAIN, "          MAC: %s", WiFi.macAddress().c_str());
+    LOGI(LOG_MAIN, "           IP: %s", WiFi.localIP().toString().c_str());
+    LOGI(LOG_MAIN, "       Subnet: %s", WiFi.subnetMask().toString().c_str());
+    LOGI(LOG_MAIN, "      Gateway: %s", WiFi.gatewayIP().toString().c_str());
+    LOGI(LOG_MAIN, "        DNS 1: %s", WiFi.dnsIP(0).toString().c_str());
+
+    // None with the cached address
+    if (wifiLeaseExpiry == 0)
+    {
+        wifiLeaseSeconds = wifiDhcpLease();
+        wifiLeaseMillis = millis();
+    }
+    wifiSaveCache();
+
+    if (wifiOnline)
+        wifiOnline(WiFi.localIP());
+}
+
+/**
+ * @brief Handles the events of the WiFi driver, and the timeouts of every state.
+ */
+void wifiTask(void *parameter)
+{
+    for (;;)
+    {
+        TickType_t wait = portMAX_DELAY;
+        uint8_t state = wifiState.load();
+        if (state == WIFI_STATE_FAST || state == WIFI_STATE_SCAN)
+        {
+            long remaining = (long)(wifiDeadline - millis());
+            wait = remaining > 0 ? pdMS_TO_TICKS(remaining) : 0;
+        }
+        else if (state == WIFI_STATE_CONNECTED && wifiLeaseSeconds != 0)
+            // Until the clock is set, for storing when the lease expires
+            wait = pdMS_TO_TICKS(WIFI_LEASE_CHECK_MS);
+
+        uint8_t event;
+        if (xQueueReceive(wifiEvents, &event, wait) != pdTRUE)
+        {
+            if (state == WIFI_STATE_FAST)
+            {
+                LOGW(LOG_MAIN, "Could not reconnect to the last access point, scanning...");
+                wifiConnectScan();
+            }
+            else if (state == WIFI_STATE_SCAN)
+                wifiStartAP();
+            else if (state == WIFI_STATE_CONNECTED)
+                wifiSaveCache();
+            continue;
+        }
+
+        if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+            wifiConnected();
+        else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+        {
+            if (state == WIFI_STATE_FAST)
+            {
+                // The access point moved or changed, the cache is no longer useful
+                LOGW(LOG_MAIN, "Last access point not available, scanning...");
+                preferences.remove(pref_wifiCache);
+                wifiConnectScan();
+            }
+            else if (state == WIFI_STATE_CONNECTED)
+                // The driver reconnects by itself
+                LOGW(LOG_MAIN, "Wifi connection lost.");
+        }
+    }
+}
+
+/**
+ * @brief Starts connecting to [ssid]. Returns immediately, the connection goes on in the background.
+ *
+ * @param ssid The network to join.
+ * @param password The password of [ssid].
+ * @param timeout The maximum time, in milliseconds, until creating the access point.
+ */
+void wifiBegin(const String &ssid, const String &password, unsigned long timeout)
+{
+    wifiSsid = ssid;
+    wifiPassword = password;
+    wifiTimeout = timeout;
+    wifiStartMillis = millis();
+    wifiStartMicros = micros();
+
+    wifiEvents = xQueueCreate(WIFI_EVENT_QUEUE_LENGTH, sizeof(uint8_t));
+    auto forward = [](arduino_event_id_t event, arduino_event_info_t info)
+    {
+        uint8_t id = event;
+        xQueueSend(wifiEvents, &id, 0);
+    };
+    WiFi.onEvent(forward, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    WiFi.onEvent(forward, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+
+    WifiCache cache;
+    if (wifiLoadCache(cache, ssid))
+    {
+        LOGI(LOG_MAIN, "Reconnecting to Wifi (%s) on channel %u...", ssid.c_str(), cache.channel);
+        wifiState.store(WIFI_STATE_FAST);
+        wifiDeadline = wifiStartMillis + min(timeout, (unsigned long)WIFI_FAST_CONNECT_TIMEOUT_MS);
+        // The previous lease is reused while it lasts, so DHCP is skipped too. Otherwise the router could have given
+        // the address to another device
+        uint32_t now = wifiClock();
+        if (now != 0 && now + WIFI_LEASE_MARGIN_S < cache.leaseExpiry)
+        {
+            wifiLeaseExpiry = cache.leaseExpiry;
+            WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+        }
+        else
+            LOGI(LOG_MAIN, "Cached lease expired or unknown, asking DHCP");
+        WiFi.begin(ssid.c_str(), password.c_str(), cache.channel, cache.bssid);
+    }
+    else
+    {
+        wifiState.store(WIFI_STATE_SCAN);
+        wifiDeadline = wifiStartMillis + timeout;
+        LOGI(LOG_MAIN, "Connecting to Wifi (%s)...", ssid.c_str());
+        WiFi.begin(ssid.c_str(), password.c_str());
+    }
+
+    xTaskCreate(wifiTask, "wifi", WIFI_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+}
+
+#endif
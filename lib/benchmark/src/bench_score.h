@@ -0,0 +1,228 @@
+/**
+ * @file bench_score.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Builds the scores laid out, turned through, followed and searched by the test suites, from a few settings.
+ * They're generated in memory and always the same for the same settings, so no parsing is measured with them: the
+ * MusicXML corpus of test/bench_musicxml covers that.
+ * @version 0.1
+ * @date 2022-03-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef BENCH_SCORE_H
+#define BENCH_SCORE_H
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mx/api/ScoreData.h"
+
+/**
+ * @brief The ticks of a quarter of every score built.
+ */
+#define BENCH_SCORE_TICKS_PER_QUARTER 4
+
+/**
+ * @brief Measures with the same time signature, starting with a tempo if [beatsPerMinute] is not 0, in beats of
+ * [tempoUnit] with [tempoDots] a minute.
+ */
+struct BenchScoreSection
+{
+    int measures;
+    int beats = 4;
+    int beatType = 4;
+    mx::api::DurationName tempoUnit = mx::api::DurationName::quarter;
+    int tempoDots = 0;
+    int beatsPerMinute = 0;
+};
+
+/**
+ * @brief The notes of the melody.
+ */
+enum BenchScoreRhythm
+{
+    BENCH_RHYTHM_QUARTERS,
+    BENCH_RHYTHM_EIGHTHS,
+    /**
+     * @brief A note a measure.
+     */
+    BENCH_RHYTHM_WHOLES,
+    /**
+     * @brief Quarters, and eighths every now and then.
+     */
+    BENCH_RHYTHM_MIXED
+};
+
+struct BenchScoreOptions
+{
+    int parts = 1;
+    std::vector<BenchScoreSection> sections = {{32}};
+    BenchScoreRhythm rhythm = BENCH_RHYTHM_QUARTERS;
+
+    /**
+     * @brief Every seed gives another melody.
+     */
+    uint32_t seed = 0;
+
+    /**
+     * @brief Whether the parts after the first one play triads in half notes, instead of a melody of their own.
+     */
+    bool chords = false;
+
+    /**
+     * @brief Whether some notes of the melody are sharp.
+     */
+    bool accidentals = false;
+
+    /**
+     * @brief Whether every fourth measure of the melody ends with a rest.
+     */
+    bool rests = false;
+
+    /**
+     * @brief The key of every part, in fifths. The ones missing have no key signature.
+     */
+    std::vector<int> fifths;
+
+    std::string title;
+    std::string composer;
+    std::vector<std::string> partNames;
+};
+
+/**
+ * @brief Gives the duration of [ticks], dotted if needed.
+ */
+mx::api::DurationData benchScoreDuration(int ticks)
+{
+    using namespace mx::api;
+    DurationData duration;
+    duration.durationTimeTicks = ticks;
+    int plain = ticks;
+    // Dotted when 1.5 times a plain duration
+    if (ticks % 3 == 0)
+    {
+        plain = ticks / 3 * 2;
+        duration.durationDots = 1;
+    }
+    if (plain >= 16)
+        duration.durationName = DurationName::whole;
+    else if (plain >= 8)
+        duration.durationName = DurationName::half;
+    else if (plain >= 4)
+        duration.durationName = DurationName::quarter;
+    else if (plain >= 2)
+        duration.durationName = DurationName::eighth;
+    else
+        duration.durationName = DurationName::dur16th;
+    return duration;
+}
+
+/**
+ * @brief Builds a score as told by [options]. The melody moves by steps from a random walk, starting from [seed].
+ */
+mx::api::ScoreData benchScoreBuild(const BenchScoreOptions &options)
+{
+    using namespace mx::api;
+    ScoreData score;
+    score.workTitle = options.title;
+    score.composer = options.composer;
+    score.ticksPerQuarter = BENCH_SCORE_TICKS_PER_QUARTER;
+    for (int p = 0; p < options.parts; p++)
+    {
+        PartData part;
+        if (p < (int)options.partNames.size())
+            part.name = options.partNames[p];
+        uint32_t random = options.seed * 2654435761u + p * 40503u + 12345;
+        auto next = [&random]()
+        {
+            random = random * 1664525 + 1013904223;
+            return random >> 8;
+        };
+        bool chords = options.chords && p > 0;
+        int step = (options.seed + 2 * p) % 7;
+        int m = 0;
+        for (const BenchScoreSection &section : options.sections)
+        {
+            int measureTicks = section.beats * 4 * BENCH_SCORE_TICKS_PER_QUARTER / section.beatType;
+            for (int j = 0; j < section.measures; j++, m++)
+            {
+                MeasureData measure;
+                measure.timeSignature.beats = section.beats;
+                measure.timeSignature.beatType = section.beatType;
+                measure.timeSignature.isImplicit = j != 0;
+                if (m == 0 && p < (int)options.fifths.size())
+                {
+                    KeyData key;
+                    key.fifths = options.fifths[p];
+                    measure.keys.push_back(key);
+                }
+                StaffData staff;
+                if (j == 0 && p == 0 && section.beatsPerMinute > 0)
+                {
+                    DirectionData direction;
+                    TempoData tempo;
+                    tempo.tempoType = TempoType::beatsPerMinute;
+                    tempo.beatsPerMinute.durationName = section.tempoUnit;
+                    tempo.beatsPerMinute.dots = section.tempoDots;
+                    tempo.beatsPerMinute.beatsPerMinute = section.beatsPerMinute;
+                    direction.tempos.push_back(tempo);
+                    staff.directions.push_back(direction);
+                }
+
+                VoiceData voice;
+                for (int tick = 0, n = 0; tick < measureTicks; n++)
+                {
+                    int length = 4;
+                    if (chords)
+                        length = 8;
+                    else if (options.rhythm == BENCH_RHYTHM_EIGHTHS)
+                        length = 2;
+                    else if (options.rhythm == BENCH_RHYTHM_WHOLES)
+                        length = measureTicks;
+                    else if (options.rhythm == BENCH_RHYTHM_MIXED && next() % 3 == 0)
+                        length = 2;
+                    length = std::min(length, measureTicks - tick);
+                    NoteData note;
+                    note.tickTimePosition = tick;
+                    note.durationData = benchScoreDuration(length);
+                    if (chords)
+                    {
+                        note.pitchData.step = (Step)((m * 3 + tick / 8 * 4) % 7);
+                        note.pitchData.octave = 3;
+                    }
+                    else
+                    {
+                        step = (step + (int)(next() % 5) + 5) % 7;
+                        note.pitchData.step = (Step)step;
+                        note.pitchData.octave = 4 - p + (next() % 4 == 0);
+                        note.pitchData.alter = options.accidentals && (m + n) % 5 == 0 ? 1 : 0;
+                    }
+                    tick += length;
+                    note.isRest = options.rests && !chords && m % 4 == 3 && tick == measureTicks;
+                    voice.notes.push_back(note);
+                    for (int third = 1; chords && third <= 2; third++)
+                    {
+                        NoteData chord = note;
+                        chord.isChord = true;
+                        int chordStep = (int)note.pitchData.step + 2 * third;
+                        chord.pitchData.step = (Step)(chordStep % 7);
+                        chord.pitchData.octave += chordStep / 7;
+                        voice.notes.push_back(chord);
+                    }
+                }
+                staff.voices[0] = voice;
+                measure.staves.push_back(staff);
+                part.measures.push_back(measure);
+            }
+        }
+        score.parts.push_back(part);
+    }
+    return score;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * @file bench_setup.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief The fixture and the statistics shared by the test suites that run the firmware on the native environment:
+ * the storage in RAM they start from, the percentiles they report, and the checks of the settings they take.
+ * @version 0.1
+ * @date 2022-03-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef BENCH_SETUP_H
+#define BENCH_SETUP_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "pref_consts.h"
+#include "storage_ram.h"
+
+/**
+ * @brief Gives the [percent] percentile of [values], or 0 if there are none.
+ */
+uint32_t benchPercentile(std::vector<uint32_t> values, int percent)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, values.size() * percent / 100)];
+}
+
+/**
+ * @brief Mutes Serial, and makes a storage of [bytes] in RAM the one of the firmware, with the directories of the
+ * scores and the cache, and opens the preferences. Must be called once, from main().
+ *
+ * @tparam S The storage, a RamStorage or a class extending it.
+ * @return The storage.
+ */
+template <typename S = RamStorage>
+S &benchStorageSetUp(size_t bytes)
+{
+    Serial.muted = true;
+    static S ram(bytes);
+    storage = &ram;
+    ram.mkdir(STORAGE_DIR_SCORES);
+    ram.mkdir(STORAGE_DIR_CACHE);
+    preferences.begin(preferencesName, false);
+    return ram;
+}
+
+/**
+ * @brief Checks that setting [key] to every one of [values] is refused with [error].
+ */
+#define BENCH_CONFIG_REJECTS(key, error, ...)                                  \
+    do                                                                         \
+    {                                                                          \
+        for (const char *value : std::initializer_list<const char *>{__VA_ARGS__}) \
+            TEST_ASSERT_EQUAL_STRING_MESSAGE(error, configure(key, value), value); \
+    } while (0)
+
+/**
+ * @brief Checks that setting [key] to words, partial numbers or numbers that overflow an int is refused.
+ */
+#define BENCH_CONFIG_REJECTS_NUMBERS(key)                                                \
+    do                                                                                   \
+    {                                                                                    \
+        BENCH_CONFIG_REJECTS(key, ERR_CONFIG_NUMERIC, "on", "", "1x", "+1", " 1", "-"); \
+        BENCH_CONFIG_REJECTS(key, ERR_CONFIG_BOUNDS, "99999999999", "-99999999999");     \
+    } while (0)
+
+#endif
@@ -0,0 +1,179 @@
+/**
+ * @file benchmark.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Micro-benchmark harness in the style of Google Benchmark, for the test suites. Every benchmark is run with
+ * growing iteration counts until it runs for long enough, and the time per iteration is reported through Unity.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+#include <unity.h>
+
+/**
+ * @brief The time a benchmark must run for its result to be reported, in microseconds.
+ */
+#ifndef BENCHMARK_MIN_TIME_US
+#define BENCHMARK_MIN_TIME_US 200000UL
+#endif
+
+/**
+ * @brief The maximum amount of iterations of a benchmark, for the ones that are optimized away.
+ */
+#define BENCHMARK_MAX_ITERATIONS 100000000UL
+
+/**
+ * @brief The maximum amount of benchmarks registered with BENCHMARK.
+ */
+#define BENCHMARKS_MAX 32
+
+/**
+ * @brief Given to every benchmark, which must run its body while [keepRunning] returns true.
+ */
+class BenchmarkState
+{
+public:
+    BenchmarkState(unsigned long iterations) : iterations(iterations) {}
+
+    /**
+     * @brief Starts the timer on the first call, and stops it once all the iterations have run.
+     *
+     * @return true If the body must run again.
+     */
+    bool keepRunning()
+    {
+        if (done == 0 && !started)
+        {
+            started = true;
+            start = micros();
+        }
+        if (done < iterations)
+        {
+            done++;
+            return true;
+        }
+        pauseTiming();
+        return false;
+    }
+
+    /**
+     * @brief Stops counting time, for setup done inside the loop.
+     */
+    void pauseTiming()
+    {
+        if (!paused)
+            elapsed += micros() - start;
+        paused = true;
+    }
+
+    void resumeTiming()
+    {
+        if (paused)
+            start = micros();
+        paused = false;
+    }
+
+    /**
+     * @brief Sets the bytes handled by every iteration, for reporting the throughput.
+     */
+    void setBytesPerIteration(size_t bytes) { bytesPerIteration = bytes; }
+
+    const unsigned long iterations;
+    unsigned long elapsed = 0;
+    size_t bytesPerIteration = 0;
+
+private:
+    unsigned long done = 0;
+    unsigned long start = 0;
+    bool started = false;
+    bool paused = false;
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState &state);
+
+/**
+ * @brief The outcome of a benchmark.
+ */
+struct BenchmarkResult
+{
+    const char *name;
+    unsigned long iterations;
+    float nanosPerIteration;
+
+    /**
+     * @brief The bytes handled per second, or 0 if the benchmark didn't set the bytes per iteration.
+     */
+    float bytesPerSecond;
+};
+
+struct BenchmarkRegistration
+{
+    const char *name;
+    BenchmarkFunction function;
+};
+
+BenchmarkRegistration benchmarks[BENCHMARKS_MAX];
+uint8_t benchmarkCount = 0;
+
+/**
+ * @brief Runs [function] until it takes at least BENCHMARK_MIN_TIME_US, and reports the time per iteration.
+ */
+BenchmarkResult benchmarkRun(const char *name, BenchmarkFunction function)
+{
+    unsigned long iterations = 1;
+    for (;;)
+    {
+        BenchmarkState state(iterations);
+        function(state);
+
+        if (state.elapsed >= BENCHMARK_MIN_TIME_US || iterations >= BENCHMARK_MAX_ITERATIONS)
+        {
+            BenchmarkResult result = {name, iterations, state.elapsed * 1000.0f / iterations, 0};
+            if (state.bytesPerIteration > 0 && state.elapsed > 0)
+                result.bytesPerSecond = (float)state.bytesPerIteration * iterations * 1e6f / state.elapsed;
+
+            char message[128];
+            if (result.bytesPerSecond > 0)
+                snprintf(message, sizeof(message), "%-32s %10.0f ns %10lu iterations %8.2f MB/s", name, result.nanosPerIteration, iterations, result.bytesPerSecond / 1e6f);
+            else
+                snprintf(message, sizeof(message), "%-32s %10.0f ns %10lu iterations", name, result.nanosPerIteration, iterations);
+            TEST_MESSAGE(message);
+            return result;
+        }
+
+        // Aim for 1.4 times the minimum time, growing at most 10 times per round
+        float multiplier = state.elapsed > 0 ? 1.4f * BENCHMARK_MIN_TIME_US / state.elapsed : 10;
+        multiplier = std::min(std::max(multiplier, 2.0f), 10.0f);
+        iterations = std::min((unsigned long)(iterations * multiplier), BENCHMARK_MAX_ITERATIONS);
+    }
+}
+
+/**
+ * @brief Runs all the benchmarks registered with BENCHMARK, in the order they are defined.
+ */
+void benchmarkRunAll()
+{
+    for (uint8_t i = 0; i < benchmarkCount; i++)
+        benchmarkRun(benchmarks[i].name, benchmarks[i].function);
+}
+
+/**
+ * @brief Adds [function] to the benchmarks run by benchmarkRunAll.
+ */
+bool benchmarkRegister(const char *name, BenchmarkFunction function)
+{
+    if (benchmarkCount >= BENCHMARKS_MAX)
+        return false;
+    benchmarks[benchmarkCount++] = {name, function};
+    return true;
+}
+
+#define BENCHMARK(function) bool function##Registered = benchmarkRegister(#function, function);
+
+#endif
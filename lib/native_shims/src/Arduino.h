@@ -0,0 +1,272 @@
+/**
+ * @file Arduino.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the subset of the Arduino core used by the firmware.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cctype>
+#include <algorithm>
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define LED_BUILTIN 2
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define IRAM_ATTR
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+class String
+{
+public:
+    String() {}
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(long long v) : s_(std::to_string(v)) {}
+    String(unsigned long long v) : s_(std::to_string(v)) {}
+    String(double v, unsigned int decimals = 2)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        s_ = buf;
+    }
+    String(float v, unsigned int decimals = 2) : String((double)v, decimals) {}
+
+    const char *c_str() const { return s_.c_str(); }
+    unsigned int length() const { return s_.length(); }
+    bool isEmpty() const { return s_.empty(); }
+    void reserve(size_t n) { s_.reserve(n); }
+
+    int indexOf(char c, unsigned int from = 0) const { return find(s_.find(c, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return find(s_.find(s.s_, from)); }
+    int lastIndexOf(char c) const { return find(s_.rfind(c)); }
+    String substring(unsigned int from) const { return from >= s_.size() ? String() : String(s_.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+            std::swap(from, to);
+        if (from >= s_.size())
+            return String();
+        return String(s_.substr(from, to - from));
+    }
+    bool startsWith(const String &p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+    void setCharAt(unsigned int i, char c)
+    {
+        if (i < s_.size())
+            s_[i] = c;
+    }
+    bool endsWith(const String &p) const { return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0; }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s_.c_str(), nullptr); }
+    void toLowerCase()
+    {
+        for (char &c : s_)
+            c = tolower((unsigned char)c);
+    }
+    void trim()
+    {
+        size_t b = s_.find_first_not_of(" \t\r\n");
+        size_t e = s_.find_last_not_of(" \t\r\n");
+        s_ = b == std::string::npos ? std::string() : s_.substr(b, e - b + 1);
+    }
+    char charAt(unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    bool concat(const String &o)
+    {
+        s_ += o.s_;
+        return true;
+    }
+
+    String &operator+=(const String &o)
+    {
+        s_ += o.s_;
+        return *this;
+    }
+    String &operator+=(const char *o)
+    {
+        s_ += o ? o : "";
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        s_ += c;
+        return *this;
+    }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    bool operator==(const char *o) const { return s_ == (o ? o : ""); }
+    bool operator!=(const String &o) const { return s_ != o.s_; }
+    bool operator!=(const char *o) const { return !(*this == o); }
+    bool operator<(const String &o) const { return s_ < o.s_; }
+
+    const std::string &str() const { return s_; }
+
+private:
+    static int find(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+    std::string s_;
+};
+
+inline String operator+(const String &a, const String &b) { return String(a.str() + b.str()); }
+inline String operator+(const String &a, const char *b) { return String(a.str() + (b ? b : "")); }
+inline String operator+(const char *a, const String &b) { return String((a ? a : "") + b.str()); }
+inline String operator+(const String &a, char b) { return String(a.str() + b); }
+
+class IPAddress
+{
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+    IPAddress(uint32_t address) { memcpy(bytes, &address, 4); }
+    operator uint32_t() const
+    {
+        uint32_t address;
+        memcpy(&address, bytes, 4);
+        return address;
+    }
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+        return String(buf);
+    }
+    uint8_t operator[](int i) const { return bytes[i]; }
+    bool operator==(const IPAddress &o) const { return memcmp(bytes, o.bytes, 4) == 0; }
+
+    uint8_t bytes[4] = {0, 0, 0, 0};
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v) { return print(String(v)); }
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T &v) { return print(v) + println(); }
+};
+
+/**
+ * @brief Serial port stand-in that writes to stdout, or nowhere when muted by benchmarks.
+ */
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long) {}
+    void flush() { fflush(stdout); }
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        bytesWritten += len;
+        return muted ? len : fwrite(data, 1, len, stdout);
+    }
+    using Print::write;
+    int available() { return 0; }
+    int read() { return -1; }
+    operator bool() const { return true; }
+
+    bool muted = false;
+    size_t bytesWritten = 0;
+};
+
+extern HardwareSerial Serial;
+
+inline unsigned long millis()
+{
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return (unsigned long)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+inline unsigned long micros()
+{
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+/**
+ * @brief Hardware timers, counting at 80 MHz divided by [divider]. Their interrupts run in a thread of the timer, and
+ * never at the same time as the GPIO interrupts, as on a core.
+ */
+struct hw_timer_t;
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void timerEnd(hw_timer_t *timer);
+void timerAttachInterrupt(hw_timer_t *timer, void (*isr)(), bool edge);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm, bool autoreload);
+void timerAlarmEnable(hw_timer_t *timer);
+void timerAlarmDisable(hw_timer_t *timer);
+void timerWrite(hw_timer_t *timer, uint64_t value);
+uint64_t timerRead(hw_timer_t *timer);
+
+uint32_t esp_random();
+
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+void configTime(long gmtOffset, int daylightOffset, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+
+class EspClass
+{
+public:
+    void restart() { restarts++; }
+    uint32_t getFreeHeap() { return freeHeap; }
+    uint32_t getMaxAllocHeap() { return maxAllocHeap; }
+    uint32_t getMinFreeHeap() { return minFreeHeap; }
+    uint32_t getHeapSize() { return heapSize; }
+
+    int restarts = 0;
+    uint32_t freeHeap = 200 * 1024;
+    uint32_t maxAllocHeap = 110 * 1024;
+    uint32_t minFreeHeap = 150 * 1024;
+    uint32_t heapSize = 300 * 1024;
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * @file AsyncTCP.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for AsyncTCP. The client type is declared with the web server stand-in.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef ASYNCTCP_SHIM_H
+#define ASYNCTCP_SHIM_H
+
+#include <ESPAsyncWebServer.h>
+
+#endif
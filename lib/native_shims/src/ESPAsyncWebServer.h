@@ -0,0 +1,344 @@
+/**
+ * @file ESPAsyncWebServer.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the request/response types of ESPAsyncWebServer. Requests are built by hand and dispatched
+ * synchronously to the registered handlers, or received over HTTP on a loopback socket once the server is started.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef ESPASYNCWEBSERVER_SHIM_H
+#define ESPASYNCWEBSERVER_SHIM_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+
+typedef std::function<void(AsyncWebServerRequest *request)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)> ArUploadHandlerFunction;
+typedef std::function<String(const String &)> AwsTemplateProcessor;
+typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
+typedef std::function<void(void)> ArDisconnectHandler;
+
+class AsyncClient
+{
+public:
+    IPAddress remoteIP() const { return ip; }
+    IPAddress ip = IPAddress(127, 0, 0, 1);
+};
+
+class AsyncWebHeader
+{
+public:
+    AsyncWebHeader(const String &name, const String &value) : _name(name), _value(value) {}
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+class AsyncWebParameter
+{
+public:
+    AsyncWebParameter(const String &name, const String &value, bool form = false, bool file = false, size_t size = 0)
+        : _name(name), _value(value), _isForm(form), _isFile(file), _size(size) {}
+    const String &name() const { return _name; }
+    const String &value() const { return _value; }
+    bool isPost() const { return _isForm; }
+    bool isFile() const { return _isFile; }
+    size_t size() const { return _size; }
+
+private:
+    String _name;
+    String _value;
+    bool _isForm;
+    bool _isFile;
+    size_t _size;
+};
+
+/**
+ * @brief A response is fully rendered into [body] when it's built, except for the fillers, which are pulled until
+ * they return 0 when the request is sent.
+ */
+class AsyncWebServerResponse
+{
+public:
+    AsyncWebServerResponse(int code, const String &contentType = String(), const std::string &body = std::string())
+        : code(code), contentType(contentType), body(body) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void addHeader(const String &name, const String &value) { headers.emplace_back(name, value); }
+    void setCode(int c) { code = c; }
+    void setContentLength(size_t len) { contentLength = len; }
+
+    /**
+     * @brief Renders the pending body sources into [body]. Called when the response is sent.
+     */
+    void render()
+    {
+        if (!filler)
+            return;
+        std::vector<uint8_t> chunk(1460);
+        size_t index = 0;
+        for (;;)
+        {
+            size_t len = filler(chunk.data(), chunk.size(), index);
+            if (len == 0 || len == RESPONSE_TRY_AGAIN)
+                break;
+            body.append((const char *)chunk.data(), len);
+            index += len;
+        }
+        filler = nullptr;
+    }
+
+    static const size_t RESPONSE_TRY_AGAIN = 0xFFFFFFFF;
+
+    int code;
+    String contentType;
+    std::string body;
+    std::vector<AsyncWebHeader> headers;
+    AwsResponseFiller filler;
+    bool chunked = false;
+    size_t contentLength = 0;
+};
+
+#define RESPONSE_TRY_AGAIN AsyncWebServerResponse::RESPONSE_TRY_AGAIN
+
+/**
+ * @brief Replaces all the %PLACEHOLDERS% of [content] with the result of [processor].
+ */
+std::string processTemplate(const char *content, AwsTemplateProcessor processor);
+
+class AsyncWebServerRequest
+{
+public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const String &url) : _method(method), _url(url) {}
+    ~AsyncWebServerRequest()
+    {
+        if (_disconnectHandler)
+            _disconnectHandler();
+        if (_tempObject)
+            free(_tempObject);
+    }
+
+    AsyncClient *client() { return &_client; }
+    const String &url() const { return _url; }
+    size_t contentLength() const { return _contentLength; }
+    size_t _contentLength = 0;
+    WebRequestMethodComposite method() const { return _method; }
+
+    void addHeader(const String &name, const String &value) { _headers.emplace_back(name, value); }
+    void addParam(const String &name, const String &value, bool post = false) { _params.emplace_back(name, value, post); }
+
+    bool hasHeader(const String &name) const { return findHeader(name) != nullptr; }
+    AsyncWebHeader *getHeader(const String &name) { return const_cast<AsyncWebHeader *>(findHeader(name)); }
+    size_t headers() const { return _headers.size(); }
+
+    size_t params() const { return _params.size(); }
+    bool hasParam(const String &name, bool post = false, bool file = false) const { return findParam(name, post) != nullptr; }
+    AsyncWebParameter *getParam(const String &name, bool post = false, bool file = false) { return const_cast<AsyncWebParameter *>(findParam(name, post)); }
+    AsyncWebParameter *getParam(size_t i) { return i < _params.size() ? &_params[i] : nullptr; }
+    bool hasArg(const char *name) const { return hasParam(name) || hasParam(name, true); }
+    String arg(const char *name) const
+    {
+        const AsyncWebParameter *p = findParam(name, false);
+        if (!p)
+            p = findParam(name, true);
+        return p ? p->value() : String();
+    }
+
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String())
+    {
+        return new AsyncWebServerResponse(code, contentType, content.str());
+    }
+    AsyncWebServerResponse *beginResponse_P(int code, const String &contentType, const char *content, AwsTemplateProcessor processor = nullptr)
+    {
+        return new AsyncWebServerResponse(code, contentType, processor ? processTemplate(content, processor) : std::string(content));
+    }
+    AsyncWebServerResponse *beginResponse(const String &contentType, size_t len, AwsResponseFiller filler, AwsTemplateProcessor processor = nullptr)
+    {
+        AsyncWebServerResponse *response = new AsyncWebServerResponse(200, contentType);
+        response->filler = filler;
+        response->contentLength = len;
+        return response;
+    }
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller filler, AwsTemplateProcessor processor = nullptr)
+    {
+        AsyncWebServerResponse *response = new AsyncWebServerResponse(200, contentType);
+        response->filler = filler;
+        response->chunked = true;
+        return response;
+    }
+    AsyncWebServerResponse *beginResponse(fs::FS &fs, const String &path, const String &contentType = String(), bool download = false);
+
+    void send(AsyncWebServerResponse *response)
+    {
+        response->render();
+        _response.reset(response);
+    }
+    void send(int code, const String &contentType = String(), const String &content = String()) { send(beginResponse(code, contentType, content)); }
+    void send_P(int code, const String &contentType, const char *content, AwsTemplateProcessor processor = nullptr) { send(beginResponse_P(code, contentType, content, processor)); }
+    void send(fs::FS &fs, const String &path, const String &contentType = String(), bool download = false) { send(beginResponse(fs, path, contentType, download)); }
+
+    void redirect(const String &url)
+    {
+        AsyncWebServerResponse *response = beginResponse(302);
+        response->addHeader("Location", url);
+        send(response);
+    }
+    void requestAuthentication(const char *realm = NULL, bool isDigest = true) { send(401); }
+
+    void onDisconnect(ArDisconnectHandler fn) { _disconnectHandler = fn; }
+
+    /**
+     * @brief The response sent by the handler, if any.
+     */
+    AsyncWebServerResponse *response() { return _response.get(); }
+
+    fs::File _tempFile;
+    void *_tempObject = NULL;
+
+private:
+    const AsyncWebHeader *findHeader(const String &name) const
+    {
+        for (const AsyncWebHeader &h : _headers)
+            if (strcasecmp(h.name().c_str(), name.c_str()) == 0)
+                return &h;
+        return nullptr;
+    }
+    const AsyncWebParameter *findParam(const String &name, bool post) const
+    {
+        for (const AsyncWebParameter &p : _params)
+            if (p.name() == name && p.isPost() == post)
+                return &p;
+        return nullptr;
+    }
+
+    WebRequestMethodComposite _method;
+    String _url;
+    AsyncClient _client;
+    std::vector<AsyncWebHeader> _headers;
+    std::vector<AsyncWebParameter> _params;
+    std::unique_ptr<AsyncWebServerResponse> _response;
+    ArDisconnectHandler _disconnectHandler;
+};
+
+class AsyncWebHandler
+{
+public:
+    virtual ~AsyncWebHandler() {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+public:
+    String uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction onRequest;
+    ArUploadHandlerFunction onUpload;
+};
+
+class AsyncWebServer
+{
+public:
+    AsyncWebServer(uint16_t port) : port(port) {}
+    ~AsyncWebServer() { end(); }
+
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload = nullptr)
+    {
+        handlers.emplace_back(new AsyncCallbackWebHandler());
+        AsyncCallbackWebHandler &h = *handlers.back();
+        h.uri = uri;
+        h.method = method;
+        h.onRequest = onRequest;
+        h.onUpload = onUpload;
+        return h;
+    }
+    void onNotFound(ArRequestHandlerFunction fn) { notFoundHandler = fn; }
+    void onFileUpload(ArUploadHandlerFunction fn) { uploadHandler = fn; }
+
+    /**
+     * @brief Starts serving HTTP on 127.0.0.1:[port], or on a free port if [port] is 0, which is then set. Like
+     * AsyncTCP, a single thread runs every handler, and the connection is closed after each response.
+     */
+    void begin();
+    void end();
+    void reset() { handlers.clear(); }
+
+    /**
+     * @brief Runs [request] through the handler registered for its url and method, or the not found handler.
+     */
+    void handle(AsyncWebServerRequest *request)
+    {
+        for (auto &h : handlers)
+            if (h->uri == request->url() && (h->method & request->method()))
+            {
+                h->onRequest(request);
+                return;
+            }
+        if (notFoundHandler)
+            notFoundHandler(request);
+    }
+
+    /**
+     * @brief Runs an upload of [data] named [filename] through the handlers, in chunks of [chunk] bytes.
+     */
+    void upload(AsyncWebServerRequest *request, const String &filename, const uint8_t *data, size_t len, size_t chunk = 1436)
+    {
+        ArUploadHandlerFunction handler = uploadHandler;
+        ArRequestHandlerFunction onRequest = nullptr;
+        for (auto &h : handlers)
+            if (h->uri == request->url() && (h->method & request->method()) && h->onUpload)
+            {
+                handler = h->onUpload;
+                onRequest = h->onRequest;
+            }
+        size_t index = 0;
+        do
+        {
+            size_t n = std::min(chunk, len - index);
+            handler(request, filename, index, (uint8_t *)data + index, n, index + n >= len);
+            index += n;
+        } while (index < len);
+        if (onRequest)
+            onRequest(request);
+    }
+
+    uint16_t port;
+    bool started = false;
+    int listenSocket = -1;
+    std::atomic<bool> running{false};
+    std::thread eventLoop;
+    std::vector<std::unique_ptr<AsyncCallbackWebHandler>> handlers;
+    ArRequestHandlerFunction notFoundHandler;
+    ArUploadHandlerFunction uploadHandler;
+};
+
+#endif
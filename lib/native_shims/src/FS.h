@@ -0,0 +1,108 @@
+/**
+ * @file FS.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the Arduino-ESP32 fs::FS API, backed by a directory of the host file system.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef FS_SHIM_H
+#define FS_SHIM_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+    enum SeekMode
+    {
+        SeekSet = 0,
+        SeekCur = 1,
+        SeekEnd = 2
+    };
+
+    struct FileImpl;
+
+    class File : public Print
+    {
+    public:
+        File() {}
+        File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+
+        size_t write(const uint8_t *data, size_t len) override;
+        using Print::write;
+        size_t read(uint8_t *buf, size_t len);
+        int read();
+        int available();
+        int peek();
+        bool seek(uint32_t pos, SeekMode mode = SeekSet);
+        size_t position() const;
+        size_t size() const;
+        void flush();
+        void close();
+        const char *name() const;
+        const char *path() const;
+        bool isDirectory() const;
+        File openNextFile(const char *mode = FILE_READ);
+        void rewindDirectory();
+        time_t getLastWrite();
+        operator bool() const;
+
+    private:
+        std::shared_ptr<FileImpl> impl;
+    };
+
+    class FS
+    {
+    public:
+        FS() {}
+        FS(const std::string &root) : root(root) {}
+
+        File open(const char *path, const char *mode = FILE_READ, bool create = false);
+        File open(const String &path, const char *mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+        bool exists(const char *path);
+        bool exists(const String &path) { return exists(path.c_str()); }
+        bool remove(const char *path);
+        bool remove(const String &path) { return remove(path.c_str()); }
+        bool rename(const char *from, const char *to);
+        bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+        bool mkdir(const char *path);
+        bool mkdir(const String &path) { return mkdir(path.c_str()); }
+        bool rmdir(const char *path);
+        bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+        /**
+         * @brief Points the file system to a directory of the host. Created if it doesn't exist.
+         */
+        void setRoot(const std::string &dir);
+
+        /**
+         * @brief The path of the host directory that holds the contents of the file system.
+         */
+        std::string root = "/tmp/ems-fs";
+
+        /**
+         * @brief Whether the file system has no directories, like SPIFFS. Slashes are then part of the file names.
+         */
+        bool flat = false;
+
+    protected:
+        std::string hostPath(const char *path) const;
+    };
+}
+
+using fs::File;
+using fs::FS;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif
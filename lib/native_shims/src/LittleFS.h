@@ -0,0 +1,32 @@
+/**
+ * @file LittleFS.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the LittleFS file system.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef LITTLEFS_SHIM_H
+#define LITTLEFS_SHIM_H
+
+#include <SPIFFS.h>
+
+namespace fs
+{
+    class LittleFSFS : public SPIFFSFS
+    {
+    public:
+        LittleFSFS(const std::string &root) : SPIFFSFS(root, "littlefs") {}
+        bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10, const char *partitionLabel = "spiffs")
+        {
+            return SPIFFSFS::begin(formatOnFail, basePath, maxOpenFiles, partitionLabel);
+        }
+    };
+}
+
+extern fs::LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * @file Preferences.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the NVS backed Preferences library. Values live in memory and writes are counted.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef PREFERENCES_SHIM_H
+#define PREFERENCES_SHIM_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partition = NULL) { return true; }
+    void end() {}
+    bool clear()
+    {
+        values.clear();
+        return true;
+    }
+    bool remove(const char *key) { return values.erase(key) > 0; }
+    bool isKey(const char *key) { return values.count(key) > 0; }
+
+    size_t putUShort(const char *key, uint16_t v) { return put(key, &v, sizeof(v)); }
+    size_t putShort(const char *key, int16_t v) { return put(key, &v, sizeof(v)); }
+    size_t putUChar(const char *key, uint8_t v) { return put(key, &v, sizeof(v)); }
+    size_t putInt(const char *key, int32_t v) { return put(key, &v, sizeof(v)); }
+    size_t putUInt(const char *key, uint32_t v) { return put(key, &v, sizeof(v)); }
+    size_t putLong(const char *key, int32_t v) { return put(key, &v, sizeof(v)); }
+    size_t putULong(const char *key, uint32_t v) { return put(key, &v, sizeof(v)); }
+    size_t putBool(const char *key, bool v) { return put(key, &v, sizeof(v)); }
+    size_t putBytes(const char *key, const void *v, size_t len) { return put(key, v, len); }
+    size_t putString(const char *key, const char *v) { return put(key, v, strlen(v) + 1); }
+    size_t putString(const char *key, const String &v) { return putString(key, v.c_str()); }
+
+    uint16_t getUShort(const char *key, uint16_t d = 0) { return get(key, d); }
+    int16_t getShort(const char *key, int16_t d = 0) { return get(key, d); }
+    uint8_t getUChar(const char *key, uint8_t d = 0) { return get(key, d); }
+    int32_t getInt(const char *key, int32_t d = 0) { return get(key, d); }
+    uint32_t getUInt(const char *key, uint32_t d = 0) { return get(key, d); }
+    int32_t getLong(const char *key, int32_t d = 0) { return get(key, d); }
+    uint32_t getULong(const char *key, uint32_t d = 0) { return get(key, d); }
+    bool getBool(const char *key, bool d = false) { return get(key, d); }
+    size_t getBytesLength(const char *key)
+    {
+        auto it = values.find(key);
+        return it == values.end() ? 0 : it->second.size();
+    }
+    size_t getBytes(const char *key, void *buf, size_t maxLen)
+    {
+        auto it = values.find(key);
+        if (it == values.end() || it->second.size() > maxLen)
+            return 0;
+        memcpy(buf, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+    String getString(const char *key, const String &d = String())
+    {
+        auto it = values.find(key);
+        return it == values.end() ? d : String((const char *)it->second.data());
+    }
+
+    /**
+     * @brief The amount of write operations done, for comparing against the NVS wear budget.
+     */
+    size_t writes = 0;
+
+private:
+    size_t put(const char *key, const void *v, size_t len)
+    {
+        writes++;
+        const uint8_t *bytes = (const uint8_t *)v;
+        values[key] = std::vector<uint8_t>(bytes, bytes + len);
+        return len;
+    }
+
+    template <typename T>
+    T get(const char *key, T d)
+    {
+        auto it = values.find(key);
+        if (it == values.end() || it->second.size() != sizeof(T))
+            return d;
+        T v;
+        memcpy(&v, it->second.data(), sizeof(T));
+        return v;
+    }
+
+    std::map<std::string, std::vector<uint8_t>> values;
+};
+
+#endif
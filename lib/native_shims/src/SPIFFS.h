@@ -0,0 +1,44 @@
+/**
+ * @file SPIFFS.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the SPIFFS file system.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef SPIFFS_SHIM_H
+#define SPIFFS_SHIM_H
+
+#include <FS.h>
+
+namespace fs
+{
+    class SPIFFSFS : public FS
+    {
+    public:
+        SPIFFSFS(const std::string &root, const char *kind = "spiffs") : FS(root), kind(kind) { flat = this->kind == "spiffs"; }
+        bool begin(bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10, const char *partitionLabel = NULL);
+        bool format();
+        void end() {}
+        size_t totalBytes() { return capacity; }
+        size_t usedBytes();
+
+        /**
+         * @brief The size of the emulated partition.
+         */
+        size_t capacity = 896 * 1024;
+
+        /**
+         * @brief The format of the file system. SPIFFS and LittleFS share the partition: mounting one fails while the
+         * partition holds the other, unless formatting.
+         */
+        std::string kind;
+    };
+}
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif
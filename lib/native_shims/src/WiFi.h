@@ -0,0 +1,158 @@
+/**
+ * @file WiFi.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the ESP32 WiFi class. Connection results are scripted by the tests.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef WIFI_SHIM_H
+#define WIFI_SHIM_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum
+{
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8,
+    ARDUINO_EVENT_WIFI_SCAN_DONE = 1,
+} arduino_event_id_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+
+typedef union
+{
+    struct
+    {
+        uint8_t reason;
+    } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+class WiFiClass
+{
+public:
+    bool mode(wifi_mode_t m)
+    {
+        _mode = m;
+        return true;
+    }
+    wifi_mode_t getMode() { return _mode; }
+    wl_status_t begin(const char *ssid, const char *pass = NULL, int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true)
+    {
+        _ssid = ssid;
+        _channel = channel;
+        beginCalls++;
+        lastBeginUsedBssid = bssid != NULL;
+        _status = WL_DISCONNECTED;
+        return _status;
+    }
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress()) { return true; }
+    bool disconnect(bool wifiOff = false, bool eraseAp = false)
+    {
+        _status = WL_DISCONNECTED;
+        return true;
+    }
+    bool setAutoReconnect(bool) { return true; }
+    bool setSleep(bool) { return true; }
+    wl_status_t status() { return _status; }
+    bool isConnected() { return _status == WL_CONNECTED; }
+    String SSID() { return _ssid; }
+    int8_t RSSI() { return -60; }
+    int32_t channel() { return _channel; }
+    uint8_t *BSSID() { return _bssid; }
+    String BSSIDstr() { return "00:11:22:33:44:55"; }
+    String macAddress() { return "24:0A:C4:00:00:01"; }
+    IPAddress localIP() { return _localIP; }
+    IPAddress subnetMask() { return IPAddress(255, 255, 255, 0); }
+    IPAddress gatewayIP() { return IPAddress(192, 168, 1, 1); }
+    IPAddress dnsIP(uint8_t i = 0) { return IPAddress(192, 168, 1, 1); }
+    bool softAP(const char *ssid, const char *pass = NULL) { return true; }
+    bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) { return true; }
+    IPAddress softAPIP() { return IPAddress(8, 8, 4, 4); }
+    int16_t scanNetworks(bool async = false) { return 0; }
+    int16_t scanComplete() { return 0; }
+    void scanDelete() {}
+    int onEvent(WiFiEventFuncCb cb, arduino_event_id_t event = (arduino_event_id_t)0)
+    {
+        callbacks.push_back({cb, event});
+        return callbacks.size();
+    }
+
+    /**
+     * @brief Simulates the station getting an IP lease, firing the registered events.
+     */
+    void simulateConnected(IPAddress ip = IPAddress(192, 168, 1, 42))
+    {
+        _status = WL_CONNECTED;
+        _localIP = ip;
+        if (_channel == 0)
+            _channel = 6;
+        fire(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    }
+
+    /**
+     * @brief Simulates the station losing the connection to the access point.
+     */
+    void simulateDisconnected()
+    {
+        _status = WL_DISCONNECTED;
+        fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    }
+
+    int beginCalls = 0;
+    bool lastBeginUsedBssid = false;
+
+private:
+    void fire(arduino_event_id_t event)
+    {
+        arduino_event_info_t info = {};
+        for (auto &c : callbacks)
+            if (c.second == 0 || c.second == event)
+                c.first(event, info);
+    }
+
+    wifi_mode_t _mode = WIFI_OFF;
+    wl_status_t _status = WL_IDLE_STATUS;
+    String _ssid;
+    int32_t _channel = 0;
+    uint8_t _bssid[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    IPAddress _localIP;
+    std::vector<std::pair<WiFiEventFuncCb, int>> callbacks;
+};
+
+extern WiFiClass WiFi;
+
+#endif
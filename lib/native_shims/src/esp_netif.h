@@ -0,0 +1,19 @@
+/**
+ * @file esp_netif.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the network interfaces of ESP-IDF. There are none, so no lease is ever found.
+ * @version 0.1
+ * @date 2022-03-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef ESP_NETIF_SHIM_H
+#define ESP_NETIF_SHIM_H
+
+typedef struct esp_netif_obj esp_netif_t;
+
+inline esp_netif_t *esp_netif_get_handle_from_ifkey(const char *key) { return nullptr; }
+
+#endif
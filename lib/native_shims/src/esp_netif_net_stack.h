@@ -0,0 +1,19 @@
+/**
+ * @file esp_netif_net_stack.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for reaching the lwIP interface of an ESP-IDF network interface.
+ * @version 0.1
+ * @date 2022-03-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef ESP_NETIF_NET_STACK_SHIM_H
+#define ESP_NETIF_NET_STACK_SHIM_H
+
+#include "esp_netif.h"
+
+inline void *esp_netif_get_netif_impl(esp_netif_t *netif) { return nullptr; }
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * @file FreeRTOS.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the FreeRTOS task and queue primitives used by the firmware, backed by std::thread.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef FREERTOS_SHIM_H
+#define FREERTOS_SHIM_H
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7fffffff
+#define configMAX_PRIORITIES 25
+
+/**
+ * @brief A task is a detached host thread plus the state needed for direct-to-task notifications.
+ */
+struct TaskControl
+{
+    const char *name;
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notification = 0;
+    bool pending = false;
+};
+typedef TaskControl *TaskHandle_t;
+
+TaskControl *shimCurrentTask();
+void shimSetCurrentTask(TaskControl *task);
+
+/**
+ * @brief The tasks created, for xTaskGetHandle. Tasks are never removed, like vTaskDelete does nothing here.
+ */
+inline std::vector<TaskControl *> &shimTasks(std::unique_lock<std::mutex> &guard)
+{
+    static std::mutex lock;
+    static std::vector<TaskControl *> tasks;
+    guard = std::unique_lock<std::mutex>(lock);
+    return tasks;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t, void *arg, UBaseType_t, TaskHandle_t *handle, BaseType_t)
+{
+    TaskControl *task = new TaskControl();
+    task->name = name;
+    {
+        std::unique_lock<std::mutex> guard;
+        shimTasks(guard).push_back(task);
+    }
+    if (handle)
+        *handle = task;
+    std::thread([fn, arg, task]()
+                { shimSetCurrentTask(task); fn(arg); })
+        .detach();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, tskNO_AFFINITY);
+}
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline TickType_t xTaskGetTickCount()
+{
+    using namespace std::chrono;
+    static const auto start = steady_clock::now();
+    return (TickType_t)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return shimCurrentTask(); }
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
+
+inline TaskHandle_t xTaskGetHandle(const char *name)
+{
+    std::unique_lock<std::mutex> guard;
+    for (TaskControl *task : shimTasks(guard))
+        if (strcmp(task->name, name) == 0)
+            return task;
+    return NULL;
+}
+
+inline const char *pcTaskGetName(TaskHandle_t task) { return task ? task->name : "main"; }
+
+inline BaseType_t xPortGetCoreID() { return 1; }
+
+inline BaseType_t xTaskNotify(TaskHandle_t task, uint32_t bits, int)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notification |= bits;
+        task->pending = true;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) { return xTaskNotify(task, 0, 0); }
+
+inline BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t bits, int action, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xTaskNotify(task, bits, action);
+}
+
+inline BaseType_t xTaskNotifyWait(uint32_t, uint32_t clearOnExit, uint32_t *value, TickType_t ticks)
+{
+    TaskControl *task = shimCurrentTask();
+    std::unique_lock<std::mutex> guard(task->lock);
+    auto ready = [task]()
+    { return task->pending; };
+    if (ticks == portMAX_DELAY)
+        task->cv.wait(guard, ready);
+    else if (!task->cv.wait_for(guard, std::chrono::milliseconds(ticks), ready))
+        return pdFALSE;
+    if (value)
+        *value = task->notification;
+    task->notification &= ~clearOnExit;
+    task->pending = false;
+    return pdTRUE;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t ticks)
+{
+    uint32_t value = 0;
+    return xTaskNotifyWait(0, 0xffffffff, &value, ticks) == pdTRUE ? 1 : 0;
+}
+
+#define eSetBits 1
+#define eNoAction 0
+
+#define portYIELD_FROM_ISR(x) (void)(x)
+#define portENTER_CRITICAL(mux) (mux)->lock()
+#define portEXIT_CRITICAL(mux) (mux)->unlock()
+#define portENTER_CRITICAL_ISR(mux) (mux)->lock()
+#define portEXIT_CRITICAL_ISR(mux) (mux)->unlock()
+typedef std::mutex portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED \
+    {                                \
+    }
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file queue.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for FreeRTOS queues.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef FREERTOS_QUEUE_SHIM_H
+#define FREERTOS_QUEUE_SHIM_H
+
+#include "FreeRTOS.h"
+#include <string.h>
+
+struct QueueControl
+{
+    size_t itemSize;
+    size_t capacity;
+    std::deque<std::vector<uint8_t>> items;
+    std::mutex lock;
+    std::condition_variable cv;
+};
+typedef QueueControl *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    QueueControl *q = new QueueControl();
+    q->itemSize = itemSize;
+    q->capacity = length;
+    return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t)
+{
+    {
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (q->items.size() >= q->capacity)
+            return pdFAIL;
+        const uint8_t *bytes = (const uint8_t *)item;
+        q->items.emplace_back(bytes, bytes + q->itemSize);
+    }
+    q->cv.notify_one();
+    return pdPASS;
+}
+
+inline BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t)
+{
+    {
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (q->items.size() >= q->capacity)
+            return pdFAIL;
+        const uint8_t *bytes = (const uint8_t *)item;
+        q->items.emplace_front(bytes, bytes + q->itemSize);
+    }
+    q->cv.notify_one();
+    return pdPASS;
+}
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xQueueSend(q, item, 0);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> guard(q->lock);
+    auto ready = [q]()
+    { return !q->items.empty(); };
+    if (ticks == portMAX_DELAY)
+        q->cv.wait(guard, ready);
+    else if (!q->cv.wait_for(guard, std::chrono::milliseconds(ticks), ready))
+        return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    return pdTRUE;
+}
+
+inline BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> guard(q->lock);
+    auto ready = [q]()
+    { return !q->items.empty(); };
+    if (ticks == portMAX_DELAY)
+        q->cv.wait(guard, ready);
+    else if (!q->cv.wait_for(guard, std::chrono::milliseconds(ticks), ready))
+        return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> guard(q->lock);
+    return q->items.size();
+}
+
+#endif
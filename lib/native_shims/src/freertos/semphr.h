@@ -0,0 +1,66 @@
+/**
+ * @file semphr.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for FreeRTOS mutexes and recursive mutexes.
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef FREERTOS_SEMPHR_SHIM_H
+#define FREERTOS_SEMPHR_SHIM_H
+
+#include "FreeRTOS.h"
+
+struct SemaphoreControl
+{
+    std::timed_mutex lock;
+    std::recursive_timed_mutex recursive;
+};
+typedef SemaphoreControl *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new SemaphoreControl();
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        semaphore->lock.lock();
+        return pdTRUE;
+    }
+    return semaphore->lock.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    semaphore->lock.unlock();
+    return pdTRUE;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+    return new SemaphoreControl();
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        semaphore->recursive.lock();
+        return pdTRUE;
+    }
+    return semaphore->recursive.try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore)
+{
+    semaphore->recursive.unlock();
+    return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * @file task.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the FreeRTOS task API, which is declared with the kernel stand-in.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef FREERTOS_TASK_SHIM_H
+#define FREERTOS_TASK_SHIM_H
+
+#include "FreeRTOS.h"
+
+#endif
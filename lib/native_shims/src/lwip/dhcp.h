@@ -0,0 +1,32 @@
+/**
+ * @file dhcp.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the DHCP client of lwIP, with the fields read by the firmware.
+ * @version 0.1
+ * @date 2022-03-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef LWIP_DHCP_SHIM_H
+#define LWIP_DHCP_SHIM_H
+
+#include <stdint.h>
+
+#define DHCP_STATE_BOUND 10
+
+struct dhcp
+{
+    uint8_t state;
+    uint32_t offered_t0_lease;
+};
+
+struct netif
+{
+    struct dhcp *dhcp;
+};
+
+#define netif_dhcp_data(netif) ((netif)->dhcp)
+
+#endif
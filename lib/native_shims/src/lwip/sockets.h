@@ -0,0 +1,20 @@
+/**
+ * @file sockets.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the lwIP BSD sockets, which are the POSIX ones.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef LWIP_SOCKETS_SHIM_H
+#define LWIP_SOCKETS_SHIM_H
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#endif
@@ -0,0 +1,46 @@
+/**
+ * @file md.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the mbedtls message digest API. Only SHA-256 is provided.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef MBEDTLS_MD_SHIM_H
+#define MBEDTLS_MD_SHIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef enum
+{
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+typedef struct
+{
+    mbedtls_md_type_t type;
+} mbedtls_md_info_t;
+
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t bitlen;
+    uint8_t data[64];
+    size_t datalen;
+} mbedtls_md_context_t;
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type);
+void mbedtls_md_init(mbedtls_md_context_t *ctx);
+int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *info, int hmac);
+int mbedtls_md_starts(mbedtls_md_context_t *ctx);
+int mbedtls_md_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t ilen);
+int mbedtls_md_finish(mbedtls_md_context_t *ctx, unsigned char *output);
+void mbedtls_md_free(mbedtls_md_context_t *ctx);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file DocumentManager.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the mx document manager. The stream is read to the end, so the storage is measured, but
+ * nothing is parsed: libmx is only built for the device.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef MX_DOCUMENTMANAGER_SHIM_H
+#define MX_DOCUMENTMANAGER_SHIM_H
+
+#include <istream>
+
+#include "ScoreData.h"
+
+namespace mx
+{
+    namespace api
+    {
+        class DocumentManager
+        {
+        public:
+            static DocumentManager &getInstance()
+            {
+                static DocumentManager manager;
+                return manager;
+            }
+
+            int createFromStream(std::istream &stream)
+            {
+                char buffer[256];
+                while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+                    bytesRead += stream.gcount();
+                return ++documents;
+            }
+
+            /**
+             * @brief Gives the data set by the test in [score].
+             */
+            ScoreData getData(int documentId) const { return score; }
+
+            void destroyDocument(int documentId) {}
+
+            ScoreData score;
+            size_t bytesRead = 0;
+
+        private:
+            int documents = 0;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * @file ScoreData.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Host stand-in for the score structure of mx, with the fields read by the firmware.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef MX_SCOREDATA_SHIM_H
+#define MX_SCOREDATA_SHIM_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mx
+{
+    namespace api
+    {
+        enum class DurationName
+        {
+            unspecified,
+            maxima,
+            longa,
+            breve,
+            whole,
+            half,
+            quarter,
+            eighth,
+            dur16th,
+            dur32nd,
+            dur64th,
+            dur128th,
+            dur256th,
+            dur512th,
+            dur1024th
+        };
+
+        enum class Step
+        {
+            c,
+            d,
+            e,
+            f,
+            g,
+            a,
+            b,
+            unspecified
+        };
+
+        struct PitchData
+        {
+            Step step = Step::c;
+            int alter = 0;
+            int octave = 4;
+        };
+
+        struct DurationData
+        {
+            DurationName durationName = DurationName::unspecified;
+            int durationDots = 0;
+            int durationTimeTicks = 0;
+        };
+
+        struct NoteData
+        {
+            bool isRest = false;
+            bool isChord = false;
+            PitchData pitchData;
+            DurationData durationData;
+            int tickTimePosition = 0;
+        };
+
+        struct VoiceData
+        {
+            std::vector<NoteData> notes;
+        };
+
+        enum class ClefSymbol
+        {
+            g,
+            f,
+            c,
+            percussion,
+            tab,
+            jianpu,
+            none,
+            unspecified
+        };
+
+        struct ClefData
+        {
+            ClefSymbol symbol = ClefSymbol::g;
+            int line = 2;
+            int octaveChange = 0;
+            int tickTimePosition = 0;
+        };
+
+        enum class TempoType
+        {
+            unspecified,
+            beatsPerMinute,
+            tempoText
+        };
+
+        struct BeatsPerMinute
+        {
+            DurationName durationName = DurationName::quarter;
+            int dots = 0;
+            int beatsPerMinute = 0;
+        };
+
+        struct TempoData
+        {
+            TempoType tempoType = TempoType::unspecified;
+            BeatsPerMinute beatsPerMinute;
+        };
+
+        struct DirectionData
+        {
+            int tickTimePosition = 0;
+            std::vector<TempoData> tempos;
+        };
+
+        struct StaffData
+        {
+            std::vector<ClefData> clefs;
+            std::map<int, VoiceData> voices;
+            std::vector<DirectionData> directions;
+        };
+
+        struct KeyData
+        {
+            int fifths = 0;
+            int tickTimePosition = 0;
+        };
+
+        struct TimeSignatureData
+        {
+            int beats = 4;
+            int beatType = 4;
+            bool isImplicit = true;
+        };
+
+        struct MeasureData
+        {
+            std::vector<StaffData> staves;
+            std::vector<KeyData> keys;
+            TimeSignatureData timeSignature;
+        };
+
+        struct PartData
+        {
+            std::string uniqueId;
+            std::string name;
+            std::vector<MeasureData> measures;
+        };
+
+        struct ScoreData
+        {
+            std::string workTitle;
+            std::string composer;
+            std::vector<PartData> parts;
+            int ticksPerQuarter = 0;
+        };
+    }
+}
+
+#endif
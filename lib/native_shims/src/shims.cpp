@@ -0,0 +1,959 @@
+/**
+ * @file shims.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Implementation of the host stand-ins for the Arduino and ESP-IDF APIs.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <mbedtls/md.h>
+#include <freertos/FreeRTOS.h>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+fs::SPIFFSFS SPIFFS("/tmp/ems-fs/partition");
+fs::LittleFSFS LittleFS("/tmp/ems-fs/partition");
+
+// Tasks
+
+static thread_local TaskControl *currentTask = nullptr;
+
+TaskControl *shimCurrentTask()
+{
+    if (!currentTask)
+    {
+        currentTask = new TaskControl();
+        currentTask->name = "main";
+    }
+    return currentTask;
+}
+
+void shimSetCurrentTask(TaskControl *task) { currentTask = task; }
+
+
+// GPIO and time
+
+#define SHIM_PINS 64
+
+static std::atomic<int> pinLevels[SHIM_PINS];
+static std::atomic<bool> pinLevelsSet[SHIM_PINS];
+static std::atomic<void (*)()> pinInterrupts[SHIM_PINS];
+
+/**
+ * @brief Held while an interrupt runs, interrupts don't preempt each other.
+ */
+static std::mutex interruptLock;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (mode == INPUT_PULLUP && !pinLevelsSet[pin].exchange(true))
+        pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+    pinLevelsSet[pin] = true;
+    int previous = pinLevels[pin].exchange(value);
+    void (*isr)() = pinInterrupts[pin];
+    if (previous != value && isr)
+    {
+        std::lock_guard<std::mutex> lock(interruptLock);
+        isr();
+    }
+}
+
+int digitalRead(uint8_t pin) { return pinLevels[pin]; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) { pinInterrupts[pin] = isr; }
+
+void detachInterrupt(uint8_t pin) { pinInterrupts[pin] = nullptr; }
+
+struct hw_timer_t
+{
+    std::mutex lock;
+    std::condition_variable changed;
+    std::thread thread;
+    double tickMicros;
+    void (*isr)() = nullptr;
+    uint64_t alarm = 0;
+    bool autoreload = false;
+    bool enabled = false;
+    bool ended = false;
+    std::chrono::steady_clock::time_point start;
+};
+
+static void timerRun(hw_timer_t *timer)
+{
+    std::unique_lock<std::mutex> lock(timer->lock);
+    while (!timer->ended)
+    {
+        if (!timer->enabled)
+        {
+            timer->changed.wait(lock);
+            continue;
+        }
+        auto due = timer->start + std::chrono::microseconds((int64_t)(timer->alarm * timer->tickMicros));
+        if (timer->changed.wait_until(lock, due) != std::cv_status::timeout)
+            continue;
+        if (timer->autoreload)
+            timer->start = due;
+        else
+            timer->enabled = false;
+        void (*isr)() = timer->isr;
+        lock.unlock();
+        if (isr)
+        {
+            std::lock_guard<std::mutex> running(interruptLock);
+            isr();
+        }
+        lock.lock();
+    }
+}
+
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp)
+{
+    hw_timer_t *timer = new hw_timer_t();
+    timer->tickMicros = divider / 80.0;
+    timer->start = std::chrono::steady_clock::now();
+    timer->thread = std::thread(timerRun, timer);
+    return timer;
+}
+
+void timerEnd(hw_timer_t *timer)
+{
+    {
+        std::lock_guard<std::mutex> lock(timer->lock);
+        timer->ended = true;
+    }
+    timer->changed.notify_all();
+    timer->thread.join();
+    delete timer;
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*isr)(), bool edge)
+{
+    std::lock_guard<std::mutex> lock(timer->lock);
+    timer->isr = isr;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm, bool autoreload)
+{
+    std::lock_guard<std::mutex> lock(timer->lock);
+    timer->alarm = alarm;
+    timer->autoreload = autoreload;
+    timer->changed.notify_all();
+}
+
+void timerAlarmEnable(hw_timer_t *timer)
+{
+    std::lock_guard<std::mutex> lock(timer->lock);
+    timer->enabled = true;
+    timer->changed.notify_all();
+}
+
+void timerAlarmDisable(hw_timer_t *timer)
+{
+    std::lock_guard<std::mutex> lock(timer->lock);
+    timer->enabled = false;
+    timer->changed.notify_all();
+}
+
+void timerWrite(hw_timer_t *timer, uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(timer->lock);
+    timer->start = std::chrono::steady_clock::now() - std::chrono::microseconds((int64_t)(value * timer->tickMicros));
+    timer->changed.notify_all();
+}
+
+uint64_t timerRead(hw_timer_t *timer)
+{
+    std::lock_guard<std::mutex> lock(timer->lock);
+    return (uint64_t)(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - timer->start).count() / timer->tickMicros);
+}
+
+uint32_t esp_random()
+{
+    static std::mutex lock;
+    static std::random_device device;
+    std::lock_guard<std::mutex> guard(lock);
+    return device();
+}
+
+bool getLocalTime(struct tm *info, uint32_t ms)
+{
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return true;
+}
+
+void configTime(long gmtOffset, int daylightOffset, const char *server1, const char *server2, const char *server3) {}
+
+
+// File system
+
+namespace fs
+{
+    struct FileImpl
+    {
+        std::string path;
+        std::string hostPath;
+        FILE *file = nullptr;
+        DIR *dir = nullptr;
+        std::string fsRoot;
+        bool fsFlat = false;
+        std::string entryName;
+    };
+
+    static std::string escapeFlat(const std::string &name)
+    {
+        std::string out;
+        for (char c : name)
+            out += c == '/' ? std::string("%2F") : std::string(1, c);
+        return out;
+    }
+
+    static std::string unescapeFlat(const std::string &name)
+    {
+        std::string out;
+        for (size_t i = 0; i < name.size(); i++)
+        {
+            if (name.compare(i, 3, "%2F") == 0)
+            {
+                out += '/';
+                i += 2;
+            }
+            else
+                out += name[i];
+        }
+        return out;
+    }
+
+    static std::string baseName(const std::string &path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    size_t File::write(const uint8_t *data, size_t len) { return impl && impl->file ? fwrite(data, 1, len, impl->file) : 0; }
+    size_t File::read(uint8_t *buf, size_t len) { return impl && impl->file ? fread(buf, 1, len, impl->file) : 0; }
+    int File::read()
+    {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    int File::available() { return impl && impl->file ? (int)(size() - position()) : 0; }
+    int File::peek()
+    {
+        if (!impl || !impl->file)
+            return -1;
+        int c = fgetc(impl->file);
+        if (c != EOF)
+            ungetc(c, impl->file);
+        return c;
+    }
+    bool File::seek(uint32_t pos, SeekMode mode) { return impl && impl->file && fseek(impl->file, pos, mode) == 0; }
+    size_t File::position() const { return impl && impl->file ? ftell(impl->file) : 0; }
+    size_t File::size() const
+    {
+        struct stat st;
+        if (!impl || stat(impl->hostPath.c_str(), &st) != 0)
+            return 0;
+        if (impl->file)
+            fflush(impl->file);
+        stat(impl->hostPath.c_str(), &st);
+        return st.st_size;
+    }
+    void File::flush()
+    {
+        if (impl && impl->file)
+            fflush(impl->file);
+    }
+    void File::close()
+    {
+        if (!impl)
+            return;
+        if (impl->file)
+            fclose(impl->file);
+        if (impl->dir)
+            closedir(impl->dir);
+        impl->file = nullptr;
+        impl->dir = nullptr;
+        impl.reset();
+    }
+    const char *File::name() const { return impl ? impl->entryName.c_str() : ""; }
+    const char *File::path() const { return impl ? impl->path.c_str() : ""; }
+    bool File::isDirectory() const { return impl && impl->dir; }
+    File File::openNextFile(const char *mode)
+    {
+        if (!impl || !impl->dir)
+            return File();
+        struct dirent *entry;
+        while ((entry = readdir(impl->dir)) != nullptr)
+        {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                continue;
+            bool flat = impl->fsFlat;
+            std::string name = flat ? unescapeFlat(entry->d_name) : std::string(entry->d_name);
+            std::string child = impl->path == "/" ? "/" + name : impl->path + "/" + name;
+            FS fs(impl->fsRoot);
+            fs.flat = flat;
+            return fs.open(child.c_str(), mode);
+        }
+        return File();
+    }
+    void File::rewindDirectory()
+    {
+        if (impl && impl->dir)
+            rewinddir(impl->dir);
+    }
+    time_t File::getLastWrite()
+    {
+        struct stat st;
+        return impl && stat(impl->hostPath.c_str(), &st) == 0 ? st.st_mtime : 0;
+    }
+    File::operator bool() const { return impl && (impl->file || impl->dir); }
+
+    std::string FS::hostPath(const char *path) const
+    {
+        std::string p = path ? path : "/";
+        if (p.empty() || p[0] != '/')
+            p = "/" + p;
+        if (flat && p.size() > 1)
+            p = "/" + escapeFlat(p.substr(1));
+        return root + p;
+    }
+
+    static void makeDirs(const std::string &dir)
+    {
+        for (size_t i = 1; i <= dir.size(); i++)
+            if (i == dir.size() || dir[i] == '/')
+                ::mkdir(dir.substr(0, i).c_str(), 0755);
+    }
+
+    void FS::setRoot(const std::string &dir)
+    {
+        root = dir;
+        makeDirs(root);
+    }
+
+    File FS::open(const char *path, const char *mode, bool create)
+    {
+        auto impl = std::make_shared<FileImpl>();
+        impl->path = path;
+        impl->hostPath = hostPath(path);
+        impl->fsRoot = root;
+        impl->fsFlat = flat;
+        impl->entryName = baseName(path);
+
+        struct stat st;
+        if (stat(impl->hostPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            impl->dir = opendir(impl->hostPath.c_str());
+            return File(impl);
+        }
+        if (mode[0] != 'r' && !flat)
+        {
+            size_t slash = impl->hostPath.find_last_of('/');
+            makeDirs(impl->hostPath.substr(0, slash));
+        }
+        const char *hostMode = mode[0] == 'w' ? "w+b" : mode[0] == 'a' ? "a+b" : strchr(mode, '+') ? "r+b" : "rb";
+        impl->file = fopen(impl->hostPath.c_str(), hostMode);
+        if (!impl->file)
+            return File();
+        return File(impl);
+    }
+
+    bool FS::exists(const char *path)
+    {
+        struct stat st;
+        return stat(hostPath(path).c_str(), &st) == 0;
+    }
+
+    bool FS::remove(const char *path) { return ::unlink(hostPath(path).c_str()) == 0; }
+
+    bool FS::rename(const char *from, const char *to) { return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0; }
+
+    bool FS::mkdir(const char *path)
+    {
+        if (flat)
+            return false;
+        makeDirs(hostPath(path));
+        return true;
+    }
+
+    bool FS::rmdir(const char *path) { return ::rmdir(hostPath(path).c_str()) == 0; }
+
+    static size_t directorySize(const std::string &dir)
+    {
+        size_t total = 0;
+        DIR *d = opendir(dir.c_str());
+        if (!d)
+            return 0;
+        struct dirent *entry;
+        while ((entry = readdir(d)) != nullptr)
+        {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                continue;
+            std::string child = dir + "/" + entry->d_name;
+            struct stat st;
+            if (stat(child.c_str(), &st) != 0)
+                continue;
+            total += S_ISDIR(st.st_mode) ? directorySize(child) : st.st_size;
+        }
+        closedir(d);
+        return total;
+    }
+
+    static std::string readMarker(const std::string &path)
+    {
+        char buffer[16] = {0};
+        FILE *file = fopen(path.c_str(), "r");
+        if (!file)
+            return "";
+        size_t len = fread(buffer, 1, sizeof(buffer) - 1, file);
+        fclose(file);
+        return std::string(buffer, len);
+    }
+
+    bool SPIFFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel)
+    {
+        // The format of the partition is kept next to the host directory
+        std::string marker = readMarker(root + ".format");
+        if (!marker.empty() && marker != kind)
+            return formatOnFail && format();
+        makeDirs(root);
+        FILE *file = fopen((root + ".format").c_str(), "w");
+        fputs(kind.c_str(), file);
+        fclose(file);
+        return true;
+    }
+
+    bool SPIFFSFS::format()
+    {
+        std::string command = "rm -rf '" + root + "'";
+        if (system(command.c_str()) != 0)
+            return false;
+        makeDirs(root);
+        FILE *file = fopen((root + ".format").c_str(), "w");
+        fputs(kind.c_str(), file);
+        fclose(file);
+        return true;
+    }
+
+    size_t SPIFFSFS::usedBytes() { return directorySize(root); }
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(fs::FS &fs, const String &path, const String &contentType, bool download)
+{
+    fs::File file = fs.open(path, "r");
+    if (!file)
+        return new AsyncWebServerResponse(404);
+    std::string body(file.size(), '\0');
+    file.read((uint8_t *)&body[0], body.size());
+    file.close();
+    AsyncWebServerResponse *response = new AsyncWebServerResponse(200, contentType, body);
+    if (download)
+        response->addHeader("Content-Disposition", "attachment");
+    return response;
+}
+
+
+// Web server
+
+std::string processTemplate(const char *content, AwsTemplateProcessor processor)
+{
+    std::string out;
+    const char *p = content;
+    while (*p)
+    {
+        if (*p == '%')
+        {
+            const char *end = strchr(p + 1, '%');
+            if (end && end > p + 1)
+            {
+                std::string name(p + 1, end - p - 1);
+                if (name.find_first_of(" \n\t;:{}") == std::string::npos)
+                {
+                    out += processor(String(name)).str();
+                    p = end + 1;
+                    continue;
+                }
+            }
+            else if (end == p + 1)
+            {
+                out += '%';
+                p += 2;
+                continue;
+            }
+        }
+        out += *p++;
+    }
+    return out;
+}
+
+
+// HTTP front end of the web server
+
+/**
+ * @brief The largest request accepted, headers and body, in bytes.
+ */
+#define SHIM_HTTP_MAX_REQUEST (4 * 1024 * 1024)
+
+struct ShimConnection
+{
+    int socket;
+    IPAddress ip;
+    std::string in;
+    std::string out;
+    size_t sent = 0;
+};
+
+static std::string urlDecode(const std::string &text)
+{
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '+')
+            out += ' ';
+        else if (text[i] == '%' && i + 2 < text.size())
+        {
+            out += (char)strtol(text.substr(i + 1, 2).c_str(), NULL, 16);
+            i += 2;
+        }
+        else
+            out += text[i];
+    }
+    return out;
+}
+
+/**
+ * @brief Adds the parameters of the url encoded [text] to [request].
+ */
+static void addParams(AsyncWebServerRequest &request, const std::string &text, bool post)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('&', start);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string pair = text.substr(start, end - start);
+        size_t equals = pair.find('=');
+        if (!pair.empty())
+            request.addParam(String(urlDecode(pair.substr(0, equals))),
+                             String(equals == std::string::npos ? std::string() : urlDecode(pair.substr(equals + 1))), post);
+        start = end + 1;
+    }
+}
+
+/**
+ * @brief Gives the value of the attribute [name] of a header such as Content-Disposition, or an empty string.
+ */
+static std::string headerAttribute(const std::string &header, const char *name)
+{
+    std::string key = std::string(name) + "=";
+    size_t pos = header.find(key);
+    if (pos == std::string::npos)
+        return std::string();
+    pos += key.size();
+    if (pos < header.size() && header[pos] == '"')
+        return header.substr(pos + 1, header.find('"', pos + 1) - pos - 1);
+    return header.substr(pos, header.find_first_of("; \r", pos) - pos);
+}
+
+/**
+ * @brief Runs the form fields of the multipart [body] through [request], and its files through the upload handlers.
+ *
+ * @return true If any file was uploaded, which already ran the request handler.
+ */
+static bool handleMultipart(AsyncWebServer &server, AsyncWebServerRequest &request, const std::string &body, const std::string &boundary)
+{
+    std::string delimiter = "--" + boundary;
+    bool uploaded = false;
+    size_t pos = body.find(delimiter);
+    while (pos != std::string::npos)
+    {
+        pos += delimiter.size();
+        if (body.compare(pos, 2, "--") == 0)
+            break;
+        size_t headersEnd = body.find("\r\n\r\n", pos);
+        if (headersEnd == std::string::npos)
+            break;
+        std::string headers = body.substr(pos, headersEnd - pos);
+        size_t dataStart = headersEnd + 4;
+        size_t next = body.find("\r\n" + delimiter, dataStart);
+        if (next == std::string::npos)
+            break;
+
+        std::string name = headerAttribute(headers, "name");
+        std::string filename = headerAttribute(headers, "filename");
+        if (filename.empty())
+            request.addParam(String(name), String(body.substr(dataStart, next - dataStart)), true);
+        else
+        {
+            server.upload(&request, String(filename), (const uint8_t *)body.data() + dataStart, next - dataStart);
+            uploaded = true;
+        }
+        pos = next + 2;
+    }
+    return uploaded;
+}
+
+static const char *statusText(int code)
+{
+    switch (code)
+    {
+    case 200:
+        return "OK";
+    case 302:
+        return "Found";
+    case 303:
+        return "See Other";
+    case 400:
+        return "Bad Request";
+    case 401:
+        return "Unauthorized";
+    case 404:
+        return "Not Found";
+    case 413:
+        return "Payload Too Large";
+    case 507:
+        return "Insufficient Storage";
+    default:
+        return code >= 500 ? "Internal Server Error" : "";
+    }
+}
+
+static void writeResponse(ShimConnection &connection, int code, const String &contentType, const std::vector<AsyncWebHeader> &headers, const std::string &body)
+{
+    char line[64];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\n", code, statusText(code));
+    connection.out = line;
+    if (contentType.length() > 0)
+        connection.out += "Content-Type: " + contentType.str() + "\r\n";
+    connection.out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    for (const AsyncWebHeader &header : headers)
+        connection.out += header.name().str() + ": " + header.value().str() + "\r\n";
+    // ESPAsyncWebServer doesn't keep connections alive
+    connection.out += "Connection: close\r\n\r\n";
+    connection.out += body;
+}
+
+/**
+ * @brief Handles the request buffered in [connection], if it's complete.
+ *
+ * @return true If the response is ready to be sent.
+ */
+static bool handleConnection(AsyncWebServer &server, ShimConnection &connection)
+{
+    if (connection.in.size() > SHIM_HTTP_MAX_REQUEST)
+    {
+        writeResponse(connection, 413, "text/plain", {}, "Request too large");
+        return true;
+    }
+    size_t headersEnd = connection.in.find("\r\n\r\n");
+    if (headersEnd == std::string::npos)
+        return false;
+
+    // Request line
+    std::string head = connection.in.substr(0, headersEnd);
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+    size_t methodEnd = requestLine.find(' ');
+    size_t targetEnd = requestLine.find(' ', methodEnd + 1);
+    std::string methodName = requestLine.substr(0, methodEnd);
+    std::string target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    WebRequestMethodComposite method = methodName == "GET" ? HTTP_GET : methodName == "POST"   ? HTTP_POST
+                                                                    : methodName == "DELETE" ? HTTP_DELETE
+                                                                    : methodName == "PUT"    ? HTTP_PUT
+                                                                                             : HTTP_ANY;
+    size_t query = target.find('?');
+    AsyncWebServerRequest request(method, String(urlDecode(target.substr(0, query))));
+    request.client()->ip = connection.ip;
+    if (query != std::string::npos)
+        addParams(request, target.substr(query + 1), false);
+
+    // Headers
+    size_t contentLength = 0;
+    std::string contentType;
+    size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+    while (pos < head.size())
+    {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string::npos)
+            end = head.size();
+        std::string header = head.substr(pos, end - pos);
+        size_t colon = header.find(':');
+        if (colon != std::string::npos)
+        {
+            std::string name = header.substr(0, colon);
+            std::string value = header.substr(header.find_first_not_of(' ', colon + 1));
+            request.addHeader(String(name), String(value));
+            if (strcasecmp(name.c_str(), "Content-Length") == 0)
+                contentLength = strtoul(value.c_str(), NULL, 10);
+            else if (strcasecmp(name.c_str(), "Content-Type") == 0)
+                contentType = value;
+        }
+        pos = end + 2;
+    }
+    if (connection.in.size() < headersEnd + 4 + contentLength)
+        return false;
+    request._contentLength = contentLength;
+
+    // Body
+    std::string body = connection.in.substr(headersEnd + 4, contentLength);
+    bool handled = false;
+    if (contentType.compare(0, 33, "application/x-www-form-urlencoded") == 0)
+        addParams(request, body, true);
+    else if (contentType.compare(0, 19, "multipart/form-data") == 0)
+        handled = handleMultipart(server, request, body, headerAttribute(contentType, "boundary"));
+    if (!handled)
+        server.handle(&request);
+
+    AsyncWebServerResponse *response = request.response();
+    if (response)
+        writeResponse(connection, response->code, response->contentType, response->headers, response->body);
+    else
+        writeResponse(connection, 500, "text/plain", {}, "No response");
+    return true;
+}
+
+/**
+ * @brief Accepts connections and serves their requests until [server] is ended.
+ */
+static void serve(AsyncWebServer *server)
+{
+    std::vector<ShimConnection> connections;
+    std::vector<pollfd> fds;
+    while (server->running.load())
+    {
+        fds.clear();
+        fds.push_back({server->listenSocket, POLLIN, 0});
+        for (ShimConnection &connection : connections)
+            fds.push_back({connection.socket, (short)(connection.out.empty() ? POLLIN : POLLOUT), 0});
+        if (poll(fds.data(), fds.size(), 50) <= 0)
+            continue;
+
+        for (size_t i = connections.size(); i > 0; i--)
+        {
+            ShimConnection &connection = connections[i - 1];
+            short events = fds[i].revents;
+            bool done = (events & (POLLERR | POLLHUP | POLLNVAL)) && !(events & POLLIN);
+            if (!done && (events & POLLIN) && connection.out.empty())
+            {
+                char buffer[4096];
+                ssize_t len = recv(connection.socket, buffer, sizeof(buffer), 0);
+                if (len <= 0)
+                    done = true;
+                else
+                {
+                    connection.in.append(buffer, len);
+                    handleConnection(*server, connection);
+                }
+            }
+            if (!done && (events & POLLOUT))
+            {
+                ssize_t len = send(connection.socket, connection.out.data() + connection.sent, connection.out.size() - connection.sent, MSG_NOSIGNAL);
+                if (len < 0)
+                    done = true;
+                else
+                    connection.sent += len;
+                done |= connection.sent == connection.out.size();
+            }
+            if (done)
+            {
+                close(connection.socket);
+                connections.erase(connections.begin() + (i - 1));
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            sockaddr_in address;
+            socklen_t length = sizeof(address);
+            int client = accept(server->listenSocket, (sockaddr *)&address, &length);
+            if (client >= 0)
+            {
+                fcntl(client, F_SETFL, O_NONBLOCK);
+                ShimConnection connection;
+                connection.socket = client;
+                connection.ip = IPAddress(address.sin_addr.s_addr);
+                connections.push_back(std::move(connection));
+            }
+        }
+    }
+    for (ShimConnection &connection : connections)
+        close(connection.socket);
+}
+
+void AsyncWebServer::begin()
+{
+    if (running.load())
+        return;
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listenSocket, (sockaddr *)&address, sizeof(address)) != 0 || listen(listenSocket, SOMAXCONN) != 0 ||
+        getsockname(listenSocket, (sockaddr *)&address, &length) != 0)
+    {
+        close(listenSocket);
+        listenSocket = -1;
+        return;
+    }
+    port = ntohs(address.sin_port);
+    fcntl(listenSocket, F_SETFL, O_NONBLOCK);
+    started = true;
+    running.store(true);
+    eventLoop = std::thread(serve, this);
+}
+
+void AsyncWebServer::end()
+{
+    started = false;
+    if (!running.exchange(false))
+        return;
+    eventLoop.join();
+    close(listenSocket);
+    listenSocket = -1;
+}
+
+
+// SHA-256
+
+static const uint32_t sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256Transform(mbedtls_md_context_t *ctx, const uint8_t *data)
+{
+    uint32_t m[64];
+    for (int i = 0; i < 16; i++)
+        m[i] = (data[i * 4] << 24) | (data[i * 4 + 1] << 16) | (data[i * 4 + 2] << 8) | data[i * 4 + 3];
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = ROTR(m[i - 15], 7) ^ ROTR(m[i - 15], 18) ^ (m[i - 15] >> 3);
+        uint32_t s1 = ROTR(m[i - 2], 17) ^ ROTR(m[i - 2], 19) ^ (m[i - 2] >> 10);
+        m[i] = m[i - 16] + s0 + m[i - 7] + s1;
+    }
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + sha256K[i] + m[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+    ctx->state[5] += f;
+    ctx->state[6] += g;
+    ctx->state[7] += h;
+}
+
+const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type)
+{
+    static const mbedtls_md_info_t sha256 = {MBEDTLS_MD_SHA256};
+    return type == MBEDTLS_MD_SHA256 ? &sha256 : nullptr;
+}
+
+void mbedtls_md_init(mbedtls_md_context_t *ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *info, int hmac) { return info ? 0 : -1; }
+
+int mbedtls_md_starts(mbedtls_md_context_t *ctx)
+{
+    static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->bitlen = 0;
+    ctx->datalen = 0;
+    return 0;
+}
+
+int mbedtls_md_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t ilen)
+{
+    for (size_t i = 0; i < ilen; i++)
+    {
+        ctx->data[ctx->datalen++] = input[i];
+        if (ctx->datalen == 64)
+        {
+            sha256Transform(ctx, ctx->data);
+            ctx->bitlen += 512;
+            ctx->datalen = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_md_finish(mbedtls_md_context_t *ctx, unsigned char *output)
+{
+    size_t i = ctx->datalen;
+    ctx->bitlen += ctx->datalen * 8;
+    ctx->data[i++] = 0x80;
+    if (i > 56)
+    {
+        while (i < 64)
+            ctx->data[i++] = 0;
+        sha256Transform(ctx, ctx->data);
+        i = 0;
+    }
+    while (i < 56)
+        ctx->data[i++] = 0;
+    for (int j = 0; j < 8; j++)
+        ctx->data[63 - j] = ctx->bitlen >> (j * 8);
+    sha256Transform(ctx, ctx->data);
+    for (int j = 0; j < 8; j++)
+        for (int k = 0; k < 4; k++)
+            output[j * 4 + k] = ctx->state[j] >> (24 - k * 8);
+    return 0;
+}
+
+void mbedtls_md_free(mbedtls_md_context_t *ctx) {}
+
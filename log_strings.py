@@ -0,0 +1,56 @@
+import json
+import os
+import re
+
+# Generates the table used by decode_logs.py for turning binary log records back into text.
+# The ids must match logFormatId() in include/log_binary.h.
+
+sources = ["./include", "./src"]
+target_json = "./log_strings.json"
+
+# The record written by the drain task when messages are dropped, see LOG_ID_DROPPED
+dropped_format = "[log] %u messages dropped"
+
+call_regex = re.compile(r'LOG[DIWE]\(\s*\w+\s*,\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+literal_regex = re.compile(r'"((?:[^"\\]|\\.)*)"')
+modules_regex = re.compile(r'logModuleNames\[LOG_MODULE_COUNT\]\s*=\s*\{([^}]*)\}')
+
+
+def unescape(literal):
+    return literal.encode("latin-1").decode("unicode_escape")
+
+
+def format_id(fmt):
+    value = 2166136261
+    for byte in fmt.encode("latin-1"):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return 1 if value == 0 else value
+
+
+formats = {"0": dropped_format}
+modules = []
+
+for source in sources:
+    for root, dirs, files in os.walk(source):
+        for file in sorted(files):
+            if not file.endswith((".h", ".cpp")):
+                continue
+            path = os.path.join(root, file)
+            with open(path, "r") as stream:
+                content = stream.read()
+
+            match = modules_regex.search(content)
+            if match:
+                modules = literal_regex.findall(match.group(1))
+
+            for call in call_regex.finditer(content):
+                fmt = "".join(unescape(l) for l in literal_regex.findall(call.group(1)))
+                key = str(format_id(fmt))
+                if key in formats and formats[key] != fmt:
+                    raise Exception(f"Log format id collision between \"{formats[key]}\" and \"{fmt}\"")
+                formats[key] = fmt
+
+with open(target_json, "w") as stream:
+    json.dump({"modules": modules, "formats": formats}, stream, indent=1)
+
+print(f"📝 Generated {len(formats)} log strings.")
@@ -5,8 +5,6 @@
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
-#include <DNSServer.h>
-#include <SPIFFS.h>
 #include <Preferences.h>
 #ifdef ENABLE_OTA
 #include <AsyncElegantOTA.h>
@@ -16,6 +14,8 @@
 #include "hash.h"
 #include "filesystem.h"
 #include "server.h"
+#include "wifi_connect.h"
+#include "control.h"
 
 // Constants files
 #include "pref_consts.h"
@@ -24,6 +24,7 @@
 
 // For logging messages into serial
 #include "logger.h"
+#include "boot.h"
 
 /**
  * @brief The NTP server for getting the current time.
@@ -42,11 +43,12 @@ struct Config
 
 // variables
 Config config;             // configuration
-bool shouldReboot = false; // schedule a reboot
 AsyncWebServer *server;    // initialise webserver
-unsigned long blockingRequestTime = 0;
-IPAddress apIP(8, 8, 4, 4); // The default android DNS
-DNSServer dnsServer;
+
+/**
+ * @brief The stack size of the task that runs the deferred boot work.
+ */
+#define BOOT_TASK_STACK_SIZE 8192
 
 /**
  * @brief Reboots the device.
@@ -55,157 +57,174 @@ DNSServer dnsServer;
  */
 void rebootESP(String message)
 {
-  warn("Rebooting ESP32: ");
-  warnln(message);
+  LOGW(LOG_MAIN, "Rebooting ESP32: %s", message.c_str());
+  // Make sure the reason reaches Serial and the log file before the drain task dies with the reboot. Waits for the
+  // drain task if it's writing meanwhile.
+  logFlush(true);
   ESP.restart();
 }
 
-void setup()
+/**
+ * @brief Starts the network services. Run by [bootTask], so it doesn't delay the critical path. The WiFi connection
+ * goes on in the background, handled by [wifiTask].
+ */
+void networkBegin()
 {
-  Serial.begin(115200);
-
-  info("Firmware: ");
-  infoln(FIRMWARE_VERSION);
+  // Update time
+  // Defaults to 3600  for Spain timezone (+1h=3600s)
+  LOGI(LOG_MAIN, "Configuring time...");
+  int daylightOffset = preferences.getInt(pref_timezone, 3600);
+  configTime(0, daylightOffset, ntpServer);
 
-  infoln("Booting ...");
+  BootPhaseTimer phase("webserver");
 
-  info("Initializing outputs...");
-  pinMode(LED_BUILTIN, OUTPUT);
-  infoln("ok");
+  // configure web server
+  LOGI(LOG_MAIN, "Configuring Webserver ...");
+  server = new AsyncWebServer(config.webserverporthttp);
+  configureWebServer(server);
 
-  info("Turning on LED_BUILTIN...");
-  digitalWrite(LED_BUILTIN, HIGH);
-  infoln("ok");
+#ifdef ENABLE_OTA
+  LOGI(LOG_MAIN, "Starting OTA...");
+  AsyncElegantOTA.begin(server, config.httpuser.c_str(), config.httppassword.c_str());
+#endif
 
-  info("Initializing preferences...");
-  preferences.begin(preferencesName, false);
-  infoln("ok");
+  // startup web server
+  LOGI(LOG_MAIN, "Starting Webserver ...");
+  server->begin();
+}
 
-  info("Mounting SPIFFS ...");
-  if (!SPIFFS.begin(true))
+/**
+ * @brief Runs the boot work that the score doesn't need: the catalog scan while the WiFi connects, and then the
+ * network services.
+ */
+void bootTask(void *parameter)
+{
   {
-    infoln("error!");
-    // if you have not used SPIFFS before on a ESP32, it will show this error.
-    // after a reboot SPIFFS will be configured and will happily work.
-    errln("ERROR: Cannot mount SPIFFS, Rebooting");
-    rebootESP("ERROR: Cannot mount SPIFFS, Rebooting");
-    return;
+    BootPhaseTimer phase("catalog");
+    if (!storageUnmigrated.empty())
+      storageMigrateRetry();
+    scoreStoreScan();
+
+    size_t total = storage->totalBytes();
+    size_t used = storage->usedBytes();
+    LOGI(LOG_MAIN, "Storage Free: %s", humanReadableSize(total - used).c_str());
+    LOGI(LOG_MAIN, "Storage Used: %s", humanReadableSize(used).c_str());
+    LOGI(LOG_MAIN, "Storage Total: %s", humanReadableSize(total).c_str());
   }
-  infoln("ok");
-
-  info("SPIFFS Free: ");
-  infoln(humanReadableSize((SPIFFS.totalBytes() - SPIFFS.usedBytes())));
-  info("SPIFFS Used: ");
-  infoln(humanReadableSize(SPIFFS.usedBytes()));
-  info("SPIFFS Total: ");
-  infoln(humanReadableSize(SPIFFS.totalBytes()));
-
-  infoln(listFiles());
-
-  infoln("Loading Configuration ...");
-  config.ssid = preferences.getString(pref_wifiSsid, WIFI_DEFAULT_SSID);
-  config.wifipassword = preferences.getString(pref_wifiPass, WIFI_DEFAULT_PASS);
-  config.httpuser = preferences.getString(pref_authUser, AUTH_DEFAULT_USER);
-  config.httppassword = preferences.getString(pref_authPass, AUTH_DEFAULT_PASS);
-  config.webserverporthttp = WEB_PORT;
-
-  info("\nConnecting to Wifi (");
-  info(config.ssid);
-  info(")");
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(config.ssid.c_str(), config.wifipassword.c_str());
-  blockingRequestTime = millis();
-  int timeout = preferences.getInt(pref_wifiTimeout, WIFI_TIMEOUT_DEFAULT);
-  while (WiFi.status() != WL_CONNECTED)
-  {
-    // If timed-out, break from while.
-    if (millis() - blockingRequestTime >= timeout)
-      break;
 
-    delay(500);
-    info(".");
-  }
-  if (WiFi.status() == WL_CONNECTED)
+  networkBegin();
+
+  bootComplete.store(true);
+  LOGI(LOG_MAIN, "Boot complete in %lu ms", millis());
+
+  LOGI(LOG_MAIN, "Turning off LED_BUILTIN...");
+  digitalWrite(LED_BUILTIN, LOW);
+
+  vTaskDelete(NULL);
+}
+
+void setup()
+{
   {
-    infoln("ok");
-
-    infoln("\nNetwork Configuration:");
-    infoln("----------------------");
-    info("         SSID: ");
-    infoln(WiFi.SSID());
-    info("  Wifi Status: ");
-    infoln(String(WiFi.status()));
-    info("Wifi Strength: ");
-    info(String(WiFi.RSSI()));
-    infoln(" dBm");
-    info("          MAC: ");
-    infoln(WiFi.macAddress());
-    info("           IP: ");
-    infoln(WiFi.localIP());
-    info("       Subnet: ");
-    infoln(WiFi.subnetMask());
-    info("      Gateway: ");
-    infoln(WiFi.gatewayIP());
-    info("        DNS 1: ");
-    infoln(WiFi.dnsIP(0));
-    info("        DNS 2: ");
-    infoln(WiFi.dnsIP(1));
-    info("        DNS 3: ");
-    infoln(WiFi.dnsIP(2));
-    infoln(String());
+    BootPhaseTimer phase("serial");
+    Serial.begin(115200);
+    loggerBegin();
   }
-  else
-  {
-    infoln("timeout!");
 
-    info("Setting up AP...");
-    WiFi.mode(WIFI_AP);
-    WiFi.softAP("ESP32-DNSServer");
-    WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
-    infoln("ok");
+  LOGI(LOG_MAIN, "Firmware: %s", FIRMWARE_VERSION);
 
-    info("Setting up DNS server...");
-    dnsServer.start(DNS_PORT, "*", apIP);
-    infoln("ok");
-  }
+  controlBegin();
 
-  // Update time
-  // Defaults to 3600  for Spain timezone (+1h=3600s)
-  info("Configuring time...");
-  int daylightOffset = preferences.getInt(pref_timezone, 3600);
-  configTime(0, daylightOffset, ntpServer);
-  infoln("ok");
+  LOGI(LOG_MAIN, "Booting ...");
 
-  // configure web server
-  info("Configuring Webserver ...");
-  server = new AsyncWebServer(config.webserverporthttp);
-  configureWebServer(server, &shouldReboot);
-  infoln("ok");
+  LOGI(LOG_MAIN, "Initializing outputs...");
+  pinMode(LED_BUILTIN, OUTPUT);
 
-#ifdef ENABLE_OTA
-  info("Starting OTA...");
-  AsyncElegantOTA.begin(server, config.httpuser.c_str(), config.httppassword.c_str());
-  infoln("ok");
-#endif
+  LOGI(LOG_MAIN, "Turning on LED_BUILTIN...");
+  digitalWrite(LED_BUILTIN, HIGH);
 
-  // startup web server
-  info("Starting Webserver ...");
-  server->begin();
-  infoln("ok");
+  {
+    BootPhaseTimer phase("preferences");
+    LOGI(LOG_MAIN, "Initializing preferences...");
+    preferences.begin(preferencesName, false);
+
+    LOGI(LOG_MAIN, "Loading Configuration ...");
+    config.ssid = preferences.getString(pref_wifiSsid, WIFI_DEFAULT_SSID);
+    config.wifipassword = preferences.getString(pref_wifiPass, WIFI_DEFAULT_PASS);
+    config.httpuser = preferences.getString(pref_authUser, AUTH_DEFAULT_USER);
+    config.httppassword = preferences.getString(pref_authPass, AUTH_DEFAULT_PASS);
+    config.webserverporthttp = WEB_PORT;
+  }
 
-  info("Turning off LED_BUILTIN...");
-  digitalWrite(LED_BUILTIN, LOW);
-  infoln("ok");
+  {
+    BootPhaseTimer phase("storage");
+    LOGI(LOG_MAIN, "Mounting storage ...");
+    if (!storageBegin())
+    {
+      LOGE(LOG_MAIN, "ERROR: Cannot mount storage, Rebooting");
+      rebootESP("ERROR: Cannot mount storage, Rebooting");
+      return;
+    }
+
+    if (!logFileBegin())
+      LOGE(LOG_MAIN, "Could not open the log file, logs will only be sent through Serial.");
+
+    scoreStoreBegin();
+    // Before the setlist, the index or the last score write them again
+    scoreStoreCleanTemps();
+  }
+  layoutBegin();
+  syncBegin();
+  renderBegin();
+  pedalBegin();
+  followBegin();
+  metronomeBegin();
+  setlistBegin();
+  scoreIndexBegin();
+
+  // The association runs in the background while the score is loaded
+  wifiOnline = syncOnline;
+  wifiBegin(config.ssid, config.wifipassword, preferences.getInt(pref_wifiTimeout, WIFI_TIMEOUT_DEFAULT));
+
+  String lastScore = preferences.getString(pref_lastScore, "");
+  if (lastScore.length() > 0)
+  {
+    BootPhaseTimer phase("score");
+    LOGI(LOG_MAIN, "Opening last score \"%s\"...", lastScore.c_str());
+    scoreOpen(lastScore);
+  }
+
+  xTaskCreate(bootTask, "boot", BOOT_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
 }
 
 void loop()
 {
-  // reboot if we've told it to reboot
-  if (shouldReboot)
-    rebootESP("Web Admin Initiated Reboot");
-
-  if (WiFi.getMode() == WIFI_AP)
-    dnsServer.processNextRequest();
+  // Sleeps until there's something to do, the rest of the work is done by the tasks
+  ControlEvent event;
+  if (!controlReceive(event, portMAX_DELAY))
+    return;
 
-  delay(10);
+  switch (event.type)
+  {
+  case CONTROL_REBOOT:
+    rebootESP(event.reason);
+    break;
+  case CONTROL_SETLIST:
+    // One score at a time, so other events are handled in between
+    if (setlistLayOutNext())
+      controlPost(CONTROL_SETLIST, "Setlist laying out");
+    break;
+  case CONTROL_INDEX:
+    if (scoreIndexNext())
+      controlPost(CONTROL_INDEX, "Indexing scores");
+    break;
+  case CONTROL_LAYOUT:
+    renderRelayOut();
+    break;
+  case CONTROL_OPEN:
+    scoreOpenAsked();
+    break;
+  default:
+    break;
+  }
 }
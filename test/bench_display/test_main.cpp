@@ -0,0 +1,308 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Compares the bytes sent to the display when only the parts that change are refreshed, against redrawing the
+ * whole display every time. Pages of a score are turned through, and a small mark is moved over a page, as when
+ * following the score. A simulated display receives the updates, and must always end up showing the page drawn.
+ * @version 0.1
+ * @date 2022-03-06
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <vector>
+
+#include <bench_score.h>
+
+#include "renderer.h"
+#include "storage_ram.h"
+
+#define BENCH_SCORE_ID "0123456789abcdef"
+#define BENCH_MEASURES 48
+
+/**
+ * @brief How many times the mark is moved over the page.
+ */
+#define BENCH_MARK_MOVES 40
+
+Layout benchLayout;
+
+/**
+ * @brief A display that keeps what it's sent, and counts the bytes.
+ */
+struct SimulatedDisplay
+{
+    std::vector<uint8_t> pixels;
+    uint32_t bytesSent = 0;
+    uint32_t fullRefreshes = 0;
+    uint32_t partialRefreshes = 0;
+
+    void send(const FrameBuffer &buffer, const Damage &damage)
+    {
+        uint16_t rowBytes = (buffer.width + 7) / 8;
+        pixels.resize((size_t)rowBytes * buffer.height);
+        for (uint8_t i = 0; i < damage.count; i++)
+        {
+            const DamageRect &rect = damage.rects[i];
+            uint16_t first = rect.x / 8, last = (rect.x + rect.width + 7) / 8;
+            for (uint16_t row = rect.y; row < rect.y + rect.height; row++)
+                memcpy(pixels.data() + row * rowBytes + first, buffer.pixels + row * buffer.stride + first, last - first);
+        }
+        bytesSent += damageBytes(damage, buffer);
+        if (damage.full)
+            fullRefreshes++;
+        else
+            partialRefreshes++;
+    }
+
+    bool shows(const FrameBuffer &buffer)
+    {
+        uint16_t rowBytes = (buffer.width + 7) / 8;
+        for (uint16_t row = 0; row < buffer.height; row++)
+            if (memcmp(pixels.data() + row * rowBytes, buffer.pixels + row * buffer.stride, rowBytes) != 0)
+                return false;
+        return true;
+    }
+};
+
+FrameBuffer newBuffer()
+{
+    uint16_t stride = (layoutGeometry.width + 31) / 32 * 4;
+    return {(uint8_t *)calloc(stride, layoutGeometry.height), layoutGeometry.width, layoutGeometry.height, stride, -1};
+}
+
+void drawPage(FrameBuffer &buffer, size_t page)
+{
+    memset(buffer.pixels, 0, buffer.stride * buffer.height);
+    TEST_ASSERT_TRUE(layoutReplay(benchLayout, page, [&](const DisplayItem &item)
+                                  { renderGlyph(buffer, item, layoutGeometry.staffSpace); }));
+    buffer.page = page;
+}
+
+/**
+ * @brief A score for two staves, with notes, chords, rests and accidentals changing from measure to measure.
+ */
+mx::api::ScoreData benchScore()
+{
+    BenchScoreOptions options;
+    options.parts = 2;
+    options.sections = {{BENCH_MEASURES}};
+    options.rhythm = BENCH_RHYTHM_MIXED;
+    options.chords = true;
+    options.accidentals = true;
+    options.rests = true;
+    options.fifths = {2, -1};
+    return benchScoreBuild(options);
+}
+
+void report(const char *name, const SimulatedDisplay &display, uint32_t updates, const FrameBuffer &buffer)
+{
+    uint32_t fullBytes = updates * damageBytes({true}, buffer);
+    char message[160];
+    snprintf(message, sizeof(message), "%s: %u updates, %u bytes sent (%u full, %u partial refreshes), %u bytes redrawing, %.1f%%",
+             name, updates, display.bytesSent, display.fullRefreshes, display.partialRefreshes, fullBytes,
+             display.bytesSent * 100.0 / fullBytes);
+    TEST_MESSAGE(message);
+}
+
+void test_unchanged()
+{
+    FrameBuffer a = newBuffer(), b = newBuffer();
+    drawPage(a, 0);
+    drawPage(b, 0);
+    DamageTracker tracker;
+    Damage damage;
+    TEST_ASSERT_TRUE(tracker.plan(NULL, a, damage));
+    TEST_ASSERT_TRUE(damage.full);
+    TEST_ASSERT_FALSE(tracker.plan(&a, b, damage));
+    free(a.pixels);
+    free(b.pixels);
+}
+
+/**
+ * @brief Turns forward through every page and back, as [renderShow] would.
+ */
+void test_pageTurns()
+{
+    TEST_ASSERT_TRUE(benchLayout.pages.size() >= 3);
+    FrameBuffer buffers[2] = {newBuffer(), newBuffer()};
+    std::vector<size_t> turns;
+    for (size_t page = 0; page < benchLayout.pages.size(); page++)
+        turns.push_back(page);
+    for (size_t page = benchLayout.pages.size() - 1; page-- > 0;)
+        turns.push_back(page);
+
+    DamageTracker tracker;
+    SimulatedDisplay display;
+    const FrameBuffer *shown = NULL;
+    for (size_t i = 0; i < turns.size(); i++)
+    {
+        FrameBuffer &next = buffers[i % 2];
+        drawPage(next, turns[i]);
+        Damage damage;
+        if (tracker.plan(shown, next, damage))
+            display.send(next, damage);
+        TEST_ASSERT_TRUE(display.shows(next));
+        shown = &next;
+    }
+    report("page turns", display, turns.size(), buffers[0]);
+    TEST_ASSERT_TRUE(display.bytesSent <= turns.size() * damageBytes({true}, buffers[0]));
+    // Never more partial refreshes in a row than allowed
+    TEST_ASSERT_TRUE(display.fullRefreshes >= turns.size() / (DAMAGE_FULL_REFRESH_INTERVAL + 1));
+    free(buffers[0].pixels);
+    free(buffers[1].pixels);
+}
+
+/**
+ * @brief Moves a mark over the notes of the first page, which changes a small part of the display every time.
+ */
+void test_mark()
+{
+    FrameBuffer buffers[2] = {newBuffer(), newBuffer()};
+    DamageTracker tracker;
+    SimulatedDisplay display;
+    const FrameBuffer *shown = NULL;
+    uint32_t updates = 0;
+    for (int move = 0; move <= BENCH_MARK_MOVES; move++)
+    {
+        FrameBuffer &next = buffers[move % 2];
+        drawPage(next, 0);
+        int x = 120 + (move * 37) % (layoutGeometry.width - 200);
+        int y = 8 * layoutGeometry.staffSpace + (move / 10) * 11 * layoutGeometry.staffSpace;
+        renderFillRect(next, x, y, 3, 4 * layoutGeometry.staffSpace);
+        Damage damage;
+        if (tracker.plan(shown, next, damage))
+        {
+            display.send(next, damage);
+            TEST_ASSERT_TRUE(damage.count <= DAMAGE_MAX_RECTS);
+        }
+        TEST_ASSERT_TRUE(display.shows(next));
+        shown = &next;
+        updates++;
+    }
+    report("moving mark", display, updates, buffers[0]);
+    // The full refreshes are most of what's sent
+    uint32_t fullBytes = damageBytes({true}, buffers[0]);
+    TEST_ASSERT_TRUE(display.bytesSent < (display.fullRefreshes + 1) * fullBytes);
+    TEST_ASSERT_TRUE(display.bytesSent * 4 < updates * fullBytes);
+    free(buffers[0].pixels);
+    free(buffers[1].pixels);
+}
+
+/**
+ * @brief Scatters more changes than rectangles fit, so they have to be merged, and checks they're still covered.
+ */
+void test_scattered()
+{
+    FrameBuffer shown = newBuffer(), next = newBuffer();
+    uint32_t seed = 12345;
+    SimulatedDisplay display;
+    Damage damage;
+    DamageTracker tracker;
+    tracker.plan(NULL, shown, damage);
+    display.send(shown, damage);
+    for (int round = 0; round < 50; round++)
+    {
+        memcpy(next.pixels, shown.pixels, shown.stride * shown.height);
+        for (int i = 0; i < 30; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            renderFillRect(next, (seed >> 8) % next.width, (seed >> 20) % next.height, 2, 2);
+        }
+        tracker.partials = 0;
+        if (tracker.plan(&shown, next, damage))
+            display.send(next, damage);
+        TEST_ASSERT_TRUE(damage.count <= DAMAGE_MAX_RECTS);
+        TEST_ASSERT_TRUE(display.shows(next));
+        std::swap(shown, next);
+    }
+    free(shown.pixels);
+    free(next.pixels);
+}
+
+/**
+ * @brief Measures whose drawing depends on the measures before, or on the ticks of a quarter, must not keep their
+ * hash when those change, or pages laid out before would be reused.
+ */
+void test_measureHash()
+{
+    mx::api::ScoreData score = benchScore();
+    // Stated again, so it's drawn only after a change
+    for (mx::api::PartData &part : score.parts)
+        part.measures[11].timeSignature.isImplicit = false;
+    std::vector<int> partStaves = layoutPartStaves(score);
+    std::vector<LayoutMeasure> before = layoutMeasures(score, partStaves, 0);
+    TEST_ASSERT_FALSE(before[11].timeChange);
+
+    for (mx::api::PartData &part : score.parts)
+    {
+        part.measures[10].timeSignature.beats = 3;
+        part.measures[10].timeSignature.isImplicit = false;
+    }
+    std::vector<LayoutMeasure> after = layoutMeasures(score, partStaves, 0);
+    TEST_ASSERT_TRUE(after[11].timeChange);
+    TEST_ASSERT_NOT_EQUAL(before[11].hash, after[11].hash);
+
+    score.ticksPerQuarter *= 2;
+    std::vector<LayoutMeasure> ticks = layoutMeasures(score, partStaves, 0);
+    TEST_ASSERT_NOT_EQUAL(after[0].hash, ticks[0].hash);
+}
+
+/**
+ * @brief Overwrites the cache file [kind] of the score with [header], so its counts don't match its size.
+ */
+void damageCache(const String &kind, const uint32_t *header, size_t len)
+{
+    std::unique_ptr<StorageFile> file = scoreCacheOpen(BENCH_SCORE_ID, kind.c_str(), "w");
+    TEST_ASSERT_NOT_NULL(file.get());
+    TEST_ASSERT_EQUAL(len, file->write((const uint8_t *)header, len));
+}
+
+void test_damagedCache()
+{
+    uint32_t geometryKey = layoutGeometryKey(layoutGeometry);
+    Layout layout;
+    TEST_ASSERT_TRUE(layoutLoad(BENCH_SCORE_ID, layoutGeometry, layout));
+
+    uint32_t timeline[] = {TIMELINE_MAGIC, geometryKey, 1, 0x40000000, 0, 0};
+    damageCache(layoutCacheKind('t', geometryKey), timeline, sizeof(timeline));
+    TEST_ASSERT_FALSE(layoutLoad(BENCH_SCORE_ID, layoutGeometry, layout));
+
+    uint32_t index[] = {LAYOUT_INDEX_MAGIC, geometryKey, 0xFFFFFFFF};
+    damageCache(layoutCacheKind('i', geometryKey), index, sizeof(index));
+    TEST_ASSERT_FALSE(layoutLoad(BENCH_SCORE_ID, layoutGeometry, layout));
+
+    // Laid out again
+    TEST_ASSERT_TRUE(layoutBuild(BENCH_SCORE_ID, benchScore(), layoutGeometry, layout));
+    TEST_ASSERT_TRUE(layoutLoad(BENCH_SCORE_ID, layoutGeometry, layout));
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unchanged);
+    RUN_TEST(test_pageTurns);
+    RUN_TEST(test_mark);
+    RUN_TEST(test_scattered);
+    RUN_TEST(test_measureHash);
+    RUN_TEST(test_damagedCache);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    Serial.muted = true;
+    static RamStorage ram(8 * 1024 * 1024);
+    storage = &ram;
+    ram.mkdir(STORAGE_DIR_SCORES);
+    ram.mkdir(STORAGE_DIR_CACHE);
+    if (!layoutBuild(BENCH_SCORE_ID, benchScore(), layoutGeometry, benchLayout))
+        return 1;
+    return runTests();
+}
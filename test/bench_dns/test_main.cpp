@@ -0,0 +1,166 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Checks the answers of the captive DNS server, which parses UDP messages from anyone joining the access
+ * point: queries for an address are answered with the one of the access point, other questions with no answers, and
+ * anything malformed or not a query is ignored. Measures the time to answer a query.
+ * @version 0.1
+ * @date 2022-03-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+#include <benchmark.h>
+
+#include <vector>
+
+#include "captive_dns.h"
+
+/**
+ * @brief Builds a query with the id 0x1234, the recursion desired bit, and a single question for [name] of [type].
+ */
+std::vector<uint8_t> benchQuery(const char *name, uint16_t type)
+{
+    std::vector<uint8_t> query = {0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0};
+    while (*name)
+    {
+        const char *dot = strchr(name, '.');
+        size_t len = dot ? dot - name : strlen(name);
+        query.push_back(len);
+        query.insert(query.end(), name, name + len);
+        name += dot ? len + 1 : len;
+    }
+    query.push_back(0);
+    query.insert(query.end(), {(uint8_t)(type >> 8), (uint8_t)type, 0, DNS_CLASS_IN});
+    return query;
+}
+
+/**
+ * @brief Answers [query] in a buffer of DNS_MESSAGE_SIZE, as the server does, giving the answer in [answer].
+ */
+size_t benchAnswer(const std::vector<uint8_t> &query, std::vector<uint8_t> &answer)
+{
+    answer = query;
+    answer.resize(DNS_MESSAGE_SIZE);
+    size_t len = captiveDnsAnswer(answer.data(), query.size());
+    answer.resize(len);
+    return len;
+}
+
+void test_answerA()
+{
+    std::vector<uint8_t> query = benchQuery("connectivitycheck.gstatic.com", DNS_TYPE_A), answer;
+    TEST_ASSERT_EQUAL(query.size() + 16, benchAnswer(query, answer));
+    // Same id, a response keeping the recursion desired bit, one question and one answer
+    const uint8_t header[] = {0x12, 0x34, 0x85, 0x80, 0, 1, 0, 1, 0, 0, 0, 0};
+    TEST_ASSERT_EQUAL(0, memcmp(header, answer.data(), sizeof(header)));
+    TEST_ASSERT_EQUAL(0, memcmp(query.data() + DNS_HEADER_SIZE, answer.data() + DNS_HEADER_SIZE, query.size() - DNS_HEADER_SIZE));
+    const uint8_t record[] = {0xC0, DNS_HEADER_SIZE, 0, DNS_TYPE_A, 0, DNS_CLASS_IN, 0, 0, 0, DNS_TTL, 0, 4, 8, 8, 4, 4};
+    TEST_ASSERT_EQUAL(0, memcmp(record, answer.data() + query.size(), sizeof(record)));
+}
+
+void test_answerOtherTypes()
+{
+    std::vector<uint8_t> answer;
+    // AAAA, answered with no addresses
+    std::vector<uint8_t> query = benchQuery("example.com", 28);
+    TEST_ASSERT_EQUAL(query.size(), benchAnswer(query, answer));
+    TEST_ASSERT_EQUAL(0x85, answer[2]);
+    TEST_ASSERT_EQUAL(0, answer[7]);
+
+    query = benchQuery("example.com", DNS_TYPE_ANY);
+    TEST_ASSERT_EQUAL(query.size() + 16, benchAnswer(query, answer));
+}
+
+void test_ignored()
+{
+    std::vector<uint8_t> answer;
+    std::vector<uint8_t> query = benchQuery("example.com", DNS_TYPE_A);
+
+    // Shorter than the header
+    TEST_ASSERT_EQUAL(0, benchAnswer(std::vector<uint8_t>(query.begin(), query.begin() + DNS_HEADER_SIZE - 1), answer));
+    // Cut in the name, and in the type and class
+    TEST_ASSERT_EQUAL(0, benchAnswer(std::vector<uint8_t>(query.begin(), query.begin() + DNS_HEADER_SIZE + 4), answer));
+    TEST_ASSERT_EQUAL(0, benchAnswer(std::vector<uint8_t>(query.end() - 2, query.end()), answer));
+    TEST_ASSERT_EQUAL(0, benchAnswer(std::vector<uint8_t>(query.begin(), query.end() - 1), answer));
+
+    // A label longer than the message
+    std::vector<uint8_t> longLabel = query;
+    longLabel[DNS_HEADER_SIZE] = 63;
+    TEST_ASSERT_EQUAL(0, benchAnswer(longLabel, answer));
+
+    // A compression pointer in the question
+    std::vector<uint8_t> pointer = query;
+    pointer[DNS_HEADER_SIZE] = 0xC0;
+    TEST_ASSERT_EQUAL(0, benchAnswer(pointer, answer));
+
+    // Responses, other opcodes and more than one question
+    std::vector<uint8_t> response = query;
+    response[2] |= 0x80;
+    TEST_ASSERT_EQUAL(0, benchAnswer(response, answer));
+    std::vector<uint8_t> opcode = query;
+    opcode[2] |= 0x10;
+    TEST_ASSERT_EQUAL(0, benchAnswer(opcode, answer));
+    std::vector<uint8_t> questions = query;
+    questions[5] = 2;
+    TEST_ASSERT_EQUAL(0, benchAnswer(questions, answer));
+}
+
+/**
+ * @brief The answer never goes over the buffer, even for the longest name a query can carry.
+ */
+void test_longestName()
+{
+    std::vector<uint8_t> query = {0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0};
+    while (query.size() + 64 + 5 <= DNS_MESSAGE_SIZE)
+    {
+        query.push_back(63);
+        query.insert(query.end(), 63, 'a');
+    }
+    query.push_back(0);
+    query.insert(query.end(), {0, DNS_TYPE_A, 0, DNS_CLASS_IN});
+    std::vector<uint8_t> answer;
+    size_t len = benchAnswer(query, answer);
+    TEST_ASSERT_TRUE(len <= DNS_MESSAGE_SIZE);
+    TEST_ASSERT_EQUAL(query.size() + 16 <= DNS_MESSAGE_SIZE ? query.size() + 16 : query.size(), len);
+}
+
+void BM_captiveDnsAnswer(BenchmarkState &state)
+{
+    std::vector<uint8_t> query = benchQuery("connectivitycheck.gstatic.com", DNS_TYPE_A);
+    uint8_t message[DNS_MESSAGE_SIZE];
+    while (state.keepRunning())
+    {
+        memcpy(message, query.data(), query.size());
+        captiveDnsAnswer(message, query.size());
+    }
+}
+BENCHMARK(BM_captiveDnsAnswer)
+
+void test_benchmarks()
+{
+    benchmarkRunAll();
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_answerA);
+    RUN_TEST(test_answerOtherTypes);
+    RUN_TEST(test_ignored);
+    RUN_TEST(test_longestName);
+    RUN_TEST(test_benchmarks);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    Serial.muted = true;
+    captiveDnsAddress = (uint32_t)IPAddress(8, 8, 4, 4);
+    return runTests();
+}
@@ -0,0 +1,367 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Measures the time the score follower takes for every frame of audio, and how close it follows pieces played
+ * with changes of tempo. The pieces are synthesized from their scores, with harmonics and noise, and read back from
+ * WAV files. Set BENCH_FOLLOW_PIECE to a directory with score.musicxml, performance.wav and alignment.txt, with lines
+ * of "<seconds> <quarters from the start>", for following a recording too.
+ * @version 0.1
+ * @date 2022-03-09
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <bench_score.h>
+#include <bench_setup.h>
+
+#include "audio_wav.h"
+#include "follow.h"
+#include "renderer.h"
+
+#define BENCH_SCORE_ID "0123456789abcdef"
+#define BENCH_MEASURES 64
+#define BENCH_WAV_PATH "/bench.wav"
+
+/**
+ * @brief The most a page may be turned away from [followTurnBeats] beats before its end, in beats.
+ */
+#define BENCH_MAX_TURN_ERROR 1.0f
+
+/**
+ * @brief The tempo of a piece at [quarters] from its start, in quarters per minute.
+ */
+typedef float (*BenchTempo)(float quarters);
+
+float steadyTempo(float quarters) { return 96; }
+
+/**
+ * @brief Speeds up and slows down by a third every 6 measures, and stops for a while every 16.
+ */
+float rubatoTempo(float quarters)
+{
+    float tempo = 96 * (1 + 0.33f * sinf(2 * M_PI * quarters / 24));
+    if (fmodf(quarters, 64) > 62)
+        tempo *= 0.4f;
+    return tempo;
+}
+
+/**
+ * @brief The time every tick of a timeline is played at, in seconds.
+ */
+struct BenchPerformance
+{
+    std::vector<float> seconds;
+
+    float at(uint32_t tick) const { return seconds[min((size_t)tick, seconds.size() - 1)]; }
+
+    /**
+     * @brief The tick played at [time].
+     */
+    float tick(float time) const
+    {
+        size_t after = std::upper_bound(seconds.begin(), seconds.end(), time) - seconds.begin();
+        if (after == 0)
+            return 0;
+        if (after == seconds.size())
+            return seconds.size() - 1;
+        return after - 1 + (time - seconds[after - 1]) / (seconds[after] - seconds[after - 1]);
+    }
+};
+
+uint32_t benchSeed = 12345;
+
+uint32_t benchRandom()
+{
+    benchSeed = benchSeed * 1664525 + 1013904223;
+    return benchSeed >> 8;
+}
+
+/**
+ * @brief Builds a melody with [parts] - 1 parts of chords under it. Some measures end with a rest.
+ */
+mx::api::ScoreData benchScore(int parts)
+{
+    // The noise of the performance starts over with every piece
+    benchSeed = 12345;
+    BenchScoreOptions options;
+    options.parts = parts;
+    options.sections = {{BENCH_MEASURES}};
+    options.rhythm = BENCH_RHYTHM_MIXED;
+    options.chords = true;
+    options.rests = true;
+    return benchScoreBuild(options);
+}
+
+BenchPerformance benchPerform(const Timeline &timeline, BenchTempo tempo)
+{
+    BenchPerformance performance;
+    uint32_t end = timeline.pages.back().end;
+    float time = 1.0f;
+    for (uint32_t tick = 0; tick <= end; tick++)
+    {
+        performance.seconds.push_back(time);
+        time += 60.0f / tempo((float)tick / TIMELINE_TICKS_PER_QUARTER) / TIMELINE_TICKS_PER_QUARTER;
+    }
+    return performance;
+}
+
+void writeLE(StorageFile &file, uint32_t value, int bytes)
+{
+    uint8_t data[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    file.write(data, bytes);
+}
+
+/**
+ * @brief Plays the notes of [timeline] as [performance] into a WAV file at [path]. Every note has a few harmonics and
+ * fades out, and there's noise all along.
+ */
+void benchSynthesize(const Timeline &timeline, const BenchPerformance &performance, const char *path)
+{
+    size_t length = (size_t)((performance.seconds.back() + 1.5f) * FOLLOW_SAMPLE_RATE);
+    std::vector<float> mix(length, 0);
+    for (const TimelineNote &note : timeline.notes)
+    {
+        size_t start = performance.at(note.tick) * FOLLOW_SAMPLE_RATE;
+        size_t end = min(length, (size_t)(performance.at(note.tick + note.duration) * FOLLOW_SAMPLE_RATE));
+        // Slightly detached, with a short release
+        end -= (end - start) / 10;
+        float hz = 440 * powf(2, (note.pitch - 69) / 12.0f);
+        for (size_t i = start; i < end + FOLLOW_SAMPLE_RATE / 20 && i < length; i++)
+        {
+            float t = (float)(i - start) / FOLLOW_SAMPLE_RATE;
+            float envelope = min(t / 0.01f, 1.0f) * expf(-t * 1.5f);
+            if (i >= end)
+                envelope *= 1 - (float)(i - end) / (FOLLOW_SAMPLE_RATE / 20);
+            float sample = 0;
+            for (int harmonic = 1; harmonic <= 5; harmonic++)
+                sample += sinf(2 * M_PI * hz * harmonic * t) / harmonic;
+            mix[i] += 2500 * envelope * sample;
+        }
+    }
+
+    std::unique_ptr<StorageFile> file = storage->open(path, "w");
+    file->write((const uint8_t *)"RIFF", 4);
+    writeLE(*file, 36 + length * 2, 4);
+    file->write((const uint8_t *)"WAVEfmt ", 8);
+    writeLE(*file, 16, 4);
+    writeLE(*file, 1, 2);
+    writeLE(*file, 1, 2);
+    writeLE(*file, FOLLOW_SAMPLE_RATE, 4);
+    writeLE(*file, FOLLOW_SAMPLE_RATE * 2, 4);
+    writeLE(*file, 2, 2);
+    writeLE(*file, 16, 2);
+    file->write((const uint8_t *)"data", 4);
+    writeLE(*file, length * 2, 4);
+    std::vector<int16_t> samples(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        float noise = (int)(benchRandom() % 401) - 200;
+        samples[i] = (int16_t)std::min(std::max(mix[i] + noise, -32768.0f), 32767.0f);
+    }
+    file->write((const uint8_t *)samples.data(), length * 2);
+}
+
+/**
+ * @brief Follows the WAV file at [path] as [timeline], reporting the time taken per frame, and how far the position
+ * and the turns are from [performance].
+ */
+void benchFollow(const char *name, const Timeline &timeline, const BenchPerformance &performance, const char *path)
+{
+    WavAudioSource source(storage->open(path, "r"));
+    TEST_ASSERT_TRUE(source.begin());
+    TEST_ASSERT_EQUAL(FOLLOW_SAMPLE_RATE, source.sampleRate());
+
+    ScoreFollower *following = new ScoreFollower(source.sampleRate());
+    following->open(timeline);
+    int16_t hop[FOLLOW_HOP];
+    std::vector<uint32_t> times;
+    std::vector<float> errors;
+    std::vector<float> turnErrors;
+    int32_t turned = 0;
+    size_t samples = 0;
+    uint8_t beats = FOLLOW_DEFAULT_TURN_BEATS;
+    while (source.read(hop, FOLLOW_HOP) == FOLLOW_HOP)
+    {
+        samples += FOLLOW_HOP;
+        unsigned long start = micros();
+        bool aligned = following->push(hop);
+        times.push_back(micros() - start);
+        if (!aligned)
+            continue;
+
+        // The frame is mostly the last hop
+        float now = (samples - FOLLOW_HOP / 2.0f) / FOLLOW_SAMPLE_RATE;
+        float played = performance.tick(now);
+        errors.push_back(fabsf(following->tick() - played) / TIMELINE_TICKS_PER_QUARTER);
+
+        int32_t page = following->page(beats);
+        TEST_ASSERT_TRUE_MESSAGE(page <= turned + 1, "More than a page turned at once");
+        if (page > turned)
+        {
+            const TimelinePage &ended = timeline.pages[turned];
+            uint32_t due = ended.end - beats * ended.beat;
+            float beat = (performance.at(due + ended.beat) - performance.at(due));
+            turnErrors.push_back((now - performance.at(due)) / beat);
+            turned = page;
+        }
+    }
+    TEST_ASSERT_EQUAL(timeline.pages.size() - 1, turned);
+    delete following;
+
+    std::vector<float> sorted = errors;
+    std::sort(sorted.begin(), sorted.end());
+    float mean = 0;
+    for (float error : errors)
+        mean += error;
+    mean /= errors.size();
+    size_t within = std::lower_bound(sorted.begin(), sorted.end(), 1.0f) - sorted.begin();
+    float worstTurn = 0;
+    for (float error : turnErrors)
+        worstTurn = max(worstTurn, fabsf(error));
+
+    char message[300];
+    snprintf(message, sizeof(message), "%s: %u frames, %u us p50, %u us p99, %u us max per frame of %u us; "
+                                       "position %.2f beats mean, %.2f p95, %.0f%% within a beat; %u turns, worst %.2f beats off",
+             name, (unsigned)times.size(), benchPercentile(times, 50), benchPercentile(times, 99), *std::max_element(times.begin(), times.end()),
+             FOLLOW_HOP * 1000000 / FOLLOW_SAMPLE_RATE, mean, sorted[sorted.size() * 95 / 100], within * 100.0f / sorted.size(),
+             (unsigned)turnErrors.size(), worstTurn);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_TRUE(within * 100 >= sorted.size() * 90);
+    TEST_ASSERT_TRUE(worstTurn <= BENCH_MAX_TURN_ERROR);
+    // Real time with plenty of room, the device is slower
+    TEST_ASSERT_TRUE(benchPercentile(times, 99) * 10 < FOLLOW_HOP * 1000000 / FOLLOW_SAMPLE_RATE);
+}
+
+void followPiece(const char *name, int parts, BenchTempo tempo)
+{
+    Layout layout;
+    TEST_ASSERT_TRUE(layoutBuild(BENCH_SCORE_ID, benchScore(parts), layoutGeometry, layout));
+    TEST_ASSERT_TRUE(layout.pages.size() >= 3);
+    TEST_ASSERT_EQUAL(layout.pages.size(), layout.timeline.pages.size());
+    BenchPerformance performance = benchPerform(layout.timeline, tempo);
+    benchSynthesize(layout.timeline, performance, BENCH_WAV_PATH);
+    benchFollow(name, layout.timeline, performance, BENCH_WAV_PATH);
+}
+
+void test_melodySteady() { followPiece("melody, steady", 1, steadyTempo); }
+
+void test_melodyRubato() { followPiece("melody, rubato", 1, rubatoTempo); }
+
+void test_chordsRubato() { followPiece("melody and chords, rubato", 2, rubatoTempo); }
+
+/**
+ * @brief The timeline is cached with the pages, and read back when they're reused.
+ */
+void test_timelineCached()
+{
+    Layout built, loaded;
+    TEST_ASSERT_TRUE(layoutBuild(BENCH_SCORE_ID, benchScore(2), layoutGeometry, built));
+    TEST_ASSERT_TRUE(layoutLoad(BENCH_SCORE_ID, layoutGeometry, loaded));
+    TEST_ASSERT_EQUAL(built.timeline.notes.size(), loaded.timeline.notes.size());
+    TEST_ASSERT_EQUAL(built.timeline.pages.size(), loaded.timeline.pages.size());
+    TEST_ASSERT_EQUAL_MEMORY(built.timeline.notes.data(), loaded.timeline.notes.data(), built.timeline.notes.size() * sizeof(TimelineNote));
+    // 3 notes in every half of the chords, and the melody
+    TEST_ASSERT_TRUE(built.timeline.notes.size() > BENCH_MEASURES * 6);
+}
+
+/**
+ * @brief Follows a piece through [followTask], which turns the pages of the renderer.
+ */
+void test_turnsPages()
+{
+    Layout layout;
+    TEST_ASSERT_TRUE(layoutBuild(BENCH_SCORE_ID, benchScore(1), layoutGeometry, layout));
+    BenchPerformance performance = benchPerform(layout.timeline, rubatoTempo);
+    benchSynthesize(layout.timeline, performance, BENCH_WAV_PATH);
+
+    renderOpen(layout);
+    followOpen(layout);
+    followEnabled = true;
+    WavAudioSource *source = new WavAudioSource(storage->open(BENCH_WAV_PATH, "r"));
+    TEST_ASSERT_TRUE(source->begin());
+    uint32_t turns = followTurns.get();
+    TEST_ASSERT_TRUE(followStart(source));
+    while (followRunning.load())
+        delay(10);
+    delay(300);
+    TEST_ASSERT_EQUAL(layout.pages.size() - 1, renderPage.load());
+    TEST_ASSERT_EQUAL(layout.pages.size() - 1, followTurns.get() - turns);
+}
+
+bool copyIntoRam(const std::string &from, const char *to)
+{
+    std::ifstream file(from, std::ios::binary);
+    if (!file.good())
+        return false;
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string data = contents.str();
+    return storage->open(to, "w")->write((const uint8_t *)data.data(), data.size()) == data.size();
+}
+
+/**
+ * @brief Follows the recording at BENCH_FOLLOW_PIECE, if set.
+ */
+void test_recording()
+{
+    const char *piece = getenv("BENCH_FOLLOW_PIECE");
+    if (!piece)
+        TEST_IGNORE_MESSAGE("Set BENCH_FOLLOW_PIECE for following a recording");
+    std::string directory = piece;
+    TEST_ASSERT_TRUE(copyIntoRam(directory + "/score.musicxml", "/score.musicxml"));
+    TEST_ASSERT_TRUE(copyIntoRam(directory + "/performance.wav", BENCH_WAV_PATH));
+
+    mx::api::ScoreData score;
+    TEST_ASSERT_TRUE(parseScore("/score.musicxml", score));
+    Layout layout;
+    layoutBuild("fedcba9876543210", score, layoutGeometry, layout);
+
+    // The alignment is interpolated for every tick
+    std::ifstream alignment(directory + "/alignment.txt");
+    std::vector<std::pair<float, float>> points;
+    float seconds, quarters;
+    while (alignment >> seconds >> quarters)
+        points.push_back({quarters * TIMELINE_TICKS_PER_QUARTER, seconds});
+    TEST_ASSERT_TRUE(points.size() >= 2);
+    BenchPerformance performance;
+    size_t next = 1;
+    for (uint32_t tick = 0; tick <= layout.timeline.pages.back().end; tick++)
+    {
+        while (next + 1 < points.size() && points[next].first < tick)
+            next++;
+        const auto &a = points[next - 1], &b = points[next];
+        performance.seconds.push_back(a.second + (tick - a.first) * (b.second - a.second) / (b.first - a.first));
+    }
+    benchFollow(piece, layout.timeline, performance, BENCH_WAV_PATH);
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_timelineCached);
+    RUN_TEST(test_melodySteady);
+    RUN_TEST(test_melodyRubato);
+    RUN_TEST(test_chordsRubato);
+    RUN_TEST(test_turnsPages);
+    RUN_TEST(test_recording);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    benchStorageSetUp(64 * 1024 * 1024);
+    renderBegin();
+    return runTests();
+}
@@ -0,0 +1,322 @@
+/**
+ * @file glyph_atlas.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief This file was automatically generated by glyph_atlas.py from stand-in
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+static_assert(GLYPH_COUNT == 40, "enum Glyph changed, run glyph_atlas.py again");
+
+#define GLYPH_ATLAS_SIZES 2
+
+constexpr uint8_t glyphAtlasSpaces[] = {8, 11};
+
+constexpr GlyphBitmap glyphAtlasBitmaps[][GLYPH_COUNT] = {
+    {
+        {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {0, 51, 20, 8, -10, -4},
+        {51, 37, 8, 12, -4, -6}, {88, 58, 12, 16, -6, -8}, {146, 41, 16, 8, -8, -4}, {187, 63, 20, 12, -10, -6},
+        {250, 46, 8, 16, -4, -8}, {296, 37, 12, 8, -6, -4}, {333, 52, 16, 12, -8, -6}, {385, 81, 20, 16, -10, -8},
+        {466, 31, 8, 8, -4, -4}, {497, 44, 12, 12, -6, -6}, {541, 62, 16, 16, -8, -8}, {603, 51, 20, 8, -10, -4},
+        {654, 37, 8, 12, -4, -6}, {691, 58, 12, 16, -6, -8}, {749, 41, 16, 8, -8, -4}, {790, 63, 20, 12, -10, -6},
+        {853, 46, 8, 16, -4, -8}, {899, 37, 12, 8, -6, -4}, {936, 52, 16, 12, -8, -6}, {988, 81, 20, 16, -10, -8},
+        {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {1069, 62, 16, 16, -8, -8}, {1131, 51, 20, 8, -10, -4},
+        {1182, 37, 8, 12, -4, -6}, {1219, 58, 12, 16, -6, -8}, {1277, 41, 16, 8, -8, -4}, {1318, 63, 20, 12, -10, -6},
+        {1381, 46, 8, 16, -4, -8}, {1427, 37, 12, 8, -6, -4}, {1464, 52, 16, 12, -8, -6}, {1516, 81, 20, 16, -10, -8},
+        {1597, 31, 8, 8, -4, -4}, {1628, 44, 12, 12, -6, -6}, {1672, 62, 16, 16, -8, -8}, {0, 0, 0, 0, 0, 0},
+    },
+    {
+        {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {1734, 74, 27, 11, -13, -5},
+        {1808, 58, 11, 16, -5, -8}, {1866, 84, 16, 22, -8, -11}, {1950, 64, 22, 11, -11, -5}, {2014, 88, 27, 16, -13, -8},
+        {2102, 73, 11, 22, -5, -11}, {2175, 51, 16, 11, -8, -5}, {2226, 83, 22, 16, -11, -8}, {2309, 114, 27, 22, -13, -11},
+        {2423, 53, 11, 11, -5, -5}, {2476, 62, 16, 16, -8, -8}, {2538, 109, 22, 22, -11, -11}, {2647, 74, 27, 11, -13, -5},
+        {2721, 58, 11, 16, -5, -8}, {2779, 84, 16, 22, -8, -11}, {2863, 64, 22, 11, -11, -5}, {2927, 88, 27, 16, -13, -8},
+        {3015, 73, 11, 22, -5, -11}, {3088, 51, 16, 11, -8, -5}, {3139, 83, 22, 16, -11, -8}, {3222, 114, 27, 22, -13, -11},
+        {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {3336, 109, 22, 22, -11, -11}, {3445, 74, 27, 11, -13, -5},
+        {3519, 58, 11, 16, -5, -8}, {3577, 84, 16, 22, -8, -11}, {3661, 64, 22, 11, -11, -5}, {3725, 88, 27, 16, -13, -8},
+        {3813, 73, 11, 22, -5, -11}, {3886, 51, 16, 11, -8, -5}, {3937, 83, 22, 16, -11, -8}, {4020, 114, 27, 22, -13, -11},
+        {4134, 53, 11, 11, -5, -5}, {4187, 62, 16, 16, -8, -8}, {4249, 109, 22, 22, -11, -11}, {0, 0, 0, 0, 0, 0},
+    },
+};
+
+constexpr uint8_t glyphAtlasRuns[] = {
+    0x03, 0x40, 0x80, 0xb0, 0xd0, 0xf3, 0xd0, 0xb0, 0x80, 0x40, 0x04, 0x10, 0x90, 0xfd, 0x90, 0x10,
+    0x00, 0x40, 0xe0, 0xff, 0xe0, 0x40, 0xe0, 0xff, 0xf1, 0xe1, 0xff, 0xf1, 0xe0, 0x40, 0xe0, 0xff,
+    0xe0, 0x40, 0x00, 0x10, 0x90, 0xfd, 0x90, 0x10, 0x04, 0x40, 0x80, 0xb0, 0xd0, 0xf3, 0xd0, 0xb0,
+    0x80, 0x40, 0x03, 0x01, 0x80, 0xe1, 0x80, 0x02, 0x90, 0xf3, 0x90, 0x00, 0x30, 0xf5, 0x30, 0x90,
+    0xf5, 0x90, 0xd0, 0xf5, 0xd0, 0xff, 0xd0, 0xf5, 0xd0, 0x90, 0xf5, 0x90, 0x30, 0xf5, 0x30, 0x00,
+    0x90, 0xf3, 0x90, 0x02, 0x80, 0xe1, 0x80, 0x01, 0x02, 0x30, 0xa0, 0xf1, 0xa0, 0x30, 0x04, 0x50,
+    0xf5, 0x50, 0x02, 0x40, 0xf7, 0x40, 0x01, 0xe0, 0xf7, 0xe0, 0x00, 0x50, 0xf9, 0x50, 0xa0, 0xf9,
+    0xa0, 0xd0, 0xf9, 0xd0, 0xff, 0xf7, 0xd0, 0xf9, 0xd0, 0xa0, 0xf9, 0xa0, 0x50, 0xf9, 0x50, 0x00,
+    0xe0, 0xf7, 0xe0, 0x01, 0x40, 0xf7, 0x40, 0x02, 0x50, 0xf5, 0x50, 0x04, 0x30, 0xa0, 0xf1, 0xa0,
+    0x30, 0x02, 0x02, 0x40, 0x90, 0xb0, 0xf3, 0xb0, 0x90, 0x40, 0x03, 0x40, 0xd0, 0xf9, 0xd0, 0x40,
+    0x00, 0x50, 0xfd, 0x50, 0xe0, 0xfd, 0xe1, 0xfd, 0xe0, 0x50, 0xfd, 0x50, 0x00, 0x40, 0xd0, 0xf9,
+    0xd0, 0x40, 0x03, 0x40, 0x90, 0xb0, 0xf3, 0xb0, 0x90, 0x40, 0x02, 0x04, 0x50, 0x90, 0xb0, 0xf3,
+    0xb0, 0x90, 0x50, 0x07, 0x70, 0xe0, 0xf9, 0xe0, 0x70, 0x03, 0x20, 0xe0, 0xfd, 0xe0, 0x20, 0x00,
+    0x10, 0xe0, 0xff, 0xe0, 0x10, 0xa0, 0xff, 0xf1, 0xa0, 0xff, 0xff, 0xf7, 0xa0, 0xff, 0xf1, 0xa0,
+    0x10, 0xe0, 0xff, 0xe0, 0x10, 0x00, 0x20, 0xe0, 0xfd, 0xe0, 0x20, 0x03, 0x70, 0xe0, 0xf9, 0xe0,
+    0x70, 0x07, 0x50, 0x90, 0xb0, 0xf3, 0xb0, 0x90, 0x50, 0x04, 0x01, 0x50, 0xe1, 0x50, 0x02, 0x40,
+    0xf3, 0x40, 0x01, 0xd0, 0xf3, 0xd0, 0x00, 0x40, 0xf5, 0x40, 0x90, 0xf5, 0x90, 0xb0, 0xf5, 0xb0,
+    0xff, 0xff, 0xb0, 0xf5, 0xb0, 0x90, 0xf5, 0x90, 0x40, 0xf5, 0x40, 0x00, 0xd0, 0xf3, 0xd0, 0x01,
+    0x40, 0xf3, 0x40, 0x02, 0x50, 0xe1, 0x50, 0x01, 0x01, 0x30, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x30,
+    0x02, 0x90, 0xf7, 0x90, 0x00, 0x80, 0xf9, 0x80, 0xe0, 0xf9, 0xe1, 0xf9, 0xe0, 0x80, 0xf9, 0x80,
+    0x00, 0x90, 0xf7, 0x90, 0x02, 0x30, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x30, 0x01, 0x03, 0x50, 0xa0,
+    0xd0, 0xf1, 0xd0, 0xa0, 0x50, 0x05, 0x40, 0xe0, 0xf7, 0xe0, 0x40, 0x02, 0x50, 0xfb, 0x50, 0x00,
+    0x30, 0xfd, 0x30, 0xa0, 0xfd, 0xa0, 0xff, 0xff, 0xa0, 0xfd, 0xa0, 0x30, 0xfd, 0x30, 0x00, 0x50,
+    0xfb, 0x50, 0x02, 0x40, 0xe0, 0xf7, 0xe0, 0x40, 0x05, 0x50, 0xa0, 0xd0, 0xf1, 0xd0, 0xa0, 0x50,
+    0x03, 0x04, 0x10, 0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x10, 0x07, 0x10, 0x90, 0xf9, 0x90,
+    0x10, 0x04, 0x40, 0xe0, 0xfb, 0xe0, 0x40, 0x02, 0x30, 0xff, 0x30, 0x01, 0xe0, 0xff, 0xe0, 0x00,
+    0x70, 0xff, 0xf1, 0x70, 0xc0, 0xff, 0xf1, 0xc0, 0xff, 0xff, 0xf7, 0xc0, 0xff, 0xf1, 0xc0, 0x70,
+    0xff, 0xf1, 0x70, 0x00, 0xe0, 0xff, 0xe0, 0x01, 0x30, 0xff, 0x30, 0x02, 0x40, 0xe0, 0xfb, 0xe0,
+    0x40, 0x04, 0x10, 0x90, 0xf9, 0x90, 0x10, 0x07, 0x10, 0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60,
+    0x10, 0x04, 0x00, 0x20, 0xa0, 0xf1, 0xa0, 0x20, 0x00, 0x20, 0xe0, 0xf3, 0xe0, 0x20, 0xa0, 0xf5,
+    0xa0, 0xff, 0xa0, 0xf5, 0xa0, 0x20, 0xe0, 0xf3, 0xe0, 0x20, 0x00, 0x20, 0xa0, 0xf1, 0xa0, 0x20,
+    0x00, 0x02, 0x60, 0xc0, 0xf1, 0xc0, 0x60, 0x04, 0xc0, 0xf5, 0xc0, 0x02, 0xc0, 0xf7, 0xc0, 0x00,
+    0x60, 0xf9, 0x60, 0xc0, 0xf9, 0xc0, 0xff, 0xf7, 0xc0, 0xf9, 0xc0, 0x60, 0xf9, 0x60, 0x00, 0xc0,
+    0xf7, 0xc0, 0x02, 0xc0, 0xf5, 0xc0, 0x04, 0x60, 0xc0, 0xf1, 0xc0, 0x60, 0x02, 0x03, 0x20, 0x90,
+    0xd0, 0xf1, 0xd0, 0x90, 0x20, 0x06, 0x80, 0xf7, 0x80, 0x04, 0xc0, 0xf9, 0xc0, 0x02, 0x80, 0xfb,
+    0x80, 0x00, 0x20, 0xfd, 0x20, 0x90, 0xfd, 0x90, 0xd0, 0xfd, 0xd0, 0xff, 0xff, 0xd0, 0xfd, 0xd0,
+    0x90, 0xfd, 0x90, 0x20, 0xfd, 0x20, 0x00, 0x80, 0xfb, 0x80, 0x02, 0xc0, 0xf9, 0xc0, 0x04, 0x80,
+    0xf7, 0x80, 0x06, 0x20, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x20, 0x03, 0x03, 0x40, 0x80, 0xb0, 0xd0,
+    0xf3, 0xd0, 0xb0, 0x80, 0x40, 0x04, 0x10, 0x90, 0xfd, 0x90, 0x10, 0x00, 0x40, 0xe0, 0xff, 0xe0,
+    0x40, 0xe0, 0xff, 0xf1, 0xe1, 0xff, 0xf1, 0xe0, 0x40, 0xe0, 0xff, 0xe0, 0x40, 0x00, 0x10, 0x90,
+    0xfd, 0x90, 0x10, 0x04, 0x40, 0x80, 0xb0, 0xd0, 0xf3, 0xd0, 0xb0, 0x80, 0x40, 0x03, 0x01, 0x80,
+    0xe1, 0x80, 0x02, 0x90, 0xf3, 0x90, 0x00, 0x30, 0xf5, 0x30, 0x90, 0xf5, 0x90, 0xd0, 0xf5, 0xd0,
+    0xff, 0xd0, 0xf5, 0xd0, 0x90, 0xf5, 0x90, 0x30, 0xf5, 0x30, 0x00, 0x90, 0xf3, 0x90, 0x02, 0x80,
+    0xe1, 0x80, 0x01, 0x02, 0x30, 0xa0, 0xf1, 0xa0, 0x30, 0x04, 0x50, 0xf5, 0x50, 0x02, 0x40, 0xf7,
+    0x40, 0x01, 0xe0, 0xf7, 0xe0, 0x00, 0x50, 0xf9, 0x50, 0xa0, 0xf9, 0xa0, 0xd0, 0xf9, 0xd0, 0xff,
+    0xf7, 0xd0, 0xf9, 0xd0, 0xa0, 0xf9, 0xa0, 0x50, 0xf9, 0x50, 0x00, 0xe0, 0xf7, 0xe0, 0x01, 0x40,
+    0xf7, 0x40, 0x02, 0x50, 0xf5, 0x50, 0x04, 0x30, 0xa0, 0xf1, 0xa0, 0x30, 0x02, 0x02, 0x40, 0x90,
+    0xb0, 0xf3, 0xb0, 0x90, 0x40, 0x03, 0x40, 0xd0, 0xf9, 0xd0, 0x40, 0x00, 0x50, 0xfd, 0x50, 0xe0,
+    0xfd, 0xe1, 0xfd, 0xe0, 0x50, 0xfd, 0x50, 0x00, 0x40, 0xd0, 0xf9, 0xd0, 0x40, 0x03, 0x40, 0x90,
+    0xb0, 0xf3, 0xb0, 0x90, 0x40, 0x02, 0x04, 0x50, 0x90, 0xb0, 0xf3, 0xb0, 0x90, 0x50, 0x07, 0x70,
+    0xe0, 0xf9, 0xe0, 0x70, 0x03, 0x20, 0xe0, 0xfd, 0xe0, 0x20, 0x00, 0x10, 0xe0, 0xff, 0xe0, 0x10,
+    0xa0, 0xff, 0xf1, 0xa0, 0xff, 0xff, 0xf7, 0xa0, 0xff, 0xf1, 0xa0, 0x10, 0xe0, 0xff, 0xe0, 0x10,
+    0x00, 0x20, 0xe0, 0xfd, 0xe0, 0x20, 0x03, 0x70, 0xe0, 0xf9, 0xe0, 0x70, 0x07, 0x50, 0x90, 0xb0,
+    0xf3, 0xb0, 0x90, 0x50, 0x04, 0x01, 0x50, 0xe1, 0x50, 0x02, 0x40, 0xf3, 0x40, 0x01, 0xd0, 0xf3,
+    0xd0, 0x00, 0x40, 0xf5, 0x40, 0x90, 0xf5, 0x90, 0xb0, 0xf5, 0xb0, 0xff, 0xff, 0xb0, 0xf5, 0xb0,
+    0x90, 0xf5, 0x90, 0x40, 0xf5, 0x40, 0x00, 0xd0, 0xf3, 0xd0, 0x01, 0x40, 0xf3, 0x40, 0x02, 0x50,
+    0xe1, 0x50, 0x01, 0x01, 0x30, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x30, 0x02, 0x90, 0xf7, 0x90, 0x00,
+    0x80, 0xf9, 0x80, 0xe0, 0xf9, 0xe1, 0xf9, 0xe0, 0x80, 0xf9, 0x80, 0x00, 0x90, 0xf7, 0x90, 0x02,
+    0x30, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x30, 0x01, 0x03, 0x50, 0xa0, 0xd0, 0xf1, 0xd0, 0xa0, 0x50,
+    0x05, 0x40, 0xe0, 0xf7, 0xe0, 0x40, 0x02, 0x50, 0xfb, 0x50, 0x00, 0x30, 0xfd, 0x30, 0xa0, 0xfd,
+    0xa0, 0xff, 0xff, 0xa0, 0xfd, 0xa0, 0x30, 0xfd, 0x30, 0x00, 0x50, 0xfb, 0x50, 0x02, 0x40, 0xe0,
+    0xf7, 0xe0, 0x40, 0x05, 0x50, 0xa0, 0xd0, 0xf1, 0xd0, 0xa0, 0x50, 0x03, 0x04, 0x10, 0x60, 0xb0,
+    0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x10, 0x07, 0x10, 0x90, 0xf9, 0x90, 0x10, 0x04, 0x40, 0xe0, 0xfb,
+    0xe0, 0x40, 0x02, 0x30, 0xff, 0x30, 0x01, 0xe0, 0xff, 0xe0, 0x00, 0x70, 0xff, 0xf1, 0x70, 0xc0,
+    0xff, 0xf1, 0xc0, 0xff, 0xff, 0xf7, 0xc0, 0xff, 0xf1, 0xc0, 0x70, 0xff, 0xf1, 0x70, 0x00, 0xe0,
+    0xff, 0xe0, 0x01, 0x30, 0xff, 0x30, 0x02, 0x40, 0xe0, 0xfb, 0xe0, 0x40, 0x04, 0x10, 0x90, 0xf9,
+    0x90, 0x10, 0x07, 0x10, 0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x10, 0x04, 0x03, 0x20, 0x90,
+    0xd0, 0xf1, 0xd0, 0x90, 0x20, 0x06, 0x80, 0xf7, 0x80, 0x04, 0xc0, 0xf9, 0xc0, 0x02, 0x80, 0xfb,
+    0x80, 0x00, 0x20, 0xfd, 0x20, 0x90, 0xfd, 0x90, 0xd0, 0xfd, 0xd0, 0xff, 0xff, 0xd0, 0xfd, 0xd0,
+    0x90, 0xfd, 0x90, 0x20, 0xfd, 0x20, 0x00, 0x80, 0xfb, 0x80, 0x02, 0xc0, 0xf9, 0xc0, 0x04, 0x80,
+    0xf7, 0x80, 0x06, 0x20, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x20, 0x03, 0x03, 0x40, 0x80, 0xb0, 0xd0,
+    0xf3, 0xd0, 0xb0, 0x80, 0x40, 0x04, 0x10, 0x90, 0xfd, 0x90, 0x10, 0x00, 0x40, 0xe0, 0xff, 0xe0,
+    0x40, 0xe0, 0xff, 0xf1, 0xe1, 0xff, 0xf1, 0xe0, 0x40, 0xe0, 0xff, 0xe0, 0x40, 0x00, 0x10, 0x90,
+    0xfd, 0x90, 0x10, 0x04, 0x40, 0x80, 0xb0, 0xd0, 0xf3, 0xd0, 0xb0, 0x80, 0x40, 0x03, 0x01, 0x80,
+    0xe1, 0x80, 0x02, 0x90, 0xf3, 0x90, 0x00, 0x30, 0xf5, 0x30, 0x90, 0xf5, 0x90, 0xd0, 0xf5, 0xd0,
+    0xff, 0xd0, 0xf5, 0xd0, 0x90, 0xf5, 0x90, 0x30, 0xf5, 0x30, 0x00, 0x90, 0xf3, 0x90, 0x02, 0x80,
+    0xe1, 0x80, 0x01, 0x02, 0x30, 0xa0, 0xf1, 0xa0, 0x30, 0x04, 0x50, 0xf5, 0x50, 0x02, 0x40, 0xf7,
+    0x40, 0x01, 0xe0, 0xf7, 0xe0, 0x00, 0x50, 0xf9, 0x50, 0xa0, 0xf9, 0xa0, 0xd0, 0xf9, 0xd0, 0xff,
+    0xf7, 0xd0, 0xf9, 0xd0, 0xa0, 0xf9, 0xa0, 0x50, 0xf9, 0x50, 0x00, 0xe0, 0xf7, 0xe0, 0x01, 0x40,
+    0xf7, 0x40, 0x02, 0x50, 0xf5, 0x50, 0x04, 0x30, 0xa0, 0xf1, 0xa0, 0x30, 0x02, 0x02, 0x40, 0x90,
+    0xb0, 0xf3, 0xb0, 0x90, 0x40, 0x03, 0x40, 0xd0, 0xf9, 0xd0, 0x40, 0x00, 0x50, 0xfd, 0x50, 0xe0,
+    0xfd, 0xe1, 0xfd, 0xe0, 0x50, 0xfd, 0x50, 0x00, 0x40, 0xd0, 0xf9, 0xd0, 0x40, 0x03, 0x40, 0x90,
+    0xb0, 0xf3, 0xb0, 0x90, 0x40, 0x02, 0x04, 0x50, 0x90, 0xb0, 0xf3, 0xb0, 0x90, 0x50, 0x07, 0x70,
+    0xe0, 0xf9, 0xe0, 0x70, 0x03, 0x20, 0xe0, 0xfd, 0xe0, 0x20, 0x00, 0x10, 0xe0, 0xff, 0xe0, 0x10,
+    0xa0, 0xff, 0xf1, 0xa0, 0xff, 0xff, 0xf7, 0xa0, 0xff, 0xf1, 0xa0, 0x10, 0xe0, 0xff, 0xe0, 0x10,
+    0x00, 0x20, 0xe0, 0xfd, 0xe0, 0x20, 0x03, 0x70, 0xe0, 0xf9, 0xe0, 0x70, 0x07, 0x50, 0x90, 0xb0,
+    0xf3, 0xb0, 0x90, 0x50, 0x04, 0x01, 0x50, 0xe1, 0x50, 0x02, 0x40, 0xf3, 0x40, 0x01, 0xd0, 0xf3,
+    0xd0, 0x00, 0x40, 0xf5, 0x40, 0x90, 0xf5, 0x90, 0xb0, 0xf5, 0xb0, 0xff, 0xff, 0xb0, 0xf5, 0xb0,
+    0x90, 0xf5, 0x90, 0x40, 0xf5, 0x40, 0x00, 0xd0, 0xf3, 0xd0, 0x01, 0x40, 0xf3, 0x40, 0x02, 0x50,
+    0xe1, 0x50, 0x01, 0x01, 0x30, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x30, 0x02, 0x90, 0xf7, 0x90, 0x00,
+    0x80, 0xf9, 0x80, 0xe0, 0xf9, 0xe1, 0xf9, 0xe0, 0x80, 0xf9, 0x80, 0x00, 0x90, 0xf7, 0x90, 0x02,
+    0x30, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x30, 0x01, 0x03, 0x50, 0xa0, 0xd0, 0xf1, 0xd0, 0xa0, 0x50,
+    0x05, 0x40, 0xe0, 0xf7, 0xe0, 0x40, 0x02, 0x50, 0xfb, 0x50, 0x00, 0x30, 0xfd, 0x30, 0xa0, 0xfd,
+    0xa0, 0xff, 0xff, 0xa0, 0xfd, 0xa0, 0x30, 0xfd, 0x30, 0x00, 0x50, 0xfb, 0x50, 0x02, 0x40, 0xe0,
+    0xf7, 0xe0, 0x40, 0x05, 0x50, 0xa0, 0xd0, 0xf1, 0xd0, 0xa0, 0x50, 0x03, 0x04, 0x10, 0x60, 0xb0,
+    0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x10, 0x07, 0x10, 0x90, 0xf9, 0x90, 0x10, 0x04, 0x40, 0xe0, 0xfb,
+    0xe0, 0x40, 0x02, 0x30, 0xff, 0x30, 0x01, 0xe0, 0xff, 0xe0, 0x00, 0x70, 0xff, 0xf1, 0x70, 0xc0,
+    0xff, 0xf1, 0xc0, 0xff, 0xff, 0xf7, 0xc0, 0xff, 0xf1, 0xc0, 0x70, 0xff, 0xf1, 0x70, 0x00, 0xe0,
+    0xff, 0xe0, 0x01, 0x30, 0xff, 0x30, 0x02, 0x40, 0xe0, 0xfb, 0xe0, 0x40, 0x04, 0x10, 0x90, 0xf9,
+    0x90, 0x10, 0x07, 0x10, 0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x10, 0x04, 0x00, 0x20, 0xa0,
+    0xf1, 0xa0, 0x20, 0x00, 0x20, 0xe0, 0xf3, 0xe0, 0x20, 0xa0, 0xf5, 0xa0, 0xff, 0xa0, 0xf5, 0xa0,
+    0x20, 0xe0, 0xf3, 0xe0, 0x20, 0x00, 0x20, 0xa0, 0xf1, 0xa0, 0x20, 0x00, 0x02, 0x60, 0xc0, 0xf1,
+    0xc0, 0x60, 0x04, 0xc0, 0xf5, 0xc0, 0x02, 0xc0, 0xf7, 0xc0, 0x00, 0x60, 0xf9, 0x60, 0xc0, 0xf9,
+    0xc0, 0xff, 0xf7, 0xc0, 0xf9, 0xc0, 0x60, 0xf9, 0x60, 0x00, 0xc0, 0xf7, 0xc0, 0x02, 0xc0, 0xf5,
+    0xc0, 0x04, 0x60, 0xc0, 0xf1, 0xc0, 0x60, 0x02, 0x03, 0x20, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x20,
+    0x06, 0x80, 0xf7, 0x80, 0x04, 0xc0, 0xf9, 0xc0, 0x02, 0x80, 0xfb, 0x80, 0x00, 0x20, 0xfd, 0x20,
+    0x90, 0xfd, 0x90, 0xd0, 0xfd, 0xd0, 0xff, 0xff, 0xd0, 0xfd, 0xd0, 0x90, 0xfd, 0x90, 0x20, 0xfd,
+    0x20, 0x00, 0x80, 0xfb, 0x80, 0x02, 0xc0, 0xf9, 0xc0, 0x04, 0x80, 0xf7, 0x80, 0x06, 0x20, 0x90,
+    0xd0, 0xf1, 0xd0, 0x90, 0x20, 0x03, 0x05, 0x20, 0x60, 0x90, 0xb0, 0xc0, 0xf4, 0xc0, 0xb0, 0x90,
+    0x60, 0x20, 0x08, 0x20, 0x90, 0xe0, 0xfe, 0xe0, 0x90, 0x20, 0x04, 0xa0, 0xff, 0xf4, 0xa0, 0x01,
+    0x20, 0xe0, 0xff, 0xf6, 0xe0, 0x20, 0xb0, 0xff, 0xf8, 0xb0, 0xff, 0xfa, 0xb0, 0xff, 0xf8, 0xb0,
+    0x20, 0xe0, 0xff, 0xf6, 0xe0, 0x20, 0x01, 0xa0, 0xff, 0xf4, 0xa0, 0x04, 0x20, 0x90, 0xe0, 0xfe,
+    0xe0, 0x90, 0x20, 0x08, 0x20, 0x60, 0x90, 0xb0, 0xc0, 0xf4, 0xc0, 0xb0, 0x90, 0x60, 0x20, 0x05,
+    0x02, 0x70, 0xd0, 0xf0, 0xd0, 0x70, 0x04, 0x90, 0xf4, 0x90, 0x02, 0x70, 0xf6, 0x70, 0x01, 0xe0,
+    0xf6, 0xe0, 0x00, 0x60, 0xf8, 0x60, 0xb0, 0xf8, 0xb0, 0xe0, 0xf8, 0xe0, 0xff, 0xf5, 0xe0, 0xf8,
+    0xe0, 0xb0, 0xf8, 0xb0, 0x60, 0xf8, 0x60, 0x00, 0xe0, 0xf6, 0xe0, 0x01, 0x70, 0xf6, 0x70, 0x02,
+    0x90, 0xf4, 0x90, 0x04, 0x70, 0xd0, 0xf0, 0xd0, 0x70, 0x02, 0x04, 0x60, 0xc0, 0xf1, 0xc0, 0x60,
+    0x07, 0x20, 0xc0, 0xf5, 0xc0, 0x20, 0x04, 0x20, 0xe0, 0xf7, 0xe0, 0x20, 0x03, 0xc0, 0xf9, 0xc0,
+    0x02, 0x70, 0xfb, 0x70, 0x01, 0xd0, 0xfb, 0xd0, 0x00, 0x40, 0xfd, 0x40, 0x80, 0xfd, 0x80, 0xb0,
+    0xfd, 0xb0, 0xff, 0xff, 0xff, 0xff, 0xb0, 0xfd, 0xb0, 0x80, 0xfd, 0x80, 0x40, 0xfd, 0x40, 0x00,
+    0xd0, 0xfb, 0xd0, 0x01, 0x70, 0xfb, 0x70, 0x02, 0xc0, 0xf9, 0xc0, 0x03, 0x20, 0xe0, 0xf7, 0xe0,
+    0x20, 0x04, 0x20, 0xc0, 0xf5, 0xc0, 0x20, 0x07, 0x60, 0xc0, 0xf1, 0xc0, 0x60, 0x04, 0x04, 0x30,
+    0x70, 0xb0, 0xc0, 0xf3, 0xc0, 0xb0, 0x70, 0x30, 0x07, 0x70, 0xe0, 0xfb, 0xe0, 0x70, 0x03, 0x40,
+    0xe0, 0xff, 0xe0, 0x40, 0x00, 0x30, 0xff, 0xf3, 0x30, 0xc0, 0xff, 0xf3, 0xc0, 0xff, 0xf5, 0xc0,
+    0xff, 0xf3, 0xc0, 0x30, 0xff, 0xf3, 0x30, 0x00, 0x40, 0xe0, 0xff, 0xe0, 0x40, 0x03, 0x70, 0xe0,
+    0xfb, 0xe0, 0x70, 0x07, 0x30, 0x70, 0xb0, 0xc0, 0xf3, 0xc0, 0xb0, 0x70, 0x30, 0x04, 0x06, 0x20,
+    0x60, 0x90, 0xb0, 0xf4, 0xb0, 0x90, 0x60, 0x20, 0x0b, 0x60, 0xd0, 0xfc, 0xd0, 0x60, 0x07, 0x40,
+    0xe0, 0xff, 0xf0, 0xe0, 0x40, 0x04, 0x90, 0xff, 0xf4, 0x90, 0x02, 0x90, 0xff, 0xf6, 0x90, 0x00,
+    0x40, 0xff, 0xf8, 0x40, 0xa0, 0xff, 0xf8, 0xa0, 0xff, 0xff, 0xff, 0xf5, 0xa0, 0xff, 0xf8, 0xa0,
+    0x40, 0xff, 0xf8, 0x40, 0x00, 0x90, 0xff, 0xf6, 0x90, 0x02, 0x90, 0xff, 0xf4, 0x90, 0x04, 0x40,
+    0xe0, 0xff, 0xf0, 0xe0, 0x40, 0x07, 0x60, 0xd0, 0xfc, 0xd0, 0x60, 0x0b, 0x20, 0x60, 0x90, 0xb0,
+    0xf4, 0xb0, 0x90, 0x60, 0x20, 0x06, 0x02, 0x30, 0xc0, 0xf0, 0xc0, 0x30, 0x04, 0x40, 0xf4, 0x40,
+    0x03, 0xe0, 0xf4, 0xe0, 0x02, 0x70, 0xf6, 0x70, 0x01, 0xe0, 0xf6, 0xe0, 0x00, 0x30, 0xf8, 0x30,
+    0x70, 0xf8, 0x70, 0xb0, 0xf8, 0xb0, 0xc0, 0xf8, 0xc0, 0xff, 0xff, 0xfb, 0xc0, 0xf8, 0xc0, 0xb0,
+    0xf8, 0xb0, 0x70, 0xf8, 0x70, 0x30, 0xf8, 0x30, 0x00, 0xe0, 0xf6, 0xe0, 0x01, 0x70, 0xf6, 0x70,
+    0x02, 0xe0, 0xf4, 0xe0, 0x03, 0x40, 0xf4, 0x40, 0x04, 0x30, 0xc0, 0xf0, 0xc0, 0x30, 0x02, 0x03,
+    0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x05, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x02, 0x90, 0xfb,
+    0x90, 0x00, 0x70, 0xfd, 0x70, 0xd0, 0xfd, 0xd0, 0xff, 0xd0, 0xfd, 0xd0, 0x70, 0xfd, 0x70, 0x00,
+    0x90, 0xfb, 0x90, 0x02, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x05, 0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0,
+    0x60, 0x03, 0x05, 0x40, 0x80, 0xb0, 0xf3, 0xb0, 0x80, 0x40, 0x09, 0x70, 0xd0, 0xf9, 0xd0, 0x70,
+    0x05, 0x20, 0xc0, 0xfd, 0xc0, 0x20, 0x02, 0x20, 0xe0, 0xff, 0xe0, 0x20, 0x01, 0xc0, 0xff, 0xf1,
+    0xc0, 0x00, 0x60, 0xff, 0xf3, 0x60, 0xc0, 0xff, 0xf3, 0xc0, 0xff, 0xff, 0xfb, 0xc0, 0xff, 0xf3,
+    0xc0, 0x60, 0xff, 0xf3, 0x60, 0x00, 0xc0, 0xff, 0xf1, 0xc0, 0x01, 0x20, 0xe0, 0xff, 0xe0, 0x20,
+    0x02, 0x20, 0xc0, 0xfd, 0xc0, 0x20, 0x05, 0x70, 0xd0, 0xf9, 0xd0, 0x70, 0x09, 0x40, 0x80, 0xb0,
+    0xf3, 0xb0, 0x80, 0x40, 0x05, 0x07, 0x20, 0x70, 0xb0, 0xd0, 0xf2, 0xd0, 0xb0, 0x70, 0x20, 0x0d,
+    0x50, 0xd0, 0xfa, 0xd0, 0x50, 0x09, 0x20, 0xd0, 0xfe, 0xd0, 0x20, 0x06, 0x50, 0xff, 0xf2, 0x50,
+    0x04, 0x50, 0xff, 0xf4, 0x50, 0x02, 0x20, 0xff, 0xf6, 0x20, 0x01, 0xc0, 0xff, 0xf6, 0xc0, 0x00,
+    0x40, 0xff, 0xf8, 0x40, 0x90, 0xff, 0xf8, 0x90, 0xd0, 0xff, 0xf8, 0xd0, 0xff, 0xff, 0xff, 0xf5,
+    0xd0, 0xff, 0xf8, 0xd0, 0x90, 0xff, 0xf8, 0x90, 0x40, 0xff, 0xf8, 0x40, 0x00, 0xc0, 0xff, 0xf6,
+    0xc0, 0x01, 0x20, 0xff, 0xf6, 0x20, 0x02, 0x50, 0xff, 0xf4, 0x50, 0x04, 0x50, 0xff, 0xf2, 0x50,
+    0x06, 0x20, 0xd0, 0xfe, 0xd0, 0x20, 0x09, 0x50, 0xd0, 0xfa, 0xd0, 0x50, 0x0d, 0x20, 0x70, 0xb0,
+    0xd0, 0xf2, 0xd0, 0xb0, 0x70, 0x20, 0x07, 0x01, 0x10, 0x90, 0xe0, 0xf0, 0xe0, 0x90, 0x10, 0x02,
+    0x50, 0xe0, 0xf4, 0xe0, 0x50, 0x00, 0x10, 0xe0, 0xf6, 0xe0, 0x10, 0x90, 0xf8, 0x90, 0xe0, 0xf8,
+    0xe0, 0xfa, 0xe0, 0xf8, 0xe0, 0x90, 0xf8, 0x90, 0x10, 0xe0, 0xf6, 0xe0, 0x10, 0x00, 0x50, 0xe0,
+    0xf4, 0xe0, 0x50, 0x02, 0x10, 0x90, 0xe0, 0xf0, 0xe0, 0x90, 0x10, 0x01, 0x03, 0x20, 0x90, 0xd0,
+    0xf1, 0xd0, 0x90, 0x20, 0x06, 0x80, 0xf7, 0x80, 0x04, 0xc0, 0xf9, 0xc0, 0x02, 0x80, 0xfb, 0x80,
+    0x00, 0x20, 0xfd, 0x20, 0x90, 0xfd, 0x90, 0xd0, 0xfd, 0xd0, 0xff, 0xff, 0xd0, 0xfd, 0xd0, 0x90,
+    0xfd, 0x90, 0x20, 0xfd, 0x20, 0x00, 0x80, 0xfb, 0x80, 0x02, 0xc0, 0xf9, 0xc0, 0x04, 0x80, 0xf7,
+    0x80, 0x06, 0x20, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x20, 0x03, 0x06, 0x60, 0xa0, 0xe0, 0xf1, 0xe0,
+    0xa0, 0x60, 0x0b, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x07, 0x20, 0xc0, 0xfb, 0xc0, 0x20, 0x04, 0x20,
+    0xe0, 0xfd, 0xe0, 0x20, 0x03, 0xc0, 0xff, 0xc0, 0x02, 0x70, 0xff, 0xf1, 0x70, 0x01, 0xe0, 0xff,
+    0xf1, 0xe0, 0x00, 0x60, 0xff, 0xf3, 0x60, 0xa0, 0xff, 0xf3, 0xa0, 0xe0, 0xff, 0xf3, 0xe0, 0xff,
+    0xff, 0xfb, 0xe0, 0xff, 0xf3, 0xe0, 0xa0, 0xff, 0xf3, 0xa0, 0x60, 0xff, 0xf3, 0x60, 0x00, 0xe0,
+    0xff, 0xf1, 0xe0, 0x01, 0x70, 0xff, 0xf1, 0x70, 0x02, 0xc0, 0xff, 0xc0, 0x03, 0x20, 0xe0, 0xfd,
+    0xe0, 0x20, 0x04, 0x20, 0xc0, 0xfb, 0xc0, 0x20, 0x07, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x0b, 0x60,
+    0xa0, 0xe0, 0xf1, 0xe0, 0xa0, 0x60, 0x06, 0x05, 0x20, 0x60, 0x90, 0xb0, 0xc0, 0xf4, 0xc0, 0xb0,
+    0x90, 0x60, 0x20, 0x08, 0x20, 0x90, 0xe0, 0xfe, 0xe0, 0x90, 0x20, 0x04, 0xa0, 0xff, 0xf4, 0xa0,
+    0x01, 0x20, 0xe0, 0xff, 0xf6, 0xe0, 0x20, 0xb0, 0xff, 0xf8, 0xb0, 0xff, 0xfa, 0xb0, 0xff, 0xf8,
+    0xb0, 0x20, 0xe0, 0xff, 0xf6, 0xe0, 0x20, 0x01, 0xa0, 0xff, 0xf4, 0xa0, 0x04, 0x20, 0x90, 0xe0,
+    0xfe, 0xe0, 0x90, 0x20, 0x08, 0x20, 0x60, 0x90, 0xb0, 0xc0, 0xf4, 0xc0, 0xb0, 0x90, 0x60, 0x20,
+    0x05, 0x02, 0x70, 0xd0, 0xf0, 0xd0, 0x70, 0x04, 0x90, 0xf4, 0x90, 0x02, 0x70, 0xf6, 0x70, 0x01,
+    0xe0, 0xf6, 0xe0, 0x00, 0x60, 0xf8, 0x60, 0xb0, 0xf8, 0xb0, 0xe0, 0xf8, 0xe0, 0xff, 0xf5, 0xe0,
+    0xf8, 0xe0, 0xb0, 0xf8, 0xb0, 0x60, 0xf8, 0x60, 0x00, 0xe0, 0xf6, 0xe0, 0x01, 0x70, 0xf6, 0x70,
+    0x02, 0x90, 0xf4, 0x90, 0x04, 0x70, 0xd0, 0xf0, 0xd0, 0x70, 0x02, 0x04, 0x60, 0xc0, 0xf1, 0xc0,
+    0x60, 0x07, 0x20, 0xc0, 0xf5, 0xc0, 0x20, 0x04, 0x20, 0xe0, 0xf7, 0xe0, 0x20, 0x03, 0xc0, 0xf9,
+    0xc0, 0x02, 0x70, 0xfb, 0x70, 0x01, 0xd0, 0xfb, 0xd0, 0x00, 0x40, 0xfd, 0x40, 0x80, 0xfd, 0x80,
+    0xb0, 0xfd, 0xb0, 0xff, 0xff, 0xff, 0xff, 0xb0, 0xfd, 0xb0, 0x80, 0xfd, 0x80, 0x40, 0xfd, 0x40,
+    0x00, 0xd0, 0xfb, 0xd0, 0x01, 0x70, 0xfb, 0x70, 0x02, 0xc0, 0xf9, 0xc0, 0x03, 0x20, 0xe0, 0xf7,
+    0xe0, 0x20, 0x04, 0x20, 0xc0, 0xf5, 0xc0, 0x20, 0x07, 0x60, 0xc0, 0xf1, 0xc0, 0x60, 0x04, 0x04,
+    0x30, 0x70, 0xb0, 0xc0, 0xf3, 0xc0, 0xb0, 0x70, 0x30, 0x07, 0x70, 0xe0, 0xfb, 0xe0, 0x70, 0x03,
+    0x40, 0xe0, 0xff, 0xe0, 0x40, 0x00, 0x30, 0xff, 0xf3, 0x30, 0xc0, 0xff, 0xf3, 0xc0, 0xff, 0xf5,
+    0xc0, 0xff, 0xf3, 0xc0, 0x30, 0xff, 0xf3, 0x30, 0x00, 0x40, 0xe0, 0xff, 0xe0, 0x40, 0x03, 0x70,
+    0xe0, 0xfb, 0xe0, 0x70, 0x07, 0x30, 0x70, 0xb0, 0xc0, 0xf3, 0xc0, 0xb0, 0x70, 0x30, 0x04, 0x06,
+    0x20, 0x60, 0x90, 0xb0, 0xf4, 0xb0, 0x90, 0x60, 0x20, 0x0b, 0x60, 0xd0, 0xfc, 0xd0, 0x60, 0x07,
+    0x40, 0xe0, 0xff, 0xf0, 0xe0, 0x40, 0x04, 0x90, 0xff, 0xf4, 0x90, 0x02, 0x90, 0xff, 0xf6, 0x90,
+    0x00, 0x40, 0xff, 0xf8, 0x40, 0xa0, 0xff, 0xf8, 0xa0, 0xff, 0xff, 0xff, 0xf5, 0xa0, 0xff, 0xf8,
+    0xa0, 0x40, 0xff, 0xf8, 0x40, 0x00, 0x90, 0xff, 0xf6, 0x90, 0x02, 0x90, 0xff, 0xf4, 0x90, 0x04,
+    0x40, 0xe0, 0xff, 0xf0, 0xe0, 0x40, 0x07, 0x60, 0xd0, 0xfc, 0xd0, 0x60, 0x0b, 0x20, 0x60, 0x90,
+    0xb0, 0xf4, 0xb0, 0x90, 0x60, 0x20, 0x06, 0x02, 0x30, 0xc0, 0xf0, 0xc0, 0x30, 0x04, 0x40, 0xf4,
+    0x40, 0x03, 0xe0, 0xf4, 0xe0, 0x02, 0x70, 0xf6, 0x70, 0x01, 0xe0, 0xf6, 0xe0, 0x00, 0x30, 0xf8,
+    0x30, 0x70, 0xf8, 0x70, 0xb0, 0xf8, 0xb0, 0xc0, 0xf8, 0xc0, 0xff, 0xff, 0xfb, 0xc0, 0xf8, 0xc0,
+    0xb0, 0xf8, 0xb0, 0x70, 0xf8, 0x70, 0x30, 0xf8, 0x30, 0x00, 0xe0, 0xf6, 0xe0, 0x01, 0x70, 0xf6,
+    0x70, 0x02, 0xe0, 0xf4, 0xe0, 0x03, 0x40, 0xf4, 0x40, 0x04, 0x30, 0xc0, 0xf0, 0xc0, 0x30, 0x02,
+    0x03, 0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x05, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x02, 0x90,
+    0xfb, 0x90, 0x00, 0x70, 0xfd, 0x70, 0xd0, 0xfd, 0xd0, 0xff, 0xd0, 0xfd, 0xd0, 0x70, 0xfd, 0x70,
+    0x00, 0x90, 0xfb, 0x90, 0x02, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x05, 0x60, 0xb0, 0xe0, 0xf1, 0xe0,
+    0xb0, 0x60, 0x03, 0x05, 0x40, 0x80, 0xb0, 0xf3, 0xb0, 0x80, 0x40, 0x09, 0x70, 0xd0, 0xf9, 0xd0,
+    0x70, 0x05, 0x20, 0xc0, 0xfd, 0xc0, 0x20, 0x02, 0x20, 0xe0, 0xff, 0xe0, 0x20, 0x01, 0xc0, 0xff,
+    0xf1, 0xc0, 0x00, 0x60, 0xff, 0xf3, 0x60, 0xc0, 0xff, 0xf3, 0xc0, 0xff, 0xff, 0xfb, 0xc0, 0xff,
+    0xf3, 0xc0, 0x60, 0xff, 0xf3, 0x60, 0x00, 0xc0, 0xff, 0xf1, 0xc0, 0x01, 0x20, 0xe0, 0xff, 0xe0,
+    0x20, 0x02, 0x20, 0xc0, 0xfd, 0xc0, 0x20, 0x05, 0x70, 0xd0, 0xf9, 0xd0, 0x70, 0x09, 0x40, 0x80,
+    0xb0, 0xf3, 0xb0, 0x80, 0x40, 0x05, 0x07, 0x20, 0x70, 0xb0, 0xd0, 0xf2, 0xd0, 0xb0, 0x70, 0x20,
+    0x0d, 0x50, 0xd0, 0xfa, 0xd0, 0x50, 0x09, 0x20, 0xd0, 0xfe, 0xd0, 0x20, 0x06, 0x50, 0xff, 0xf2,
+    0x50, 0x04, 0x50, 0xff, 0xf4, 0x50, 0x02, 0x20, 0xff, 0xf6, 0x20, 0x01, 0xc0, 0xff, 0xf6, 0xc0,
+    0x00, 0x40, 0xff, 0xf8, 0x40, 0x90, 0xff, 0xf8, 0x90, 0xd0, 0xff, 0xf8, 0xd0, 0xff, 0xff, 0xff,
+    0xf5, 0xd0, 0xff, 0xf8, 0xd0, 0x90, 0xff, 0xf8, 0x90, 0x40, 0xff, 0xf8, 0x40, 0x00, 0xc0, 0xff,
+    0xf6, 0xc0, 0x01, 0x20, 0xff, 0xf6, 0x20, 0x02, 0x50, 0xff, 0xf4, 0x50, 0x04, 0x50, 0xff, 0xf2,
+    0x50, 0x06, 0x20, 0xd0, 0xfe, 0xd0, 0x20, 0x09, 0x50, 0xd0, 0xfa, 0xd0, 0x50, 0x0d, 0x20, 0x70,
+    0xb0, 0xd0, 0xf2, 0xd0, 0xb0, 0x70, 0x20, 0x07, 0x06, 0x60, 0xa0, 0xe0, 0xf1, 0xe0, 0xa0, 0x60,
+    0x0b, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x07, 0x20, 0xc0, 0xfb, 0xc0, 0x20, 0x04, 0x20, 0xe0, 0xfd,
+    0xe0, 0x20, 0x03, 0xc0, 0xff, 0xc0, 0x02, 0x70, 0xff, 0xf1, 0x70, 0x01, 0xe0, 0xff, 0xf1, 0xe0,
+    0x00, 0x60, 0xff, 0xf3, 0x60, 0xa0, 0xff, 0xf3, 0xa0, 0xe0, 0xff, 0xf3, 0xe0, 0xff, 0xff, 0xfb,
+    0xe0, 0xff, 0xf3, 0xe0, 0xa0, 0xff, 0xf3, 0xa0, 0x60, 0xff, 0xf3, 0x60, 0x00, 0xe0, 0xff, 0xf1,
+    0xe0, 0x01, 0x70, 0xff, 0xf1, 0x70, 0x02, 0xc0, 0xff, 0xc0, 0x03, 0x20, 0xe0, 0xfd, 0xe0, 0x20,
+    0x04, 0x20, 0xc0, 0xfb, 0xc0, 0x20, 0x07, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x0b, 0x60, 0xa0, 0xe0,
+    0xf1, 0xe0, 0xa0, 0x60, 0x06, 0x05, 0x20, 0x60, 0x90, 0xb0, 0xc0, 0xf4, 0xc0, 0xb0, 0x90, 0x60,
+    0x20, 0x08, 0x20, 0x90, 0xe0, 0xfe, 0xe0, 0x90, 0x20, 0x04, 0xa0, 0xff, 0xf4, 0xa0, 0x01, 0x20,
+    0xe0, 0xff, 0xf6, 0xe0, 0x20, 0xb0, 0xff, 0xf8, 0xb0, 0xff, 0xfa, 0xb0, 0xff, 0xf8, 0xb0, 0x20,
+    0xe0, 0xff, 0xf6, 0xe0, 0x20, 0x01, 0xa0, 0xff, 0xf4, 0xa0, 0x04, 0x20, 0x90, 0xe0, 0xfe, 0xe0,
+    0x90, 0x20, 0x08, 0x20, 0x60, 0x90, 0xb0, 0xc0, 0xf4, 0xc0, 0xb0, 0x90, 0x60, 0x20, 0x05, 0x02,
+    0x70, 0xd0, 0xf0, 0xd0, 0x70, 0x04, 0x90, 0xf4, 0x90, 0x02, 0x70, 0xf6, 0x70, 0x01, 0xe0, 0xf6,
+    0xe0, 0x00, 0x60, 0xf8, 0x60, 0xb0, 0xf8, 0xb0, 0xe0, 0xf8, 0xe0, 0xff, 0xf5, 0xe0, 0xf8, 0xe0,
+    0xb0, 0xf8, 0xb0, 0x60, 0xf8, 0x60, 0x00, 0xe0, 0xf6, 0xe0, 0x01, 0x70, 0xf6, 0x70, 0x02, 0x90,
+    0xf4, 0x90, 0x04, 0x70, 0xd0, 0xf0, 0xd0, 0x70, 0x02, 0x04, 0x60, 0xc0, 0xf1, 0xc0, 0x60, 0x07,
+    0x20, 0xc0, 0xf5, 0xc0, 0x20, 0x04, 0x20, 0xe0, 0xf7, 0xe0, 0x20, 0x03, 0xc0, 0xf9, 0xc0, 0x02,
+    0x70, 0xfb, 0x70, 0x01, 0xd0, 0xfb, 0xd0, 0x00, 0x40, 0xfd, 0x40, 0x80, 0xfd, 0x80, 0xb0, 0xfd,
+    0xb0, 0xff, 0xff, 0xff, 0xff, 0xb0, 0xfd, 0xb0, 0x80, 0xfd, 0x80, 0x40, 0xfd, 0x40, 0x00, 0xd0,
+    0xfb, 0xd0, 0x01, 0x70, 0xfb, 0x70, 0x02, 0xc0, 0xf9, 0xc0, 0x03, 0x20, 0xe0, 0xf7, 0xe0, 0x20,
+    0x04, 0x20, 0xc0, 0xf5, 0xc0, 0x20, 0x07, 0x60, 0xc0, 0xf1, 0xc0, 0x60, 0x04, 0x04, 0x30, 0x70,
+    0xb0, 0xc0, 0xf3, 0xc0, 0xb0, 0x70, 0x30, 0x07, 0x70, 0xe0, 0xfb, 0xe0, 0x70, 0x03, 0x40, 0xe0,
+    0xff, 0xe0, 0x40, 0x00, 0x30, 0xff, 0xf3, 0x30, 0xc0, 0xff, 0xf3, 0xc0, 0xff, 0xf5, 0xc0, 0xff,
+    0xf3, 0xc0, 0x30, 0xff, 0xf3, 0x30, 0x00, 0x40, 0xe0, 0xff, 0xe0, 0x40, 0x03, 0x70, 0xe0, 0xfb,
+    0xe0, 0x70, 0x07, 0x30, 0x70, 0xb0, 0xc0, 0xf3, 0xc0, 0xb0, 0x70, 0x30, 0x04, 0x06, 0x20, 0x60,
+    0x90, 0xb0, 0xf4, 0xb0, 0x90, 0x60, 0x20, 0x0b, 0x60, 0xd0, 0xfc, 0xd0, 0x60, 0x07, 0x40, 0xe0,
+    0xff, 0xf0, 0xe0, 0x40, 0x04, 0x90, 0xff, 0xf4, 0x90, 0x02, 0x90, 0xff, 0xf6, 0x90, 0x00, 0x40,
+    0xff, 0xf8, 0x40, 0xa0, 0xff, 0xf8, 0xa0, 0xff, 0xff, 0xff, 0xf5, 0xa0, 0xff, 0xf8, 0xa0, 0x40,
+    0xff, 0xf8, 0x40, 0x00, 0x90, 0xff, 0xf6, 0x90, 0x02, 0x90, 0xff, 0xf4, 0x90, 0x04, 0x40, 0xe0,
+    0xff, 0xf0, 0xe0, 0x40, 0x07, 0x60, 0xd0, 0xfc, 0xd0, 0x60, 0x0b, 0x20, 0x60, 0x90, 0xb0, 0xf4,
+    0xb0, 0x90, 0x60, 0x20, 0x06, 0x02, 0x30, 0xc0, 0xf0, 0xc0, 0x30, 0x04, 0x40, 0xf4, 0x40, 0x03,
+    0xe0, 0xf4, 0xe0, 0x02, 0x70, 0xf6, 0x70, 0x01, 0xe0, 0xf6, 0xe0, 0x00, 0x30, 0xf8, 0x30, 0x70,
+    0xf8, 0x70, 0xb0, 0xf8, 0xb0, 0xc0, 0xf8, 0xc0, 0xff, 0xff, 0xfb, 0xc0, 0xf8, 0xc0, 0xb0, 0xf8,
+    0xb0, 0x70, 0xf8, 0x70, 0x30, 0xf8, 0x30, 0x00, 0xe0, 0xf6, 0xe0, 0x01, 0x70, 0xf6, 0x70, 0x02,
+    0xe0, 0xf4, 0xe0, 0x03, 0x40, 0xf4, 0x40, 0x04, 0x30, 0xc0, 0xf0, 0xc0, 0x30, 0x02, 0x03, 0x60,
+    0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60, 0x05, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x02, 0x90, 0xfb, 0x90,
+    0x00, 0x70, 0xfd, 0x70, 0xd0, 0xfd, 0xd0, 0xff, 0xd0, 0xfd, 0xd0, 0x70, 0xfd, 0x70, 0x00, 0x90,
+    0xfb, 0x90, 0x02, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x05, 0x60, 0xb0, 0xe0, 0xf1, 0xe0, 0xb0, 0x60,
+    0x03, 0x05, 0x40, 0x80, 0xb0, 0xf3, 0xb0, 0x80, 0x40, 0x09, 0x70, 0xd0, 0xf9, 0xd0, 0x70, 0x05,
+    0x20, 0xc0, 0xfd, 0xc0, 0x20, 0x02, 0x20, 0xe0, 0xff, 0xe0, 0x20, 0x01, 0xc0, 0xff, 0xf1, 0xc0,
+    0x00, 0x60, 0xff, 0xf3, 0x60, 0xc0, 0xff, 0xf3, 0xc0, 0xff, 0xff, 0xfb, 0xc0, 0xff, 0xf3, 0xc0,
+    0x60, 0xff, 0xf3, 0x60, 0x00, 0xc0, 0xff, 0xf1, 0xc0, 0x01, 0x20, 0xe0, 0xff, 0xe0, 0x20, 0x02,
+    0x20, 0xc0, 0xfd, 0xc0, 0x20, 0x05, 0x70, 0xd0, 0xf9, 0xd0, 0x70, 0x09, 0x40, 0x80, 0xb0, 0xf3,
+    0xb0, 0x80, 0x40, 0x05, 0x07, 0x20, 0x70, 0xb0, 0xd0, 0xf2, 0xd0, 0xb0, 0x70, 0x20, 0x0d, 0x50,
+    0xd0, 0xfa, 0xd0, 0x50, 0x09, 0x20, 0xd0, 0xfe, 0xd0, 0x20, 0x06, 0x50, 0xff, 0xf2, 0x50, 0x04,
+    0x50, 0xff, 0xf4, 0x50, 0x02, 0x20, 0xff, 0xf6, 0x20, 0x01, 0xc0, 0xff, 0xf6, 0xc0, 0x00, 0x40,
+    0xff, 0xf8, 0x40, 0x90, 0xff, 0xf8, 0x90, 0xd0, 0xff, 0xf8, 0xd0, 0xff, 0xff, 0xff, 0xf5, 0xd0,
+    0xff, 0xf8, 0xd0, 0x90, 0xff, 0xf8, 0x90, 0x40, 0xff, 0xf8, 0x40, 0x00, 0xc0, 0xff, 0xf6, 0xc0,
+    0x01, 0x20, 0xff, 0xf6, 0x20, 0x02, 0x50, 0xff, 0xf4, 0x50, 0x04, 0x50, 0xff, 0xf2, 0x50, 0x06,
+    0x20, 0xd0, 0xfe, 0xd0, 0x20, 0x09, 0x50, 0xd0, 0xfa, 0xd0, 0x50, 0x0d, 0x20, 0x70, 0xb0, 0xd0,
+    0xf2, 0xd0, 0xb0, 0x70, 0x20, 0x07, 0x01, 0x10, 0x90, 0xe0, 0xf0, 0xe0, 0x90, 0x10, 0x02, 0x50,
+    0xe0, 0xf4, 0xe0, 0x50, 0x00, 0x10, 0xe0, 0xf6, 0xe0, 0x10, 0x90, 0xf8, 0x90, 0xe0, 0xf8, 0xe0,
+    0xfa, 0xe0, 0xf8, 0xe0, 0x90, 0xf8, 0x90, 0x10, 0xe0, 0xf6, 0xe0, 0x10, 0x00, 0x50, 0xe0, 0xf4,
+    0xe0, 0x50, 0x02, 0x10, 0x90, 0xe0, 0xf0, 0xe0, 0x90, 0x10, 0x01, 0x03, 0x20, 0x90, 0xd0, 0xf1,
+    0xd0, 0x90, 0x20, 0x06, 0x80, 0xf7, 0x80, 0x04, 0xc0, 0xf9, 0xc0, 0x02, 0x80, 0xfb, 0x80, 0x00,
+    0x20, 0xfd, 0x20, 0x90, 0xfd, 0x90, 0xd0, 0xfd, 0xd0, 0xff, 0xff, 0xd0, 0xfd, 0xd0, 0x90, 0xfd,
+    0x90, 0x20, 0xfd, 0x20, 0x00, 0x80, 0xfb, 0x80, 0x02, 0xc0, 0xf9, 0xc0, 0x04, 0x80, 0xf7, 0x80,
+    0x06, 0x20, 0x90, 0xd0, 0xf1, 0xd0, 0x90, 0x20, 0x03, 0x06, 0x60, 0xa0, 0xe0, 0xf1, 0xe0, 0xa0,
+    0x60, 0x0b, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x07, 0x20, 0xc0, 0xfb, 0xc0, 0x20, 0x04, 0x20, 0xe0,
+    0xfd, 0xe0, 0x20, 0x03, 0xc0, 0xff, 0xc0, 0x02, 0x70, 0xff, 0xf1, 0x70, 0x01, 0xe0, 0xff, 0xf1,
+    0xe0, 0x00, 0x60, 0xff, 0xf3, 0x60, 0xa0, 0xff, 0xf3, 0xa0, 0xe0, 0xff, 0xf3, 0xe0, 0xff, 0xff,
+    0xfb, 0xe0, 0xff, 0xf3, 0xe0, 0xa0, 0xff, 0xf3, 0xa0, 0x60, 0xff, 0xf3, 0x60, 0x00, 0xe0, 0xff,
+    0xf1, 0xe0, 0x01, 0x70, 0xff, 0xf1, 0x70, 0x02, 0xc0, 0xff, 0xc0, 0x03, 0x20, 0xe0, 0xfd, 0xe0,
+    0x20, 0x04, 0x20, 0xc0, 0xfb, 0xc0, 0x20, 0x07, 0x70, 0xe0, 0xf7, 0xe0, 0x70, 0x0b, 0x60, 0xa0,
+    0xe0, 0xf1, 0xe0, 0xa0, 0x60, 0x06,
+};
+
+#endif
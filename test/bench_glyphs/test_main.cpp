@@ -0,0 +1,235 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Checks the run-length encoding of glyph_atlas.py against the decoder and the blitters of the renderer, and
+ * measures blitting against drawing the glyphs from shapes. The atlas is generated with the stand-in rasterizer of
+ * glyph_atlas.py, which draws an ellipse of a size of its own for every glyph, computed here too, since no SMuFL
+ * font is included. See glyph_atlas.py for generating glyph_atlas_stand_in.h again when enum Glyph changes.
+ * @version 0.1
+ * @date 2022-03-07
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+#include <benchmark.h>
+
+#include <vector>
+
+// Relative to glyphs.h
+#define GLYPH_ATLAS_HEADER "../test/bench_glyphs/glyph_atlas_stand_in.h"
+
+#include "renderer.h"
+
+/**
+ * @brief The glyphs that have a SMuFL code point in glyph_atlas.py, at every size of the atlas.
+ */
+#define BENCH_ATLAS_GLYPHS 34
+
+/**
+ * @brief The bitmap of the stand-in rasterizer of glyph_atlas.py for [glyph] at [space], with its position.
+ */
+struct StandIn
+{
+    int width;
+    int height;
+    int left;
+    int top;
+    std::vector<uint8_t> coverage;
+};
+
+StandIn standIn(uint16_t glyph, uint8_t space)
+{
+    StandIn bitmap;
+    bitmap.width = space + glyph % 4 * space / 2;
+    bitmap.height = space + glyph % 3 * space / 2;
+    bitmap.left = -(bitmap.width / 2);
+    bitmap.top = -(bitmap.height / 2);
+    int64_t rx = 4 * bitmap.width, ry = 4 * bitmap.height;
+    for (int y = 0; y < bitmap.height; y++)
+        for (int x = 0; x < bitmap.width; x++)
+        {
+            int inside = 0;
+            for (int sy = 0; sy < 4; sy++)
+                for (int sx = 0; sx < 4; sx++)
+                {
+                    int64_t dx = 8 * x + 2 * sx + 1 - rx, dy = 8 * y + 2 * sy + 1 - ry;
+                    inside += dx * dx * ry * ry + dy * dy * rx * rx <= rx * rx * ry * ry;
+                }
+            bitmap.coverage.push_back(inside * 15 / 16);
+        }
+    return bitmap;
+}
+
+FrameBuffer newBuffer(uint16_t width, uint16_t height)
+{
+    uint16_t stride = (width + 31) / 32 * 4;
+    return {(uint8_t *)calloc(stride, height), width, height, stride, -1};
+}
+
+bool pixelSet(const FrameBuffer &buffer, int x, int y)
+{
+    return buffer.pixels[y * buffer.stride + x / 8] & (0x80 >> (x & 7));
+}
+
+void test_runs()
+{
+    for (int size = 0; size < GLYPH_ATLAS_SIZES; size++)
+    {
+        uint8_t space = glyphAtlasSpaces[size];
+        int found = 0;
+        for (uint16_t glyph = 0; glyph < GLYPH_COUNT; glyph++)
+        {
+            const GlyphBitmap *bitmap = glyphFind(glyph, space);
+            if (!bitmap)
+                continue;
+            found++;
+            StandIn expected = standIn(glyph, space);
+            TEST_ASSERT_EQUAL(expected.width, bitmap->width);
+            TEST_ASSERT_EQUAL(expected.height, bitmap->height);
+            TEST_ASSERT_EQUAL(expected.left, bitmap->left);
+            TEST_ASSERT_EQUAL(expected.top, bitmap->top);
+
+            // Every pixel is covered once, by its own level, and runs split at the end of the rows
+            std::vector<uint8_t> decoded(bitmap->width * bitmap->height, 0);
+            std::vector<uint8_t> spans(bitmap->width * bitmap->height, 0);
+            glyphRuns(*bitmap, [&](uint16_t x, uint16_t y, uint16_t count, uint8_t level)
+                      {
+                TEST_ASSERT_TRUE(x + count <= bitmap->width);
+                TEST_ASSERT_TRUE(y < bitmap->height);
+                for (uint16_t i = 0; i < count; i++)
+                {
+                    decoded[y * bitmap->width + x + i] = level;
+                    spans[y * bitmap->width + x + i]++;
+                } });
+            for (size_t i = 0; i < decoded.size(); i++)
+            {
+                TEST_ASSERT_EQUAL(expected.coverage[i], decoded[i]);
+                TEST_ASSERT_EQUAL(expected.coverage[i] > 0 ? 1 : 0, spans[i]);
+            }
+        }
+        TEST_ASSERT_EQUAL(BENCH_ATLAS_GLYPHS, found);
+    }
+    // Drawn from shapes, at other sizes and for the lines
+    TEST_ASSERT_NULL(glyphFind(GLYPH_NOTEHEAD_BLACK, glyphAtlasSpaces[0] + 1));
+    TEST_ASSERT_NULL(glyphFind(GLYPH_STAFF, glyphAtlasSpaces[0]));
+    TEST_ASSERT_NULL(glyphFind(GLYPH_COUNT, glyphAtlasSpaces[0]));
+}
+
+void test_blit1()
+{
+    uint8_t space = glyphAtlasSpaces[GLYPH_ATLAS_SIZES - 1];
+    FrameBuffer buffer = newBuffer(61, 40);
+    // Whole, and cut by every edge
+    const int origins[][2] = {{30, 20}, {1, 20}, {59, 20}, {30, 2}, {30, 38}, {-3, -3}};
+    for (uint16_t glyph = 0; glyph < GLYPH_COUNT; glyph++)
+    {
+        const GlyphBitmap *bitmap = glyphFind(glyph, space);
+        if (!bitmap)
+            continue;
+        StandIn expected = standIn(glyph, space);
+        for (const int *origin : origins)
+        {
+            memset(buffer.pixels, 0, buffer.stride * buffer.height);
+            renderBlit1(buffer, *bitmap, origin[0], origin[1]);
+            for (int y = 0; y < buffer.height; y++)
+                for (int x = 0; x < buffer.width; x++)
+                {
+                    int bx = x - origin[0] - expected.left, by = y - origin[1] - expected.top;
+                    bool inside = bx >= 0 && bx < expected.width && by >= 0 && by < expected.height;
+                    bool set = inside && expected.coverage[by * expected.width + bx] >= GLYPH_THRESHOLD;
+                    TEST_ASSERT_EQUAL(set, pixelSet(buffer, x, y));
+                }
+        }
+    }
+
+    // Through the display list, as the pages are drawn
+    memset(buffer.pixels, 0, buffer.stride * buffer.height);
+    renderGlyph(buffer, {GLYPH_NOTEHEAD_BLACK, 30, 20}, space);
+    StandIn notehead = standIn(GLYPH_NOTEHEAD_BLACK, space);
+    TEST_ASSERT_EQUAL(notehead.coverage[(notehead.height / 2) * notehead.width + notehead.width / 2] >= GLYPH_THRESHOLD,
+                      pixelSet(buffer, 30, 20));
+    TEST_ASSERT_FALSE(pixelSet(buffer, 30 + notehead.left - 1, 20));
+    free(buffer.pixels);
+}
+
+void test_blit4()
+{
+    uint8_t space = glyphAtlasSpaces[0];
+    const uint16_t width = 41, height = 30, stride = (width + 1) / 2;
+    std::vector<uint8_t> pixels(stride * height);
+    // Starting on both nibbles
+    const int origins[][2] = {{20, 15}, {21, 15}, {0, 0}, {40, 29}};
+    for (uint16_t glyph = 0; glyph < GLYPH_COUNT; glyph++)
+    {
+        const GlyphBitmap *bitmap = glyphFind(glyph, space);
+        if (!bitmap)
+            continue;
+        StandIn expected = standIn(glyph, space);
+        for (const int *origin : origins)
+        {
+            // Keeps the darkest of the pixels drawn before and the glyph
+            std::fill(pixels.begin(), pixels.end(), 0x55);
+            renderBlit4(pixels.data(), stride, width, height, *bitmap, origin[0], origin[1]);
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++)
+                {
+                    int bx = x - origin[0] - expected.left, by = y - origin[1] - expected.top;
+                    bool inside = bx >= 0 && bx < expected.width && by >= 0 && by < expected.height;
+                    uint8_t level = inside ? max((uint8_t)5, expected.coverage[by * expected.width + bx]) : 5;
+                    uint8_t pair = pixels[y * stride + x / 2];
+                    TEST_ASSERT_EQUAL(level, x & 1 ? pair & 0x0f : pair >> 4);
+                }
+        }
+    }
+}
+
+FrameBuffer benchBuffer = newBuffer(LAYOUT_DEFAULT_WIDTH, LAYOUT_DEFAULT_HEIGHT);
+
+/**
+ * @brief Draws the glyphs of the atlas over a row of the page, as from the display list.
+ */
+void benchDrawGlyphs(BenchmarkState &state, uint8_t space)
+{
+    while (state.keepRunning())
+        for (uint16_t glyph = GLYPH_CLEF_G; glyph < GLYPH_COUNT; glyph++)
+            renderGlyph(benchBuffer, {glyph, (int16_t)(20 + glyph * 3 * space), (int16_t)(10 * space)}, space);
+}
+
+void BM_renderGlyphAtlas(BenchmarkState &state)
+{
+    benchDrawGlyphs(state, glyphAtlasSpaces[0]);
+}
+BENCHMARK(BM_renderGlyphAtlas)
+
+void BM_renderGlyphShapes(BenchmarkState &state)
+{
+    // A staff space not in the atlas
+    benchDrawGlyphs(state, glyphAtlasSpaces[0] + 1);
+}
+BENCHMARK(BM_renderGlyphShapes)
+
+void test_benchmarks()
+{
+    benchmarkRunAll();
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_runs);
+    RUN_TEST(test_blit1);
+    RUN_TEST(test_blit4);
+    RUN_TEST(test_benchmarks);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    Serial.muted = true;
+    return runTests();
+}
@@ -0,0 +1,305 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Measures the request handlers and the functions they rely on: authentication, configuration, listing and
+ * loading scores. Runs on the native environment, against the stand-ins of lib/native_shims.
+ * @version 0.1
+ * @date 2022-03-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+#include <benchmark.h>
+
+#include "server.h"
+
+/**
+ * @brief The amount of scores stored for the listing benchmarks.
+ */
+#define BENCH_SCORES 50
+
+/**
+ * @brief The size of the score loaded and downloaded, in bytes.
+ */
+#define BENCH_SCORE_SIZE (32 * 1024)
+
+#define BENCH_USER_AGENT "Mozilla/5.0 (X11; Linux x86_64) Bench"
+
+AsyncWebServer *server;
+
+/**
+ * @brief The cookie of the session opened by [test_login].
+ */
+String sessionCookie;
+
+/**
+ * @brief Builds an authenticated request for [url].
+ */
+AsyncWebServerRequest *authenticatedRequest(const char *url)
+{
+    AsyncWebServerRequest *request = new AsyncWebServerRequest(HTTP_GET, url);
+    request->addHeader("User-Agent", BENCH_USER_AGENT);
+    request->addHeader("Cookie", sessionCookie);
+    return request;
+}
+
+/**
+ * @brief Runs the authenticated request for [url] through the handlers [state] times.
+ */
+void benchmarkRequest(BenchmarkState &state, const char *url, const char *param = NULL, const char *value = NULL)
+{
+    while (state.keepRunning())
+    {
+        std::unique_ptr<AsyncWebServerRequest> request(authenticatedRequest(url));
+        if (param)
+            request->addParam(param, value);
+        server->handle(request.get());
+    }
+}
+
+void BM_checkUserWebAuth(BenchmarkState &state)
+{
+    std::unique_ptr<AsyncWebServerRequest> request(authenticatedRequest("/"));
+    while (state.keepRunning())
+        checkUserWebAuth(request.get());
+}
+BENCHMARK(BM_checkUserWebAuth)
+
+void BM_checkUserWebAuthNoCookie(BenchmarkState &state)
+{
+    AsyncWebServerRequest request(HTTP_GET, "/");
+    while (state.keepRunning())
+        checkUserWebAuth(&request);
+}
+BENCHMARK(BM_checkUserWebAuthNoCookie)
+
+void BM_configureLogLevel(BenchmarkState &state)
+{
+    while (state.keepRunning())
+        configure("logLevel.music", "1");
+}
+BENCHMARK(BM_configureLogLevel)
+
+void BM_listFiles(BenchmarkState &state)
+{
+    while (state.keepRunning())
+        listFiles(true);
+}
+BENCHMARK(BM_listFiles)
+
+void BM_loadMusic(BenchmarkState &state)
+{
+    String path = scorePath("score000.xml");
+    state.setBytesPerIteration(BENCH_SCORE_SIZE);
+    while (state.keepRunning())
+        loadMusic(path);
+}
+BENCHMARK(BM_loadMusic)
+
+void BM_handleIndex(BenchmarkState &state)
+{
+    benchmarkRequest(state, "/");
+}
+BENCHMARK(BM_handleIndex)
+
+void BM_handleListFiles(BenchmarkState &state)
+{
+    benchmarkRequest(state, "/listfiles");
+}
+BENCHMARK(BM_handleListFiles)
+
+void BM_handleDownload(BenchmarkState &state)
+{
+    state.setBytesPerIteration(BENCH_SCORE_SIZE);
+    while (state.keepRunning())
+    {
+        std::unique_ptr<AsyncWebServerRequest> request(authenticatedRequest("/file"));
+        request->addParam("name", "score000.xml");
+        request->addParam("action", "download");
+        server->handle(request.get());
+    }
+}
+BENCHMARK(BM_handleDownload)
+
+void BM_handleMetrics(BenchmarkState &state)
+{
+    benchmarkRequest(state, "/metrics");
+}
+BENCHMARK(BM_handleMetrics)
+
+/**
+ * @brief Opens a session through the login handler, which is used by the rest of the requests.
+ */
+void test_login()
+{
+    AsyncWebServerRequest request(HTTP_POST, "/login");
+    request.addHeader("User-Agent", BENCH_USER_AGENT);
+    request.addParam("username", AUTH_DEFAULT_USER);
+    request.addParam("password", AUTH_DEFAULT_PASS);
+    server->handle(&request);
+    TEST_ASSERT_EQUAL(303, request.response()->code);
+
+    for (AsyncWebHeader &header : request.response()->headers)
+        if (header.name() == "Set-Cookie")
+            sessionCookie = header.value().substring(0, header.value().indexOf(';'));
+    TEST_ASSERT_TRUE(sessionCookie.startsWith("SESSIONID="));
+
+    std::unique_ptr<AsyncWebServerRequest> check(authenticatedRequest("/"));
+    TEST_ASSERT_TRUE(checkUserWebAuth(check.get()));
+}
+
+/**
+ * @brief /metrics needs a session, or the token of metrics.token.
+ */
+void test_metricsAuth()
+{
+    AsyncWebServerRequest anonymous(HTTP_GET, "/metrics");
+    server->handle(&anonymous);
+    TEST_ASSERT_EQUAL(HTTP_UNAUTHORIZED, anonymous.response()->code);
+
+    std::unique_ptr<AsyncWebServerRequest> logged(authenticatedRequest("/metrics"));
+    server->handle(logged.get());
+    TEST_ASSERT_EQUAL(HTTP_OK, logged->response()->code);
+    // Only the handlers are labelled as such
+    const std::string &metrics = logged->response()->body;
+    TEST_ASSERT_TRUE(metrics.find("ems_handler_duration_seconds_count{handler=\"loadMusic\"}") != std::string::npos);
+    TEST_ASSERT_TRUE(metrics.find("ems_page_turn_seconds_count ") != std::string::npos);
+    TEST_ASSERT_TRUE(metrics.find("ems_dns_queries_total ") != std::string::npos);
+    TEST_ASSERT_TRUE(metrics.find("handler=\"pageTurn\"") == std::string::npos);
+
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_BOUNDS, configure(CONFIG_KEY_METRICS_TOKEN, "short"));
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure(CONFIG_KEY_METRICS_TOKEN, "0123456789abcdef"));
+    AsyncWebServerRequest scraper(HTTP_GET, "/metrics");
+    scraper.addHeader("Authorization", "Bearer 0123456789abcdef");
+    server->handle(&scraper);
+    TEST_ASSERT_EQUAL(HTTP_OK, scraper.response()->code);
+
+    AsyncWebServerRequest wrong(HTTP_GET, "/metrics");
+    wrong.addHeader("Authorization", "Bearer 0123456789abcdeg");
+    server->handle(&wrong);
+    TEST_ASSERT_EQUAL(HTTP_UNAUTHORIZED, wrong.response()->code);
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure(CONFIG_KEY_METRICS_TOKEN, ""));
+}
+
+void test_benchmarks()
+{
+    benchmarkRunAll();
+}
+
+/**
+ * @brief Stores [BENCH_SCORES] scores. The first one has [BENCH_SCORE_SIZE] bytes, the rest are shorter.
+ */
+void test_storeScores()
+{
+    std::string contents;
+    while (contents.size() < BENCH_SCORE_SIZE)
+        contents += "<note><pitch><step>C</step><octave>4</octave></pitch><duration>4</duration></note>";
+
+    char name[32];
+    for (int i = 0; i < BENCH_SCORES; i++)
+    {
+        snprintf(name, sizeof(name), "score%03d.xml", i);
+        ScoreUpload upload(name);
+        // The name goes first, so no score is deduplicated
+        std::string header = std::string("<!-- ") + name + " -->";
+        upload.write((const uint8_t *)header.data(), header.size());
+        upload.write((const uint8_t *)contents.data(), (i == 0 ? BENCH_SCORE_SIZE : 1024) - header.size());
+        TEST_ASSERT_TRUE(upload.finish().length() > 0);
+    }
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoreList().size());
+}
+
+/**
+ * @brief Counts the contents of the scores stored, named after their id.
+ */
+size_t countBlobs()
+{
+    size_t blobs = 0;
+    storage->list(STORAGE_DIR_SCORES, [&](const char *name, size_t size)
+                  {
+        if (strlen(name) == SCORE_ID_LENGTH && strspn(name, "0123456789abcdef") == SCORE_ID_LENGTH)
+            blobs++; });
+    return blobs;
+}
+
+/**
+ * @brief Reboots between removing the manifest and renaming the new one over it, and without any manifest.
+ */
+void test_manifestRecovery()
+{
+    TEST_ASSERT_TRUE(storage->rename(SCORE_MANIFEST_PATH, SCORE_MANIFEST_TEMP_PATH));
+    scoreStoreBegin();
+    scoreStoreScan();
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoreList().size());
+    TEST_ASSERT_FALSE(storage->exists(SCORE_MANIFEST_TEMP_PATH));
+
+    // Nothing is removed if the manifest can't be read
+    std::string manifest;
+    {
+        std::unique_ptr<StorageFile> file = storage->open(SCORE_MANIFEST_PATH, "r");
+        manifest.resize(file->size());
+        file->read((uint8_t *)&manifest[0], manifest.size());
+    }
+    TEST_ASSERT_TRUE(storage->remove(SCORE_MANIFEST_PATH));
+    scoreStoreBegin();
+    scoreStoreScan();
+    TEST_ASSERT_EQUAL(0, scoreList().size());
+    TEST_ASSERT_EQUAL(BENCH_SCORES, countBlobs());
+    {
+        std::unique_ptr<StorageFile> file = storage->open(SCORE_MANIFEST_PATH, "w");
+        file->write((const uint8_t *)manifest.data(), manifest.size());
+    }
+    scoreStoreBegin();
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoreList().size());
+}
+
+/**
+ * @brief Files being written are left alone by the scan, which runs while the main loop writes the index and the cache,
+ * and only removed before anything writes them.
+ */
+void test_tempFiles()
+{
+    const char *paths[] = {SCORE_TEMP_PREFIX "index", SCORE_TEMP_PREFIX "0", SCORE_CACHE_TEMP_PREFIX "0"};
+    storage->mkdir(STORAGE_DIR_CACHE);
+    for (const char *path : paths)
+        TEST_ASSERT_NOT_NULL(storage->open(path, "w").get());
+    scoreStoreScan();
+    for (const char *path : paths)
+        TEST_ASSERT_TRUE(storage->exists(path));
+    scoreStoreCleanTemps();
+    for (const char *path : paths)
+        TEST_ASSERT_FALSE(storage->exists(path));
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoreList().size());
+}
+
+int runTests()
+{
+    Serial.muted = true;
+    loggerBegin();
+    preferences.begin(preferencesName, false);
+    LittleFS.format();
+    storageBegin();
+    scoreStoreBegin();
+
+    server = new AsyncWebServer(WEB_PORT);
+    configureWebServer(server);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_storeScores);
+    RUN_TEST(test_manifestRecovery);
+    RUN_TEST(test_tempFiles);
+    RUN_TEST(test_login);
+    RUN_TEST(test_metricsAuth);
+    RUN_TEST(test_benchmarks);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    return runTests();
+}
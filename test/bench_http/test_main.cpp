@@ -0,0 +1,354 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Load test of the web server. Clients replay the mix of requests of the web UI (login, index, listing,
+ * downloads, uploads and configuration) at increasing concurrency, and the throughput and the p50/p99 latency of
+ * every route are reported. Runs against the handlers of configureWebServer served on a loopback socket, or against
+ * a board when BENCH_HTTP_TARGET is set to its "address:port".
+ * @version 0.1
+ * @date 2022-03-03
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <bench_setup.h>
+
+#include "server.h"
+
+/**
+ * @brief The amount of requests sent at every concurrency level.
+ */
+#define BENCH_HTTP_REQUESTS 1000
+
+/**
+ * @brief The size of the score uploaded by every client, in bytes.
+ */
+#define BENCH_HTTP_UPLOAD_SIZE (8 * 1024)
+
+/**
+ * @brief How long a client waits for a response, in seconds, before counting it as an error.
+ */
+#define BENCH_HTTP_TIMEOUT_S 10
+
+#define BENCH_HTTP_USER_AGENT "Mozilla/5.0 (X11; Linux x86_64) Load"
+
+const int concurrencyLevels[] = {1, 2, 4, 8, 16};
+
+enum Route
+{
+    ROUTE_LOGIN,
+    ROUTE_INDEX,
+    ROUTE_LIST,
+    ROUTE_DOWNLOAD,
+    ROUTE_UPLOAD,
+    ROUTE_CONFIG,
+    ROUTE_COUNT
+};
+
+const char *routeNames[ROUTE_COUNT] = {"POST /login", "GET /", "GET /listfiles", "GET /file", "POST / (upload)", "GET /config"};
+
+/**
+ * @brief How often every route is requested, in percent. The listing is refreshed the most, by every device showing
+ * the web UI.
+ */
+const int routeWeights[ROUTE_COUNT] = {5, 15, 30, 25, 10, 15};
+
+/**
+ * @brief The status every route answers with when it succeeds.
+ */
+const int routeStatus[ROUTE_COUNT] = {303, 200, 200, 200, 302, 200};
+
+sockaddr_in target;
+AsyncWebServer *server;
+
+/**
+ * @brief What was measured at a concurrency level, for every route.
+ */
+struct LoadResults
+{
+    std::mutex lock;
+    std::vector<uint32_t> latencies[ROUTE_COUNT];
+    unsigned long errors[ROUTE_COUNT] = {};
+};
+
+/**
+ * @brief Sends [request] in a new connection, and reads the whole response into [response].
+ *
+ * @return int The status of the response, or 0 if the connection failed.
+ */
+int httpSend(const std::string &request, std::string &response)
+{
+    response.clear();
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+        return 0;
+    timeval timeout = {BENCH_HTTP_TIMEOUT_S, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (connect(sock, (sockaddr *)&target, sizeof(target)) != 0)
+    {
+        close(sock);
+        return 0;
+    }
+
+    size_t sent = 0;
+    while (sent < request.size())
+    {
+        ssize_t len = send(sock, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (len <= 0)
+        {
+            close(sock);
+            return 0;
+        }
+        sent += len;
+    }
+
+    // The server closes the connection after the response
+    char buffer[4096];
+    ssize_t len;
+    while ((len = recv(sock, buffer, sizeof(buffer), 0)) > 0)
+        response.append(buffer, len);
+    close(sock);
+    if (len < 0 || response.compare(0, 9, "HTTP/1.1 ") != 0)
+        return 0;
+    return atoi(response.c_str() + 9);
+}
+
+/**
+ * @brief Gives the value of the header [name] of [response], or an empty string.
+ */
+std::string httpHeader(const std::string &response, const char *name)
+{
+    std::string key = std::string("\r\n") + name + ": ";
+    size_t pos = response.find(key);
+    if (pos == std::string::npos)
+        return std::string();
+    pos += key.size();
+    return response.substr(pos, response.find("\r\n", pos) - pos);
+}
+
+std::string httpGet(const std::string &path, const std::string &cookie)
+{
+    return "GET " + path + " HTTP/1.1\r\nHost: ems\r\nUser-Agent: " BENCH_HTTP_USER_AGENT "\r\nCookie: " + cookie + "\r\n\r\n";
+}
+
+std::string httpLogin()
+{
+    std::string body = "username=" AUTH_DEFAULT_USER "&password=" AUTH_DEFAULT_PASS;
+    return "POST /login HTTP/1.1\r\nHost: ems\r\nUser-Agent: " BENCH_HTTP_USER_AGENT "\r\n"
+           "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+/**
+ * @brief Builds the upload of [name] as sent by the upload form of the web UI.
+ */
+std::string httpUpload(const std::string &name, const std::string &cookie)
+{
+    const char *boundary = "----LoadBoundary7MA4YWxkTrZu0gW";
+    std::string contents = "<?xml version=\"1.0\"?>\n<!-- " + name + " -->\n<score-partwise version=\"3.1\">\n";
+    while (contents.size() < BENCH_HTTP_UPLOAD_SIZE - 20)
+        contents += "<note><pitch><step>C</step><octave>4</octave></pitch><duration>4</duration></note>\n";
+    contents += "</score-partwise>\n";
+
+    std::string body = std::string("--") + boundary + "\r\n"
+                       "Content-Disposition: form-data; name=\"uploadFi\"; filename=\"" + name + "\"\r\n"
+                       "Content-Type: application/xml\r\n\r\n" +
+                       contents + "\r\n--" + boundary + "--\r\n";
+    return "POST / HTTP/1.1\r\nHost: ems\r\nUser-Agent: " BENCH_HTTP_USER_AGENT "\r\nCookie: " + cookie + "\r\n"
+           "Content-Type: multipart/form-data; boundary=" + boundary + "\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+/**
+ * @brief Logs in, and gives the session cookie, or an empty string if the login failed.
+ */
+std::string login(std::string &response)
+{
+    if (httpSend(httpLogin(), response) != routeStatus[ROUTE_LOGIN])
+        return std::string();
+    std::string cookie = httpHeader(response, "Set-Cookie");
+    return cookie.substr(0, cookie.find(';'));
+}
+
+/**
+ * @brief Sends [requests] requests picked from the mix, recording their latency in [results].
+ */
+void client(int id, int requests, LoadResults &results)
+{
+    std::string response;
+    std::string cookie = login(response);
+    std::string name = "load_" + std::to_string(id) + ".xml";
+    // The file downloaded by this client
+    httpSend(httpUpload(name, cookie), response);
+
+    std::vector<uint32_t> latencies[ROUTE_COUNT];
+    unsigned long errors[ROUTE_COUNT] = {};
+    uint32_t seed = id * 2654435761u + 1;
+    for (int i = 0; i < requests; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        int pick = (seed >> 16) % 100;
+        int route = 0;
+        while (pick >= routeWeights[route])
+            pick -= routeWeights[route++];
+
+        std::string request;
+        switch (route)
+        {
+        case ROUTE_LOGIN:
+            request = httpLogin();
+            break;
+        case ROUTE_INDEX:
+            request = httpGet("/", cookie);
+            break;
+        case ROUTE_LIST:
+            request = httpGet("/listfiles", cookie);
+            break;
+        case ROUTE_DOWNLOAD:
+            request = httpGet("/file?name=" + name + "&action=download", cookie);
+            break;
+        case ROUTE_UPLOAD:
+            request = httpUpload(name, cookie);
+            break;
+        case ROUTE_CONFIG:
+            request = httpGet("/config?key=logLevel.music&value=1", cookie);
+            break;
+        }
+
+        unsigned long start = micros();
+        int status = httpSend(request, response);
+        latencies[route].push_back(micros() - start);
+        if (status != routeStatus[route])
+            errors[route]++;
+    }
+
+    std::lock_guard<std::mutex> guard(results.lock);
+    for (int route = 0; route < ROUTE_COUNT; route++)
+    {
+        results.latencies[route].insert(results.latencies[route].end(), latencies[route].begin(), latencies[route].end());
+        results.errors[route] += errors[route];
+    }
+}
+
+/**
+ * @brief Runs [BENCH_HTTP_REQUESTS] requests split between [concurrency] clients, and reports the results.
+ *
+ * @return unsigned long The amount of failed requests.
+ */
+unsigned long runLevel(int concurrency)
+{
+    LoadResults results;
+    std::vector<std::thread> clients;
+    unsigned long start = micros();
+    for (int i = 0; i < concurrency; i++)
+        clients.emplace_back(client, i, BENCH_HTTP_REQUESTS / concurrency, std::ref(results));
+    for (std::thread &thread : clients)
+        thread.join();
+    unsigned long elapsed = micros() - start;
+
+    char message[160];
+    int total = (BENCH_HTTP_REQUESTS / concurrency) * concurrency;
+    snprintf(message, sizeof(message), "%d clients: %d requests in %.2f s, %.0f requests/s",
+             concurrency, total, elapsed / 1e6, total * 1e6 / elapsed);
+    TEST_MESSAGE(message);
+
+    unsigned long errors = 0;
+    for (int route = 0; route < ROUTE_COUNT; route++)
+    {
+        const std::vector<uint32_t> &latencies = results.latencies[route];
+        snprintf(message, sizeof(message), "  %-16s %5u requests, p50 %7u us, p99 %7u us, %lu errors",
+                 routeNames[route], (unsigned)latencies.size(), benchPercentile(latencies, 50), benchPercentile(latencies, 99), results.errors[route]);
+        TEST_MESSAGE(message);
+        errors += results.errors[route];
+    }
+    return errors;
+}
+
+void test_login()
+{
+    std::string response;
+    std::string cookie = login(response);
+    TEST_ASSERT_TRUE(cookie.rfind("SESSIONID=", 0) == 0);
+
+    // Without a session the login page would be measured instead
+    TEST_ASSERT_EQUAL(200, httpSend(httpGet("/listfiles", cookie), response));
+    TEST_ASSERT_TRUE(httpHeader(response, "Content-Type").rfind("text/plain", 0) == 0);
+}
+
+void test_load()
+{
+    unsigned long errors = 0;
+    for (int concurrency : concurrencyLevels)
+        errors += runLevel(concurrency);
+    TEST_ASSERT_EQUAL(0, errors);
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_login);
+    RUN_TEST(test_load);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+
+    const char *remote = getenv("BENCH_HTTP_TARGET");
+    if (remote)
+    {
+        std::string address(remote);
+        size_t colon = address.find(':');
+        target.sin_port = htons(colon == std::string::npos ? WEB_PORT : atoi(address.c_str() + colon + 1));
+        inet_pton(AF_INET, address.substr(0, colon).c_str(), &target.sin_addr);
+    }
+    else
+    {
+        Serial.muted = true;
+        loggerBegin();
+        controlBegin();
+        preferences.begin(preferencesName, false);
+        LittleFS.format();
+        storageBegin();
+        scoreStoreBegin();
+
+        // Any free port
+        server = new AsyncWebServer(0);
+        configureWebServer(server);
+        server->begin();
+        if (!server->started)
+        {
+            TEST_MESSAGE("Could not start the web server");
+            return 1;
+        }
+        target.sin_port = htons(server->port);
+        target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    int failures = runTests();
+    if (server)
+        server->end();
+    return failures;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Measures the cost of disabled log calls, which must not evaluate their arguments, and checks the segments
+ * of the log file.
+ * @version 0.1
+ * @date 2022-02-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+// Debug calls are disabled at compile time, info calls are left to the runtime levels
+#define DEBUG_LEVEL DEBUG_INFO
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "logger.h"
+#include "storage_ram.h"
+
+#define BENCH_ITERATIONS 100000
+
+/**
+ * @brief How many times the arguments of a log call have been built.
+ */
+static unsigned long argumentEvaluations = 0;
+
+/**
+ * @brief Stands for the String building done by callers, such as the client address of a request.
+ */
+String expensiveArgument()
+{
+    argumentEvaluations++;
+    return String("Client:") + String(argumentEvaluations) + " /listfiles";
+}
+
+/**
+ * @brief Runs [iterations] log calls through [fn], and prints and returns the average time per call in nanoseconds.
+ */
+template <typename F>
+float benchmark(const char *name, unsigned long iterations, F fn)
+{
+    unsigned long start = micros();
+    for (unsigned long i = 0; i < iterations; i++)
+        fn();
+    unsigned long elapsed = micros() - start;
+
+    float perCall = elapsed * 1000.0f / iterations;
+    char message[96];
+    snprintf(message, sizeof(message), "%s: %.1f ns/call", name, perCall);
+    TEST_MESSAGE(message);
+    return perCall;
+}
+
+void test_compile_time_disabled()
+{
+    argumentEvaluations = 0;
+    benchmark("LOGD (compiled out)", BENCH_ITERATIONS, []()
+              { LOGD(LOG_SERVER, "%s", expensiveArgument().c_str()); });
+    TEST_ASSERT_EQUAL(0, argumentEvaluations);
+}
+
+void test_runtime_disabled()
+{
+    logModuleLevels[LOG_SERVER] = DEBUG_ERR;
+    argumentEvaluations = 0;
+    float disabled = benchmark("LOGI (runtime disabled)", BENCH_ITERATIONS, []()
+                               { LOGI(LOG_SERVER, "%s", expensiveArgument().c_str()); });
+    TEST_ASSERT_EQUAL(0, argumentEvaluations);
+
+    logModuleLevels[LOG_SERVER] = DEBUG_INFO;
+    float enabled = benchmark("LOGI (enabled)", BENCH_ITERATIONS / 10, []()
+                              { LOGI(LOG_SERVER, "%s", expensiveArgument().c_str()); });
+    TEST_ASSERT_EQUAL(BENCH_ITERATIONS / 10, argumentEvaluations);
+
+    // Nothing is being drained, so most of the enabled calls have been dropped
+    char fragment[LOG_BUFFER_SLOT_SIZE];
+    while (logBuffer.pop(fragment) > 0)
+        ;
+    logBuffer.takeDropped();
+
+    // A disabled call is a load and a compare, it must be far below formatting a line
+    TEST_ASSERT_LESS_THAN(enabled / 10, disabled);
+}
+
+/**
+ * @brief Drains the log buffer, giving what was queued.
+ */
+std::string drainBuffer()
+{
+    std::string text;
+    char fragment[LOG_BUFFER_SLOT_SIZE];
+    size_t len;
+    while ((len = logBuffer.pop(fragment)) > 0)
+        text.append(fragment, len);
+    return text;
+}
+
+void test_long_lines()
+{
+    drainBuffer();
+    logBuffer.takeDropped();
+
+    // Lines over a slot come out whole
+    std::string line(LOG_BUFFER_SLOT_SIZE * 2 + 10, 'a');
+    logWrite(line.c_str(), line.size(), true);
+    TEST_ASSERT_TRUE(drainBuffer() == line + "\n");
+
+    // Lines over LOG_BUFFER_LINE_SLOTS slots are truncated, and counted
+    uint32_t truncated = logTruncatedLines.load();
+    std::string longest(LOG_BUFFER_LINE_SLOTS * LOG_BUFFER_SLOT_SIZE + 50, 'b');
+    logWrite(longest.c_str(), longest.size(), true);
+    TEST_ASSERT_EQUAL(truncated + 1, logTruncatedLines.load());
+    TEST_ASSERT_TRUE(drainBuffer() == longest.substr(0, LOG_BUFFER_LINE_SLOTS * LOG_BUFFER_SLOT_SIZE - 1) + "\n");
+
+    // A line that doesn't fit is dropped as a whole, instead of leaving its first fragments
+    std::string filler(LOG_BUFFER_SLOT_SIZE - 1, 'c');
+    for (int i = 0; i < LOG_BUFFER_SLOTS - 1; i++)
+        logWrite(filler.c_str(), filler.size(), true);
+    TEST_ASSERT_FALSE(logBuffer.push(line.c_str(), line.size(), true));
+    TEST_ASSERT_EQUAL(1, logBuffer.takeDropped());
+    std::string text = drainBuffer();
+    TEST_ASSERT_EQUAL((LOG_BUFFER_SLOTS - 1) * LOG_BUFFER_SLOT_SIZE, text.size());
+    TEST_ASSERT_TRUE(text.find('a') == std::string::npos);
+}
+
+/**
+ * @brief Appends [count] numbered lines to the log file, as the drain task does, and gives them.
+ */
+std::string appendLines(int from, int count)
+{
+    std::string text;
+    for (int i = from; i < from + count; i++)
+    {
+        char line[48];
+        snprintf(line, sizeof(line), "[bench] log line number %06d\n", i);
+        logFileAppend(line, strlen(line));
+        text += line;
+    }
+    return text;
+}
+
+/**
+ * @brief Reads the log from [start] to [end] as /logs does.
+ */
+std::string readLog(uint32_t start, uint32_t end)
+{
+    std::string text;
+    uint8_t buffer[1000];
+    size_t len;
+    while ((len = logFileRead(start + text.size(), end, buffer, sizeof(buffer))) > 0)
+        text.append((const char *)buffer, len);
+    return text;
+}
+
+void test_log_file()
+{
+    static RamStorage ram(1024 * 1024);
+    storage = &ram;
+    ram.mkdir(STORAGE_DIR_LOGS);
+    TEST_ASSERT_TRUE(logFileBegin());
+    TEST_ASSERT_EQUAL(0, logFileHead.load());
+
+    // More than the capacity, so the oldest segments are removed
+    std::string text = appendLines(0, 4000);
+    logFileFlush();
+    TEST_ASSERT_EQUAL(text.size(), logFileHead.load());
+    unsigned int segments = 0;
+    ram.list(STORAGE_DIR_LOGS, [&](const char *name, size_t size)
+             { segments++; });
+    TEST_ASSERT_EQUAL(LOG_FILE_SEGMENTS, segments);
+    TEST_ASSERT_GREATER_OR_EQUAL(LOG_FILE_CAPACITY - LOG_FILE_SEGMENT_SIZE, logFileHead.load() - logFileTail());
+    TEST_ASSERT_TRUE(readLog(logFileTail(), logFileHead.load()) == text.substr(logFileTail()));
+
+    // Continues after the last segment when booting again
+    uint32_t head = logFileHead.load();
+    TEST_ASSERT_TRUE(logFileBegin());
+    TEST_ASSERT_EQUAL(head, logFileHead.load());
+    text += appendLines(4000, 10);
+    logFileFlush();
+    TEST_ASSERT_TRUE(readLog(head - 100, logFileHead.load()) == text.substr(head - 100));
+
+    // Bytes that don't fit are counted as lost, without moving the cursor past what's stored
+    static RamStorage full(LOG_FILE_SEGMENT_SIZE + 100);
+    storage = &full;
+    full.mkdir(STORAGE_DIR_LOGS);
+    TEST_ASSERT_TRUE(logFileBegin());
+    text = appendLines(0, 400);
+    logFileFlush();
+    TEST_ASSERT_LESS_THAN(text.size(), logFileHead.load());
+    TEST_ASSERT_EQUAL(text.size(), logFileHead.load() + logFileLostBytes.load());
+    TEST_ASSERT_TRUE(readLog(0, logFileHead.load()) == text.substr(0, logFileHead.load()));
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_compile_time_disabled);
+    RUN_TEST(test_runtime_disabled);
+    RUN_TEST(test_long_lines);
+    RUN_TEST(test_log_file);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+    // Wait for the serial monitor to attach
+    delay(2000);
+    runTests();
+}
+
+void loop() {}
+#else
+int main(int argc, char **argv)
+{
+    return runTests();
+}
+#endif
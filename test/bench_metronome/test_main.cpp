@@ -0,0 +1,340 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Checks the beats counted by the metronome against the tempo map of a score with changes of tempo and time
+ * signature, and measures how late the beats fire and their callbacks run, with the CPU idle and with busy threads
+ * contending for it. A thread counting the beats with delays, as loop() would, is measured alongside for comparison.
+ * The timer of the metronome runs in its own thread, as an interrupt on the board, so on the host its beats can't be
+ * any closer than a sleeping thread is woken up, which is measured too.
+ * @version 0.1
+ * @date 2022-03-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <bench_score.h>
+#include <bench_setup.h>
+
+#include "config.h"
+#include "metronome.h"
+#include "renderer.h"
+
+#define BENCH_SCORE_ID "0123456789abcdef"
+#define BENCH_FAST_SCORE_ID "fedcba9876543210"
+
+/**
+ * @brief The sections of the score: measures, time signature and tempo.
+ */
+const BenchScoreSection benchSections[] = {
+    {8, 4, 4, mx::api::DurationName::quarter, 0, 120},
+    {8, 3, 4, mx::api::DurationName::quarter, 0, 90},
+    {8, 6, 8, mx::api::DurationName::quarter, 1, 60},
+    {8, 4, 4, mx::api::DurationName::half, 0, 80},
+};
+
+/**
+ * @brief The time between the beats while measuring, in microseconds, and how long it's measured.
+ */
+#define BENCH_BEAT_US 20000
+#define BENCH_RUN_MS 3000
+
+/**
+ * @brief How late the beats may be under contention, in microseconds, past how late the host wakes up a thread: most
+ * of them within a millisecond, and none adding up to half a beat.
+ */
+#define BENCH_MAX_LATE_US 1000
+#define BENCH_MAX_DRIFT_US (BENCH_BEAT_US / 2)
+
+#define BENCH_CLICK_PIN 25
+
+Layout benchLayout;
+
+/**
+ * @brief How late every beat fired and its callback ran, in microseconds.
+ */
+std::mutex benchLock;
+std::vector<uint32_t> benchFired;
+std::vector<uint32_t> benchCalled;
+std::vector<MetronomeBeat> benchBeats;
+
+void benchOnBeat(const MetronomeBeat &beat)
+{
+    uint64_t now = timerRead(metronomeTimer);
+    std::lock_guard<std::mutex> lock(benchLock);
+    benchFired.push_back(beat.fired - beat.due);
+    benchCalled.push_back(now - beat.due);
+    benchBeats.push_back(beat);
+}
+
+/**
+ * @brief A staff of eighths through [benchSections].
+ */
+mx::api::ScoreData benchScore()
+{
+    BenchScoreOptions options;
+    options.sections.assign(std::begin(benchSections), std::end(benchSections));
+    options.rhythm = BENCH_RHYTHM_EIGHTHS;
+    return benchScoreBuild(options);
+}
+
+/**
+ * @brief Gives a timeline of [measures] measures of 4/4 with a beat every [beatMicros] microseconds.
+ */
+Layout benchFastLayout(int measures, uint32_t beatMicros)
+{
+    Layout layout;
+    layout.id = BENCH_FAST_SCORE_ID;
+    uint32_t measureTicks = 4 * TIMELINE_TICKS_PER_QUARTER;
+    layout.pages.push_back(0);
+    layout.timeline.pages.push_back({0, measures * measureTicks, TIMELINE_TICKS_PER_QUARTER, 0});
+    layout.timeline.tempos.push_back({0, beatMicros});
+    layout.timeline.meters.push_back({0, 4, 4, 0});
+    return layout;
+}
+
+/**
+ * @brief Runs the metronome at a beat every BENCH_BEAT_US for BENCH_RUN_MS, and a loop counting the same beats with
+ * delays, reporting how late their beats are as [label].
+ */
+void benchJitter(const char *label)
+{
+    {
+        std::lock_guard<std::mutex> lock(benchLock);
+        benchFired.clear();
+        benchCalled.clear();
+        benchBeats.clear();
+    }
+    uint32_t beats = BENCH_RUN_MS * 1000 / BENCH_BEAT_US;
+    metronomeOpen(benchFastLayout(beats / 4 + 1, BENCH_BEAT_US));
+    metronomeOnBeat = benchOnBeat;
+    TEST_ASSERT_TRUE(metronomeStart(0));
+
+    // How late the host wakes up a thread sleeping until every beat
+    std::vector<uint32_t> woken;
+    std::thread sleeper([&woken, beats]()
+                        {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 1; i < beats; i++)
+        {
+            auto due = start + std::chrono::microseconds(i * BENCH_BEAT_US);
+            std::this_thread::sleep_until(due);
+            woken.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - due).count());
+        } });
+
+    // Counting the beats as loop() would, sleeping the length of a beat
+    std::vector<uint32_t> delayed;
+    unsigned long start = micros();
+    for (uint32_t i = 1; i < beats; i++)
+    {
+        delayMicroseconds(BENCH_BEAT_US);
+        delayed.push_back(micros() - start - i * BENCH_BEAT_US);
+    }
+    while (metronomeRunning.load())
+        delay(1);
+    delay(10);
+    metronomeOnBeat = NULL;
+    sleeper.join();
+
+    std::lock_guard<std::mutex> lock(benchLock);
+    TEST_ASSERT_GREATER_OR_EQUAL(beats, benchFired.size());
+    char message[400];
+    snprintf(message, sizeof(message), "%s, %u beats: fired late p50 %u us, p99 %u us, max %u us, last %u us; callback p50 %u us, p99 %u us; host wake-up p50 %u us, p99 %u us; delay loop p50 %u us, p99 %u us, last %u us",
+             label, (unsigned)benchFired.size(), benchPercentile(benchFired, 50), benchPercentile(benchFired, 99),
+             *std::max_element(benchFired.begin(), benchFired.end()), benchFired.back(), benchPercentile(benchCalled, 50),
+             benchPercentile(benchCalled, 99), benchPercentile(woken, 50), benchPercentile(woken, 99), benchPercentile(delayed, 50),
+             benchPercentile(delayed, 99), delayed.back());
+    TEST_MESSAGE(message);
+    // The timer of the host is a thread too, so it's never woken sooner than the sleeper
+    TEST_ASSERT_LESS_THAN(BENCH_MAX_LATE_US + benchPercentile(woken, 50), benchPercentile(benchFired, 50));
+    TEST_ASSERT_LESS_THAN(BENCH_MAX_DRIFT_US + benchPercentile(woken, 99), benchPercentile(benchFired, 99));
+    TEST_ASSERT_LESS_THAN(BENCH_MAX_DRIFT_US + benchPercentile(woken, 99), benchFired.back());
+}
+
+void test_tempoMap()
+{
+    const Timeline &timeline = benchLayout.timeline;
+    size_t sections = sizeof(benchSections) / sizeof(benchSections[0]);
+    TEST_ASSERT_EQUAL(sections, timeline.tempos.size());
+    TEST_ASSERT_EQUAL(sections, timeline.meters.size());
+    uint32_t tick = 0;
+    for (size_t i = 0; i < sections; i++)
+    {
+        const BenchScoreSection &section = benchSections[i];
+        TEST_ASSERT_EQUAL(tick, timeline.tempos[i].tick);
+        TEST_ASSERT_EQUAL(tick, timeline.meters[i].tick);
+        TEST_ASSERT_EQUAL(section.beats, timeline.meters[i].beats);
+        TEST_ASSERT_EQUAL(section.beatType, timeline.meters[i].beatType);
+        tick += section.measures * section.beats * TIMELINE_TICKS_PER_QUARTER * 4 / section.beatType;
+    }
+    // 120 quarters, 90 quarters, 60 dotted quarters and 80 halves per minute
+    TEST_ASSERT_EQUAL(500000, timeline.tempos[0].quarterMicros);
+    TEST_ASSERT_EQUAL(666666, timeline.tempos[1].quarterMicros);
+    TEST_ASSERT_EQUAL(666666, timeline.tempos[2].quarterMicros);
+    TEST_ASSERT_EQUAL(375000, timeline.tempos[3].quarterMicros);
+    TEST_ASSERT_EQUAL(tick, timeline.pages.back().end);
+
+    // Kept in the cache with the pages
+    Layout loaded;
+    TEST_ASSERT_TRUE(layoutLoad(BENCH_SCORE_ID, layoutGeometry, loaded));
+    TEST_ASSERT_EQUAL(timeline.tempos.size(), loaded.timeline.tempos.size());
+    TEST_ASSERT_EQUAL(timeline.meters.size(), loaded.timeline.meters.size());
+    TEST_ASSERT_EQUAL(timeline.tempos[3].quarterMicros, loaded.timeline.tempos[3].quarterMicros);
+}
+
+void test_schedule()
+{
+    const Timeline &timeline = benchLayout.timeline;
+    MetronomeCursor cursor;
+    metronomeSeek(timeline, cursor, 0, 0);
+    MetronomeBeat beat;
+    double expected = 0;
+    uint32_t count = 0;
+    for (const BenchScoreSection &section : benchSections)
+    {
+        double beatMicros = timeline.tempos[&section - benchSections].quarterMicros * 4.0 / section.beatType;
+        for (int m = 0; m < section.measures; m++)
+            for (int b = 0; b < section.beats; b++)
+            {
+                TEST_ASSERT_TRUE(metronomeNext(timeline, cursor, 0, beat));
+                TEST_ASSERT_EQUAL(b, beat.beat);
+                TEST_ASSERT_EQUAL(section.beats, beat.beats);
+                // Computed from the start of the tempo, never adding up the rounding of every beat
+                TEST_ASSERT_UINT32_WITHIN(2, (uint32_t)expected, (uint32_t)beat.due);
+                expected += beatMicros;
+                count++;
+            }
+    }
+    TEST_ASSERT_FALSE(metronomeNext(timeline, cursor, 0, beat));
+
+    // From the start of a page, and within a beat
+    TEST_ASSERT_GREATER_THAN(1, timeline.pages.size());
+    uint32_t start = timeline.pages[1].start;
+    metronomeSeek(timeline, cursor, start, 0);
+    TEST_ASSERT_TRUE(metronomeNext(timeline, cursor, 0, beat));
+    TEST_ASSERT_EQUAL(start, beat.tick);
+    TEST_ASSERT_EQUAL(0, beat.beat);
+    TEST_ASSERT_EQUAL(1, beat.page);
+    metronomeSeek(timeline, cursor, start + 1, 0);
+    TEST_ASSERT_TRUE(metronomeNext(timeline, cursor, 0, beat));
+    TEST_ASSERT_EQUAL(1, beat.beat);
+
+    char message[100];
+    snprintf(message, sizeof(message), "%u beats in %u pages, %.1f s", count, (unsigned)timeline.pages.size(), expected / 1e6);
+    TEST_MESSAGE(message);
+}
+
+void test_jitterIdle()
+{
+    benchJitter("Idle");
+}
+
+void test_jitterContended()
+{
+    // Busy threads contending for every core, twice over
+    std::atomic<bool> busy{true};
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < 2 * std::max(1u, std::thread::hardware_concurrency()); i++)
+        threads.emplace_back([&busy]()
+                             {
+            volatile uint64_t sink = 0;
+            while (busy.load(std::memory_order_relaxed))
+            {
+                std::vector<uint32_t> churn(1024, sink);
+                for (uint32_t &value : churn)
+                    sink += value * 2654435761u;
+            } });
+    benchJitter("Contended");
+    busy = false;
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void test_scroll()
+{
+    // The last pages of the score, fast
+    Layout layout = benchLayout;
+    for (TimelineTempo &tempo : layout.timeline.tempos)
+        tempo.quarterMicros /= 50;
+    int32_t last = layout.pages.size() - 1;
+    renderOpen(layout);
+    metronomeOpen(layout);
+    metronomeScrollBeats = 2;
+    renderGoTo(last - 1);
+    delay(100);
+    TEST_ASSERT_TRUE(metronomeStartPage(last - 1));
+    unsigned long start = millis();
+    while (metronomeRunning.load() && millis() - start < 10000)
+        delay(1);
+    delay(100);
+    TEST_ASSERT_EQUAL(last, renderPage.load());
+    metronomeScrollBeats = 0;
+}
+
+void test_stop()
+{
+    metronomeOpen(benchFastLayout(100, BENCH_BEAT_US));
+    uint32_t beats = metronomeBeatCount.get();
+    TEST_ASSERT_TRUE(metronomeStart(0));
+    delay(10 * BENCH_BEAT_US / 1000);
+    metronomeStop();
+    delay(10);
+    uint32_t counted = metronomeBeatCount.get();
+    TEST_ASSERT_GREATER_THAN(beats, counted);
+    delay(5 * BENCH_BEAT_US / 1000);
+    TEST_ASSERT_EQUAL(counted, metronomeBeatCount.get());
+    TEST_ASSERT_FALSE(metronomeRunning.load());
+    TEST_ASSERT_EQUAL(LOW, digitalRead(BENCH_CLICK_PIN));
+}
+
+void test_config()
+{
+    // Input only, taken by the flash, UART0, the microphone and the pedals, or a strapping pin
+    BENCH_CONFIG_REJECTS("metronome.pin", ERR_CONFIG_BOUNDS, "34", "6", "1", "14", "15", "32", "33", "2", "4294967322");
+    BENCH_CONFIG_REJECTS("metronome.scroll", ERR_CONFIG_BOUNDS, "9", "-1");
+    BENCH_CONFIG_REJECTS_NUMBERS("metronome.pin");
+    BENCH_CONFIG_REJECTS_NUMBERS("metronome.scroll");
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_KEY, configure("metronome.other", "1"));
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("metronome.pin", "26"));
+    TEST_ASSERT_EQUAL(26, metronomePin);
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("metronome.pin", "-1"));
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("metronome.scroll", "3"));
+    TEST_ASSERT_EQUAL(-1, metronomePin);
+    TEST_ASSERT_EQUAL(3, metronomeScrollBeats.load());
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tempoMap);
+    RUN_TEST(test_schedule);
+    RUN_TEST(test_jitterIdle);
+    RUN_TEST(test_jitterContended);
+    RUN_TEST(test_scroll);
+    RUN_TEST(test_stop);
+    RUN_TEST(test_config);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    benchStorageSetUp(8 * 1024 * 1024);
+    preferences.putInt(pref_metronomePin, BENCH_CLICK_PIN);
+    if (!layoutBuild(BENCH_SCORE_ID, benchScore(), layoutGeometry, benchLayout))
+        return 1;
+    renderBegin();
+    metronomeBegin();
+    return runTests();
+}
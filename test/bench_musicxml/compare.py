@@ -0,0 +1,71 @@
+import argparse
+import re
+import sys
+
+# Checks the results printed by the bench_musicxml suite on the device against baseline.txt, failing when any score
+# regressed beyond its margin. libmx is only built for the device, so the suite can't run on the native environment.
+#
+# Usage:
+#   pio test -e esp32doit-devkit-v1 -f bench_musicxml | python test/bench_musicxml/compare.py
+#   pio test -e esp32doit-devkit-v1 -f bench_musicxml | python test/bench_musicxml/compare.py --update
+
+FIELDS = ["time", "allocations", "peak heap", "bytes read"]
+
+# How much every field may grow over the baseline, in percent and in absolute units. Both must be exceeded, so the
+# timer resolution doesn't fail the small scores.
+MARGIN_PERCENT = [50, 10, 10, 10]
+SLACK = [200, 0, 0, 0]
+
+result_regex = re.compile(r"BENCH (\S+) (\d+) (\d+) (\d+) (\d+)")
+
+
+def parse(lines):
+    results = {}
+    for line in lines:
+        match = result_regex.search(line)
+        if match:
+            results[match.group(1)] = [int(value) for value in match.groups()[1:]]
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compares the MusicXML benchmark with its baseline.")
+    parser.add_argument("input", nargs="?", help="A file with the output of the suite. Reads stdin if missing.")
+    parser.add_argument("--baseline", default="test/bench_musicxml/baseline.txt")
+    parser.add_argument("--update", action="store_true", help="Replace the baseline with the results.")
+    args = parser.parse_args()
+
+    text = open(args.input, "r").read() if args.input else sys.stdin.read()
+    results = parse(text.splitlines())
+    if not results:
+        sys.exit("No results found, did the suite run?")
+
+    if args.update:
+        with open(args.baseline, "w") as stream:
+            stream.write("# name time_us allocations peak_bytes bytes_read, measured on the device\n")
+            for name, values in results.items():
+                stream.write(" ".join([name] + [str(value) for value in values]) + "\n")
+        print("Baseline updated")
+        return
+
+    with open(args.baseline, "r") as stream:
+        baseline = parse("BENCH " + line for line in stream if not line.startswith("#"))
+
+    passed = True
+    for name, values in results.items():
+        if name not in baseline:
+            print(f"{name}: not in the baseline, run with --update for adding it")
+            passed = False
+            continue
+        for field, value, base, percent, slack in zip(FIELDS, values, baseline[name], MARGIN_PERCENT, SLACK):
+            limit = base + base * percent // 100 + slack
+            if value > limit:
+                print(f"{name}: {field} regressed from {base} to {value} (limit {limit})")
+                passed = False
+    if not passed:
+        sys.exit("Regressions over the baseline")
+    print(f"{len(results)} scores within the baseline")
+
+
+if __name__ == "__main__":
+    main()
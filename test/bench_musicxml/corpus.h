@@ -0,0 +1,278 @@
+/**
+ * @file corpus.h
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief The MusicXML scores measured by the parsing benchmark: a public domain melody, and generated scores from a
+ * one page solo to a full orchestra. The generator is deterministic, so the scores are the same in every run.
+ * @version 0.1
+ * @date 2022-03-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <Arduino.h>
+
+#include <functional>
+#include <string>
+
+/**
+ * @brief The shape of a generated score.
+ */
+struct CorpusScore
+{
+    const char *name;
+    int parts;
+
+    /**
+     * @brief The staves of every part, 2 for piano parts.
+     */
+    int staves;
+    int measures;
+
+    /**
+     * @brief Whether notes are stacked into chords of three.
+     */
+    bool chords;
+};
+
+const CorpusScore corpusScores[] = {
+    {"solo_16", 1, 1, 16, false},
+    {"solo_64", 1, 1, 64, false},
+    {"piano_64", 1, 2, 64, true},
+    {"quartet_100", 4, 1, 100, false},
+    {"orchestra_100", 16, 1, 100, false},
+};
+
+/**
+ * @brief "Ode to Joy", from the 9th symphony of Ludwig van Beethoven (1824), which is in the public domain.
+ */
+#define CORPUS_ODE_TO_JOY_MEASURES 16
+
+const char corpusOdeToJoy[] = R"(<?xml version="1.0" encoding="UTF-8" standalone="no"?>
+<!DOCTYPE score-partwise PUBLIC "-//Recordare//DTD MusicXML 3.1 Partwise//EN" "http://www.musicxml.org/dtds/partwise.dtd">
+<score-partwise version="3.1">
+  <work><work-title>Ode to Joy</work-title></work>
+  <identification><creator type="composer">Ludwig van Beethoven</creator></identification>
+  <part-list><score-part id="P1"><part-name>Melody</part-name></score-part></part-list>
+  <part id="P1">
+    <measure number="1">
+      <attributes><divisions>2</divisions><key><fifths>0</fifths></key><time><beats>4</beats><beat-type>4</beat-type></time><clef><sign>G</sign><line>2</line></clef></attributes>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="2">
+      <note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="3">
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="4">
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>3</duration><type>quarter</type><dot/></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>4</duration><type>half</type></note>
+    </measure>
+    <measure number="5">
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="6">
+      <note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="7">
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="8">
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>3</duration><type>quarter</type><dot/></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>4</duration><type>half</type></note>
+    </measure>
+    <measure number="9">
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="10">
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="11">
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="12">
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>G</step><octave>3</octave></pitch><duration>4</duration><type>half</type></note>
+    </measure>
+    <measure number="13">
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="14">
+      <note><pitch><step>G</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>F</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="15">
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+      <note><pitch><step>E</step><octave>4</octave></pitch><duration>2</duration><type>quarter</type></note>
+    </measure>
+    <measure number="16">
+      <note><pitch><step>D</step><octave>4</octave></pitch><duration>3</duration><type>quarter</type><dot/></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>1</duration><type>eighth</type></note>
+      <note><pitch><step>C</step><octave>4</octave></pitch><duration>4</duration><type>half</type></note>
+      <barline location="right"><bar-style>light-heavy</bar-style></barline>
+    </measure>
+  </part>
+</score-partwise>
+)";
+
+/**
+ * @brief The state of the pseudo-random generator, reset for every score.
+ */
+uint32_t corpusSeed;
+
+uint32_t corpusRandom(uint32_t range)
+{
+    corpusSeed = corpusSeed * 1664525 + 1013904223;
+    return (corpusSeed >> 16) % range;
+}
+
+/**
+ * @brief Appends a note of [type], lasting [duration] divisions, to [out]. Pitches walk around the staff.
+ */
+void corpusAppendNote(std::string &out, int staff, int duration, const char *type, bool chord, bool rest)
+{
+    const char steps[] = "CDEFGAB";
+    out += "<note>";
+    if (chord)
+        out += "<chord/>";
+    if (rest)
+        out += "<rest/>";
+    else
+    {
+        out += "<pitch><step>";
+        out += steps[corpusRandom(7)];
+        out += "</step>";
+        if (corpusRandom(8) == 0)
+            out += "<alter>1</alter>";
+        out += "<octave>";
+        out += std::to_string(staff == 2 ? 2 + corpusRandom(2) : 4 + corpusRandom(2));
+        out += "</octave></pitch>";
+    }
+    out += "<duration>" + std::to_string(duration) + "</duration>";
+    out += "<voice>" + std::to_string(staff) + "</voice>";
+    out += "<type>";
+    out += type;
+    out += "</type>";
+    if (staff > 1)
+        out += "<staff>" + std::to_string(staff) + "</staff>";
+    out += "</note>\n";
+}
+
+/**
+ * @brief Generates the MusicXML of [score], in 4/4 with quarters, pairs of eighths, halves and rests. The text is
+ * given to [sink] a measure at a time, so the largest scores never have to fit in memory.
+ */
+void corpusGenerate(const CorpusScore &score, std::function<void(const std::string &)> sink)
+{
+    corpusSeed = score.parts * 7919 + score.staves * 104729 + score.measures;
+    std::string out = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+                      "<score-partwise version=\"3.1\">\n";
+    out += "<work><work-title>";
+    out += score.name;
+    out += "</work-title></work>\n<part-list>\n";
+    for (int p = 1; p <= score.parts; p++)
+        out += "<score-part id=\"P" + std::to_string(p) + "\"><part-name>Part " + std::to_string(p) + "</part-name></score-part>\n";
+    out += "</part-list>\n";
+
+    for (int p = 1; p <= score.parts; p++)
+    {
+        out += "<part id=\"P" + std::to_string(p) + "\">\n";
+        for (int m = 1; m <= score.measures; m++)
+        {
+            out += "<measure number=\"" + std::to_string(m) + "\">\n";
+            if (m == 1)
+            {
+                out += "<attributes><divisions>2</divisions><key><fifths>" + std::to_string((int)corpusRandom(5) - 2) + "</fifths></key>"
+                       "<time><beats>4</beats><beat-type>4</beat-type></time>";
+                if (score.staves > 1)
+                    out += "<staves>2</staves><clef number=\"1\"><sign>G</sign><line>2</line></clef><clef number=\"2\"><sign>F</sign><line>4</line></clef>";
+                else
+                    out += "<clef><sign>G</sign><line>2</line></clef>";
+                out += "</attributes>\n";
+            }
+            for (int staff = 1; staff <= score.staves; staff++)
+            {
+                if (staff > 1)
+                    out += "<backup><duration>8</duration></backup>\n";
+                int beat = 0;
+                while (beat < 4)
+                {
+                    uint32_t shape = corpusRandom(beat <= 2 ? 6 : 4);
+                    int chordNotes = score.chords ? 2 : 0;
+                    if (shape == 0)
+                        corpusAppendNote(out, staff, 2, "quarter", false, true);
+                    else if (shape == 1)
+                    {
+                        corpusAppendNote(out, staff, 1, "eighth", false, false);
+                        corpusAppendNote(out, staff, 1, "eighth", false, false);
+                    }
+                    else if (shape >= 4)
+                    {
+                        corpusAppendNote(out, staff, 4, "half", false, false);
+                        for (int c = 0; c < chordNotes; c++)
+                            corpusAppendNote(out, staff, 4, "half", true, false);
+                        beat++;
+                    }
+                    else
+                    {
+                        corpusAppendNote(out, staff, 2, "quarter", false, false);
+                        for (int c = 0; c < chordNotes; c++)
+                            corpusAppendNote(out, staff, 2, "quarter", true, false);
+                    }
+                    beat++;
+                }
+            }
+            out += "</measure>\n";
+            sink(out);
+            out.clear();
+        }
+        out += "</part>\n";
+    }
+    out += "</score-partwise>\n";
+    sink(out);
+}
+
+#endif
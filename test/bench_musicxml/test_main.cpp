@@ -0,0 +1,258 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Measures parsing every score of the corpus with libmx: parse time, allocations, peak heap and bytes read. It
+ * only runs on the device, since libmx isn't built for the native environment. Every result is printed as a line
+ * "BENCH <name> <time_us> <allocations> <peak_bytes> <bytes_read>", which compare.py checks against baseline.txt.
+ * The storage partition is written.
+ * @version 0.1
+ * @date 2022-03-02
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <atomic>
+#include <climits>
+#include <new>
+
+#include "musicxml.h"
+#include "corpus.h"
+#include "filesystem.h"
+
+/**
+ * @brief The amount of times every score is loaded. The fastest run is kept, since the others only add noise.
+ */
+#define BENCH_RUNS 5
+
+/**
+ * @brief The largest generated score loaded on the device, in measures of all the parts. The DOM of libmx for the
+ * larger ones doesn't fit in the heap.
+ */
+#define BENCH_DEVICE_MAX_MEASURES 128
+
+/**
+ * @brief What's measured for each score.
+ */
+struct BenchResult
+{
+    String name;
+    unsigned long timeUs;
+    unsigned long allocations;
+    unsigned long peakBytes;
+    unsigned long bytesRead;
+};
+
+/**
+ * @brief The heap used by the code measured. Only counted while [allocTracking] is set.
+ */
+std::atomic<bool> allocTracking{false};
+std::atomic<unsigned long> allocCount{0};
+std::atomic<long> allocCurrent{0};
+std::atomic<long> allocPeak{0};
+
+/**
+ * @brief Kept before every allocation for knowing its size when freed. Large enough for keeping the alignment.
+ */
+#define ALLOC_HEADER_SIZE 16
+
+void *operator new(size_t size)
+{
+    uint8_t *block = (uint8_t *)malloc(size + ALLOC_HEADER_SIZE);
+    if (block == nullptr)
+        throw std::bad_alloc();
+    *(size_t *)block = size;
+    if (allocTracking.load(std::memory_order_relaxed))
+    {
+        allocCount.fetch_add(1, std::memory_order_relaxed);
+        long current = allocCurrent.fetch_add(size, std::memory_order_relaxed) + size;
+        long peak = allocPeak.load(std::memory_order_relaxed);
+        while (current > peak && !allocPeak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+            ;
+    }
+    return block + ALLOC_HEADER_SIZE;
+}
+
+/**
+ * @brief Frees a block given by the operator new above. Not inlined, so the compiler doesn't see free called on what
+ * operator new returned.
+ */
+__attribute__((noinline)) void allocFree(void *pointer)
+{
+    uint8_t *block = (uint8_t *)pointer - ALLOC_HEADER_SIZE;
+    if (allocTracking.load(std::memory_order_relaxed))
+        allocCurrent.fetch_sub(*(size_t *)block, std::memory_order_relaxed);
+    free(block);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    if (pointer != nullptr)
+        allocFree(pointer);
+}
+
+// The size is also kept in the header of the block
+void operator delete(void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+/**
+ * @brief A file that counts the bytes read from it into [countingBytesRead].
+ */
+unsigned long countingBytesRead = 0;
+
+class CountingStorageFile : public StorageFile
+{
+public:
+    CountingStorageFile(std::unique_ptr<StorageFile> file) : file(std::move(file)) {}
+
+    size_t read(uint8_t *buffer, size_t len) override
+    {
+        size_t read = file->read(buffer, len);
+        countingBytesRead += read;
+        return read;
+    }
+    size_t write(const uint8_t *data, size_t len) override { return file->write(data, len); }
+    bool seek(size_t position) override { return file->seek(position); }
+    size_t position() override { return file->position(); }
+    size_t size() override { return file->size(); }
+
+private:
+    std::unique_ptr<StorageFile> file;
+};
+
+/**
+ * @brief Forwards everything to [backend], counting the bytes read from the files it opens.
+ */
+class CountingStorage : public Storage
+{
+public:
+    CountingStorage(Storage &backend) : backend(backend) {}
+
+    std::unique_ptr<StorageFile> open(const char *path, const char *mode) override
+    {
+        std::unique_ptr<StorageFile> file = backend.open(path, mode);
+        if (!file)
+            return nullptr;
+        return std::unique_ptr<StorageFile>(new CountingStorageFile(std::move(file)));
+    }
+    bool stat(const char *path, StorageStat &out) override { return backend.stat(path, out); }
+    bool list(const char *path, std::function<void(const char *name, size_t size)> callback) override { return backend.list(path, callback); }
+    bool rename(const char *from, const char *to) override { return backend.rename(from, to); }
+    bool remove(const char *path) override { return backend.remove(path); }
+    bool mkdir(const char *path) override { return backend.mkdir(path); }
+    size_t totalBytes() override { return backend.totalBytes(); }
+    size_t usedBytes() override { return backend.usedBytes(); }
+
+private:
+    Storage &backend;
+};
+
+Storage *benchBackend;
+
+/**
+ * @brief Parses the score at [path] [BENCH_RUNS] times, and stores what was measured as [name]. Every run must give
+ * [parts] parts of [measures] measures.
+ */
+void measureScore(const char *name, const String &path, size_t parts, size_t measures)
+{
+    CountingStorage counting(*benchBackend);
+    storage = &counting;
+    // The log would be measured too otherwise
+    uint8_t level = logModuleLevels[LOG_MUSIC];
+    logModuleLevels[LOG_MUSIC] = DEBUG_ERR;
+
+    BenchResult result = {name, ULONG_MAX, 0, 0, 0};
+    bool parsedAll = true;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        countingBytesRead = 0;
+        allocCount = 0;
+        allocCurrent = 0;
+        allocPeak = 0;
+        mx::api::ScoreData score;
+        allocTracking = true;
+        unsigned long start = micros();
+        bool parsed = parseScore(path, score);
+        unsigned long elapsed = micros() - start;
+        allocTracking = false;
+        parsedAll &= parsed && score.parts.size() == parts;
+        for (const mx::api::PartData &part : score.parts)
+            parsedAll &= part.measures.size() == measures;
+
+        result.timeUs = min(result.timeUs, elapsed);
+        // The same in every run, but the first one could include lazily created singletons
+        result.allocations = allocCount;
+        result.peakBytes = allocPeak;
+        result.bytesRead = countingBytesRead;
+    }
+
+    logModuleLevels[LOG_MUSIC] = level;
+    storage = benchBackend;
+    TEST_ASSERT_TRUE_MESSAGE(parsedAll, "The score wasn't parsed into its parts and measures");
+
+    char message[128];
+    snprintf(message, sizeof(message), "BENCH %s %lu %lu %lu %lu",
+             name, result.timeUs, result.allocations, result.peakBytes, result.bytesRead);
+    TEST_MESSAGE(message);
+}
+
+void test_odeToJoy()
+{
+    String path = STORAGE_DIR_SCORES "/ode_to_joy.xml";
+    std::unique_ptr<StorageFile> file = benchBackend->open(path.c_str(), "w");
+    TEST_ASSERT_NOT_NULL(file.get());
+    size_t len = sizeof(corpusOdeToJoy) - 1;
+    TEST_ASSERT_EQUAL(len, file->write((const uint8_t *)corpusOdeToJoy, len));
+    file.reset();
+    measureScore("ode_to_joy", path, 1, CORPUS_ODE_TO_JOY_MEASURES);
+}
+
+void test_generated()
+{
+    for (const CorpusScore &score : corpusScores)
+    {
+        if (score.parts * score.staves * score.measures > BENCH_DEVICE_MAX_MEASURES)
+        {
+            char message[64];
+            snprintf(message, sizeof(message), "%s: skipped, too large for the device", score.name);
+            TEST_MESSAGE(message);
+            continue;
+        }
+        String path = String(STORAGE_DIR_SCORES "/") + score.name + ".xml";
+        std::unique_ptr<StorageFile> file = benchBackend->open(path.c_str(), "w");
+        TEST_ASSERT_NOT_NULL(file.get());
+        bool written = true;
+        corpusGenerate(score, [&](const std::string &text)
+                       { written &= file->write((const uint8_t *)text.data(), text.size()) == text.size(); });
+        file.reset();
+        TEST_ASSERT_TRUE_MESSAGE(written, "Storage full");
+        measureScore(score.name, path, score.parts, score.measures);
+        benchBackend->remove(path.c_str());
+    }
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_odeToJoy);
+    RUN_TEST(test_generated);
+    return UNITY_END();
+}
+
+void setup()
+{
+    // Wait for the serial monitor to attach
+    delay(2000);
+    storageBegin();
+    benchBackend = storage;
+    runTests();
+}
+
+void loop() {}
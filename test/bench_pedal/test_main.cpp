@@ -0,0 +1,324 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Presses the pedals as told by a script, bounces included, and measures the time from the first edge of every
+ * press until its page is sent to the display. The pins are driven through the GPIO stand-ins, which run the
+ * interrupts of the pedals, and the debounce timers run in their own threads. Set BENCH_PEDAL_SCRIPT to the path of
+ * another script for replaying it instead.
+ * @version 0.1
+ * @date 2022-03-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <bench_score.h>
+#include <bench_setup.h>
+
+#include "config.h"
+#include "pedal.h"
+#include "renderer.h"
+
+#define BENCH_SCORE_ID "0123456789abcdef"
+#define BENCH_MEASURES 200
+
+/**
+ * @brief How long a page may take to be shown after its press, in milliseconds.
+ */
+#define BENCH_TURN_TIMEOUT_MS 2000
+
+/**
+ * @brief The time between the edges of a bounce, in microseconds. All of them are within the debounce time.
+ */
+#define BENCH_BOUNCE_US 400
+
+/**
+ * @brief Every line is "<time in ms> <next|previous> <press|release> [bounces=<amount>]", times counting from the
+ * start of the script. Lines starting with # are comments.
+ */
+const char *benchScript = R"(# Turning through the score, every press with a different amount of bounces
+0 next press bounces=3
+80 next release bounces=2
+400 next press
+480 next release bounces=5
+800 next press bounces=8
+900 next release
+1200 next press bounces=1
+1260 next release bounces=1
+# Back and forth
+1600 previous press bounces=4
+1700 previous release bounces=4
+2000 previous press
+2050 previous release
+2400 next press bounces=2
+2500 next release bounces=2
+# Held down, turns once
+2800 next press bounces=6
+4000 next release bounces=6
+# Pressed again right after the contacts settled
+4300 next press bounces=2
+4340 next release
+4380 next press
+4420 next release bounces=2
+# Both at once
+4800 next press bounces=3
+4800 previous press bounces=3
+4900 next release
+4900 previous release
+)";
+
+struct BenchEvent
+{
+    uint32_t time;
+    int pedal;
+    bool press;
+    int bounces;
+};
+
+Layout benchLayout;
+
+/**
+ * @brief The last page sent to the display, and when.
+ */
+std::atomic<int32_t> benchShownPage{-1};
+std::atomic<uint32_t> benchShownAt{0};
+std::atomic<uint32_t> benchShows{0};
+
+void benchDisplay(const FrameBuffer &buffer, const Damage &damage)
+{
+    benchShownAt = micros();
+    benchShownPage = buffer.page;
+    benchShows++;
+}
+
+/**
+ * @brief Builds a score for a staff, long enough to have a few pages.
+ */
+mx::api::ScoreData benchScore()
+{
+    BenchScoreOptions options;
+    options.sections = {{BENCH_MEASURES}};
+    return benchScoreBuild(options);
+}
+
+bool parseScript(const std::string &script, std::vector<BenchEvent> &events)
+{
+    std::istringstream lines(script);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        BenchEvent event = {0, 0, false, 0};
+        std::string pedal, action, bounces;
+        if (!(fields >> event.time >> pedal >> action))
+            return false;
+        if (pedal != "next" && pedal != "previous")
+            return false;
+        if (action != "press" && action != "release")
+            return false;
+        event.pedal = pedal == "next" ? 0 : 1;
+        event.press = action == "press";
+        if (fields >> bounces)
+        {
+            if (bounces.rfind("bounces=", 0) != 0)
+                return false;
+            event.bounces = atoi(bounces.c_str() + strlen("bounces="));
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+/**
+ * @brief Drives the pin of [event]'s pedal, bouncing before it settles.
+ */
+void drive(const BenchEvent &event)
+{
+    uint8_t pin = pedals[event.pedal].pin;
+    uint8_t level = event.press ? pedalPressedLevel : !pedalPressedLevel;
+    digitalWrite(pin, level);
+    for (int i = 0; i < event.bounces; i++)
+    {
+        delayMicroseconds(BENCH_BOUNCE_US);
+        digitalWrite(pin, !level);
+        delayMicroseconds(BENCH_BOUNCE_US);
+        digitalWrite(pin, level);
+    }
+}
+
+void waitIdle()
+{
+    // The pages around the one shown are drawn ahead
+    delay(300);
+}
+
+void test_script()
+{
+    std::string script = benchScript;
+    const char *path = getenv("BENCH_PEDAL_SCRIPT");
+    if (path)
+    {
+        std::ifstream file(path);
+        TEST_ASSERT_TRUE_MESSAGE(file.good(), "Could not open the script");
+        std::stringstream contents;
+        contents << file.rdbuf();
+        script = contents.str();
+    }
+    std::vector<BenchEvent> events;
+    TEST_ASSERT_TRUE_MESSAGE(parseScript(script, events), "Could not parse the script");
+
+    renderOpen(benchLayout);
+    waitIdle();
+    TEST_ASSERT_EQUAL(0, benchShownPage.load());
+
+    int32_t pageCount = benchLayout.pages.size();
+    int32_t expected = 0;
+    uint32_t presses = 0, edges = 0;
+    uint32_t pressesBefore = pedalPresses.get(), bouncesBefore = pedalBounces.get();
+    std::vector<uint32_t> latencies;
+    unsigned long start = millis();
+    for (const BenchEvent &event : events)
+    {
+        while (millis() - start < event.time)
+            delay(1);
+        uint32_t shows = benchShows.load();
+        uint32_t pressedAt = micros();
+        drive(event);
+        edges += 1 + 2 * event.bounces;
+        if (!event.press)
+            continue;
+        presses++;
+        int32_t target = max((int32_t)0, min(expected + pedals[event.pedal].pages, pageCount - 1));
+        if (target == expected)
+            continue;
+        expected = target;
+        // Waits for the page, unless the next press comes first
+        unsigned long waiting = millis();
+        while (benchShownPage.load() != expected && millis() - waiting < BENCH_TURN_TIMEOUT_MS)
+            delayMicroseconds(100);
+        TEST_ASSERT_EQUAL(expected, benchShownPage.load());
+        if (benchShows.load() > shows)
+            latencies.push_back(benchShownAt.load() - pressedAt);
+    }
+    waitIdle();
+
+    TEST_ASSERT_EQUAL(expected, benchShownPage.load());
+    TEST_ASSERT_EQUAL(presses, pedalPresses.get() - pressesBefore);
+    // Only the first edge of every press and release is taken, the rest are bounces
+    uint32_t bounces = pedalBounces.get() - bouncesBefore;
+    TEST_ASSERT_EQUAL(edges - events.size(), bounces);
+    TEST_ASSERT_FALSE(latencies.empty());
+
+    char message[200];
+    snprintf(message, sizeof(message), "%u presses, %u edges, %u bounces ignored, %u turns shown: pedal to page p50 %u us, p99 %u us, max %u us",
+             presses, edges, bounces, (unsigned)latencies.size(), benchPercentile(latencies, 50), benchPercentile(latencies, 99),
+             *std::max_element(latencies.begin(), latencies.end()));
+    TEST_MESSAGE(message);
+}
+
+void test_config()
+{
+    // Input only, taken by the flash, UART0, the microphone, the metronome and the other pedal, or a strapping pin
+    preferences.putInt(pref_metronomePin, 25);
+    BENCH_CONFIG_REJECTS("pedal.next", ERR_CONFIG_BOUNDS, "34", "6", "11", "1", "3", "14", "15", "25", "33", "12", "-2");
+    BENCH_CONFIG_REJECTS("pedal.debounce", ERR_CONFIG_BOUNDS, "0", "501");
+    BENCH_CONFIG_REJECTS("pedal.invert", ERR_CONFIG_BOUNDS, "2", "-1");
+    BENCH_CONFIG_REJECTS_NUMBERS("pedal.next");
+    BENCH_CONFIG_REJECTS_NUMBERS("pedal.debounce");
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_KEY, configure("pedal.other", "1"));
+
+    // Pedals that close when released, on other pins
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("pedal.invert", "1"));
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("pedal.next", "26"));
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("pedal.previous", "-1"));
+    TEST_ASSERT_EQUAL(HIGH, pedalPressedLevel);
+    TEST_ASSERT_EQUAL(26, pedals[0].pin);
+    TEST_ASSERT_EQUAL(-1, pedals[1].pin);
+
+    renderOpen(benchLayout);
+    waitIdle();
+    uint32_t presses = pedalPresses.get();
+    digitalWrite(26, LOW);
+    digitalWrite(26, HIGH);
+    delay(PEDAL_DEFAULT_DEBOUNCE_MS * 2);
+    digitalWrite(26, LOW);
+    delay(PEDAL_DEFAULT_DEBOUNCE_MS * 2);
+    waitIdle();
+    TEST_ASSERT_EQUAL(presses + 1, pedalPresses.get());
+    TEST_ASSERT_EQUAL(1, benchShownPage.load());
+
+    // The pedals detached are not taken
+    digitalWrite(PEDAL_DEFAULT_PREVIOUS_PIN, LOW);
+    digitalWrite(PEDAL_DEFAULT_PREVIOUS_PIN, HIGH);
+    TEST_ASSERT_EQUAL(presses + 1, pedalPresses.get());
+}
+
+void test_evicted()
+{
+    // The score is stored, it's parsed when laid out again
+    {
+        std::unique_ptr<StorageFile> file = storage->open(scoreBlobPath(BENCH_SCORE_ID).c_str(), "w");
+        TEST_ASSERT_NOT_NULL(file.get());
+        file->write((const uint8_t *)"<score-partwise/>", strlen("<score-partwise/>"));
+    }
+    mx::api::DocumentManager::getInstance().score = benchScore();
+    scoreLayout = benchLayout;
+    renderOpen(benchLayout);
+    waitIdle();
+    TEST_ASSERT_EQUAL(0, benchShownPage.load());
+
+    // A page not drawn yet is evicted: it's not shown, and the score is laid out again once
+    String path = scoreCachePath(BENCH_SCORE_ID, layoutCacheKind('p', benchLayout.pages[3]).c_str());
+    TEST_ASSERT_TRUE(storage->remove(path.c_str()));
+    renderGoTo(3);
+    waitIdle();
+    TEST_ASSERT_EQUAL(0, benchShownPage.load());
+    renderGoTo(3);
+    waitIdle();
+    ControlEvent event;
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    TEST_ASSERT_EQUAL(CONTROL_LAYOUT, event.type);
+    TEST_ASSERT_FALSE(controlReceive(event, 0));
+
+    // As the main loop does
+    uint32_t parsed = scoresParsed.get();
+    TEST_ASSERT_TRUE(renderRelayOut());
+    waitIdle();
+    TEST_ASSERT_EQUAL(parsed + 1, scoresParsed.get());
+    TEST_ASSERT_TRUE(storage->exists(path.c_str()));
+    TEST_ASSERT_EQUAL(3, benchShownPage.load());
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_script);
+    RUN_TEST(test_config);
+    RUN_TEST(test_evicted);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    benchStorageSetUp(8 * 1024 * 1024);
+    if (!layoutBuild(BENCH_SCORE_ID, benchScore(), layoutGeometry, benchLayout))
+        return 1;
+    controlBegin();
+    renderDisplay = benchDisplay;
+    renderBegin();
+    pedalBegin();
+    return runTests();
+}
@@ -0,0 +1,283 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Uploads a library of scores, indexed by the main loop as they arrive, and measures the time to search it by
+ * title, composer and parts. Checks what's read from the scores, that they're parsed once even after a reboot, and
+ * that searching never opens a score.
+ * @version 0.1
+ * @date 2022-03-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <bench_score.h>
+#include <bench_setup.h>
+
+#include "control.h"
+#include "score_index.h"
+#include "storage_ram.h"
+
+#define BENCH_SCORES 300
+#define BENCH_SEARCHES 200
+#define BENCH_SCORE_SIZE 4096
+
+/**
+ * @brief How long a search of the whole library may take, in microseconds.
+ */
+#define BENCH_MAX_SEARCH_US 50000
+
+/**
+ * @brief Counts the scores opened, apart from the manifest and the index.
+ */
+class BenchStorage : public RamStorage
+{
+public:
+    BenchStorage(size_t capacity) : RamStorage(capacity) {}
+
+    std::unique_ptr<StorageFile> open(const char *path, const char *mode) override
+    {
+        String name = path;
+        if (name.startsWith(STORAGE_DIR_SCORES "/") && name != SCORE_MANIFEST_PATH && name != SCORE_INDEX_PATH &&
+            !name.startsWith(SCORE_TEMP_PREFIX))
+            scoresOpened++;
+        return RamStorage::open(path, mode);
+    }
+
+    unsigned int scoresOpened = 0;
+};
+
+BenchStorage *benchStorage;
+
+const char *benchComposers[] = {"Johann Sebastian Bach", "Ludwig van Beethoven", "Antonín Dvořák", "Clara Schumann",
+                                "Florence Price"};
+const char *benchForms[] = {"Sonata", "Suite", "Partita", "Nocturne", "Serenade", "Fugue", "Étude"};
+const char *benchInstruments[] = {"Violin", "Viola", "Cello", "Flute", "Piano", "Clarinet"};
+
+/**
+ * @brief The metadata of the score [i]. Every score has its own title, a composer, and one or two parts.
+ */
+mx::api::ScoreData benchScore(int i)
+{
+    BenchScoreOptions options;
+    options.title = std::string(benchForms[i % 7]) + " No. " + std::to_string(i / 7 + 1);
+    options.composer = benchComposers[i % 5];
+    options.parts = 1 + i % 2;
+    for (int p = 0; p < options.parts; p++)
+    {
+        options.partNames.push_back(benchInstruments[(i + p * 3) % 6]);
+        options.fifths.push_back(i % 7 - 3);
+    }
+    BenchScoreSection section = {20 + i % 40};
+    section.beatsPerMinute = 60 + i % 4 * 20;
+    options.sections = {section};
+    options.rhythm = BENCH_RHYTHM_WHOLES;
+    return benchScoreBuild(options);
+}
+
+String benchName(int i)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "score%03d.xml", i);
+    return name;
+}
+
+/**
+ * @brief Handles the events sent to the main loop as it does, until there are none.
+ */
+void benchLoop()
+{
+    ControlEvent event;
+    while (controlReceive(event, 0))
+        if (event.type == CONTROL_INDEX && scoreIndexNext())
+            controlPost(CONTROL_INDEX, "Indexing scores");
+}
+
+/**
+ * @brief Stores the score [i], as uploaded.
+ */
+void benchUpload(int i)
+{
+    String name = benchName(i);
+    std::string contents = "<!-- " + std::string(name.c_str()) + " -->";
+    while (contents.size() < BENCH_SCORE_SIZE)
+        contents += "<note><pitch><step>C</step><octave>4</octave></pitch><duration>4</duration></note>";
+    ScoreUpload upload(name);
+    upload.write((const uint8_t *)contents.data(), contents.size());
+    TEST_ASSERT_TRUE(upload.finish().length() > 0);
+    controlPost(CONTROL_INDEX, "Score uploaded");
+}
+
+size_t benchCount(const String &text, const char *what)
+{
+    size_t count = 0;
+    for (int at = text.indexOf(what); at >= 0; at = text.indexOf(what, at + 1))
+        count++;
+    return count;
+}
+
+void test_index()
+{
+    // Every upload is indexed by the main loop, parsing the score that arrived
+    for (int i = 0; i < BENCH_SCORES; i++)
+    {
+        benchUpload(i);
+        mx::api::DocumentManager::getInstance().score = benchScore(i);
+        benchLoop();
+    }
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoreIndexed.size());
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoresParsed.get());
+    TEST_ASSERT_GREATER_OR_EQUAL(BENCH_SCORES, benchStorage->scoresOpened);
+
+    // Indexed already after a reboot
+    scoreIndexBegin();
+    benchLoop();
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoreIndexed.size());
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoresParsed.get());
+
+    // Laid out scores are indexed already too
+    scoreIndexed.clear();
+    layoutParsed(scoreId(benchName(0)), benchScore(0));
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoreIndexed.size());
+    TEST_ASSERT_EQUAL(BENCH_SCORES, scoresParsed.get());
+
+    StorageStat stat;
+    TEST_ASSERT_TRUE(storage->stat(SCORE_INDEX_PATH, stat));
+    char message[100];
+    snprintf(message, sizeof(message), "Index of %u scores: %u bytes, %u a score", BENCH_SCORES, (unsigned)stat.size,
+             (unsigned)(stat.size / BENCH_SCORES));
+    TEST_MESSAGE(message);
+}
+
+void test_info()
+{
+    // Score 4: Serenade No. 1 by Florence Price, for piano, in one sharp, 24 measures of 4/4 at 60 quarters a minute
+    String result = scoreSearch("serenade no 1 price");
+    TEST_ASSERT_EQUAL(0, result.indexOf("{\"results\":[{\"name\":\"score004.xml\",\"title\":\"Serenade No. 1\","
+                                        "\"composer\":\"Florence Price\",\"parts\":[\"Piano\"],\"key\":1,\"seconds\":96,"
+                                        "\"measures\":24}"));
+    // Score 3: Nocturne No. 1 by Clara Schumann, for flute and violin, 23 measures at 120
+    result = scoreSearch("nocturne no 1 clara");
+    TEST_ASSERT_TRUE(result.indexOf("\"parts\":[\"Flute\",\"Violin\"],\"key\":0,\"seconds\":46,\"measures\":23}") > 0);
+}
+
+void test_search()
+{
+    benchStorage->scoresOpened = 0;
+
+    // By composer and title, by a word and by the start of one, whatever the case
+    TEST_ASSERT_EQUAL(BENCH_SCORES / 35 + 1, benchCount(scoreSearch("bach sonata"), "\"name\""));
+    TEST_ASSERT_EQUAL(BENCH_SCORES / 35 + 1, benchCount(scoreSearch("BEETH sui"), "\"name\""));
+    TEST_ASSERT_EQUAL(BENCH_SCORES / 35 + 1, benchCount(scoreSearch("dvořák partita"), "\"name\""));
+    TEST_ASSERT_EQUAL(BENCH_SCORES / 35 + 1, benchCount(scoreSearch("clara suite"), "\"name\""));
+    // Every word must be found
+    TEST_ASSERT_EQUAL(0, benchCount(scoreSearch("bach beethoven"), "\"name\""));
+    // At most [SCORE_SEARCH_MAX_RESULTS]
+    TEST_ASSERT_EQUAL(SCORE_SEARCH_MAX_RESULTS, benchCount(scoreSearch("bach"), "\"name\""));
+    // By the parts: the sonatas with a cello, every 42 scores from the 14th and the 35th
+    TEST_ASSERT_EQUAL(14, benchCount(scoreSearch("cello sonata"), "\"name\""));
+    // By the name
+    TEST_ASSERT_EQUAL(1, benchCount(scoreSearch("score123"), "\"name\""));
+    TEST_ASSERT_EQUAL(0, benchCount(scoreSearch("requiem"), "\"name\""));
+
+    // The title starting with the query goes first
+    String result = scoreSearch("Étude No. 4");
+    TEST_ASSERT_EQUAL(0, result.indexOf("{\"results\":[{\"name\":\"score027.xml\""));
+
+    TEST_ASSERT_EQUAL(0, benchStorage->scoresOpened);
+}
+
+void test_unindexed()
+{
+    // Found by its name until the main loop indexes it
+    benchUpload(BENCH_SCORES);
+    TEST_ASSERT_TRUE(scoreSearch(benchName(BENCH_SCORES)).indexOf("{\"name\":\"score300.xml\"}") >= 0);
+    mx::api::DocumentManager::getInstance().score = benchScore(BENCH_SCORES);
+    benchLoop();
+    TEST_ASSERT_TRUE(scoreSearch(benchName(BENCH_SCORES)).indexOf("\"title\":\"Étude No. 43\"") >= 0);
+
+    // Removed scores are not found, and leave the index file once it's compacted, at boot
+    TEST_ASSERT_TRUE(scoreRemove(benchName(BENCH_SCORES)));
+    TEST_ASSERT_EQUAL(0, benchCount(scoreSearch(benchName(BENCH_SCORES)), "\"name\""));
+    size_t lines = scoreIndexLines;
+    benchUpload(BENCH_SCORES + 1);
+    mx::api::DocumentManager::getInstance().score = benchScore(BENCH_SCORES + 1);
+    benchLoop();
+    TEST_ASSERT_EQUAL(BENCH_SCORES + 1, scoreIndexed.size());
+    TEST_ASSERT_EQUAL(lines + 1, scoreIndexLines);
+    scoreIndexBegin();
+    benchLoop();
+    TEST_ASSERT_EQUAL(BENCH_SCORES + 1, scoreIndexed.size());
+    TEST_ASSERT_EQUAL(BENCH_SCORES + 1, scoreIndexLines);
+    TEST_ASSERT_EQUAL(0, benchCount(scoreSearch(benchName(BENCH_SCORES)), "\"name\""));
+}
+
+void test_heapReserve()
+{
+    benchUpload(BENCH_SCORES + 2);
+    uint32_t parsed = scoresParsed.get();
+    uint32_t freeHeap = ESP.freeHeap;
+    ESP.freeHeap = SCORE_INDEX_HEAP_RESERVE - 1;
+    ControlEvent event;
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    // Waits for the heap, without parsing nor blocking the main loop
+    unsigned long start = millis();
+    TEST_ASSERT_FALSE(scoreIndexNext());
+    TEST_ASSERT_LESS_THAN(SCORE_INDEX_RETRY_MS / 2, millis() - start);
+    TEST_ASSERT_EQUAL(parsed, scoresParsed.get());
+    TEST_ASSERT_FALSE(controlReceive(event, 0));
+    ESP.freeHeap = freeHeap;
+    // Tried again later
+    TEST_ASSERT_TRUE(controlReceive(event, SCORE_INDEX_RETRY_MS * 2));
+    TEST_ASSERT_EQUAL(CONTROL_INDEX, event.type);
+    mx::api::DocumentManager::getInstance().score = benchScore(BENCH_SCORES + 2);
+    TEST_ASSERT_TRUE(scoreIndexNext());
+    TEST_ASSERT_EQUAL(parsed + 1, scoresParsed.get());
+    TEST_ASSERT_EQUAL(BENCH_SCORES + 2, scoreIndexed.size());
+}
+
+void test_latency()
+{
+    const char *queries[] = {"bach", "sonata no 1", "viola", "price nocturne", "score2", "clar", "e"};
+    std::vector<uint32_t> times;
+    for (int i = 0; i < BENCH_SEARCHES; i++)
+    {
+        unsigned long start = micros();
+        scoreSearch(queries[i % 7]);
+        times.push_back(micros() - start);
+    }
+    char message[100];
+    snprintf(message, sizeof(message), "Search of %u scores: p50 %u us, p99 %u us", BENCH_SCORES, benchPercentile(times, 50),
+             benchPercentile(times, 99));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(BENCH_MAX_SEARCH_US, benchPercentile(times, 99));
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_index);
+    RUN_TEST(test_info);
+    RUN_TEST(test_search);
+    RUN_TEST(test_unindexed);
+    RUN_TEST(test_heapReserve);
+    RUN_TEST(test_latency);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    benchStorage = &benchStorageSetUp<BenchStorage>(8 * 1024 * 1024);
+    controlBegin();
+    scoreIndexBegin();
+    return runTests();
+}
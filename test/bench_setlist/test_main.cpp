@@ -0,0 +1,355 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Lays out a setlist as the main loop does before a concert, and measures the time to open every piece of it
+ * afterwards, against laying it out when opened. Checks that no score is parsed when moving through the setlist, even
+ * after other scores filled the cache, and that the setlist is laid out again when its scores or the transposition
+ * change.
+ * @version 0.1
+ * @date 2022-03-11
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <bench_score.h>
+#include <bench_setup.h>
+
+#include "config.h"
+#include "control.h"
+#include "score_open.h"
+#include "setlist.h"
+
+#define BENCH_ENTRIES 6
+#define BENCH_OTHERS 4
+#define BENCH_MEASURES 240
+#define BENCH_SCORE_SIZE (32 * 1024)
+
+/**
+ * @brief Holds the scores, their layouts for a few transpositions, and some more.
+ */
+#define BENCH_STORAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * @brief The time spent laying out every entry of the setlist, in microseconds.
+ */
+std::vector<uint32_t> benchLaidOut;
+
+/**
+ * @brief A score for two staves of eighths, long enough to have a few pages.
+ */
+mx::api::ScoreData benchScore()
+{
+    BenchScoreOptions options;
+    options.parts = 2;
+    options.sections = {{BENCH_MEASURES}};
+    options.rhythm = BENCH_RHYTHM_EIGHTHS;
+    return benchScoreBuild(options);
+}
+
+String benchName(const char *prefix, int i)
+{
+    return String(prefix) + " " + String(i + 1);
+}
+
+/**
+ * @brief Stores a score called [name], with contents of its own.
+ */
+void benchUpload(const String &name, int version = 0)
+{
+    std::string contents = "<!-- " + std::string(name.c_str()) + " " + std::to_string(version) + " -->";
+    while (contents.size() < BENCH_SCORE_SIZE)
+        contents += "<note><pitch><step>C</step><octave>4</octave></pitch><duration>4</duration></note>";
+    // Making room as the upload handler does
+    ScoreUpload upload(name, contents.size());
+    TEST_ASSERT_TRUE(upload.reserved());
+    upload.write((const uint8_t *)contents.data(), contents.size());
+    TEST_ASSERT_TRUE(upload.finish().length() > 0);
+}
+
+/**
+ * @brief Handles the events sent to the main loop as it does, until there are none.
+ */
+void benchLoop()
+{
+    ControlEvent event;
+    while (controlReceive(event, 0))
+    {
+        if (event.type != CONTROL_SETLIST)
+            continue;
+        uint32_t parsed = scoresParsed.get();
+        unsigned long start = micros();
+        bool more = setlistLayOutNext();
+        if (scoresParsed.get() > parsed)
+            benchLaidOut.push_back(micros() - start);
+        if (more)
+            controlPost(CONTROL_SETLIST, "Setlist laying out");
+    }
+}
+
+size_t benchCount(SetlistState state)
+{
+    std::shared_ptr<const SetlistEntries> entries = setlistEntries();
+    return std::count_if(entries->begin(), entries->end(), [state](const std::unique_ptr<SetlistEntry> &entry)
+                         { return entry->state.load() == state; });
+}
+
+String benchSetlist()
+{
+    String text;
+    for (int i = 0; i < BENCH_ENTRIES; i++)
+        text += benchName("Piece", i) + "\r\n";
+    return text;
+}
+
+void test_set()
+{
+    String unknown;
+    TEST_ASSERT_FALSE(setlistSet("Piece 1\nEncore", unknown));
+    TEST_ASSERT_EQUAL_STRING("Encore", unknown.c_str());
+    TEST_ASSERT_TRUE(setlistSet(benchSetlist(), unknown));
+    // Stored one name per line, without the carriage returns
+    String stored;
+    for (int i = 0; i < BENCH_ENTRIES; i++)
+        stored += benchName("Piece", i) + "\n";
+    TEST_ASSERT_EQUAL_STRING(stored.c_str(), preferences.getString(pref_setlist, "").c_str());
+    benchLoop();
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, setlistEntries()->size());
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, benchCount(SETLIST_READY));
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, benchLaidOut.size());
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, setlistLaidOut.get());
+    TEST_ASSERT_EQUAL(-1, setlistPosition.load());
+
+    // Laid out already, so refreshing doesn't parse them again
+    uint32_t parsed = scoresParsed.get();
+    setlistRefresh();
+    benchLoop();
+    TEST_ASSERT_EQUAL(parsed, scoresParsed.get());
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, benchCount(SETLIST_READY));
+}
+
+void test_advance()
+{
+    uint32_t parsed = scoresParsed.get();
+    std::vector<uint32_t> opened;
+    Layout layout;
+    for (int i = 0; i < BENCH_ENTRIES; i++)
+    {
+        unsigned long start = micros();
+        TEST_ASSERT_TRUE(setlistOpen(i, layout));
+        opened.push_back(micros() - start);
+        TEST_ASSERT_EQUAL(i, setlistPosition.load());
+        TEST_ASSERT_EQUAL_STRING(benchName("Piece", i).c_str(), preferences.getString(pref_lastScore, "").c_str());
+        TEST_ASSERT_GREATER_THAN(1, layout.pages.size());
+    }
+    TEST_ASSERT_FALSE(setlistOpen(BENCH_ENTRIES, layout));
+    TEST_ASSERT_EQUAL(parsed, scoresParsed.get());
+    TEST_ASSERT_EQUAL(0, setlistMisses.get());
+
+    char message[200];
+    snprintf(message, sizeof(message), "%u pages a piece: laid out ahead in p50 %u us, max %u us; opened in p50 %u us, max %u us",
+             (unsigned)layout.pages.size(), benchPercentile(benchLaidOut, 50), *std::max_element(benchLaidOut.begin(), benchLaidOut.end()),
+             benchPercentile(opened, 50), *std::max_element(opened.begin(), opened.end()));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(benchPercentile(benchLaidOut, 50), benchPercentile(opened, 50));
+}
+
+void test_pinned()
+{
+    // Other scores, laid out for every transposition, fill the cache
+    unsigned int evicted = quotaStats.evictedFiles;
+    Layout layout;
+    for (int semitones = -12; semitones <= 12 && quotaStats.evictedFiles < evicted + 100; semitones++)
+    {
+        layoutGeometry.transpose = semitones;
+        for (int i = 0; i < BENCH_OTHERS; i++)
+            layoutScore(benchName("Other", i), layoutGeometry, layout);
+    }
+    layoutGeometry.transpose = 0;
+    char message[100];
+    snprintf(message, sizeof(message), "%u cache files evicted", quotaStats.evictedFiles - evicted);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_GREATER_THAN(evicted + BENCH_ENTRIES * 3, quotaStats.evictedFiles);
+
+    // The setlist was laid out first, but its files are still there
+    uint32_t parsed = scoresParsed.get();
+    for (int i = 0; i < BENCH_ENTRIES; i++)
+        TEST_ASSERT_TRUE(setlistOpen(i, layout));
+    TEST_ASSERT_EQUAL(parsed, scoresParsed.get());
+    TEST_ASSERT_EQUAL(0, setlistMisses.get());
+    TEST_ASSERT_FALSE(layoutLoad(scoreId(benchName("Other", 0)), (LayoutGeometry){LAYOUT_DEFAULT_WIDTH, LAYOUT_DEFAULT_HEIGHT, LAYOUT_DEFAULT_STAFF_SPACE, -12}, layout));
+
+    // The score open isn't evicted either
+    TEST_ASSERT_TRUE(layoutScore(benchName("Other", 0), layoutGeometry, layout));
+    quotaSetOpen(layout.id);
+    evicted = quotaStats.evictedFiles;
+    Layout other;
+    for (int semitones = -12; semitones <= 12 && quotaStats.evictedFiles < evicted + 100; semitones++)
+    {
+        layoutGeometry.transpose = semitones;
+        for (int i = 1; i < BENCH_OTHERS; i++)
+            layoutScore(benchName("Other", i), layoutGeometry, other);
+    }
+    layoutGeometry.transpose = 0;
+    TEST_ASSERT_GREATER_THAN(evicted + BENCH_ENTRIES * 3, quotaStats.evictedFiles);
+    TEST_ASSERT_TRUE(layoutLoad(layout.id, layoutGeometry, other));
+    quotaSetOpen(String());
+}
+
+void test_refresh()
+{
+    // Transposing lays out the setlist again, an entry opened meanwhile is parsed
+    uint32_t parsed = scoresParsed.get();
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_BOUNDS, configure("transpose", "13"));
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_BOUNDS, configure("transpose", "-4294967298"));
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_NUMERIC, configure("transpose", "+2"));
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_NUMERIC, configure("transpose", "-"));
+    TEST_ASSERT_EQUAL_STRING(ERR_CONFIG_NUMERIC, configure("transpose", "2 "));
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("transpose", "2"));
+    Layout layout;
+    TEST_ASSERT_TRUE(setlistOpen(0, layout));
+    TEST_ASSERT_EQUAL(1, setlistMisses.get());
+    benchLoop();
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, benchCount(SETLIST_READY));
+    TEST_ASSERT_EQUAL(parsed + BENCH_ENTRIES, scoresParsed.get());
+
+    // A new version of a score is laid out, a score removed is missing
+    parsed = scoresParsed.get();
+    benchUpload(benchName("Piece", 1), 1);
+    setlistRefresh();
+    benchLoop();
+    TEST_ASSERT_EQUAL(parsed + 1, scoresParsed.get());
+    TEST_ASSERT_TRUE(scoreRemove(benchName("Piece", 2)));
+    setlistRefresh();
+    benchLoop();
+    TEST_ASSERT_EQUAL(1, benchCount(SETLIST_MISSING));
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES - 1, benchCount(SETLIST_READY));
+    TEST_ASSERT_FALSE(setlistOpen(2, layout));
+    TEST_ASSERT_EQUAL(parsed + 1, scoresParsed.get());
+    benchUpload(benchName("Piece", 2));
+    setlistRefresh();
+    benchLoop();
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, benchCount(SETLIST_READY));
+}
+
+void test_heapReserve()
+{
+    uint32_t parsed = scoresParsed.get();
+    uint32_t freeHeap = ESP.freeHeap;
+    ESP.freeHeap = SETLIST_HEAP_RESERVE - 1;
+    // Not laid out yet
+    layoutGeometry.transpose = 1;
+    setlistRefresh();
+    ControlEvent event;
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    // Waits for the heap, without parsing nor blocking the main loop. Timed in ticks, the clock of controlPostAfter
+    TickType_t start = xTaskGetTickCount();
+    TEST_ASSERT_FALSE(setlistLayOutNext());
+    TEST_ASSERT_LESS_THAN(pdMS_TO_TICKS(SETLIST_RETRY_MS / 2), xTaskGetTickCount() - start);
+    TEST_ASSERT_EQUAL(parsed, scoresParsed.get());
+    TEST_ASSERT_FALSE(controlReceive(event, 0));
+    ESP.freeHeap = freeHeap;
+    // Tried again later
+    TEST_ASSERT_TRUE(controlReceive(event, SETLIST_RETRY_MS * 2));
+    TEST_ASSERT_EQUAL(CONTROL_SETLIST, event.type);
+    TEST_ASSERT_GREATER_OR_EQUAL(pdMS_TO_TICKS(SETLIST_RETRY_MS), xTaskGetTickCount() - start);
+    controlPost(CONTROL_SETLIST, "Setlist laying out");
+    benchLoop();
+    TEST_ASSERT_EQUAL(BENCH_ENTRIES, benchCount(SETLIST_READY));
+    TEST_ASSERT_EQUAL(parsed + BENCH_ENTRIES, scoresParsed.get());
+    layoutGeometry.transpose = 0;
+}
+
+void test_events()
+{
+    // The setlist and the index are handled once for all the changes meanwhile, reboots go first
+    for (int i = 0; i < CONTROL_QUEUE_LENGTH * 2; i++)
+    {
+        TEST_ASSERT_TRUE(controlPost(CONTROL_SETLIST, "Setlist laying out"));
+        TEST_ASSERT_TRUE(controlPost(CONTROL_INDEX, "Score uploaded"));
+    }
+    TEST_ASSERT_TRUE(controlPost(CONTROL_REBOOT, "Web Admin Initiated Reboot"));
+    ControlEvent event;
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    TEST_ASSERT_EQUAL(CONTROL_REBOOT, event.type);
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    TEST_ASSERT_EQUAL(CONTROL_SETLIST, event.type);
+    // Sent again while handled
+    TEST_ASSERT_TRUE(controlPost(CONTROL_SETLIST, "Setlist laying out"));
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    TEST_ASSERT_EQUAL(CONTROL_INDEX, event.type);
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    TEST_ASSERT_EQUAL(CONTROL_SETLIST, event.type);
+    TEST_ASSERT_FALSE(controlReceive(event, 0));
+}
+
+void test_status()
+{
+    const String name = "Air \"on the G string\" \\ Bach";
+    benchUpload(name);
+    String unknown;
+    TEST_ASSERT_TRUE(setlistSet(name, unknown));
+    benchLoop();
+    TEST_ASSERT_EQUAL_STRING("{\"position\":-1,\"entries\":[{\"name\":\"Air \\\"on the G string\\\" \\\\ Bach\","
+                             "\"state\":\"ready\"}]}",
+                             setlistStatus().c_str());
+}
+
+void test_openLater()
+{
+    // As the request handlers do
+    scoreLayout = Layout();
+    scoreOpenEntryLater(0);
+    TEST_ASSERT_EQUAL(0, scoreLayout.pages.size());
+    ControlEvent event;
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    TEST_ASSERT_EQUAL(CONTROL_OPEN, event.type);
+    scoreOpenAsked();
+    TEST_ASSERT_EQUAL(0, setlistPosition.load());
+    TEST_ASSERT_GREATER_THAN(1, scoreLayout.pages.size());
+
+    // Only the last one asked for is opened
+    scoreOpenEntryLater(0);
+    scoreOpenLater(benchName("Other", 0));
+    TEST_ASSERT_TRUE(controlReceive(event, 0));
+    TEST_ASSERT_FALSE(controlReceive(event, 0));
+    scoreOpenAsked();
+    Layout other;
+    TEST_ASSERT_TRUE(layoutScore(benchName("Other", 0), layoutGeometry, other));
+    TEST_ASSERT_EQUAL_STRING(other.id.c_str(), scoreLayout.id.c_str());
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_set);
+    RUN_TEST(test_advance);
+    RUN_TEST(test_pinned);
+    RUN_TEST(test_refresh);
+    RUN_TEST(test_heapReserve);
+    RUN_TEST(test_events);
+    RUN_TEST(test_status);
+    RUN_TEST(test_openLater);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    benchStorageSetUp(BENCH_STORAGE_SIZE);
+    controlBegin();
+    mx::api::DocumentManager::getInstance().score = benchScore();
+    for (int i = 0; i < BENCH_ENTRIES; i++)
+        benchUpload(benchName("Piece", i));
+    for (int i = 0; i < BENCH_OTHERS; i++)
+        benchUpload(benchName("Other", i));
+    return runTests();
+}
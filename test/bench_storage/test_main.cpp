@@ -0,0 +1,247 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Compares the open, stat and list latency of the storage backends as the amount of files grows, and checks
+ * the migration from SPIFFS to LittleFS on the host. On the device this formats the storage partition, so all the
+ * uploaded scores are lost.
+ * @version 0.1
+ * @date 2022-02-24
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "storage.h"
+#ifdef ARDUINO
+#include <SPIFFS.h>
+#include <LittleFS.h>
+#include "storage_fs.h"
+#else
+#include "filesystem.h"
+#include "storage_posix.h"
+#include "storage_ram.h"
+#endif
+
+/**
+ * @brief The amount of open and stat calls measured for each amount of files.
+ */
+#define BENCH_LOOKUPS 200
+
+/**
+ * @brief The amount of times the whole directory is listed for each amount of files.
+ */
+#define BENCH_LISTS 10
+
+const size_t fileCounts[] = {10, 100, 500};
+
+/**
+ * @brief Fills the scores directory of [storage] up to [count] files, named by their index.
+ */
+void fillFiles(Storage &storage, size_t from, size_t count)
+{
+    const uint8_t contents[] = "<score-partwise/>";
+    char path[32];
+    for (size_t i = from; i < count; i++)
+    {
+        snprintf(path, sizeof(path), STORAGE_DIR_SCORES "/score%03u.xml", (unsigned)i);
+        std::unique_ptr<StorageFile> file = storage.open(path, "w");
+        TEST_ASSERT_NOT_NULL(file.get());
+        file->write(contents, sizeof(contents));
+    }
+}
+
+/**
+ * @brief Prints the average time per call of [fn], run [iterations] times, in microseconds.
+ */
+template <typename F>
+void benchmark(const char *backend, const char *operation, size_t files, unsigned long iterations, F fn)
+{
+    unsigned long start = micros();
+    for (unsigned long i = 0; i < iterations; i++)
+        fn(i);
+    unsigned long elapsed = micros() - start;
+
+    char message[96];
+    snprintf(message, sizeof(message), "%s %s @%u files: %.1f us/call", backend, operation, (unsigned)files, (float)elapsed / iterations);
+    TEST_MESSAGE(message);
+}
+
+/**
+ * @brief Measures [storage] at every amount of files of [fileCounts]. [storage] must be empty.
+ */
+void benchmarkStorage(const char *backend, Storage &storage)
+{
+    TEST_ASSERT_TRUE(storage.mkdir(STORAGE_DIR_SCORES));
+
+    size_t created = 0;
+    for (size_t count : fileCounts)
+    {
+        fillFiles(storage, created, count);
+        created = count;
+
+        char path[32];
+        benchmark(backend, "open", count, BENCH_LOOKUPS, [&](unsigned long i)
+                  {
+            snprintf(path, sizeof(path), STORAGE_DIR_SCORES "/score%03u.xml", (unsigned)((i * 7919) % count));
+            TEST_ASSERT_NOT_NULL(storage.open(path, "r").get()); });
+
+        StorageStat info;
+        benchmark(backend, "stat", count, BENCH_LOOKUPS, [&](unsigned long i)
+                  {
+            snprintf(path, sizeof(path), STORAGE_DIR_SCORES "/score%03u.xml", (unsigned)((i * 7919) % count));
+            TEST_ASSERT_TRUE(storage.stat(path, info)); });
+
+        benchmark(backend, "list", count, BENCH_LISTS, [&](unsigned long i)
+                  {
+            size_t listed = 0;
+            storage.list(STORAGE_DIR_SCORES, [&](const char *name, size_t size)
+                         { listed++; });
+            TEST_ASSERT_EQUAL(count, listed); });
+    }
+}
+
+#ifdef ARDUINO
+void test_spiffs()
+{
+    LittleFS.end();
+    TEST_ASSERT_TRUE(SPIFFS.begin(true));
+    TEST_ASSERT_TRUE(SPIFFS.format());
+    FSStorage<fs::SPIFFSFS> storage(SPIFFS, false, false);
+    benchmarkStorage("SPIFFS", storage);
+    SPIFFS.end();
+}
+
+void test_littlefs()
+{
+    TEST_ASSERT_TRUE(LittleFS.begin(true));
+    TEST_ASSERT_TRUE(LittleFS.format());
+    FSStorage<fs::LittleFSFS> storage(LittleFS, true, true);
+    benchmarkStorage("LittleFS", storage);
+}
+#else
+void test_posix()
+{
+    system("rm -rf /tmp/ems-bench-storage");
+    PosixStorage storage("/tmp/ems-bench-storage");
+    benchmarkStorage("POSIX", storage);
+}
+
+void test_ram()
+{
+    RamStorage storage(1024 * 1024);
+    benchmarkStorage("RAM", storage);
+}
+
+/**
+ * @brief Leaves SPIFFS mounted with [count] files of [size] bytes at its root, as stored by previous versions.
+ */
+void benchSpiffs(int count, size_t size)
+{
+    TEST_ASSERT_TRUE(SPIFFS.format());
+    for (int i = 0; i < count; i++)
+    {
+        fs::File file = SPIFFS.open(("/score" + std::to_string(i) + ".xml").c_str(), "w");
+        std::string contents(size, 'a' + i);
+        file.write((const uint8_t *)contents.data(), contents.size());
+        file.close();
+    }
+}
+
+void test_migrate()
+{
+    benchSpiffs(3, 10 * 1024);
+    TEST_ASSERT_TRUE(storageBegin());
+    TEST_ASSERT_TRUE(storage == &littleFsStorage);
+    TEST_ASSERT_TRUE(storageUnmigrated.empty());
+    std::unique_ptr<StorageFile> file = storage->open(STORAGE_DIR_SCORES "/score2.xml", "r");
+    TEST_ASSERT_TRUE(file != nullptr);
+    TEST_ASSERT_EQUAL(10 * 1024, file->size());
+    uint8_t byte = 0;
+    file->read(&byte, 1);
+    TEST_ASSERT_EQUAL('c', byte);
+}
+
+void test_migrateTooBig()
+{
+    // The blocks of the files and the reserve don't fit in LittleFS, SPIFFS is kept as it was
+    size_t capacity = SPIFFS.capacity;
+    SPIFFS.capacity = QUOTA_RESERVE_BYTES + (STORAGE_MIGRATION_OVERHEAD_BLOCKS + 5) * STORAGE_LITTLEFS_BLOCK_SIZE;
+    benchSpiffs(2, 10 * 1024);
+    TEST_ASSERT_TRUE(storageBegin());
+    TEST_ASSERT_TRUE(storage == &spiffsStorage);
+    TEST_ASSERT_TRUE(storage->exists(STORAGE_DIR_SCORES "/score1.xml"));
+    SPIFFS.capacity = capacity;
+}
+#endif
+
+void test_cacheWrite()
+{
+    RamStorage ram(64 * 1024);
+    storage = &ram;
+    ram.mkdir(STORAGE_DIR_CACHE);
+    std::string contents(1024, 'p');
+    auto write = [&](StorageFile &file)
+    { return file.write((const uint8_t *)contents.data(), contents.size()) == contents.size(); };
+
+    TEST_ASSERT_TRUE(scoreCacheWrite("0123456789abcdef", "p000000", write));
+    StorageStat stat;
+    TEST_ASSERT_TRUE(storage->stat(STORAGE_DIR_CACHE "/0123456789abcdef.p000000", stat));
+    TEST_ASSERT_EQUAL(contents.size(), stat.size);
+
+    // A write that fails leaves the file written before, and no temporary file
+    contents.assign(2048, 'q');
+    TEST_ASSERT_FALSE(scoreCacheWrite("0123456789abcdef", "p000000", [&](StorageFile &file)
+                                      { write(file);
+                                        return false; }));
+    TEST_ASSERT_TRUE(storage->stat(STORAGE_DIR_CACHE "/0123456789abcdef.p000000", stat));
+    TEST_ASSERT_EQUAL(1024, stat.size);
+    int files = 0;
+    storage->list(STORAGE_DIR_CACHE, [&](const char *name, size_t size)
+                  { files++; });
+    TEST_ASSERT_EQUAL(1, files);
+
+    // Not even when the storage runs out of space
+    contents.assign(128 * 1024, 'r');
+    TEST_ASSERT_FALSE(scoreCacheWrite("0123456789abcdef", "i000000", write));
+    TEST_ASSERT_FALSE(storage->exists(STORAGE_DIR_CACHE "/0123456789abcdef.i000000"));
+    files = 0;
+    storage->list(STORAGE_DIR_CACHE, [&](const char *name, size_t size)
+                  { files++; });
+    TEST_ASSERT_EQUAL(1, files);
+    storage = nullptr;
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+#ifdef ARDUINO
+    RUN_TEST(test_spiffs);
+    RUN_TEST(test_littlefs);
+#else
+    RUN_TEST(test_posix);
+    RUN_TEST(test_ram);
+    RUN_TEST(test_migrate);
+    RUN_TEST(test_migrateTooBig);
+    RUN_TEST(test_cacheWrite);
+#endif
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+    // Wait for the serial monitor to attach
+    delay(2000);
+    runTests();
+}
+
+void loop() {}
+#else
+int main(int argc, char **argv)
+{
+    return runTests();
+}
+#endif
@@ -0,0 +1,369 @@
+/**
+ * @file test_main.cpp
+ * @author Arnau Mora (arnyminer.z@gmail.com)
+ * @brief Runs a section of stands on the loopback interface, every one with its own socket in the multicast group,
+ * and measures the time from the leader turning a page until every follower turns to it. Half of the followers lay out
+ * the score with larger staves, so they turn to the page with the measure of the leader instead of the same page.
+ * @version 0.1
+ * @date 2022-03-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "consts.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <bench_score.h>
+#include <bench_setup.h>
+
+#include "config.h"
+#include "renderer.h"
+#include "sync.h"
+
+#define BENCH_SCORE_ID "0123456789abcdef"
+#define BENCH_OTHER_SCORE_ID "fedcba9876543210"
+#define BENCH_MEASURES 400
+#define BENCH_FOLLOWERS 4
+
+/**
+ * @brief The port of the group, away from the one of the firmware.
+ */
+#define BENCH_PORT 14747
+
+/**
+ * @brief The time between the turns of the leader, in milliseconds.
+ */
+#define BENCH_TURN_INTERVAL_MS 10
+
+/**
+ * @brief How long a turn may take to reach every follower, in microseconds.
+ */
+#define BENCH_MAX_LATENCY_US 5000
+
+/**
+ * @brief How long waiting for a message that should arrive, in milliseconds.
+ */
+#define BENCH_TIMEOUT_MS 500
+
+/**
+ * @brief How long waiting for a message that shouldn't arrive, in milliseconds.
+ */
+#define BENCH_QUIET_MS 50
+
+/**
+ * @brief A stand of the section, with the pages it turned to.
+ */
+struct BenchStand
+{
+    SyncNode node;
+    Layout layout;
+    std::atomic<int32_t> page{-1};
+    std::atomic<uint32_t> turnedAt{0};
+    std::atomic<uint32_t> turns{0};
+};
+
+Layout leaderLayout;
+Layout largeLayout;
+Layout otherLayout;
+
+BenchStand leader;
+std::vector<std::unique_ptr<BenchStand>> followers;
+
+int benchSocket = -1;
+
+/**
+ * @brief Builds a score for a staff, with a different melody for [seed].
+ */
+mx::api::ScoreData benchScore(int seed)
+{
+    BenchScoreOptions options;
+    options.sections = {{BENCH_MEASURES}};
+    options.seed = seed;
+    return benchScoreBuild(options);
+}
+
+/**
+ * @brief Gives the page of [layout] with [measure].
+ */
+int32_t pageWith(const Layout &layout, uint32_t measure)
+{
+    int32_t page = 0;
+    while (page + 1 < (int32_t)layout.timeline.pages.size() && layout.timeline.pages[page + 1].measure <= measure)
+        page++;
+    return page;
+}
+
+bool beginStand(BenchStand &stand, SyncRole role, const Layout &layout)
+{
+    stand.layout = layout;
+    stand.node.turn = [&stand](int32_t page)
+    {
+        stand.turnedAt = micros();
+        stand.page = page;
+        stand.turns++;
+    };
+    stand.node.setRole(role);
+    if (!stand.node.begin(inet_addr("127.0.0.1"), BENCH_PORT))
+        return false;
+    stand.node.open(layout);
+    return true;
+}
+
+/**
+ * @brief Turns the leader to [page], and waits for every follower to turn to it.
+ *
+ * @return true If all of them did.
+ */
+bool turnLeader(int32_t page, std::vector<uint32_t> *latencies = NULL)
+{
+    std::vector<uint32_t> before;
+    for (auto &follower : followers)
+        before.push_back(follower->turns.load());
+    uint32_t measure = leaderLayout.timeline.pages[page].measure;
+    uint32_t turnedAt = micros();
+    leader.node.publish(leaderLayout.id, page, measure);
+
+    unsigned long start = millis();
+    for (size_t i = 0; i < followers.size(); i++)
+    {
+        BenchStand &follower = *followers[i];
+        while (follower.turns.load() == before[i] && millis() - start < BENCH_TIMEOUT_MS)
+            delayMicroseconds(50);
+        if (follower.turns.load() == before[i] || follower.page.load() != pageWith(follower.layout, measure))
+            return false;
+        if (latencies)
+            latencies->push_back(follower.turnedAt.load() - turnedAt);
+    }
+    return true;
+}
+
+/**
+ * @brief Sends [message] to the group as a stand that's not in the bench.
+ */
+void inject(SyncMessage message)
+{
+    message.magic = SYNC_MAGIC;
+    message.version = SYNC_VERSION;
+    message.type = SYNC_TYPE_STATE;
+    message.sender = 1;
+    struct sockaddr_in group;
+    memset(&group, 0, sizeof(group));
+    group.sin_family = AF_INET;
+    group.sin_port = htons(BENCH_PORT);
+    group.sin_addr.s_addr = (uint32_t)SYNC_GROUP;
+    sendto(benchSocket, &message, sizeof(message), 0, (struct sockaddr *)&group, sizeof(group));
+}
+
+uint32_t totalTurns()
+{
+    uint32_t turns = 0;
+    for (auto &follower : followers)
+        turns += follower->turns.load();
+    return turns;
+}
+
+void test_turns()
+{
+    int32_t pageCount = leaderLayout.pages.size();
+    TEST_ASSERT_GREATER_THAN(9, pageCount);
+    TEST_ASSERT_TRUE(largeLayout.pages.size() > leaderLayout.pages.size());
+
+    std::vector<uint32_t> latencies;
+    // Through the score, back to the start, and a few jumps
+    std::vector<int32_t> pages;
+    for (int32_t page = 1; page < pageCount; page++)
+        pages.push_back(page);
+    for (int32_t page = pageCount - 2; page >= 0; page--)
+        pages.push_back(page);
+    for (int32_t page : {pageCount / 2, 1, pageCount - 1, 0})
+        pages.push_back(page);
+    for (int32_t page : pages)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(turnLeader(page, &latencies), "A follower didn't turn to the page of the leader");
+        delay(BENCH_TURN_INTERVAL_MS);
+    }
+
+    char message[200];
+    snprintf(message, sizeof(message), "%u turns to %u followers: leader to follower p50 %u us, p99 %u us, max %u us",
+             (unsigned)pages.size(), (unsigned)followers.size(), benchPercentile(latencies, 50), benchPercentile(latencies, 99),
+             *std::max_element(latencies.begin(), latencies.end()));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(BENCH_MAX_LATENCY_US, benchPercentile(latencies, 99));
+}
+
+void test_order()
+{
+    TEST_ASSERT_TRUE(turnLeader(3));
+    SyncMessage state;
+    TEST_ASSERT_TRUE(leader.node.current(state));
+
+    // Late, already applied
+    uint32_t turns = totalTurns();
+    SyncMessage late = state;
+    late.sequence--;
+    late.page = 1;
+    late.measure = leaderLayout.timeline.pages[1].measure;
+    inject(late);
+    inject(state);
+    delay(BENCH_QUIET_MS);
+    TEST_ASSERT_EQUAL(turns, totalTurns());
+
+    // Out of order, the newest is kept
+    SyncMessage newest = state, older = state;
+    newest.sequence += 2;
+    newest.page = 5;
+    newest.measure = leaderLayout.timeline.pages[5].measure;
+    older.sequence += 1;
+    older.page = 4;
+    older.measure = leaderLayout.timeline.pages[4].measure;
+    inject(newest);
+    inject(older);
+    delay(BENCH_QUIET_MS);
+    TEST_ASSERT_EQUAL(turns + followers.size(), totalTurns());
+    for (auto &follower : followers)
+        TEST_ASSERT_EQUAL(pageWith(follower->layout, newest.measure), follower->page.load());
+
+    // The leader goes on from its own sequence, which followers took as older
+    TEST_ASSERT_FALSE(turnLeader(2));
+    // A leader booted again has another id
+    SyncMessage booted = state;
+    booted.leader++;
+    booted.sequence = 1;
+    booted.page = 2;
+    booted.measure = leaderLayout.timeline.pages[2].measure;
+    turns = totalTurns();
+    inject(booted);
+    delay(BENCH_QUIET_MS);
+    TEST_ASSERT_EQUAL(turns + followers.size(), totalTurns());
+}
+
+void test_otherScore()
+{
+    TEST_ASSERT_TRUE(turnLeader(4));
+    BenchStand &follower = *followers[0];
+
+    // Nothing is turned while another score is open, but the state is kept
+    follower.node.open(otherLayout);
+    follower.layout = otherLayout;
+    uint32_t turns = follower.turns.load();
+    leader.node.publish(leaderLayout.id, 6, leaderLayout.timeline.pages[6].measure);
+    delay(BENCH_QUIET_MS);
+    TEST_ASSERT_EQUAL(turns, follower.turns.load());
+
+    follower.layout = leaderLayout;
+    follower.node.open(leaderLayout);
+    TEST_ASSERT_EQUAL(turns + 1, follower.turns.load());
+    TEST_ASSERT_EQUAL(6, follower.page.load());
+}
+
+void test_lateJoiner()
+{
+    TEST_ASSERT_TRUE(turnLeader(7));
+
+    // Answered by the leader, and by every follower. The stands run until the end, as their tasks
+    static BenchStand joiner;
+    unsigned long start = millis();
+    TEST_ASSERT_TRUE(beginStand(joiner, SYNC_FOLLOWER, largeLayout));
+    while (joiner.turns.load() == 0 && millis() - start < BENCH_TIMEOUT_MS)
+        delay(1);
+    TEST_ASSERT_EQUAL(pageWith(largeLayout, leaderLayout.timeline.pages[7].measure), joiner.page.load());
+
+    // Answered by the followers only
+    leader.node.setRole(SYNC_OFF);
+    static BenchStand other;
+    start = millis();
+    TEST_ASSERT_TRUE(beginStand(other, SYNC_FOLLOWER, leaderLayout));
+    while (other.turns.load() == 0 && millis() - start < BENCH_TIMEOUT_MS)
+        delay(1);
+    TEST_ASSERT_EQUAL(7, other.page.load());
+    leader.node.setRole(SYNC_LEADER);
+
+    char message[100];
+    snprintf(message, sizeof(message), "Late joiner turned in %lu ms", millis() - start);
+    TEST_MESSAGE(message);
+    joiner.node.setRole(SYNC_OFF);
+    other.node.setRole(SYNC_OFF);
+}
+
+void test_rejoin()
+{
+    // As after the WiFi reconnected: the group is left and joined again, and the turns keep arriving
+    TEST_ASSERT_TRUE(leader.node.begin(inet_addr("127.0.0.1"), BENCH_PORT));
+    for (auto &follower : followers)
+        TEST_ASSERT_TRUE(follower->node.begin(inet_addr("127.0.0.1"), BENCH_PORT));
+    delay(BENCH_QUIET_MS);
+    TEST_ASSERT_TRUE(turnLeader(3));
+}
+
+void test_renderer()
+{
+    // A follower turning the pages of the renderer, from its own layout
+    BenchStand &follower = *followers[1];
+    follower.node.turn = renderGoTo;
+    renderOpen(follower.layout);
+    delay(BENCH_QUIET_MS);
+    leader.node.publish(leaderLayout.id, 9, leaderLayout.timeline.pages[9].measure);
+    unsigned long start = millis();
+    int32_t expected = pageWith(follower.layout, leaderLayout.timeline.pages[9].measure);
+    while (renderPage.load() != expected && millis() - start < BENCH_TIMEOUT_MS)
+        delay(1);
+    TEST_ASSERT_EQUAL(expected, renderPage.load());
+}
+
+void test_config()
+{
+    BENCH_CONFIG_REJECTS("sync.role", ERR_CONFIG_BOUNDS, "3", "-1", "4294967297");
+    BENCH_CONFIG_REJECTS("sync.role", ERR_CONFIG_NUMERIC, "leader");
+    BENCH_CONFIG_REJECTS_NUMBERS("sync.role");
+    TEST_ASSERT_EQUAL_STRING(CONFIG_OK, configure("sync.role", "0"));
+    TEST_ASSERT_EQUAL(SYNC_OFF, syncNode.getRole());
+    TEST_ASSERT_EQUAL(SYNC_OFF, preferences.getUChar(pref_syncRole, 1));
+}
+
+int runTests()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_turns);
+    RUN_TEST(test_order);
+    RUN_TEST(test_otherScore);
+    RUN_TEST(test_lateJoiner);
+    RUN_TEST(test_rejoin);
+    RUN_TEST(test_renderer);
+    RUN_TEST(test_config);
+    return UNITY_END();
+}
+
+int main(int argc, char **argv)
+{
+    benchStorageSetUp(8 * 1024 * 1024);
+
+    LayoutGeometry large = layoutGeometry;
+    large.staffSpace = layoutGeometry.staffSpace * 3 / 2;
+    if (!layoutBuild(BENCH_SCORE_ID, benchScore(0), layoutGeometry, leaderLayout) ||
+        !layoutBuild(BENCH_SCORE_ID, benchScore(0), large, largeLayout) ||
+        !layoutBuild(BENCH_OTHER_SCORE_ID, benchScore(1), layoutGeometry, otherLayout))
+        return 1;
+    renderBegin();
+
+    benchSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct in_addr loopback;
+    loopback.s_addr = inet_addr("127.0.0.1");
+    setsockopt(benchSocket, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback));
+    if (!beginStand(leader, SYNC_LEADER, leaderLayout))
+        return 1;
+    for (int i = 0; i < BENCH_FOLLOWERS; i++)
+    {
+        followers.emplace_back(new BenchStand());
+        if (!beginStand(*followers.back(), SYNC_FOLLOWER, i % 2 ? largeLayout : leaderLayout))
+            return 1;
+    }
+    return runTests();
+}
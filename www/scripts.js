@@ -166,6 +166,19 @@ function fileAction(filename, action) {
         }
         CA(_("spinner"), "hide");
     }
+    if (action == "rename") {
+        const to = prompt("New name", filename);
+        if (!to || to == filename) return;
+        try {
+            // Only the name changes, so this doesn't copy the file
+            G(`${uc}&to=${encodeURIComponent(to)}`);
+            listFiles();
+            sb("Renamed file");
+        } catch (e) {
+            sb("Could not rename file");
+            console.error("Could not rename file. Error:", e);
+        }
+    }
     if (action == "download")
         NB(uc);
 }